@@ -0,0 +1,69 @@
+#include "bench.hpp"
+#include <cstdio>
+#include <utility>
+
+namespace {
+std::vector<bench::Result> all_results;
+std::vector<bench::Binary> all_binaries;
+
+void put_string(std::FILE *file, const std::string &text) {
+  std::fputc('"', file);
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(c, file);
+  }
+  std::fputc('"', file);
+}
+} // namespace
+
+void bench::report(const char *name, const char *metric, double value) {
+  std::printf("%-32s %-24s %14.2f\n", name, metric, value);
+  std::fflush(stdout);
+  all_results.push_back({name, metric, value});
+}
+
+const std::vector<bench::Result> &bench::results() { return all_results; }
+
+bool bench::write_json(const char *path) {
+  std::FILE *file = std::fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+
+  std::fputs("{\n  \"results\": [", file);
+  for (size_t i = 0; i < all_results.size(); ++i) {
+    const auto &result = all_results[i];
+    std::fputs(i == 0 ? "\n    {\"name\": " : ",\n    {\"name\": ", file);
+    put_string(file, result.name);
+    std::fputs(", \"metric\": ", file);
+    put_string(file, result.metric);
+    std::fprintf(file, ", \"value\": %.6g}", result.value);
+  }
+  std::fprintf(file, "\n  ],\n  \"peak_memory_kib\": %ld\n}\n",
+               peak_memory_kib());
+
+  return std::fclose(file) == 0;
+}
+
+long bench::peak_memory_kib() {
+  long peak = 0;
+  std::FILE *status = std::fopen("/proc/self/status", "r");
+  if (status == nullptr) {
+    return peak;
+  }
+
+  char line[128];
+  while (std::fgets(line, sizeof(line), status) != nullptr) {
+    std::sscanf(line, "VmHWM: %ld", &peak);
+  }
+  std::fclose(status);
+  return peak;
+}
+
+const std::vector<bench::Binary> &bench::binaries() { return all_binaries; }
+
+void bench::add_binary(Binary binary) {
+  all_binaries.push_back(std::move(binary));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace bench {
+using clock = std::chrono::steady_clock;
+
+inline double seconds_since(clock::time_point start) {
+  return std::chrono::duration<double>(clock::now() - start).count();
+}
+
+// prints a result and keeps it for the JSON output
+void report(const char *name, const char *metric, double value);
+
+struct Result {
+  std::string name;
+  std::string metric;
+  double value;
+};
+const std::vector<Result> &results();
+// {"results": [{"name", "metric", "value"}...], "peak_memory_kib"}
+bool write_json(const char *path);
+
+// peak resident memory of the process (VmHWM), 0 where it can't be read
+long peak_memory_kib();
+
+// raw 6502 binaries passed with --bin, run by the workloads benchmark
+struct Binary {
+  std::string path;
+  uint16_t org;
+};
+const std::vector<Binary> &binaries();
+void add_binary(Binary binary);
+
+// NROM image of a game-like main loop: rendering and NMI on, the NMI handler
+// sets the scroll every frame
+std::vector<uint8_t> demo_rom();
+
+// writes 16-bit mono samples to a WAV file
+bool write_wav(const char *path, const std::vector<int16_t> &samples,
+               uint32_t sample_rate);
+} // namespace bench
+
+// benchmarks
+void bench_dispatch();
+void bench_workloads();
+void bench_bus();
+void bench_rom();
+void bench_mapper();
+void bench_ppu();
+void bench_sync();
+void bench_pipeline();
+void bench_display();
+void bench_apu();
+void bench_state();
+void bench_idle();
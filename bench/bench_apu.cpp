@@ -0,0 +1,95 @@
+#include "../lib/apu/apu.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace {
+constexpr uint32_t SECONDS = 10;
+constexpr uint32_t FRAMES = SECONDS * 60;
+constexpr uint32_t FRAME_CYCLES = 29781;
+constexpr uint32_t FRAMES_PER_NOTE = 8;
+constexpr const char *WAV_PATH = "apu.wav";
+
+// pulse timer periods of a C major scale from C4
+constexpr uint16_t SCALE[8] = {427, 380, 338, 319, 284, 253, 225, 213};
+
+// what a music driver does once a frame in the NMI: a melody on pulse 1,
+// arpeggios on pulse 2, a bass line on the triangle and hi-hats on the noise
+void play(APU &apu, uint32_t frame) {
+  if (frame == 0) {
+    apu.write_register(0x4015, 0x0f);
+    apu.write_register(0x4001, 0x08);
+    apu.write_register(0x4005, 0x08);
+    apu.write_register(0x4008, 0xff);
+  }
+
+  uint32_t note = frame / FRAMES_PER_NOTE;
+  if (frame % FRAMES_PER_NOTE == 0) {
+    uint16_t melody = SCALE[(note * 3) % 8];
+    apu.write_register(0x4000, 0x84); // 50% duty, decaying envelope
+    apu.write_register(0x4002, melody & 0xff);
+    apu.write_register(0x4003, 0x08 | (melody >> 8));
+
+    uint16_t bass = SCALE[(note / 4) % 8];
+    apu.write_register(0x400a, bass & 0xff);
+    apu.write_register(0x400b, 0x08 | (bass >> 8));
+
+    apu.write_register(0x400c, 0x01); // short decay
+    apu.write_register(0x400e, note % 2 ? 0x03 : 0x8a);
+    apu.write_register(0x400f, 0x08);
+  }
+
+  uint16_t arpeggio = SCALE[(note + frame % 3 * 2) % 8] / 2;
+  apu.write_register(0x4004, 0x56); // 25% duty, constant volume
+  apu.write_register(0x4006, arpeggio & 0xff);
+  apu.write_register(0x4007, 0x08 | (arpeggio >> 8));
+}
+
+// the writes land at the start of the frame, the APU is run in `step` cycle
+// slices (1 is what ticking it alongside the CPU would cost)
+double synthesize(uint32_t sample_rate, uint32_t step,
+                  std::vector<int16_t> *out) {
+  APU apu(sample_rate);
+  apu.set_sample_handler(
+      [](void *context, const int16_t *samples, size_t count) {
+        auto *out = static_cast<std::vector<int16_t> *>(context);
+        if (out != nullptr) {
+          out->insert(out->end(), samples, samples + count);
+        }
+      },
+      out);
+
+  uint64_t cycle = 0;
+  auto start = bench::clock::now();
+  for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+    play(apu, frame);
+    uint64_t end = cycle + FRAME_CYCLES;
+    for (; step > 0 && cycle + step < end; cycle += step) {
+      apu.run_to(cycle);
+    }
+    cycle = end;
+    apu.end_frame(cycle);
+  }
+  return bench::seconds_since(start);
+}
+} // namespace
+
+void bench_apu() {
+  std::vector<int16_t> samples;
+  double block = synthesize(44100, 0, &samples);
+  double block_22k = synthesize(22050, 0, nullptr);
+  double ticked = synthesize(44100, 1, nullptr);
+
+  bench::report("apu/block 44100 Hz", "ms / emulated s",
+                1000 * block / SECONDS);
+  bench::report("apu/block 22050 Hz", "ms / emulated s",
+                1000 * block_22k / SECONDS);
+  bench::report("apu/ticked every cycle", "ms / emulated s",
+                1000 * ticked / SECONDS);
+  bench::report("apu/block", "speedup", ticked / block);
+
+  if (bench::write_wav(WAV_PATH, samples, 44100)) {
+    std::printf("%-32s wrote %s, %zu samples\n", "apu/wav", WAV_PATH,
+                samples.size());
+  }
+}
@@ -0,0 +1,69 @@
+#include "../lib/bus/bus.hpp"
+#include "bench.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace {
+constexpr uint32_t ACCESSES = 50'000'000;
+
+// the flat 64 KiB bus the page table replaced, kept to compare against. its
+// accessors lived in bus.cpp, so they are kept out of line here as well
+class FlatBus {
+public:
+  [[gnu::noinline]] uint8_t mem_read(uint16_t addr) {
+    if (addr <= 0x1fff) {
+      addr = addr & 0b0000011111111111;
+    }
+
+    return ram[addr];
+  }
+  [[gnu::noinline]] void mem_write(uint16_t addr, uint8_t data) {
+    ram[addr] = data;
+  }
+
+private:
+  std::array<uint8_t, 65536> ram{};
+};
+
+// walks zero page, stack, RAM mirrors and ROM the way a game loop would
+template <typename B> double run_reads(B &bus) {
+  uint32_t sum = 0;
+  auto start = bench::clock::now();
+  for (uint32_t i = 0; i < ACCESSES; ++i) {
+    uint16_t addr = (i & 1) ? static_cast<uint16_t>(i & 0x1fff)
+                            : static_cast<uint16_t>(0x8000 | (i & 0x7fff));
+    sum += bus.mem_read(addr);
+  }
+  double seconds = bench::seconds_since(start);
+
+  // keeps the loop from being optimized away
+  if (sum == 1) {
+    std::printf("\n");
+  }
+  return ACCESSES / seconds;
+}
+
+template <typename B> double run_writes(B &bus) {
+  auto start = bench::clock::now();
+  for (uint32_t i = 0; i < ACCESSES; ++i) {
+    bus.mem_write(static_cast<uint16_t>(i & 0x1fff), static_cast<uint8_t>(i));
+  }
+  double seconds = bench::seconds_since(start);
+  return ACCESSES / seconds;
+}
+} // namespace
+
+void bench_bus() {
+  auto flat = std::make_unique<FlatBus>();
+  auto paged = std::make_unique<Bus>();
+  static uint8_t rom[0x8000];
+  paged->map_rom(0x8000, sizeof(rom), rom);
+
+  bench::report("bus/flat", "reads/s", run_reads(*flat));
+  bench::report("bus/paged", "reads/s", run_reads(*paged));
+  bench::report("bus/flat", "writes/s", run_writes(*flat));
+  bench::report("bus/paged", "writes/s", run_writes(*paged));
+  bench::report("bus/flat", "bytes", sizeof(FlatBus));
+  bench::report("bus/paged", "bytes", sizeof(Bus));
+}
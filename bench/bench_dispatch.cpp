@@ -0,0 +1,58 @@
+#include "../lib/cpu/cpu.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace {
+constexpr uint32_t INSTRUCTIONS = 20'000'000;
+
+// 11 instructions per iteration covering immediate, zero page, accumulator
+// and implied handlers, closed by an absolute jump back to the start
+const std::vector<uint8_t> LOOP = {
+    0xa9, 0x01,       // LDA #$01
+    0x85, 0x10,       // STA $10
+    0xe6, 0x10,       // INC $10
+    0xa6, 0x10,       // LDX $10
+    0xe8,             // INX
+    0x8a,             // TXA
+    0x49, 0xff,       // EOR #$ff
+    0x0a,             // ASL A
+    0x48,             // PHA
+    0x68,             // PLA
+    0x4c, 0x00, 0x80, // JMP $8000
+};
+} // namespace
+
+void bench_dispatch() {
+  CPU table_cpu;
+  table_cpu.load_program(LOOP);
+
+  auto start = bench::clock::now();
+  for (uint32_t i = 0; i < INSTRUCTIONS; ++i) {
+    table_cpu.step();
+  }
+  double table_seconds = bench::seconds_since(start);
+
+  CPU run_cpu;
+  run_cpu.load_program(LOOP);
+
+  start = bench::clock::now();
+  run_cpu.run(INSTRUCTIONS);
+  double run_seconds = bench::seconds_since(start);
+
+  bench::report("dispatch/table (step)", "instructions/s",
+                INSTRUCTIONS / table_seconds);
+#if NES_THREADED_DISPATCH
+  bench::report("dispatch/threaded (run)", "instructions/s",
+                INSTRUCTIONS / run_seconds);
+#else
+  bench::report("dispatch/table (run)", "instructions/s",
+                INSTRUCTIONS / run_seconds);
+#endif
+
+  if (table_cpu.get_pc() != run_cpu.get_pc() ||
+      table_cpu.get_reg_a() != run_cpu.get_reg_a() ||
+      table_cpu.get_status() != run_cpu.get_status()) {
+    std::printf("dispatch: engines diverged\n");
+  }
+}
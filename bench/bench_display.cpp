@@ -0,0 +1,117 @@
+#include "../lib/display/display.hpp"
+#include "../lib/display/rgb565.hpp"
+#include "../lib/nes/nes.hpp"
+#include "bench.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace {
+constexpr uint32_t LINES = 2000000;
+constexpr uint32_t FRAMES = 600;
+constexpr uint16_t HUD_LINES = 32;
+
+using Line = std::array<uint8_t, PPU::WIDTH>;
+
+// a tiled background, shifted `scroll` pixels to the left
+void background(Line &line, uint16_t y, uint32_t scroll) {
+  for (uint16_t x = 0; x < PPU::WIDTH; ++x) {
+    uint32_t tile = ((x + scroll) >> 3) + (y >> 3) * 7;
+    line[x] = 0x0f + (tile % 5) * 0x10 - (((x + scroll) ^ y) & 4 ? 0 : 0x0e);
+  }
+}
+
+template <typename Convert>
+uint64_t convert(const char *name, Convert routine) {
+  Line line;
+  background(line, 0, 0);
+  std::array<uint16_t, PPU::WIDTH> pixels;
+  uint64_t checksum = 0;
+
+  auto start = bench::clock::now();
+  for (uint32_t i = 0; i < LINES; ++i) {
+    line[i & 0xff] = i & 0x3f;
+    routine(line.data(), pixels.data());
+    checksum += pixels[i & 0xff];
+  }
+  double seconds = bench::seconds_since(start);
+
+  bench::report(name, "Mpixels/s", LINES * double{PPU::WIDTH} / seconds / 1e6);
+  return checksum;
+}
+
+// the whole scene goes through the output stage, the counting display tells
+// what a SPI panel would have been sent
+template <typename Scene> void scene(const char *name, Scene draw) {
+  CountingDisplay display;
+  DisplayOutput output(display, ByteOrder::Big);
+  Line line;
+
+  for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+    for (uint16_t y = 0; y < PPU::HEIGHT; ++y) {
+      draw(line, frame, y);
+      output.present_line(y, line.data());
+    }
+  }
+
+  std::string label = std::string("display/") + name;
+  bench::report(label.c_str(), "KiB/frame",
+                double(display.get_bytes()) / FRAMES / 1024);
+  bench::report(label.c_str(), "saved %",
+                100 - 100.0 * display.get_bytes() / display.get_full_bytes());
+}
+} // namespace
+
+void bench_display() {
+  Rgb565Palette palette(ByteOrder::Big);
+  convert("display/convert scalar", [&](const uint8_t *in, uint16_t *out) {
+    palette.convert_scalar(in, out, PPU::WIDTH);
+  });
+  convert("display/convert packed", [&](const uint8_t *in, uint16_t *out) {
+    palette.convert_packed(in, out, PPU::WIDTH);
+  });
+#if NES_RGB565_SSSE3
+  if (Rgb565Palette::has_ssse3()) {
+    convert("display/convert ssse3", [&](const uint8_t *in, uint16_t *out) {
+      palette.convert_ssse3(in, out, PPU::WIDTH);
+    });
+  }
+#endif
+
+  // title screens, pause menus, text boxes
+  scene("static", [](Line &line, uint32_t, uint16_t y) {
+    background(line, y, 0);
+  });
+  // a 16x16 sprite walking over a still background
+  scene("sprite", [](Line &line, uint32_t frame, uint16_t y) {
+    background(line, y, 0);
+    uint16_t top = 120 + (frame / 4) % 32;
+    if (y >= top && y < top + 16) {
+      for (uint16_t x = 0; x < 16; ++x) {
+        line[(frame + x) & 0xff] = 0x16;
+      }
+    }
+  });
+  // a side scroller: still status bar, the playfield scrolls every frame
+  scene("scrolling", [](Line &line, uint32_t frame, uint16_t y) {
+    background(line, y, y < HUD_LINES ? 0 : frame);
+  });
+
+  // the demo ROM, NMI every frame and the scroll rewritten
+  auto image = bench::demo_rom();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  CountingDisplay display;
+  DisplayOutput output(display, ByteOrder::Big);
+  nes.get_ppu().set_scanline_handler(
+      [](void *context, uint16_t y, const uint8_t *pixels) {
+        static_cast<DisplayOutput *>(context)->present_line(y, pixels);
+      },
+      &output);
+  for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+    nes.run_frame();
+  }
+  bench::report("display/demo rom", "KiB/frame",
+                double(display.get_bytes()) / display.get_frames() / 1024);
+  bench::report("display/demo rom", "saved %",
+                100 - 100.0 * display.get_bytes() / display.get_full_bytes());
+}
@@ -0,0 +1,114 @@
+#include "../lib/cpu/cpu.hpp"
+#include "../lib/nes/nes.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint32_t FRAMES = 3000;
+constexpr uint32_t FRAME_CYCLES = 29781;
+
+// NROM loop of a game that waits for the NMI: a few thousand cycles of work
+// once per frame, then polls the frame counter the NMI handler bumps
+const uint8_t PROGRAM[] = {
+    0x78,             // 8000: SEI
+    0xa2, 0xff,       // 8001: LDX #$ff
+    0x9a,             // 8003: TXS
+    0x2c, 0x02, 0x20, // 8004: BIT $2002
+    0x10, 0xfb,       // 8007: BPL $8004
+    0xa9, 0x1e,       // 8009: LDA #$1e
+    0x8d, 0x01, 0x20, // 800b: STA $2001
+    0xa9, 0x80,       // 800e: LDA #$80
+    0x8d, 0x00, 0x20, // 8010: STA $2000
+    0xa5, 0x00,       // 8013: LDA $00
+    0x45, 0x03,       // 8015: EOR $03
+    0xf0, 0xfa,       // 8017: BEQ $8013
+    0xa5, 0x00,       // 8019: LDA $00
+    0x85, 0x03,       // 801b: STA $03
+    0xa0, 0x00,       // 801d: LDY #$00
+    0xb9, 0x00, 0x03, // 801f: LDA $0300,Y
+    0x99, 0x00, 0x04, // 8022: STA $0400,Y
+    0x88,             // 8025: DEY
+    0xd0, 0xf7,       // 8026: BNE $801f
+    0x4c, 0x13, 0x80, // 8028: JMP $8013
+    0xe6, 0x00,       // 802b: INC $00
+    0xad, 0x02, 0x20, // 802d: LDA $2002
+    0xa5, 0x00,       // 8030: LDA $00
+    0x8d, 0x05, 0x20, // 8032: STA $2005
+    0x8d, 0x05, 0x20, // 8035: STA $2005
+    0x40,             // 8038: RTI
+};
+constexpr uint16_t MAIN_LOOP = 0x8013;
+constexpr uint16_t NMI_HANDLER = 0x802b;
+
+std::vector<uint8_t> waiting_rom() {
+  auto image = bench::demo_rom();
+  uint8_t *prg = image.data() + ines::HEADER_SIZE;
+  std::memset(prg, 0xea, 0x100);
+  std::memcpy(prg, PROGRAM, sizeof(PROGRAM));
+  prg[0x7ffa] = NMI_HANDLER & 0xff;
+  prg[0x7ffb] = NMI_HANDLER >> 8;
+  return image;
+}
+
+// the CPU alone on the same loop, the frame counter bumped in between frames
+// in place of the NMI: what the skipping saves without the PPU's share
+void run_cpu(const std::string &name, const std::vector<uint8_t> &image) {
+  // no PPU to wait for, it starts at the main loop
+  std::vector<uint8_t> prg(image.begin() + ines::HEADER_SIZE, image.end());
+  prg[0x7ffc] = MAIN_LOOP & 0xff;
+  prg[0x7ffd] = MAIN_LOOP >> 8;
+  double seconds[2];
+  uint64_t skipped = 0;
+  for (int skip = 0; skip < 2; ++skip) {
+    CPU cpu;
+    cpu.set_idle_skip(skip);
+    cpu.get_bus().map_rom(0x8000, 0x8000, prg.data());
+    cpu.reset();
+    auto start = bench::clock::now();
+    for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+      cpu.get_bus().mem_write(0x00, static_cast<uint8_t>(frame));
+      cpu.run_cycles(FRAME_CYCLES);
+    }
+    seconds[skip] = bench::seconds_since(start);
+    skipped = cpu.get_idle_stats().skipped_cycles;
+  }
+
+  double per_frame = static_cast<double>(skipped) / FRAMES;
+  bench::report(name.c_str(), "frame us off", seconds[0] / FRAMES * 1e6);
+  bench::report(name.c_str(), "frame us on", seconds[1] / FRAMES * 1e6);
+  bench::report(name.c_str(), "speedup", seconds[0] / seconds[1]);
+  bench::report(name.c_str(), "skipped cycles/frame", per_frame);
+}
+
+void run(const std::string &name, const std::vector<uint8_t> &image) {
+  double seconds[2];
+  uint64_t skipped = 0;
+  for (int skip = 0; skip < 2; ++skip) {
+    NES nes(RomImage::from_memory(image.data(), image.size()));
+    nes.get_cpu().set_idle_skip(skip);
+    auto start = bench::clock::now();
+    for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+      nes.run_frame();
+      skipped += nes.get_frame_idle_cycles();
+    }
+    seconds[skip] = bench::seconds_since(start);
+  }
+
+  double per_frame = static_cast<double>(skipped) / FRAMES;
+  bench::report(name.c_str(), "frame us off", seconds[0] / FRAMES * 1e6);
+  bench::report(name.c_str(), "frame us on", seconds[1] / FRAMES * 1e6);
+  bench::report(name.c_str(), "speedup", seconds[0] / seconds[1]);
+  bench::report(name.c_str(), "skipped cycles/frame", per_frame);
+  bench::report(name.c_str(), "skipped %", per_frame / FRAME_CYCLES * 100);
+}
+} // namespace
+
+void bench_idle() {
+  auto image = waiting_rom();
+  run_cpu("idle/cpu waits for nmi", image);
+  run("idle/waits for nmi", image);
+  run("idle/demo rom", bench::demo_rom());
+}
@@ -0,0 +1,65 @@
+#include "../lib/cartridge/cartridge.hpp"
+#include "../lib/cpu/cpu.hpp"
+#include "../lib/mapper/mapper.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr uint32_t ITERATIONS = 2'000'000;
+constexpr uint32_t INSTRUCTIONS_PER_ITERATION = 5;
+
+// 128 KiB UxROM image running a loop from the fixed bank at 0xc000 that
+// stores X to `target` and then reads from the switchable bank
+std::vector<uint8_t> make_image(uint16_t target) {
+  std::vector<uint8_t> image(ines::HEADER_SIZE + 8 * ines::PRG_ROM_UNIT);
+  std::memcpy(image.data(), "NES\x1a", 4);
+  image[4] = 8;
+  image[6] = 0x20;
+
+  uint8_t *last_bank =
+      image.data() + ines::HEADER_SIZE + 7 * ines::PRG_ROM_UNIT;
+  auto low = static_cast<uint8_t>(target & 0xff);
+  auto high = static_cast<uint8_t>(target >> 8);
+  const uint8_t loop[] = {
+      0xe8,             // INX
+      0x8e, low, high,  // STX target
+      0xad, 0x00, 0x80, // LDA $8000
+      0x85, 0x10,       // STA $10
+      0x4c, 0x00, 0xc0, // JMP $c000
+  };
+  std::memcpy(last_bank, loop, sizeof(loop));
+  last_bank[0x3ffc] = 0x00;
+  last_bank[0x3ffd] = 0xc0;
+  return image;
+}
+
+double run(uint16_t target) {
+  auto image = make_image(target);
+  Cartridge cartridge(RomImage::from_memory(image.data(), image.size()));
+  auto mapper = make_mapper(cartridge);
+
+  CPU cpu;
+  mapper->attach(cpu.get_bus());
+  cpu.reset();
+
+  auto start = bench::clock::now();
+  cpu.run(ITERATIONS * INSTRUCTIONS_PER_ITERATION);
+  return bench::seconds_since(start);
+}
+} // namespace
+
+void bench_mapper() {
+  double ram_seconds = run(0x0200);
+  double switch_seconds = run(0x8000);
+
+  bench::report("mapper/ram store", "instructions/s",
+                ITERATIONS * INSTRUCTIONS_PER_ITERATION / ram_seconds);
+  bench::report("mapper/bank switch", "instructions/s",
+                ITERATIONS * INSTRUCTIONS_PER_ITERATION / switch_seconds);
+  bench::report("mapper/bank switch", "switches/s",
+                ITERATIONS / switch_seconds);
+  bench::report("mapper/bank switch", "ns per switch",
+                (switch_seconds - ram_seconds) / ITERATIONS * 1e9);
+}
@@ -0,0 +1,106 @@
+#include "../lib/nes/nes.hpp"
+#include "../lib/pipeline/pipeline.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+constexpr uint32_t FRAMES = 600;
+constexpr uint32_t SLOW_FRAMES = 120;
+// per line cost of a display slower than the emulation (ex: an SPI LCD)
+constexpr uint64_t SLOW_LINE_US = 20;
+
+struct Sink {
+  uint64_t checksum = 0;
+  uint64_t line_us = 0;
+};
+
+void consume(void *context, const Scanline &line) {
+  auto *sink = static_cast<Sink *>(context);
+  for (uint8_t pixel : line.pixels) {
+    sink->checksum += pixel;
+  }
+
+  if (sink->line_us > 0) {
+    uint64_t until = Worker::now_us() + sink->line_us;
+    while (Worker::now_us() < until) {
+    }
+  }
+}
+
+// emulation and output on the same thread
+double run_serial(const std::vector<uint8_t> &image) {
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  Sink sink;
+  static Scanline line;
+  nes.get_ppu().set_scanline_handler(
+      [](void *context, uint16_t y, const uint8_t *pixels) {
+        line.y = y;
+        std::copy(pixels, pixels + PPU::WIDTH, line.pixels.begin());
+        consume(context, line);
+      },
+      &sink);
+
+  auto start = bench::clock::now();
+  for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+    nes.run_frame();
+  }
+  return bench::seconds_since(start);
+}
+
+struct Result {
+  double seconds;
+  double latency_us;
+  double latency_max_us;
+  double dropped;
+};
+
+Result run_pipeline(const std::vector<uint8_t> &image, Backpressure policy,
+                    uint32_t frames, uint64_t line_us) {
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  Sink sink;
+  sink.line_us = line_us;
+  Pipeline pipeline(nes, policy);
+  pipeline.set_line_sink(consume, &sink);
+
+  auto start = bench::clock::now();
+  pipeline.start(frames);
+  pipeline.join();
+  double seconds = bench::seconds_since(start);
+
+  const auto &stats = pipeline.get_stats();
+  uint64_t presented = stats.frames_presented.load();
+  return {seconds,
+          presented > 0
+              ? static_cast<double>(stats.latency_total_us.load()) / presented
+              : 0,
+          static_cast<double>(stats.latency_max_us.load()),
+          static_cast<double>(stats.frames_dropped.load())};
+}
+} // namespace
+
+void bench_pipeline() {
+  auto image = bench::demo_rom();
+  double serial = run_serial(image);
+  Result wait = run_pipeline(image, Backpressure::Wait, FRAMES, 0);
+  Result slow_wait =
+      run_pipeline(image, Backpressure::Wait, SLOW_FRAMES, SLOW_LINE_US);
+  Result slow_drop =
+      run_pipeline(image, Backpressure::Drop, SLOW_FRAMES, SLOW_LINE_US);
+
+  bench::report("pipeline/serial", "frames/s", FRAMES / serial);
+  bench::report("pipeline/wait", "frames/s", FRAMES / wait.seconds);
+  bench::report("pipeline/wait", "latency us", wait.latency_us);
+  bench::report("pipeline/wait", "max latency us", wait.latency_max_us);
+  bench::report("pipeline/slow display wait", "frames/s",
+                SLOW_FRAMES / slow_wait.seconds);
+  bench::report("pipeline/slow display wait", "latency us",
+                slow_wait.latency_us);
+  bench::report("pipeline/slow display drop", "frames/s",
+                SLOW_FRAMES / slow_drop.seconds);
+  bench::report("pipeline/slow display drop", "latency us",
+                slow_drop.latency_us);
+  bench::report("pipeline/slow display drop", "dropped %",
+                100 * slow_drop.dropped / SLOW_FRAMES);
+}
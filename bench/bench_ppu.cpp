@@ -0,0 +1,111 @@
+#include "../lib/cartridge/cartridge.hpp"
+#include "../lib/mapper/mapper.hpp"
+#include "../lib/ppu/ppu.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr uint32_t FRAMES = 2000;
+
+// CNROM image with 2 banks of 8 KiB CHR-ROM holding pseudo random tiles
+std::vector<uint8_t> make_image() {
+  std::vector<uint8_t> image(ines::HEADER_SIZE + 2 * ines::PRG_ROM_UNIT +
+                             2 * ines::CHR_ROM_UNIT);
+  std::memcpy(image.data(), "NES\x1a", 4);
+  image[4] = 2;
+  image[5] = 2;
+  image[6] = 0x30;
+
+  uint8_t *chr = image.data() + ines::HEADER_SIZE + 2 * ines::PRG_ROM_UNIT;
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < 2 * ines::CHR_ROM_UNIT; ++i) {
+    seed = seed * 1103515245 + 12345;
+    chr[i] = seed >> 24;
+  }
+  return image;
+}
+
+// fills both visible nametables with distinct tiles and OAM with 64 sprites,
+// 8 per row band so no line overflows
+void fill_screen(PPU &ppu, Bus &bus) {
+  for (uint16_t addr = 0x2000; addr < 0x2800; ++addr) {
+    ppu.mem_write(addr, addr * 7);
+  }
+  for (uint16_t addr = 0x3f00; addr < 0x3f20; ++addr) {
+    ppu.mem_write(addr, addr & 0x3f);
+  }
+
+  bus.mem_write(0x2003, 0);
+  for (uint8_t i = 0; i < 64; ++i) {
+    bus.mem_write(0x2004, (i / 8) * 28 + 8); // y
+    bus.mem_write(0x2004, i);                // tile
+    bus.mem_write(0x2004, i & 0xe3);         // palette, priority, flips
+    bus.mem_write(0x2004, (i % 8) * 30);     // x
+  }
+
+  bus.mem_write(0x2000, ppu_ctrl::SPRITE_TABLE);
+  bus.mem_write(0x2001, ppu_mask::BACKGROUND | ppu_mask::SPRITES |
+                            ppu_mask::BACKGROUND_LEFT |
+                            ppu_mask::SPRITES_LEFT);
+}
+
+struct Result {
+  double seconds;
+  double tiles_per_frame;
+};
+
+// `switch_banks` flips the CHR bank every frame, forcing the cache to decode
+// again
+Result run(bool switch_banks) {
+  auto image = make_image();
+  Cartridge cartridge(RomImage::from_memory(image.data(), image.size()));
+  auto mapper = make_mapper(cartridge);
+  Bus bus;
+  mapper->attach(bus);
+  PPU ppu(*mapper);
+  ppu.attach(bus);
+  fill_screen(ppu, bus);
+
+  uint64_t checksum = 0;
+  ppu.set_scanline_handler(
+      [](void *context, uint16_t, const uint8_t *pixels) {
+        *static_cast<uint64_t *>(context) += pixels[0] + pixels[255];
+      },
+      &checksum);
+
+  ppu.render_frame(); // warm up the tile cache
+  uint64_t tiles_decoded = ppu.get_tiles_decoded();
+
+  auto start = bench::clock::now();
+  for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+    // scroll a pixel per frame
+    bus.mem_write(0x2005, frame);
+    bus.mem_write(0x2005, 0);
+    if (switch_banks) {
+      bus.mem_write(0x8000, frame & 1);
+    }
+    ppu.render_frame();
+  }
+  double seconds = bench::seconds_since(start);
+
+  if (checksum == 0) {
+    std::printf("blank output\n");
+  }
+  return {seconds,
+          static_cast<double>(ppu.get_tiles_decoded() - tiles_decoded) /
+              FRAMES};
+}
+} // namespace
+
+void bench_ppu() {
+  Result cached = run(false);
+  Result switching = run(true);
+
+  bench::report("ppu/cached", "frames/s", FRAMES / cached.seconds);
+  bench::report("ppu/cached", "tiles decoded/frame", cached.tiles_per_frame);
+  bench::report("ppu/bank switch", "frames/s", FRAMES / switching.seconds);
+  bench::report("ppu/bank switch", "tiles decoded/frame",
+                switching.tiles_per_frame);
+}
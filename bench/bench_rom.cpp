@@ -0,0 +1,132 @@
+#include "../lib/cartridge/cartridge.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr int LOADS = 200;
+constexpr size_t PRG_UNITS = 16; // 256 KiB of PRG-ROM
+constexpr size_t IMAGE_SIZE =
+    ines::HEADER_SIZE + PRG_UNITS * ines::PRG_ROM_UNIT;
+
+// resident anonymous (heap, stack) and file backed memory, in KiB
+struct Resident {
+  long anon;
+  long file;
+};
+
+Resident resident() {
+  Resident r = {0, 0};
+  FILE *status = std::fopen("/proc/self/status", "r");
+  if (status == nullptr) {
+    return r;
+  }
+
+  char line[128];
+  while (std::fgets(line, sizeof(line), status) != nullptr) {
+    std::sscanf(line, "RssAnon: %ld", &r.anon);
+    std::sscanf(line, "RssFile: %ld", &r.file);
+  }
+  std::fclose(status);
+  return r;
+}
+
+Resident resident_since(const Resident &before) {
+  auto now = resident();
+  return {now.anon - before.anon, now.file - before.file};
+}
+
+// empty if the file can't be opened
+std::vector<uint8_t> read_file(const char *path) {
+  std::vector<uint8_t> data(IMAGE_SIZE);
+  FILE *file = std::fopen(path, "rb");
+  if (file == nullptr) {
+    return {};
+  }
+  data.resize(std::fread(data.data(), 1, data.size(), file));
+  std::fclose(file);
+  return data;
+}
+
+// touches every page of PRG-ROM the way running the game eventually would
+uint32_t touch(const uint8_t *data, size_t size) {
+  uint32_t sum = 0;
+  for (size_t i = 0; i < size; i += 64) {
+    sum += data[i];
+  }
+  return sum;
+}
+} // namespace
+
+void bench_rom() {
+  std::vector<uint8_t> image(IMAGE_SIZE);
+  std::memcpy(image.data(), "NES\x1a", 4);
+  image[4] = PRG_UNITS;
+  image[6] = 0x20; // mapper 2 (UxROM)
+  for (size_t i = ines::HEADER_SIZE; i < image.size(); ++i) {
+    image[i] = static_cast<uint8_t>(i * 31);
+  }
+
+  char path[] = "/tmp/nes-bench-rom-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || write(fd, image.data(), image.size()) !=
+                    static_cast<ssize_t>(image.size())) {
+    std::printf("rom: failed to write %s\n", path);
+    return;
+  }
+  close(fd);
+  std::vector<uint8_t>().swap(image);
+
+  uint32_t sum = 0;
+
+  // resident memory is measured before the timing loops have warmed up the
+  // allocator. the copy is what load_program amounted to: the whole image on
+  // the heap
+  auto before = resident();
+  std::vector<uint8_t> copy = read_file(path);
+  if (copy.size() != IMAGE_SIZE) {
+    std::printf("rom: failed to read %s\n", path);
+    std::remove(path);
+    return;
+  }
+  sum += touch(copy.data(), copy.size());
+  auto copy_resident = resident_since(before);
+  std::vector<uint8_t>().swap(copy);
+
+  before = resident();
+  Resident map_resident;
+  {
+    Cartridge cartridge(RomImage::map_file(path));
+    sum += touch(cartridge.get_prg_rom(), cartridge.get_prg_rom_size());
+    map_resident = resident_since(before);
+  }
+
+  auto start = bench::clock::now();
+  for (int i = 0; i < LOADS; ++i) {
+    copy = read_file(path);
+    sum += copy[ines::HEADER_SIZE];
+  }
+  double copy_seconds = bench::seconds_since(start) / LOADS;
+
+  start = bench::clock::now();
+  for (int i = 0; i < LOADS; ++i) {
+    Cartridge cartridge(RomImage::map_file(path));
+    sum += cartridge.get_prg_rom()[0];
+  }
+  double map_seconds = bench::seconds_since(start) / LOADS;
+
+  bench::report("rom/copy", "load us", copy_seconds * 1e6);
+  bench::report("rom/copy", "anon resident KiB", copy_resident.anon);
+  bench::report("rom/copy", "file resident KiB", copy_resident.file);
+  bench::report("rom/mapped", "load us", map_seconds * 1e6);
+  bench::report("rom/mapped", "anon resident KiB", map_resident.anon);
+  bench::report("rom/mapped", "file resident KiB", map_resident.file);
+
+  std::remove(path);
+  // keeps the reads from being optimized away
+  volatile uint32_t sink = sum;
+  (void)sink;
+}
@@ -0,0 +1,165 @@
+#include "../lib/cpu/cpu.hpp"
+#include "../lib/nes/nes.hpp"
+#include "../lib/state/rewind.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint32_t REPEATS = 20000;
+constexpr uint32_t FRAMES = 600;
+constexpr uint32_t FRAME_CYCLES = 29781;
+constexpr size_t REWIND_BUDGET = 256 << 10;
+constexpr uint32_t REWIND_SECONDS = 60;
+
+// stores to the work RAM a game keeps its objects in, $0300..$04ff, and
+// counts frames in the zero page
+const std::vector<uint8_t> OBJECT_UPDATE = {
+    0xa2, 0x00,       // 8000: LDX #$00
+    0xbd, 0x00, 0x03, // 8002: LDA $0300,X
+    0xe8,             // 8005: INX
+    0x9d, 0x00, 0x03, // 8006: STA $0300,X
+    0x9d, 0x00, 0x04, // 8009: STA $0400,X
+    0xd0, 0xf4,       // 800c: BNE $8002
+    0xe6, 0x10,       // 800e: INC $10
+    0x4c, 0x00, 0x80, // 8010: JMP $8000
+};
+
+// full save and restore, `frame` runs one frame between deltas
+template <typename Frame>
+void run(const std::string &name, CPU &cpu, Frame frame) {
+  std::vector<uint8_t> full;
+  auto start = bench::clock::now();
+  for (uint32_t i = 0; i < REPEATS; ++i) {
+    full = cpu.save_state(state::Kind::Full);
+  }
+  double save_seconds = bench::seconds_since(start);
+
+  start = bench::clock::now();
+  for (uint32_t i = 0; i < REPEATS; ++i) {
+    cpu.load_state(full);
+  }
+  double load_seconds = bench::seconds_since(start);
+
+  bench::report(name.c_str(), "full bytes", full.size());
+  bench::report(name.c_str(), "full save us", save_seconds / REPEATS * 1e6);
+  bench::report(name.c_str(), "full load us", load_seconds / REPEATS * 1e6);
+
+  // a delta every frame, then one every second on top of the full state
+  uint64_t delta_bytes = 0;
+  double delta_seconds = 0;
+  for (uint32_t i = 0; i < FRAMES; ++i) {
+    frame();
+    start = bench::clock::now();
+    delta_bytes += cpu.save_state(state::Kind::Delta).size();
+    delta_seconds += bench::seconds_since(start);
+  }
+  bench::report(name.c_str(), "frame delta bytes",
+                static_cast<double>(delta_bytes) / FRAMES);
+  bench::report(name.c_str(), "frame delta us", delta_seconds / FRAMES * 1e6);
+
+  for (uint32_t i = 0; i < 60; ++i) {
+    frame();
+  }
+  bench::report(name.c_str(), "second delta bytes",
+                cpu.save_state(state::Kind::Delta).size());
+}
+
+// a snapshot pushed every frame, then rewound one frame at a time
+template <typename Frame>
+void run_rewind(const std::string &name, CPU &cpu, Frame frame) {
+  Rewind rewind(REWIND_BUDGET, REWIND_SECONDS);
+  double push_seconds = 0;
+  for (uint32_t i = 0; i < FRAMES; ++i) {
+    frame();
+    auto start = bench::clock::now();
+    rewind.push(cpu);
+    push_seconds += bench::seconds_since(start);
+  }
+
+  double step_seconds = 0;
+  double worst_step = 0;
+  uint32_t steps = rewind.frames();
+  double held = rewind.seconds();
+  size_t used = rewind.bytes_used();
+  for (uint32_t i = 0; i < steps; ++i) {
+    auto start = bench::clock::now();
+    rewind.rewind(cpu);
+    double seconds = bench::seconds_since(start);
+    step_seconds += seconds;
+    worst_step = std::max(worst_step, seconds);
+  }
+
+  const auto &stats = rewind.stats;
+  std::string rewind_name = name + " (rewind)";
+  bench::report(rewind_name.c_str(), "push us", push_seconds / FRAMES * 1e6);
+  bench::report(rewind_name.c_str(), "stored bytes/frame",
+                static_cast<double>(stats.stored_bytes) / stats.pushes);
+  bench::report(rewind_name.c_str(), "compression", stats.compression());
+  bench::report(rewind_name.c_str(), "seconds held", held);
+  bench::report(rewind_name.c_str(), "bytes used", used);
+  bench::report(rewind_name.c_str(), "step us", step_seconds / steps * 1e6);
+  bench::report(rewind_name.c_str(), "worst step us", worst_step * 1e6);
+  bench::report(rewind_name.c_str(), "worst step decoded",
+                stats.max_step_decoded);
+}
+
+double run_frames(const std::vector<uint8_t> &image, uint8_t run_ahead) {
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  nes.set_run_ahead(run_ahead);
+  auto start = bench::clock::now();
+  for (uint32_t i = 0; i < FRAMES; ++i) {
+    nes.run_frame();
+  }
+  return bench::seconds_since(start) / FRAMES;
+}
+
+// what run-ahead costs per frame on top of running the frame, and how much
+// of it is the snapshot rather than the frames run ahead
+void run_ahead(const std::vector<uint8_t> &image) {
+  double plain = run_frames(image, 0);
+  bench::report("state/run-ahead", "frame us", plain * 1e6);
+  for (uint8_t frames = 1; frames <= 2; ++frames) {
+    double ahead = run_frames(image, frames);
+    std::string name = "state/run-ahead " + std::to_string(frames);
+    bench::report(name.c_str(), "frame us", ahead * 1e6);
+    bench::report(name.c_str(), "extra us/frame", (ahead - plain) * 1e6);
+    bench::report(name.c_str(), "cost", ahead / plain);
+  }
+
+  // one frame between snapshot and restore, like run-ahead by 1
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  NES::Snapshot snapshot;
+  double take_seconds = 0;
+  double restore_seconds = 0;
+  for (uint32_t i = 0; i < FRAMES; ++i) {
+    nes.run_frame();
+    auto start = bench::clock::now();
+    nes.take_snapshot(snapshot);
+    take_seconds += bench::seconds_since(start);
+    nes.run_frame();
+    start = bench::clock::now();
+    nes.restore_snapshot(snapshot);
+    restore_seconds += bench::seconds_since(start);
+  }
+  bench::report("state/run-ahead", "snapshot us", take_seconds / FRAMES * 1e6);
+  bench::report("state/run-ahead", "restore us",
+                restore_seconds / FRAMES * 1e6);
+}
+} // namespace
+
+void bench_state() {
+  CPU cpu;
+  cpu.load_program(OBJECT_UPDATE);
+  run("state/object update", cpu, [&] { cpu.run_cycles(FRAME_CYCLES); });
+  run_rewind("state/object update", cpu,
+             [&] { cpu.run_cycles(FRAME_CYCLES); });
+
+  auto image = bench::demo_rom();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  run("state/demo rom", nes.get_cpu(), [&] { nes.run_frame(); });
+  run_rewind("state/demo rom", nes.get_cpu(), [&] { nes.run_frame(); });
+  run_ahead(image);
+}
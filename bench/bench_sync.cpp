@@ -0,0 +1,29 @@
+#include "../lib/nes/nes.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace {
+constexpr uint32_t FRAMES = 600;
+
+double run(const std::vector<uint8_t> &image, Sync sync) {
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  nes.set_sync(sync);
+
+  auto start = bench::clock::now();
+  for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+    nes.run_frame();
+  }
+  return bench::seconds_since(start);
+}
+} // namespace
+
+void bench_sync() {
+  auto image = bench::demo_rom();
+  double lockstep = run(image, Sync::Lockstep);
+  double catch_up = run(image, Sync::CatchUp);
+
+  bench::report("sync/lockstep", "frames/s", FRAMES / lockstep);
+  bench::report("sync/catch-up", "frames/s", FRAMES / catch_up);
+  bench::report("sync/catch-up", "speedup", lockstep / catch_up);
+}
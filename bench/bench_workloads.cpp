@@ -0,0 +1,250 @@
+#include "../lib/cpu/cpu.hpp"
+#include "../lib/nes/nes.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint32_t INSTRUCTIONS = 50'000'000;
+constexpr uint16_t ORG = 0x8000;
+constexpr uint32_t DEMO_FRAMES = 600;
+
+struct Workload {
+  const char *name;
+  std::vector<uint8_t> program;
+};
+
+// DEX / BNE spinning 256 times between jumps
+const std::vector<uint8_t> TIGHT_LOOP = {
+    0xa2, 0x00,       // 8000: LDX #$00
+    0xca,             // 8002: DEX
+    0xd0, 0xfd,       // 8003: BNE $8002
+    0x88,             // 8005: DEY
+    0x4c, 0x00, 0x80, // 8006: JMP $8000
+};
+
+// copies [0x0200..0x0400] to [0x0400..0x0600], absolute indexed
+const std::vector<uint8_t> MEMORY_COPY = {
+    0xa2, 0x00,       // 8000: LDX #$00
+    0xbd, 0x00, 0x02, // 8002: LDA $0200,X
+    0x9d, 0x00, 0x04, // 8005: STA $0400,X
+    0xbd, 0x00, 0x03, // 8008: LDA $0300,X
+    0x9d, 0x00, 0x05, // 800b: STA $0500,X
+    0xe8,             // 800e: INX
+    0xd0, 0xf1,       // 800f: BNE $8002
+    0x4c, 0x00, 0x80, // 8011: JMP $8000
+};
+
+// bitwise CRC-16 (polynomial 0x1021) of the zero page, the CRC lives in
+// $00 / $01
+const std::vector<uint8_t> ZERO_PAGE_MATH = {
+    0xa2, 0x00,       // 8000: LDX #$00
+    0xb5, 0x10,       // 8002: LDA $10,X
+    0x45, 0x01,       // 8004: EOR $01
+    0x85, 0x01,       // 8006: STA $01
+    0xa0, 0x08,       // 8008: LDY #$08
+    0x06, 0x00,       // 800a: ASL $00
+    0x26, 0x01,       // 800c: ROL $01
+    0x90, 0x0c,       // 800e: BCC $801c
+    0xa5, 0x00,       // 8010: LDA $00
+    0x49, 0x21,       // 8012: EOR #$21
+    0x85, 0x00,       // 8014: STA $00
+    0xa5, 0x01,       // 8016: LDA $01
+    0x49, 0x10,       // 8018: EOR #$10
+    0x85, 0x01,       // 801a: STA $01
+    0x88,             // 801c: DEY
+    0xd0, 0xeb,       // 801d: BNE $800a
+    0xe8,             // 801f: INX
+    0xd0, 0xe0,       // 8020: BNE $8002
+    0x4c, 0x00, 0x80, // 8022: JMP $8000
+};
+
+// shift-and-add 8x8 multiplies of every X by 0x5b, the products summed into
+// $00 / $01 with ADC and subtracted from $02 with SBC, CMP counting the
+// wraps in $03
+const std::vector<uint8_t> ARITHMETIC = {
+    0xa2, 0x00,       // 8000: LDX #$00
+    0x86, 0x10,       // 8002: STX $10
+    0xa9, 0x5b,       // 8004: LDA #$5b
+    0x85, 0x11,       // 8006: STA $11
+    0xa9, 0x00,       // 8008: LDA #$00
+    0xa0, 0x08,       // 800a: LDY #$08
+    0x46, 0x11,       // 800c: LSR $11
+    0x90, 0x03,       // 800e: BCC $8013
+    0x18,             // 8010: CLC
+    0x65, 0x10,       // 8011: ADC $10
+    0x6a,             // 8013: ROR A
+    0x66, 0x12,       // 8014: ROR $12
+    0x88,             // 8016: DEY
+    0xd0, 0xf3,       // 8017: BNE $800c
+    0x85, 0x13,       // 8019: STA $13
+    0x18,             // 801b: CLC
+    0xa5, 0x12,       // 801c: LDA $12
+    0x65, 0x00,       // 801e: ADC $00
+    0x85, 0x00,       // 8020: STA $00
+    0xa5, 0x13,       // 8022: LDA $13
+    0x65, 0x01,       // 8024: ADC $01
+    0x85, 0x01,       // 8026: STA $01
+    0x38,             // 8028: SEC
+    0xa5, 0x02,       // 8029: LDA $02
+    0xe5, 0x12,       // 802b: SBC $12
+    0x85, 0x02,       // 802d: STA $02
+    0xc9, 0x80,       // 802f: CMP #$80
+    0xb0, 0x02,       // 8031: BCS $8035
+    0xe6, 0x03,       // 8033: INC $03
+    0xe8,             // 8035: INX
+    0xd0, 0xca,       // 8036: BNE $8002
+    0x4c, 0x00, 0x80, // 8038: JMP $8000
+};
+
+// folds a 1 KiB table at $8100 into $20 through a zero page pointer,
+// indirect indexed
+constexpr uint16_t TABLE_OFFSET = 0x100;
+constexpr uint16_t TABLE_SIZE = 0x400;
+const std::vector<uint8_t> TABLE_WALK_CODE = {
+    0xa9, 0x00,       // 8000: LDA #$00
+    0x85, 0x10,       // 8002: STA $10
+    0xa9, 0x81,       // 8004: LDA #$81
+    0x85, 0x11,       // 8006: STA $11
+    0xa2, 0x04,       // 8008: LDX #$04
+    0xa0, 0x00,       // 800a: LDY #$00
+    0xb1, 0x10,       // 800c: LDA ($10),Y
+    0x45, 0x20,       // 800e: EOR $20
+    0x85, 0x20,       // 8010: STA $20
+    0xc8,             // 8012: INY
+    0xd0, 0xf7,       // 8013: BNE $800c
+    0xe6, 0x11,       // 8015: INC $11
+    0xca,             // 8017: DEX
+    0xd0, 0xf0,       // 8018: BNE $800a
+    0x4c, 0x00, 0x80, // 801a: JMP $8000
+};
+
+std::vector<uint8_t> table_walk() {
+  std::vector<uint8_t> program = TABLE_WALK_CODE;
+  program.resize(TABLE_OFFSET + TABLE_SIZE);
+  for (uint16_t i = 0; i < TABLE_SIZE; ++i) {
+    program[TABLE_OFFSET + i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+  }
+  return program;
+}
+
+// the threaded engine, then the block cache and the JIT on top of it
+enum class Engine { Threaded, BlockCache, Jit };
+
+void select(CPU &cpu, Engine engine) {
+  cpu.set_block_cache(engine == Engine::BlockCache);
+#if NES_JIT
+  cpu.set_jit(engine == Engine::Jit);
+#endif
+}
+
+double run_engine(const std::vector<uint8_t> &program, uint16_t org,
+                  Engine engine, CPU &cpu) {
+  select(cpu, engine);
+  cpu.load_program(program, org);
+
+  auto start = bench::clock::now();
+  cpu.run(INSTRUCTIONS);
+  return bench::seconds_since(start);
+}
+
+void run(const std::string &name, const std::vector<uint8_t> &program,
+         uint16_t org) {
+  CPU cpu;
+  double seconds = run_engine(program, org, Engine::Threaded, cpu);
+
+  std::string label = "workloads/" + name;
+  bench::report(label.c_str(), "MIPS", INSTRUCTIONS / seconds / 1e6);
+  bench::report(label.c_str(), "ns/instruction", seconds * 1e9 / INSTRUCTIONS);
+  bench::report(label.c_str(), "cycles/instruction",
+                double(cpu.get_cycles()) / INSTRUCTIONS);
+
+  CPU cached;
+  double cached_seconds = run_engine(program, org, Engine::BlockCache, cached);
+  auto stats = cached.get_block_cache_stats();
+
+  std::string cached_label = label + " (block cache)";
+  bench::report(cached_label.c_str(), "MIPS",
+                INSTRUCTIONS / cached_seconds / 1e6);
+  bench::report(cached_label.c_str(), "speedup", seconds / cached_seconds);
+  bench::report(cached_label.c_str(), "hit rate %", stats.hit_rate() * 100);
+
+#if NES_JIT
+  CPU compiled;
+  double jit_seconds = run_engine(program, org, Engine::Jit, compiled);
+  auto jit_stats = compiled.get_jit_stats();
+
+  std::string jit_label = label + " (jit)";
+  bench::report(jit_label.c_str(), "MIPS", INSTRUCTIONS / jit_seconds / 1e6);
+  bench::report(jit_label.c_str(), "speedup", seconds / jit_seconds);
+  bench::report(jit_label.c_str(), "interpreted %",
+                100.0 * jit_stats.interpreted / INSTRUCTIONS);
+#endif
+}
+
+double run_demo(const std::vector<uint8_t> &image, Engine engine) {
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  select(nes.get_cpu(), engine);
+
+  auto start = bench::clock::now();
+  for (uint32_t frame = 0; frame < DEMO_FRAMES; ++frame) {
+    nes.run_frame();
+  }
+  return bench::seconds_since(start);
+}
+
+bool read_binary(const std::string &path, std::vector<uint8_t> &data) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  data.resize(0x10000);
+  data.resize(std::fread(data.data(), 1, data.size(), file));
+  std::fclose(file);
+  return true;
+}
+} // namespace
+
+void bench_workloads() {
+  const Workload workloads[] = {
+      {"tight loop", TIGHT_LOOP},
+      {"memory copy", MEMORY_COPY},
+      {"zero page math", ZERO_PAGE_MATH},
+      {"arithmetic", ARITHMETIC},
+      {"table walk", table_walk()},
+  };
+
+  for (const auto &workload : workloads) {
+    run(workload.name, workload.program, ORG);
+  }
+
+  // the binary is entered at its first byte and run for as many
+  // instructions, it should loop forever
+  for (const auto &binary : bench::binaries()) {
+    std::vector<uint8_t> program;
+    if (!read_binary(binary.path, program) ||
+        program.size() > 0x10000u - binary.org) {
+      std::fprintf(stderr, "workloads: can't load %s\n", binary.path.c_str());
+      continue;
+    }
+    run(binary.path, program, binary.org);
+  }
+
+  // a whole frame of the demo ROM, PPU and scheduler included
+  auto image = bench::demo_rom();
+  double threaded = run_demo(image, Engine::Threaded);
+  double cached = run_demo(image, Engine::BlockCache);
+  bench::report("workloads/demo rom", "frames/s", DEMO_FRAMES / threaded);
+  bench::report("workloads/demo rom (block cache)", "frames/s",
+                DEMO_FRAMES / cached);
+  bench::report("workloads/demo rom (block cache)", "speedup",
+                threaded / cached);
+#if NES_JIT
+  double compiled = run_demo(image, Engine::Jit);
+  bench::report("workloads/demo rom (jit)", "frames/s", DEMO_FRAMES / compiled);
+  bench::report("workloads/demo rom (jit)", "speedup", threaded / compiled);
+#endif
+}
@@ -0,0 +1,56 @@
+#include "../lib/cartridge/cartridge.hpp"
+#include "bench.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+// NROM game-like loop: turns on rendering and NMI after the first vblank,
+// then spins in the main loop while the NMI handler sets the scroll every
+// frame, so the PPU is only touched a handful of times per frame
+const uint8_t PROGRAM[] = {
+    0x78,             // 8000: SEI
+    0xa2, 0xff,       // 8001: LDX #$ff
+    0x9a,             // 8003: TXS
+    0x2c, 0x02, 0x20, // 8004: BIT $2002
+    0x10, 0xfb,       // 8007: BPL $8004
+    0xa9, 0x1e,       // 8009: LDA #$1e
+    0x8d, 0x01, 0x20, // 800b: STA $2001
+    0xa9, 0x80,       // 800e: LDA #$80
+    0x8d, 0x00, 0x20, // 8010: STA $2000
+    0xe6, 0x01,       // 8013: INC $01
+    0xd0, 0xfc,       // 8015: BNE $8013
+    0xe6, 0x02,       // 8017: INC $02
+    0x4c, 0x13, 0x80, // 8019: JMP $8013
+    0xe6, 0x00,       // 801c: INC $00
+    0xad, 0x02, 0x20, // 801e: LDA $2002
+    0xa5, 0x00,       // 8021: LDA $00
+    0x8d, 0x05, 0x20, // 8023: STA $2005
+    0x8d, 0x05, 0x20, // 8026: STA $2005
+    0x40,             // 8029: RTI
+};
+constexpr uint16_t NMI_HANDLER = 0x801c;
+
+} // namespace
+
+std::vector<uint8_t> bench::demo_rom() {
+  std::vector<uint8_t> image(ines::HEADER_SIZE + 2 * ines::PRG_ROM_UNIT +
+                             ines::CHR_ROM_UNIT);
+  std::memcpy(image.data(), "NES\x1a", 4);
+  image[4] = 2;
+  image[5] = 1;
+
+  uint8_t *prg = image.data() + ines::HEADER_SIZE;
+  std::memcpy(prg, PROGRAM, sizeof(PROGRAM));
+  prg[0x7ffa] = NMI_HANDLER & 0xff;
+  prg[0x7ffb] = NMI_HANDLER >> 8;
+  prg[0x7ffc] = 0x00;
+  prg[0x7ffd] = 0x80;
+
+  uint8_t *chr = prg + 2 * ines::PRG_ROM_UNIT;
+  for (uint32_t i = 0; i < ines::CHR_ROM_UNIT; ++i) {
+    chr[i] = i * 13;
+  }
+  return image;
+}
+
@@ -0,0 +1,79 @@
+#include "bench.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Benchmark {
+  const char *name;
+  void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+    {"dispatch", bench_dispatch},
+    {"workloads", bench_workloads},
+    {"bus", bench_bus},
+    {"rom", bench_rom},
+    {"mapper", bench_mapper},
+    {"ppu", bench_ppu},
+    {"sync", bench_sync},
+    {"pipeline", bench_pipeline},
+    {"display", bench_display},
+    {"apu", bench_apu},
+    {"state", bench_state},
+    {"idle", bench_idle},
+};
+
+static void usage(const char *program) {
+  std::fprintf(stderr,
+               "usage: %s [--json FILE] [--bin FILE[@ORG]]... [BENCHMARK]...\n"
+               "  --json FILE       also writes the results to FILE\n"
+               "  --bin FILE[@ORG]  runs a raw 6502 binary loaded at ORG (hex, "
+               "default 8000) in the workloads benchmark\n",
+               program);
+}
+
+// runs every benchmark, or only the ones named on the command line
+int main(int argc, char **argv) {
+  const char *json_path = nullptr;
+  std::vector<const char *> names;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--bin") == 0 && i + 1 < argc) {
+      std::string arg = argv[++i];
+      size_t at = arg.rfind('@');
+      uint16_t org = 0x8000;
+      if (at != std::string::npos) {
+        org = std::strtoul(arg.c_str() + at + 1, nullptr, 16);
+        arg.resize(at);
+      }
+      bench::add_binary({arg, org});
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 1;
+    } else {
+      names.push_back(argv[i]);
+    }
+  }
+
+  for (const auto &benchmark : benchmarks) {
+    bool selected = names.empty();
+
+    for (const char *name : names) {
+      selected |= std::strcmp(name, benchmark.name) == 0;
+    }
+
+    if (selected) {
+      benchmark.run();
+    }
+  }
+
+  bench::report("process", "peak memory KiB", bench::peak_memory_kib());
+  if (json_path != nullptr && !bench::write_json(json_path)) {
+    std::fprintf(stderr, "failed to write %s\n", json_path);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,42 @@
+#include "bench.hpp"
+#include <cstdio>
+
+namespace {
+void put_u16(std::FILE *file, uint16_t value) {
+  std::fputc(value & 0xff, file);
+  std::fputc(value >> 8, file);
+}
+
+void put_u32(std::FILE *file, uint32_t value) {
+  put_u16(file, value & 0xffff);
+  put_u16(file, value >> 16);
+}
+} // namespace
+
+// 16-bit mono PCM
+bool bench::write_wav(const char *path, const std::vector<int16_t> &samples,
+                      uint32_t sample_rate) {
+  std::FILE *file = std::fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  uint32_t data_size = samples.size() * sizeof(int16_t);
+  std::fputs("RIFF", file);
+  put_u32(file, 36 + data_size);
+  std::fputs("WAVEfmt ", file);
+  put_u32(file, 16);
+  put_u16(file, 1); // PCM
+  put_u16(file, 1); // mono
+  put_u32(file, sample_rate);
+  put_u32(file, sample_rate * sizeof(int16_t));
+  put_u16(file, sizeof(int16_t));
+  put_u16(file, 16);
+  std::fputs("data", file);
+  put_u32(file, data_size);
+  for (int16_t sample : samples) {
+    put_u16(file, static_cast<uint16_t>(sample));
+  }
+
+  return std::fclose(file) == 0;
+}
@@ -0,0 +1,312 @@
+#include "apu.hpp"
+#include <algorithm>
+
+namespace {
+constexpr uint16_t REGISTERS_START = 0x4000;
+constexpr uint16_t REGISTER_COUNT = 0x20;
+constexpr size_t CHUNK = 256;
+
+// linear approximation of the mixer, scaled so that every channel at its
+// loudest adds up to about full scale
+// ref: https://www.nesdev.org/wiki/APU_Mixer
+constexpr int32_t PULSE_WEIGHT = 286;
+constexpr int32_t TRIANGLE_WEIGHT = 323;
+constexpr int32_t NOISE_WEIGHT = 188;
+constexpr int32_t DMC_WEIGHT = 127;
+} // namespace
+
+APU::APU(uint32_t sample_rate)
+    : bus(nullptr), scheduler(nullptr), sync_event(0), sample_handler(nullptr),
+      sample_context(nullptr), output_enabled(true), ports{},
+      buffer(CLOCK_RATE, sample_rate),
+      pulse1(true), pulse2(false), triangle(), noise(), dmc(), frame_start(0),
+      now(0), five_step(false), irq_inhibit(false), frame_irq(false),
+      frame_step(0), next_frame_step(0), samples(0) {
+  pulse1.voice = {&buffer, PULSE_WEIGHT, 0};
+  pulse2.voice = {&buffer, PULSE_WEIGHT, 0};
+  // the triangle sits at the top of its wave from power up, not a step
+  triangle.voice = {&buffer, TRIANGLE_WEIGHT, triangle.output()};
+  noise.voice = {&buffer, NOISE_WEIGHT, 0};
+  dmc.voice = {&buffer, DMC_WEIGHT, 0};
+  write_frame_counter(0);
+}
+
+void APU::attach(Bus &target) {
+  bus = &target;
+  bus->map_io(REGISTERS_START, Bus::PAGE_SIZE, register_read, register_write,
+              this);
+  dmc.set_reader(dmc_read, this);
+}
+
+void APU::set_port(uint16_t addr, Bus::ReadHandler read,
+                   Bus::WriteHandler write, void *context) {
+  ports[(addr - REGISTERS_START) % REGISTER_COUNT] = {read, write, context};
+}
+
+void APU::set_scheduler(Scheduler &target) {
+  scheduler = &target;
+  sync_event = scheduler->add_event(sync, this);
+  reschedule();
+}
+
+void APU::set_sample_handler(SampleHandler handler, void *context) {
+  sample_handler = handler;
+  sample_context = context;
+}
+
+void APU::set_sample_rate(uint32_t sample_rate) {
+  buffer = BlipBuffer(CLOCK_RATE, sample_rate);
+  reschedule();
+}
+
+// the voices point at this APU's buffer, which a copy of the channels keeps
+void APU::take_snapshot(Snapshot &snapshot) const {
+  snapshot.buffer = buffer;
+  snapshot.pulse1 = pulse1;
+  snapshot.pulse2 = pulse2;
+  snapshot.triangle = triangle;
+  snapshot.noise = noise;
+  snapshot.dmc = dmc;
+  snapshot.frame_start = frame_start;
+  snapshot.now = now;
+  snapshot.five_step = five_step;
+  snapshot.irq_inhibit = irq_inhibit;
+  snapshot.frame_irq = frame_irq;
+  snapshot.frame_step = frame_step;
+  snapshot.next_frame_step = next_frame_step;
+  snapshot.samples = samples;
+}
+
+void APU::restore_snapshot(const Snapshot &snapshot) {
+  buffer = snapshot.buffer;
+  pulse1 = snapshot.pulse1;
+  pulse2 = snapshot.pulse2;
+  triangle = snapshot.triangle;
+  noise = snapshot.noise;
+  dmc = snapshot.dmc;
+  frame_start = snapshot.frame_start;
+  now = snapshot.now;
+  five_step = snapshot.five_step;
+  irq_inhibit = snapshot.irq_inhibit;
+  frame_irq = snapshot.frame_irq;
+  frame_step = snapshot.frame_step;
+  next_frame_step = snapshot.next_frame_step;
+  samples = snapshot.samples;
+}
+
+// timing
+void APU::run_to(uint64_t cycle) {
+  if (cycle <= frame_start + now) {
+    return;
+  }
+
+  uint32_t end = static_cast<uint32_t>(cycle - frame_start);
+  while (next_frame_step <= end) {
+    run_channels(next_frame_step);
+    clock_frame_counter();
+  }
+  run_channels(end);
+}
+
+void APU::run_channels(uint32_t end) {
+  pulse1.run(end);
+  pulse2.run(end);
+  triangle.run(end);
+  noise.run(end);
+  dmc.run(end);
+  now = end;
+}
+
+void APU::end_frame(uint64_t cycle) {
+  run_to(cycle);
+
+  uint32_t duration = now;
+  buffer.end_frame(duration);
+  pulse1.end_frame(duration);
+  pulse2.end_frame(duration);
+  triangle.end_frame(duration);
+  noise.end_frame(duration);
+  dmc.end_frame(duration);
+  next_frame_step -= duration;
+  frame_start += duration;
+  now = 0;
+
+  std::array<int16_t, CHUNK> chunk;
+  size_t count;
+  while ((count = buffer.read_samples(chunk.data(), chunk.size())) > 0) {
+    samples += count;
+    if (sample_handler != nullptr && output_enabled) {
+      sample_handler(sample_context, chunk.data(), count);
+    }
+  }
+
+  reschedule();
+}
+
+// 4-step mode: envelopes every step, lengths and sweeps every other step and
+// the IRQ on the last one. 5-step mode: nothing on the 4th step, no IRQ
+void APU::clock_frame_counter() {
+  bool quarter = !five_step || frame_step != 3;
+  bool half = frame_step == 1 || frame_step == (five_step ? 4 : 3);
+
+  if (quarter) {
+    pulse1.clock_quarter();
+    pulse2.clock_quarter();
+    triangle.clock_quarter();
+    noise.clock_quarter();
+  }
+  if (half) {
+    pulse1.clock_half();
+    pulse2.clock_half();
+    triangle.clock_half();
+    noise.clock_half();
+  }
+  if (!five_step && frame_step == 3 && !irq_inhibit) {
+    frame_irq = true;
+  }
+
+  next_frame_step += step_delay(frame_step);
+  frame_step = (frame_step + 1) % (five_step ? 5 : 4);
+}
+
+// cycles from a step to the one after it
+uint32_t APU::step_delay(uint8_t step) const {
+  uint8_t last = five_step ? 4 : 3;
+  if (step == last) {
+    return (five_step ? FIVE_STEP_PERIOD : FOUR_STEP_PERIOD) - STEPS[last] +
+           STEPS[0];
+  }
+  return STEPS[step + 1] - STEPS[step];
+}
+
+void APU::write_frame_counter(uint8_t data) {
+  five_step = data & 0x80;
+  irq_inhibit = data & 0x40;
+  if (irq_inhibit) {
+    frame_irq = false;
+  }
+
+  frame_step = 0;
+  next_frame_step = now + STEPS[0];
+  // 5-step mode clocks everything right away
+  if (five_step) {
+    pulse1.clock_quarter();
+    pulse2.clock_quarter();
+    triangle.clock_quarter();
+    noise.clock_quarter();
+    pulse1.clock_half();
+    pulse2.clock_half();
+    triangle.clock_half();
+    noise.clock_half();
+  }
+}
+
+// the IRQ line is raised again while it is held, and the event runs at the
+// next frame or DMC IRQ, and half way to a full buffer
+void APU::reschedule() {
+  if (scheduler == nullptr) {
+    return;
+  }
+
+  if (irq_pending()) {
+    scheduler->schedule(event::IRQ, frame_start + now);
+  }
+
+  uint32_t next = buffer.max_frame() / 2;
+  if (!five_step && !irq_inhibit && !frame_irq) {
+    next = std::min(next, next_frame_step + STEPS[3] - STEPS[frame_step]);
+  }
+  if (!dmc.irq) {
+    next = std::min(next, dmc.irq_time());
+  }
+  scheduler->schedule(sync_event, frame_start + next);
+}
+
+// registers
+uint8_t APU::read_register(uint16_t addr) {
+  if (addr != STATUS) {
+    return 0;
+  }
+
+  uint8_t status = (pulse1.length.count > 0) | (pulse2.length.count > 0) << 1 |
+                   (triangle.length.count > 0) << 2 |
+                   (noise.length.count > 0) << 3 | dmc.active() << 4 |
+                   frame_irq << 6 | dmc.irq << 7;
+  frame_irq = false;
+  return status;
+}
+
+void APU::write_register(uint16_t addr, uint8_t data) {
+  if (addr < 0x4004) {
+    pulse1.write(addr, data);
+  } else if (addr < 0x4008) {
+    pulse2.write(addr, data);
+  } else if (addr < 0x400c) {
+    triangle.write(addr, data);
+  } else if (addr < 0x4010) {
+    noise.write(addr, data);
+  } else if (addr < 0x4014) {
+    dmc.write(addr, data);
+  } else if (addr == STATUS) {
+    pulse1.length.set_enabled(data & 0x01);
+    pulse2.length.set_enabled(data & 0x02);
+    triangle.length.set_enabled(data & 0x04);
+    noise.length.set_enabled(data & 0x08);
+    dmc.set_enabled(data & 0x10);
+  } else if (addr == FRAME_COUNTER) {
+    write_frame_counter(data);
+  }
+
+  reschedule();
+}
+
+uint8_t APU::register_read(void *context, uint16_t addr, uint64_t cycle) {
+  auto *apu = static_cast<APU *>(context);
+  uint16_t index = addr - REGISTERS_START;
+  if (index >= REGISTER_COUNT) {
+    return 0;
+  }
+
+  const Port &port = apu->ports[index];
+  if (port.read != nullptr) {
+    return port.read(port.context, addr, cycle);
+  }
+  if (addr != STATUS) {
+    return 0;
+  }
+
+  apu->run_to(cycle);
+  return apu->read_register(addr);
+}
+
+void APU::register_write(void *context, uint16_t addr, uint8_t data,
+                         uint64_t cycle) {
+  auto *apu = static_cast<APU *>(context);
+  uint16_t index = addr - REGISTERS_START;
+  if (index >= REGISTER_COUNT) {
+    return;
+  }
+
+  const Port &port = apu->ports[index];
+  if (port.write != nullptr) {
+    port.write(port.context, addr, data, cycle);
+    return;
+  }
+
+  apu->run_to(cycle);
+  apu->write_register(addr, data);
+}
+
+uint8_t APU::dmc_read(void *context, uint16_t addr) {
+  return static_cast<APU *>(context)->bus->mem_read(addr);
+}
+
+void APU::sync(void *context, uint64_t cycle) {
+  auto *apu = static_cast<APU *>(context);
+  apu->run_to(cycle);
+  if (cycle - apu->frame_start >= apu->buffer.max_frame() / 2) {
+    apu->end_frame(cycle);
+  } else {
+    apu->reschedule();
+  }
+}
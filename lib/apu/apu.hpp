@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../bus/bus.hpp"
+#include "../scheduler/scheduler.hpp"
+#include "blip_buffer.hpp"
+#include "channels.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// the 2A03's audio: two pulse channels, triangle, noise, DMC and the frame
+// counter. there is no sample per CPU cycle: like the PPU the APU is only
+// brought up to date when the CPU touches one of its registers, and the
+// channels step from one waveform edge to the next, handing each amplitude
+// change to a band-limited synthesizer. the samples are made in blocks when
+// the frame ends (or the buffer would overflow) and go to the sample handler
+//
+// the APU also owns the rest of the [0x4000..0x4020] I/O registers, other
+// devices plug into them as ports (OAM DMA at 0x4014, the controllers)
+class APU {
+public:
+  // NTSC CPU clock
+  static constexpr uint32_t CLOCK_RATE = 1789773;
+  static constexpr uint32_t DEFAULT_SAMPLE_RATE = 44100;
+  static constexpr uint16_t STATUS = 0x4015;
+  static constexpr uint16_t FRAME_COUNTER = 0x4017;
+
+  using SampleHandler = void (*)(void *context, const int16_t *samples,
+                                 size_t count);
+
+  explicit APU(uint32_t sample_rate = DEFAULT_SAMPLE_RATE);
+  APU(const APU &) = delete;
+  APU &operator=(const APU &) = delete;
+
+  // maps [0x4000..0x4100], the DMC reads its samples through the bus
+  void attach(Bus &bus);
+  // routes a register of [0x4000..0x4020] to another device, reads of
+  // registers without a port return 0
+  void set_port(uint16_t addr, Bus::ReadHandler read, Bus::WriteHandler write,
+                void *context);
+  // adds the APU's event, it raises the frame and DMC IRQs through the
+  // scheduler and makes sure a long frame doesn't overflow the buffer
+  void set_scheduler(Scheduler &target);
+  // receives the samples, without one they are dropped
+  void set_sample_handler(SampleHandler handler, void *context);
+  // off still makes the samples but drops them, for frames that are never
+  // heard
+  void set_output_enabled(bool enabled) { output_enabled = enabled; }
+  // restarts the synthesis at another rate (ex: 22050 to halve its cost)
+  void set_sample_rate(uint32_t sample_rate);
+  uint32_t get_sample_rate() const { return buffer.get_sample_rate(); }
+
+  // runs the channels and the frame counter up to the CPU cycle
+  void run_to(uint64_t cycle);
+  // runs up to the CPU cycle and hands the frame's samples to the handler
+  void end_frame(uint64_t cycle);
+
+  uint8_t read_register(uint16_t addr);
+  void write_register(uint16_t addr, uint8_t data);
+
+  // the IRQ line, frame counter or DMC
+  bool irq_pending() const { return frame_irq || dmc.irq; }
+  uint64_t get_samples() const { return samples; }
+
+  // the channels, the frame counter and the samples not handed out yet, for
+  // run-ahead. only goes back into the APU it was taken from
+  struct Snapshot {
+    BlipBuffer buffer{CLOCK_RATE, DEFAULT_SAMPLE_RATE};
+    Pulse pulse1{true};
+    Pulse pulse2{false};
+    Triangle triangle;
+    Noise noise;
+    Dmc dmc;
+    uint64_t frame_start;
+    uint32_t now;
+    bool five_step;
+    bool irq_inhibit;
+    bool frame_irq;
+    uint8_t frame_step;
+    uint32_t next_frame_step;
+    uint64_t samples;
+  };
+  void take_snapshot(Snapshot &snapshot) const;
+  void restore_snapshot(const Snapshot &snapshot);
+
+private:
+  // frame counter steps, in CPU cycles after a $4017 write, NTSC
+  static constexpr uint32_t STEPS[5] = {7457, 14913, 22371, 29829, 37281};
+  static constexpr uint32_t FOUR_STEP_PERIOD = 29830;
+  static constexpr uint32_t FIVE_STEP_PERIOD = 37282;
+
+  struct Port {
+    Bus::ReadHandler read;
+    Bus::WriteHandler write;
+    void *context;
+  };
+
+  Bus *bus;
+  Scheduler *scheduler;
+  uint8_t sync_event;
+  SampleHandler sample_handler;
+  void *sample_context;
+  bool output_enabled;
+  std::array<Port, 0x20> ports;
+
+  BlipBuffer buffer;
+  Pulse pulse1;
+  Pulse pulse2;
+  Triangle triangle;
+  Noise noise;
+  Dmc dmc;
+
+  // CPU cycle the audio frame started at, every time below counts from it
+  uint64_t frame_start;
+  uint32_t now;
+  bool five_step;
+  bool irq_inhibit;
+  bool frame_irq;
+  uint8_t frame_step;
+  uint32_t next_frame_step;
+  uint64_t samples;
+
+  void run_channels(uint32_t end);
+  void clock_frame_counter();
+  uint32_t step_delay(uint8_t step) const;
+  void write_frame_counter(uint8_t data);
+  void reschedule();
+
+  static uint8_t register_read(void *context, uint16_t addr, uint64_t cycle);
+  static void register_write(void *context, uint16_t addr, uint8_t data,
+                             uint64_t cycle);
+  static uint8_t dmc_read(void *context, uint16_t addr);
+  static void sync(void *context, uint64_t cycle);
+};
@@ -0,0 +1,87 @@
+#include "blip_buffer.hpp"
+#include "../error/error.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+// a bit below the Nyquist frequency, leaves room for the window's roll off
+constexpr double CUTOFF = 0.9;
+} // namespace
+
+BlipBuffer::BlipBuffer(uint32_t clock_rate, uint32_t sample_rate)
+    : clock_rate(clock_rate), sample_rate(sample_rate),
+      factor((uint64_t{sample_rate} << TIME_BITS) / clock_rate +
+             ((uint64_t{sample_rate} << TIME_BITS) % clock_rate >=
+              clock_rate / 2)),
+      offset(0), integrator(0), kernels{}, samples{} {
+  if (sample_rate == 0 || sample_rate >= clock_rate) {
+    error::fail("the sample rate must be below the clock rate");
+  }
+
+  // blackman windowed sinc, a step `phase / PHASES` of a sample past the
+  // start of its sample lands between taps WIDTH/2 - 1 and WIDTH/2
+  for (uint8_t phase = 0; phase < PHASES; ++phase) {
+    std::array<double, WIDTH> taps;
+    double total = 0;
+    for (uint8_t tap = 0; tap < WIDTH; ++tap) {
+      double x = tap - (WIDTH / 2 - 1) - double(phase) / PHASES;
+      double sinc = x == 0 ? 1 : std::sin(PI * CUTOFF * x) / (PI * CUTOFF * x);
+      double w = (x + WIDTH / 2) / WIDTH;
+      double window =
+          0.42 - 0.5 * std::cos(2 * PI * w) + 0.08 * std::cos(4 * PI * w);
+      taps[tap] = sinc * window;
+      total += taps[tap];
+    }
+
+    // every phase sums to exactly 1 << KERNEL_BITS, so a step ends up at its
+    // full height whatever its offset, the rounding goes to the center tap
+    int32_t sum = 0;
+    for (uint8_t tap = 0; tap < WIDTH; ++tap) {
+      kernels[phase][tap] = static_cast<int16_t>(
+          std::lround(taps[tap] / total * (1 << KERNEL_BITS)));
+      sum += kernels[phase][tap];
+    }
+    kernels[phase][WIDTH / 2 - 1] += (1 << KERNEL_BITS) - sum;
+  }
+}
+
+void BlipBuffer::end_frame(uint32_t duration) {
+  offset += duration * factor;
+  if (samples_available() > CAPACITY) {
+    error::fail("audio frame longer than the buffer");
+  }
+}
+
+uint32_t BlipBuffer::max_frame() const {
+  return static_cast<uint32_t>(((uint64_t{CAPACITY} << TIME_BITS) - offset) /
+                               factor);
+}
+
+size_t BlipBuffer::read_samples(int16_t *out, size_t count) {
+  count = std::min(count, samples_available());
+
+  int32_t sum = integrator;
+  for (size_t i = 0; i < count; ++i) {
+    int32_t sample = sum >> KERNEL_BITS;
+    out[i] = static_cast<int16_t>(std::clamp(sample, -32768, 32767));
+    sum += samples[i];
+    sum -= sum >> BASS_SHIFT;
+  }
+  integrator = sum;
+
+  // the unfinished samples move to the front
+  size_t remaining = samples_available() - count + WIDTH;
+  std::copy(samples.begin() + count, samples.begin() + count + remaining,
+            samples.begin());
+  std::fill(samples.begin() + remaining, samples.begin() + remaining + count,
+            0);
+  offset -= uint64_t{count} << TIME_BITS;
+  return count;
+}
+
+void BlipBuffer::clear() {
+  offset = 0;
+  integrator = 0;
+  samples.fill(0);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// band-limited synthesis: a channel only reports the clock at which its
+// amplitude changes and by how much. each change is added to the output as a
+// band-limited step (a windowed sinc, picked among PHASES sub-sample
+// offsets), and the samples are the running sum of those steps. the cost is
+// per amplitude change, not per clock, and there is no aliasing to filter out
+//
+// the buffer has a fixed size: a frame has to be ended (and its samples read)
+// before it runs past CAPACITY samples
+class BlipBuffer {
+public:
+  static constexpr size_t CAPACITY = 2048;
+  static constexpr uint8_t WIDTH = 16;
+  static constexpr uint8_t PHASE_BITS = 5;
+  static constexpr uint8_t PHASES = 1 << PHASE_BITS;
+  // kernel taps sum to 1 << KERNEL_BITS
+  static constexpr uint8_t KERNEL_BITS = 14;
+
+  BlipBuffer(uint32_t clock_rate, uint32_t sample_rate);
+
+  // adds an amplitude change at `time` clocks since the start of the frame
+  void add_delta(uint32_t time, int32_t delta) {
+    uint64_t position = offset + time * factor;
+    size_t index = position >> TIME_BITS;
+    const auto &kernel =
+        kernels[(position >> (TIME_BITS - PHASE_BITS)) & (PHASES - 1)];
+
+    int32_t *out = samples.data() + index;
+    for (uint8_t tap = 0; tap < WIDTH; ++tap) {
+      out[tap] += delta * kernel[tap];
+    }
+  }
+
+  // ends the frame `duration` clocks after it started, its samples become
+  // available and the next frame starts there
+  void end_frame(uint32_t duration);
+  // clocks a frame may last at most with an empty buffer
+  uint32_t max_frame() const;
+  size_t samples_available() const { return offset >> TIME_BITS; }
+  // takes up to `count` finished samples out of the buffer
+  size_t read_samples(int16_t *out, size_t count);
+  void clear();
+
+  uint32_t get_sample_rate() const { return sample_rate; }
+
+private:
+  static constexpr uint8_t TIME_BITS = 20;
+  // high-pass that takes the DC offset out, like the console's output does
+  static constexpr uint8_t BASS_SHIFT = 9;
+
+  uint32_t clock_rate;
+  uint32_t sample_rate;
+  // sample position per clock, fixed point
+  uint64_t factor;
+  // position of the frame start in the buffer, fixed point
+  uint64_t offset;
+  int32_t integrator;
+
+  std::array<std::array<int16_t, WIDTH>, PHASES> kernels;
+  // amplitude differences, a step's kernel can spill WIDTH samples past the
+  // end of the frame
+  std::array<int32_t, CAPACITY + WIDTH> samples;
+};
@@ -0,0 +1,360 @@
+#include "channels.hpp"
+
+namespace {
+constexpr uint8_t LENGTHS[32] = {
+    10, 254, 20, 2,  40, 4,  80, 6,  160, 8,  60, 10, 14, 12, 26, 14,
+    12, 16,  24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30,
+};
+
+constexpr uint8_t DUTY[4][8] = {
+    {0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 1, 1, 1, 0, 0, 0},
+    {1, 0, 0, 1, 1, 1, 1, 1},
+};
+
+constexpr uint8_t TRIANGLE[32] = {
+    15, 14, 13, 12, 11, 10, 9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+};
+
+// NTSC, in CPU cycles
+constexpr uint16_t NOISE_PERIODS[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
+};
+constexpr uint16_t DMC_RATES[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
+};
+
+// steps a silent channel's timer past `end`, returns how many steps it took
+uint32_t skip(uint32_t &next, uint32_t end, uint32_t period) {
+  if (next >= end) {
+    return 0;
+  }
+  uint32_t steps = (end - next + period - 1) / period;
+  next += steps * period;
+  return steps;
+}
+} // namespace
+
+// envelope
+void Envelope::write(uint8_t data) {
+  period = data & 0x0f;
+  constant = data & 0x10;
+  loop = data & 0x20;
+}
+
+void Envelope::clock() {
+  if (start) {
+    start = false;
+    decay = 15;
+    divider = period;
+  } else if (divider > 0) {
+    divider--;
+  } else {
+    divider = period;
+    if (decay > 0) {
+      decay--;
+    } else if (loop) {
+      decay = 15;
+    }
+  }
+}
+
+// length counter
+void LengthCounter::load(uint8_t index) {
+  if (enabled) {
+    count = LENGTHS[index & 0x1f];
+  }
+}
+
+void LengthCounter::set_enabled(bool value) {
+  enabled = value;
+  if (!enabled) {
+    count = 0;
+  }
+}
+
+void LengthCounter::clock() {
+  if (!halt && count > 0) {
+    count--;
+  }
+}
+
+// pulse
+Pulse::Pulse(bool ones_complement) : ones_complement(ones_complement) {}
+
+void Pulse::write(uint8_t reg, uint8_t data) {
+  switch (reg & 3) {
+  case 0:
+    duty = data >> 6;
+    length.halt = data & 0x20;
+    envelope.write(data);
+    break;
+  case 1:
+    sweep_enabled = data & 0x80;
+    sweep_period = (data >> 4) & 7;
+    sweep_negate = data & 0x08;
+    sweep_shift = data & 7;
+    sweep_reload = true;
+    break;
+  case 2:
+    timer = (timer & 0x700) | data;
+    break;
+  case 3:
+    timer = (timer & 0xff) | ((data & 7) << 8);
+    length.load(data >> 3);
+    envelope.start = true;
+    phase = 0;
+    break;
+  }
+}
+
+uint16_t Pulse::sweep_target() const {
+  uint16_t change = timer >> sweep_shift;
+  if (!sweep_negate) {
+    return timer + change;
+  }
+  return timer - change - ones_complement;
+}
+
+// short periods and sweeps past the top mute the channel even when the sweep
+// unit is off
+bool Pulse::audible() const {
+  return length.count > 0 && timer >= 8 &&
+         (sweep_negate || sweep_target() <= 0x7ff);
+}
+
+void Pulse::clock_half() {
+  length.clock();
+
+  if (sweep_divider == 0 && sweep_enabled && sweep_shift > 0 && audible()) {
+    timer = sweep_target();
+  }
+  if (sweep_divider == 0 || sweep_reload) {
+    sweep_divider = sweep_period;
+    sweep_reload = false;
+  } else {
+    sweep_divider--;
+  }
+}
+
+void Pulse::run(uint32_t end) {
+  const uint32_t period = (timer + 1) * 2;
+  int32_t volume = audible() ? envelope.volume() : 0;
+  voice.update(now, DUTY[duty][phase] ? volume : 0);
+
+  if (volume == 0) {
+    phase = (phase + skip(next, end, period)) & 7;
+  } else {
+    for (; next < end; next += period) {
+      phase = (phase + 1) & 7;
+      voice.update(next, DUTY[duty][phase] ? volume : 0);
+    }
+  }
+  now = end;
+}
+
+void Pulse::end_frame(uint32_t duration) {
+  now -= duration;
+  next -= duration;
+}
+
+// triangle
+void Triangle::write(uint8_t reg, uint8_t data) {
+  switch (reg & 3) {
+  case 0:
+    control = data & 0x80;
+    length.halt = control;
+    linear_reload = data & 0x7f;
+    break;
+  case 2:
+    timer = (timer & 0x700) | data;
+    break;
+  case 3:
+    timer = (timer & 0xff) | ((data & 7) << 8);
+    length.load(data >> 3);
+    linear_reload_flag = true;
+    break;
+  }
+}
+
+void Triangle::clock_quarter() {
+  if (linear_reload_flag) {
+    linear = linear_reload;
+  } else if (linear > 0) {
+    linear--;
+  }
+  if (!control) {
+    linear_reload_flag = false;
+  }
+}
+
+// a stopped triangle holds its level instead of dropping to 0. periods below
+// 2 are ultrasonic and only average out, they hold too
+void Triangle::run(uint32_t end) {
+  const uint32_t period = timer + 1;
+  voice.update(now, output());
+
+  if (length.count == 0 || linear == 0 || timer < 2) {
+    skip(next, end, period);
+  } else {
+    for (; next < end; next += period) {
+      phase = (phase + 1) & 31;
+      voice.update(next, TRIANGLE[phase]);
+    }
+  }
+  now = end;
+}
+
+int32_t Triangle::output() const { return TRIANGLE[phase]; }
+
+void Triangle::end_frame(uint32_t duration) {
+  now -= duration;
+  next -= duration;
+}
+
+// noise
+void Noise::write(uint8_t reg, uint8_t data) {
+  switch (reg & 3) {
+  case 0:
+    length.halt = data & 0x20;
+    envelope.write(data);
+    break;
+  case 2:
+    short_mode = data & 0x80;
+    period = data & 0x0f;
+    break;
+  case 3:
+    length.load(data >> 3);
+    envelope.start = true;
+    break;
+  }
+}
+
+// the shift register is only clocked while it can be heard, a silent channel
+// just lets the time go by
+void Noise::run(uint32_t end) {
+  const uint32_t steps = NOISE_PERIODS[period];
+  int32_t volume = length.count > 0 ? envelope.volume() : 0;
+  voice.update(now, (shift & 1) ? 0 : volume);
+
+  if (volume == 0) {
+    skip(next, end, steps);
+  } else {
+    const uint8_t tap = short_mode ? 6 : 1;
+    for (; next < end; next += steps) {
+      uint16_t feedback = (shift ^ (shift >> tap)) & 1;
+      shift = (shift >> 1) | (feedback << 14);
+      voice.update(next, (shift & 1) ? 0 : volume);
+    }
+  }
+  now = end;
+}
+
+void Noise::end_frame(uint32_t duration) {
+  now -= duration;
+  next -= duration;
+}
+
+// DMC
+void Dmc::set_reader(Reader read, void *context) {
+  reader = read;
+  reader_context = context;
+}
+
+void Dmc::write(uint8_t reg, uint8_t data) {
+  switch (reg & 3) {
+  case 0:
+    irq_enabled = data & 0x80;
+    loop = data & 0x40;
+    rate = data & 0x0f;
+    if (!irq_enabled) {
+      irq = false;
+    }
+    break;
+  case 1:
+    level = data & 0x7f;
+    break;
+  case 2:
+    sample_address = 0xc000 | (data << 6);
+    break;
+  case 3:
+    sample_length = (data << 4) + 1;
+    break;
+  }
+}
+
+void Dmc::set_enabled(bool enabled) {
+  irq = false;
+  if (!enabled) {
+    bytes_remaining = 0;
+  } else if (bytes_remaining == 0) {
+    restart();
+  }
+}
+
+void Dmc::restart() {
+  address = sample_address;
+  bytes_remaining = sample_length;
+}
+
+// the sample byte is fetched when the shift register empties, the CPU isn't
+// stalled for the read
+bool Dmc::fetch() {
+  if (bytes_remaining == 0) {
+    return false;
+  }
+
+  shift = reader != nullptr ? reader(reader_context, address) : 0;
+  address = address == 0xffff ? 0x8000 : address + 1;
+  if (--bytes_remaining == 0) {
+    if (loop) {
+      restart();
+    } else if (irq_enabled) {
+      irq = true;
+    }
+  }
+  return true;
+}
+
+uint32_t Dmc::irq_time() const {
+  if (!irq_enabled || loop || bytes_remaining == 0) {
+    return NO_IRQ;
+  }
+  // the last byte is fetched `bits` steps from now and then every 8 steps
+  return next + ((bits - 1) + 8u * (bytes_remaining - 1)) * DMC_RATES[rate];
+}
+
+void Dmc::run(uint32_t end) {
+  const uint32_t period = DMC_RATES[rate];
+  voice.update(now, level);
+
+  if (silence && bytes_remaining == 0) {
+    uint32_t steps = skip(next, end, period);
+    bits = (bits + 7 - steps % 8) % 8 + 1;
+  } else {
+    for (; next < end; next += period) {
+      if (!silence) {
+        if (shift & 1) {
+          level += level <= 125 ? 2 : 0;
+        } else {
+          level -= level >= 2 ? 2 : 0;
+        }
+        shift >>= 1;
+        voice.update(next, level);
+      }
+
+      if (--bits == 0) {
+        bits = 8;
+        silence = !fetch();
+      }
+    }
+  }
+  now = end;
+}
+
+void Dmc::end_frame(uint32_t duration) {
+  now -= duration;
+  next -= duration;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "blip_buffer.hpp"
+#include <cstdint>
+
+// the APU's sound channels. a channel is run up to a point in time (in CPU
+// cycles since the start of the audio frame) and only does work when its
+// waveform steps, every amplitude change goes into the blip buffer as a delta
+//
+// ref: https://www.nesdev.org/wiki/APU
+
+// a channel's share of the mix, linear approximation of the console's mixer
+struct Voice {
+  BlipBuffer *buffer = nullptr;
+  int32_t weight = 0;
+  int32_t amplitude = 0;
+
+  void update(uint32_t time, int32_t value) {
+    if (value != amplitude) {
+      buffer->add_delta(time, (value - amplitude) * weight);
+      amplitude = value;
+    }
+  }
+};
+
+// volume envelope of the pulse and noise channels, clocked every quarter frame
+struct Envelope {
+  uint8_t period = 0;
+  bool constant = false;
+  bool loop = false;
+  bool start = false;
+  uint8_t divider = 0;
+  uint8_t decay = 0;
+
+  void write(uint8_t data);
+  void clock();
+  uint8_t volume() const { return constant ? period : decay; }
+};
+
+// silences a channel once it runs out, clocked every half frame
+struct LengthCounter {
+  uint8_t count = 0;
+  bool halt = false;
+  bool enabled = false;
+
+  void load(uint8_t index);
+  void set_enabled(bool value);
+  void clock();
+};
+
+class Pulse {
+public:
+  // pulse 1 negates its sweep in one's complement, pulse 2 in two's
+  explicit Pulse(bool ones_complement);
+
+  void write(uint8_t reg, uint8_t data);
+  void run(uint32_t end);
+  void clock_quarter() { envelope.clock(); }
+  void clock_half();
+  void end_frame(uint32_t duration);
+
+  Voice voice;
+  LengthCounter length;
+
+private:
+  bool ones_complement;
+  Envelope envelope;
+  uint8_t duty = 0;
+  uint8_t phase = 0;
+  uint16_t timer = 0;
+  // sweep unit
+  bool sweep_enabled = false;
+  uint8_t sweep_period = 0;
+  bool sweep_negate = false;
+  uint8_t sweep_shift = 0;
+  uint8_t sweep_divider = 0;
+  bool sweep_reload = false;
+
+  uint32_t now = 0;
+  uint32_t next = 0;
+
+  uint16_t sweep_target() const;
+  bool audible() const;
+};
+
+class Triangle {
+public:
+  void write(uint8_t reg, uint8_t data);
+  void run(uint32_t end);
+  void clock_quarter();
+  void clock_half() { length.clock(); }
+  void end_frame(uint32_t duration);
+  int32_t output() const;
+
+  Voice voice;
+  LengthCounter length;
+
+private:
+  uint8_t phase = 0;
+  uint16_t timer = 0;
+  bool control = false;
+  uint8_t linear_reload = 0;
+  uint8_t linear = 0;
+  bool linear_reload_flag = false;
+
+  uint32_t now = 0;
+  uint32_t next = 0;
+};
+
+class Noise {
+public:
+  void write(uint8_t reg, uint8_t data);
+  void run(uint32_t end);
+  void clock_quarter() { envelope.clock(); }
+  void clock_half() { length.clock(); }
+  void end_frame(uint32_t duration);
+
+  Voice voice;
+  LengthCounter length;
+
+private:
+  Envelope envelope;
+  bool short_mode = false;
+  uint8_t period = 0;
+  uint16_t shift = 1;
+
+  uint32_t now = 0;
+  uint32_t next = 0;
+};
+
+// delta modulation channel, plays 1-bit delta samples straight out of CPU
+// memory
+class Dmc {
+public:
+  static constexpr uint32_t NO_IRQ = UINT32_MAX;
+
+  using Reader = uint8_t (*)(void *context, uint16_t addr);
+
+  void set_reader(Reader read, void *context);
+  void write(uint8_t reg, uint8_t data);
+  void set_enabled(bool enabled);
+  void run(uint32_t end);
+  void end_frame(uint32_t duration);
+
+  bool active() const { return bytes_remaining > 0; }
+  // time of the IRQ at the end of the sample, if it raises one
+  uint32_t irq_time() const;
+
+  Voice voice;
+  bool irq = false;
+
+private:
+  Reader reader = nullptr;
+  void *reader_context = nullptr;
+
+  bool irq_enabled = false;
+  bool loop = false;
+  uint8_t rate = 0;
+  uint8_t level = 0;
+  uint16_t sample_address = 0xc000;
+  uint16_t sample_length = 1;
+
+  uint16_t address = 0xc000;
+  uint16_t bytes_remaining = 0;
+  uint8_t shift = 0;
+  uint8_t bits = 8;
+  bool silence = true;
+
+  uint32_t now = 0;
+  uint32_t next = 0;
+
+  void restart();
+  bool fetch();
+};
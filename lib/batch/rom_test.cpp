@@ -0,0 +1,190 @@
+#include "rom_test.hpp"
+#include "../nes/nes.hpp"
+#include "../pipeline/worker.hpp"
+#include <cstdio>
+#include <utility>
+
+#if defined(__cpp_exceptions)
+#include <exception>
+#endif
+
+namespace {
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001b3;
+constexpr uint16_t RAM_SIZE = 0x800;
+// frames between the ROM asking for a reset and the reset, about 100 ms
+constexpr uint32_t RESET_DELAY = 6;
+// the message stays inside PRG-RAM
+constexpr uint16_t TEXT_END = 0x8000;
+
+uint64_t fnv1a(uint64_t hash, const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+void hash_line(void *context, uint16_t, const uint8_t *pixels) {
+  auto *hash = static_cast<uint64_t *>(context);
+  *hash = fnv1a(*hash, pixels, PPU::WIDTH);
+}
+
+// the RAM, then the picture of the last frame
+uint64_t hash_console(CPU &cpu, uint64_t frame_hash) {
+  uint8_t ram[RAM_SIZE];
+  for (uint16_t addr = 0; addr < RAM_SIZE; ++addr) {
+    ram[addr] = cpu.mem_read(addr);
+  }
+  uint64_t hash = fnv1a(FNV_OFFSET, ram, RAM_SIZE);
+  return fnv1a(hash, reinterpret_cast<const uint8_t *>(&frame_hash),
+               sizeof(frame_hash));
+}
+
+// PRG-RAM is plain memory, reading it has no side effects
+bool has_signature(CPU &cpu) {
+  for (uint16_t i = 0; i < sizeof(test_result::SIGNATURE_BYTES); ++i) {
+    if (cpu.mem_read(test_result::SIGNATURE + i) !=
+        test_result::SIGNATURE_BYTES[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// without the trailing newlines
+std::string read_message(CPU &cpu) {
+  std::string message;
+  for (uint16_t addr = test_result::TEXT; addr < TEXT_END; ++addr) {
+    uint8_t c = cpu.mem_read(addr);
+    if (c == 0) {
+      break;
+    }
+    message.push_back(static_cast<char>(c));
+  }
+  while (!message.empty() &&
+         (message.back() == '\n' || message.back() == ' ')) {
+    message.pop_back();
+  }
+  return message;
+}
+
+std::string halt_message(const CPU &cpu) {
+  char message[64];
+  std::snprintf(message, sizeof(message), "CPU %s at $%04x",
+                cpu.get_halt() == CPU::Halt::Stopped
+                    ? "stopped"
+                    : "hit an invalid addressing mode",
+                cpu.get_pc());
+  return message;
+}
+
+struct Batch {
+  const std::vector<RomTest> *tests;
+  std::vector<RomResult> *results;
+};
+
+void run_one(void *context, size_t index) {
+  auto *batch = static_cast<Batch *>(context);
+  (*batch->results)[index] = run_rom_test((*batch->tests)[index]);
+}
+} // namespace
+
+const char *verdict_name(Verdict verdict) {
+  switch (verdict) {
+  case Verdict::Pass:
+    return "pass";
+  case Verdict::Fail:
+    return "fail";
+  case Verdict::Timeout:
+    return "timeout";
+  case Verdict::Mismatch:
+    return "mismatch";
+  case Verdict::Recorded:
+    return "recorded";
+  case Verdict::Error:
+    return "error";
+  }
+  return "?";
+}
+
+RomResult run_rom_test(RomImage image, const RomTest &test) {
+  uint64_t start = Worker::now_us();
+  RomResult result{Verdict::Timeout, 0, "", 0, 0, 0, 0};
+  NES nes(std::move(image));
+  CPU &cpu = nes.get_cpu();
+  uint64_t frame_hash = FNV_OFFSET;
+  bool reset_pending = false;
+  uint32_t reset_frame = 0;
+
+  while (result.frames < test.frames) {
+    // only the last frame is hashed, the ones before it aren't looked at
+    if (test.hash_mode && result.frames + 1 == test.frames) {
+      nes.get_ppu().set_scanline_handler(hash_line, &frame_hash);
+    }
+    nes.run_frame();
+    result.frames++;
+    result.cycles = cpu.get_cycles();
+
+    if (cpu.get_halt() != CPU::Halt::None) {
+      result.verdict = Verdict::Error;
+      result.message = halt_message(cpu);
+      break;
+    }
+    if (test.cycles > 0 && result.cycles >= test.cycles) {
+      break;
+    }
+    if (test.hash_mode || !has_signature(cpu)) {
+      continue;
+    }
+
+    uint8_t status = cpu.mem_read(test_result::STATUS);
+    if (status == test_result::NEEDS_RESET) {
+      if (!reset_pending) {
+        reset_pending = true;
+        reset_frame = result.frames + RESET_DELAY;
+      } else if (result.frames >= reset_frame) {
+        nes.reset();
+        reset_pending = false;
+      }
+    } else if (status < test_result::RUNNING) {
+      result.verdict = status == 0 ? Verdict::Pass : Verdict::Fail;
+      result.code = status;
+      result.message = read_message(cpu);
+      break;
+    }
+  }
+
+  if (test.hash_mode && result.verdict == Verdict::Timeout &&
+      result.frames == test.frames) {
+    result.hash = hash_console(cpu, frame_hash);
+    if (!test.check_hash) {
+      result.verdict = Verdict::Recorded;
+    } else {
+      result.verdict =
+          result.hash == test.hash ? Verdict::Pass : Verdict::Mismatch;
+    }
+  }
+  result.wall_us = Worker::now_us() - start;
+  return result;
+}
+
+// a ROM that doesn't load is that ROM's error, the batch goes on
+RomResult run_rom_test(const RomTest &test) {
+#if defined(__cpp_exceptions)
+  try {
+    return run_rom_test(RomImage::map_file(test.path.c_str()), test);
+  } catch (const std::exception &e) {
+    return {Verdict::Error, 0, e.what(), 0, 0, 0, 0};
+  }
+#else
+  return run_rom_test(RomImage::map_file(test.path.c_str()), test);
+#endif
+}
+
+std::vector<RomResult> run_rom_tests(const std::vector<RomTest> &tests,
+                                     WorkPool &pool) {
+  std::vector<RomResult> results(tests.size());
+  Batch batch{&tests, &results};
+  pool.run(tests.size(), run_one, &batch);
+  return results;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../cartridge/rom_image.hpp"
+#include "work_pool.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the result protocol of the test ROMs (blargg's and ours): once
+// $6001-$6003 hold DE B0 61, $6000 is the status and a zero terminated
+// message starts at $6004
+namespace test_result {
+constexpr uint16_t STATUS = 0x6000;
+constexpr uint16_t SIGNATURE = 0x6001;
+constexpr uint16_t TEXT = 0x6004;
+constexpr uint8_t SIGNATURE_BYTES[] = {0xde, 0xb0, 0x61};
+// anything below RUNNING is the result, 0 for a pass
+constexpr uint8_t RUNNING = 0x80;
+// the ROM wants the console reset in 100 ms
+constexpr uint8_t NEEDS_RESET = 0x81;
+} // namespace test_result
+
+enum class Verdict : uint8_t {
+  Pass,
+  // the ROM reported a nonzero result
+  Fail,
+  // the frame or cycle limit ran out before a result
+  Timeout,
+  // the hash after the last frame is not the expected one
+  Mismatch,
+  // hash mode without an expected hash, the hash is in the result
+  Recorded,
+  // the ROM didn't load, or the CPU halted
+  Error,
+};
+
+const char *verdict_name(Verdict verdict);
+
+// one ROM and how it is judged. with the result protocol it runs until the
+// ROM reports, or up to the limits. in hash mode it runs exactly `frames`
+// frames and the RAM and the picture of the last frame are hashed, for ROMs
+// (nestest, games) that don't report anything
+struct RomTest {
+  std::string path;
+  uint32_t frames;
+  // 0 for no limit
+  uint64_t cycles;
+  bool hash_mode;
+  bool check_hash;
+  uint64_t hash;
+};
+
+struct RomResult {
+  Verdict verdict;
+  // the status at $6000
+  uint8_t code;
+  // the ROM's message, or what went wrong
+  std::string message;
+  uint32_t frames;
+  uint64_t cycles;
+  uint64_t hash;
+  uint64_t wall_us;
+};
+
+// runs a ROM on an emulator of its own. nothing is shared between two
+// calls, so any number of them can run at the same time
+RomResult run_rom_test(RomImage image, const RomTest &test);
+// maps test.path first
+RomResult run_rom_test(const RomTest &test);
+// every test on the pool, the results in the same order
+std::vector<RomResult> run_rom_tests(const std::vector<RomTest> &tests,
+                                     WorkPool &pool);
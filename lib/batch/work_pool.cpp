@@ -0,0 +1,67 @@
+#include "work_pool.hpp"
+#include <algorithm>
+#include <thread>
+
+WorkPool::WorkPool(unsigned count)
+    : threads(count > 0 ? count
+                        : std::max(1u, std::thread::hardware_concurrency())),
+      deques(std::make_unique<Deque[]>(threads)), job(nullptr),
+      context(nullptr), steals(0) {}
+
+void WorkPool::run(size_t count, Job target, void *target_context) {
+  job = target;
+  context = target_context;
+  steals = 0;
+  // dealt round robin, so neighbouring jobs (ex: ROMs of the same suite,
+  // which take about as long) end up on different threads
+  for (size_t index = 0; index < count; ++index) {
+    deques[index % threads].jobs.push_back(index);
+  }
+
+  std::vector<Thread> contexts(threads);
+  auto workers = std::make_unique<Worker[]>(threads);
+  for (unsigned id = 0; id < threads; ++id) {
+    contexts[id] = {this, id};
+    workers[id].start("pool", work, &contexts[id], id % 2);
+  }
+  for (unsigned id = 0; id < threads; ++id) {
+    workers[id].join();
+  }
+}
+
+bool WorkPool::take(unsigned id, size_t &index) {
+  Deque &own = deques[id];
+  std::lock_guard<std::mutex> guard(own.lock);
+  if (own.jobs.empty()) {
+    return false;
+  }
+  index = own.jobs.front();
+  own.jobs.pop_front();
+  return true;
+}
+
+// starts at the next thread over, so the thieves spread out
+bool WorkPool::steal(unsigned id, size_t &index) {
+  for (unsigned offset = 1; offset < threads; ++offset) {
+    Deque &victim = deques[(id + offset) % threads];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.jobs.empty()) {
+      index = victim.jobs.back();
+      victim.jobs.pop_back();
+      steals++;
+      return true;
+    }
+  }
+  return false;
+}
+
+// nothing is added while the pool runs, so once every deque is empty the
+// thread is done
+void WorkPool::work(void *thread) {
+  auto *self = static_cast<Thread *>(thread);
+  WorkPool &pool = *self->pool;
+  size_t index;
+  while (pool.take(self->id, index) || pool.steal(self->id, index)) {
+    pool.job(pool.context, index);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../pipeline/worker.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// runs a batch of independent jobs on a pool of threads (native builds).
+// every thread is dealt its share of the jobs up front, takes them from the
+// front of its own deque and, once that is empty, steals from the back of the
+// others, so a few slow jobs at the end don't leave the other cores idle.
+// jobs are whole emulator runs, a lock per deque costs nothing next to them
+class WorkPool {
+public:
+  using Job = void (*)(void *context, size_t index);
+
+  // 0 threads is one per core
+  explicit WorkPool(unsigned threads = 0);
+  WorkPool(const WorkPool &) = delete;
+  WorkPool &operator=(const WorkPool &) = delete;
+
+  // calls job(context, index) once for every index below count, on any of
+  // the threads, and returns once all of them have
+  void run(size_t count, Job job, void *context);
+
+  unsigned get_threads() const { return threads; }
+  // jobs taken from another thread's deque during the last run
+  uint64_t get_steals() const { return steals; }
+
+private:
+  struct Deque {
+    std::mutex lock;
+    std::deque<size_t> jobs;
+  };
+  struct Thread {
+    WorkPool *pool;
+    unsigned id;
+  };
+
+  unsigned threads;
+  std::unique_ptr<Deque[]> deques;
+  Job job;
+  void *context;
+  std::atomic<uint64_t> steals;
+
+  bool take(unsigned id, size_t &index);
+  bool steal(unsigned id, size_t &index);
+  static void work(void *thread);
+};
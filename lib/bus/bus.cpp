@@ -1,14 +1,64 @@
 #include "bus.hpp"
 #include "../constants/constants.hpp"
+#include "../error/error.hpp"
+#include "../state/state.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 
-Bus::Bus() {}
+namespace {
+// nothing drives the data bus for unmapped addresses, reads just see 0
+uint8_t open_bus_read(void *, uint16_t, uint64_t) { return 0; }
+void open_bus_write(void *, uint16_t, uint8_t, uint64_t) {}
 
-uint8_t Bus::mem_read(uint16_t addr) {
-  if (memory_map::RAM_START <= addr && addr <= memory_map::RAM_END) {
-    addr = addr & 0b0000011111111111;
+constexpr uint32_t STATE_SECTION = state::tag("BUS ");
+} // namespace
+
+Bus::Bus()
+    : watched_pages{}, watched_io{}, page_versions{}, generation(0),
+      layout(0), dirty_pages{}, state_sequence(0), ram{}, idle_clock(0),
+      clock(&idle_clock) {
+  map_io(0x0000, 0x10000, open_bus_read, open_bus_write, nullptr);
+
+  // 2 KiB of RAM mirrored 4 times across [0x0000..0x2000]
+  for (uint32_t mirror = memory_map::RAM_START; mirror < memory_map::RAM_END;
+       mirror += ram.size()) {
+    map_memory(mirror, ram.size(), ram.data());
   }
+}
 
-  return ram[addr];
+Bus::Bus(const Bus &other)
+    : read_pages(other.read_pages), write_pages(other.write_pages),
+      io_pages(other.io_pages), watched_pages(other.watched_pages),
+      watched_io(other.watched_io), page_versions(other.page_versions),
+      generation(other.generation), layout(other.layout),
+      dirty_pages(other.dirty_pages),
+      state_sequence(other.state_sequence), ram(other.ram),
+      program_memory(other.program_memory), idle_clock(other.idle_clock),
+      clock(other.clock) {
+  rebase(other);
+}
+
+Bus &Bus::operator=(const Bus &other) {
+  if (this != &other) {
+    read_pages = other.read_pages;
+    write_pages = other.write_pages;
+    io_pages = other.io_pages;
+    watched_pages = other.watched_pages;
+    watched_io = other.watched_io;
+    page_versions = other.page_versions;
+    generation = other.generation;
+    layout = other.layout;
+    dirty_pages = other.dirty_pages;
+    state_sequence = other.state_sequence;
+    ram = other.ram;
+    program_memory = other.program_memory;
+    idle_clock = other.idle_clock;
+    clock = other.clock;
+    rebase(other);
+  }
+
+  return *this;
 }
 
 uint16_t Bus::mem_read_u16(uint16_t addr) {
@@ -18,8 +68,6 @@ uint16_t Bus::mem_read_u16(uint16_t addr) {
   return (high << 8) | low;
 }
 
-void Bus::mem_write(uint16_t addr, uint8_t data) { ram[addr] = data; }
-
 void Bus::mem_write_u16(uint16_t addr, uint16_t data) {
   auto low = static_cast<uint8_t>(data & 0xff);
   auto high = static_cast<uint8_t>(data >> 8);
@@ -27,3 +75,289 @@ void Bus::mem_write_u16(uint16_t addr, uint16_t data) {
   mem_write(addr, low);
   mem_write(addr + 1, high);
 }
+
+void Bus::map_memory(uint16_t addr, uint32_t size, uint8_t *memory) {
+  generation++;
+  layout++;
+  for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+    auto page = (addr + offset) >> PAGE_SHIFT;
+    unwatch(page);
+    read_pages[page] = memory + offset;
+    write_pages[page] = memory + offset;
+  }
+}
+
+// a PRG bank switch only moves read-only pages, the writable ones stay put
+void Bus::map_rom(uint16_t addr, uint32_t size, const uint8_t *memory) {
+  generation++;
+  for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+    auto page = (addr + offset) >> PAGE_SHIFT;
+    unmap_writable(page);
+    unwatch(page);
+    read_pages[page] = memory + offset;
+    write_pages[page] = nullptr;
+  }
+}
+
+void Bus::map_io(uint16_t addr, uint32_t size, ReadHandler read,
+                 WriteHandler write, void *context) {
+  generation++;
+  for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+    auto page = (addr + offset) >> PAGE_SHIFT;
+    unmap_writable(page);
+    unwatch(page);
+    read_pages[page] = nullptr;
+    write_pages[page] = nullptr;
+    io_pages[page] = {read, write, context};
+  }
+}
+
+void Bus::load_program(const std::vector<uint8_t> &program,
+                       uint16_t start_addr) {
+  uint32_t first_page = start_addr >> PAGE_SHIFT;
+  uint32_t end_page =
+      (start_addr + program.size() + PAGE_SIZE - 1) >> PAGE_SHIFT;
+  if (end_page > PAGE_COUNT) {
+    end_page = PAGE_COUNT;
+  }
+
+  bool backed = true;
+  for (uint32_t page = first_page; page < end_page; ++page) {
+    backed &= write_pages[page] != nullptr;
+  }
+
+  // the backing covers the whole address space, a page at its own offset, and
+  // is allocated once: pages mapped by an earlier call stay where they are
+  if (!backed) {
+    if (program_memory.empty()) {
+      program_memory.assign(PAGE_COUNT << PAGE_SHIFT, 0);
+    }
+
+    for (uint32_t page = first_page; page < end_page; ++page) {
+      if (write_pages[page] == nullptr) {
+        map_memory(page << PAGE_SHIFT, PAGE_SIZE,
+                   program_memory.data() + (page << PAGE_SHIFT));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < program.size(); ++i) {
+    mem_write(start_addr + i, program[i]);
+  }
+}
+
+void Bus::watch_writes(uint8_t page) {
+  uint8_t *memory = write_pages[page];
+  if (memory == nullptr) {
+    return;
+  }
+
+  // the mirrors of the page too, they write the same memory
+  for (uint32_t other = 0; other < PAGE_COUNT; ++other) {
+    if (write_pages[other] == memory) {
+      watched_pages[other] = memory;
+      watched_io[other] = io_pages[other];
+      write_pages[other] = nullptr;
+      io_pages[other] = {open_bus_read, watched_write, this};
+    }
+  }
+}
+
+void Bus::unwatch(uint32_t page) {
+  if (watched_pages[page] != nullptr) {
+    watched_pages[page] = nullptr;
+    io_pages[page] = watched_io[page];
+    page_versions[page]++;
+  }
+}
+
+void Bus::watched_write(void *context, uint16_t addr, uint8_t data,
+                        uint64_t) {
+  auto *bus = static_cast<Bus *>(context);
+  uint8_t *memory = bus->watched_pages[addr >> PAGE_SHIFT];
+  memory[addr & (PAGE_SIZE - 1)] = data;
+  bus->dirty_pages[addr >> PAGE_SHIFT] = 1;
+
+  // every mirror of the page sees the write
+  for (uint32_t page = 0; page < PAGE_COUNT; ++page) {
+    if (bus->watched_pages[page] == memory) {
+      bus->page_versions[page]++;
+    }
+  }
+  bus->generation++;
+}
+
+// watches are dropped on the copy, its writes take the fast path again
+void Bus::rebase(const Bus &other) {
+  if (clock == &other.idle_clock) {
+    clock = &idle_clock;
+  }
+
+  for (uint32_t page = 0; page < PAGE_COUNT; ++page) {
+    if (watched_pages[page] != nullptr) {
+      write_pages[page] = watched_pages[page];
+      io_pages[page] = watched_io[page];
+      watched_pages[page] = nullptr;
+    }
+  }
+
+  auto rebase_page = [&](const uint8_t *page) -> uint8_t * {
+    if (page >= other.ram.data() && page < other.ram.data() + ram.size()) {
+      return ram.data() + (page - other.ram.data());
+    }
+
+    const uint8_t *program_begin = other.program_memory.data();
+    const uint8_t *program_end = program_begin + other.program_memory.size();
+    if (page >= program_begin && page < program_end) {
+      return program_memory.data() + (page - program_begin);
+    }
+
+    return const_cast<uint8_t *>(page);
+  };
+
+  for (uint32_t page = 0; page < PAGE_COUNT; ++page) {
+    if (read_pages[page] != nullptr) {
+      read_pages[page] = rebase_page(read_pages[page]);
+    }
+    if (write_pages[page] != nullptr) {
+      write_pages[page] = rebase_page(write_pages[page]);
+    }
+  }
+}
+
+uint8_t *Bus::writable_page(uint32_t page) const {
+  return write_pages[page] != nullptr ? write_pages[page]
+                                      : watched_pages[page];
+}
+
+// a writable page going away changes the snapshot page list
+void Bus::unmap_writable(uint32_t page) {
+  if (writable_page(page) != nullptr) {
+    layout++;
+  }
+}
+
+void Bus::save_state(StateWriter &writer) {
+  auto kind = writer.get_kind();
+  bool delta = kind == state::Kind::Delta;
+
+  // a write through a mirror dirties the first page mapping the same memory
+  std::array<bool, PAGE_COUNT> saved{};
+  uint32_t count = 0;
+  for (uint32_t page = 0; page < PAGE_COUNT; ++page) {
+    uint8_t *memory = writable_page(page);
+    if (memory == nullptr) {
+      continue;
+    }
+
+    uint32_t first = 0;
+    while (writable_page(first) != memory) {
+      first++;
+    }
+
+    bool save = !delta || dirty_pages[page];
+    if (save && !saved[first]) {
+      saved[first] = true;
+      count++;
+    }
+  }
+
+  writer.begin_section(STATE_SECTION);
+  writer.write_u16(static_cast<uint16_t>(count));
+  for (uint32_t page = 0; page < PAGE_COUNT; ++page) {
+    if (saved[page]) {
+      writer.write_u8(static_cast<uint8_t>(page));
+      writer.write_bytes(writable_page(page), PAGE_SIZE);
+    }
+  }
+  writer.end_section();
+
+  if (kind != state::Kind::Snapshot) {
+    dirty_pages.fill(0);
+    state_sequence = writer.get_sequence();
+  }
+}
+
+void Bus::load_state(StateReader &reader) {
+  if (!reader.find_section(STATE_SECTION)) {
+    error::fail("save state has no bus section");
+  }
+  if (reader.get_kind() == state::Kind::Delta &&
+      reader.get_sequence() != state_sequence + 1) {
+    error::fail("save state delta doesn't follow the bus' state");
+  }
+
+  bool snapshot = reader.get_kind() == state::Kind::Snapshot;
+  uint16_t count = reader.read_u16();
+  if (reader.remaining() != count * (1u + PAGE_SIZE)) {
+    error::fail("save state bus section has the wrong size");
+  }
+  for (uint16_t i = 0; i < count; ++i) {
+    uint8_t *memory = writable_page(reader.read_u8());
+    if (memory == nullptr) {
+      error::fail("save state page isn't writable memory");
+    }
+    // pages that didn't change keep the code decoded out of them
+    uint8_t bytes[PAGE_SIZE];
+    reader.read_bytes(bytes, PAGE_SIZE);
+    if (std::memcmp(memory, bytes, PAGE_SIZE) == 0) {
+      continue;
+    }
+    std::memcpy(memory, bytes, PAGE_SIZE);
+    invalidate(memory, snapshot);
+  }
+
+  generation++;
+  if (!snapshot) {
+    dirty_pages.fill(0);
+    state_sequence = reader.get_sequence();
+  }
+}
+
+void Bus::take_snapshot(Snapshot &snapshot) const {
+  if (snapshot.layout != layout) {
+    snapshot.pages.clear();
+    for (uint32_t page = 0; page < PAGE_COUNT; ++page) {
+      uint8_t *memory = writable_page(page);
+      if (memory != nullptr &&
+          std::find(snapshot.pages.begin(), snapshot.pages.end(), memory) ==
+              snapshot.pages.end()) {
+        snapshot.pages.push_back(memory);
+      }
+    }
+    snapshot.memory.resize(snapshot.pages.size() * PAGE_SIZE);
+    snapshot.layout = layout;
+  }
+
+  uint8_t *out = snapshot.memory.data();
+  for (uint8_t *memory : snapshot.pages) {
+    std::memcpy(out, memory, PAGE_SIZE);
+    out += PAGE_SIZE;
+  }
+}
+
+void Bus::restore_snapshot(const Snapshot &snapshot) {
+  const uint8_t *in = snapshot.memory.data();
+  bool changed = false;
+  for (uint8_t *memory : snapshot.pages) {
+    if (std::memcmp(memory, in, PAGE_SIZE) != 0) {
+      std::memcpy(memory, in, PAGE_SIZE);
+      invalidate(memory, true);
+      changed = true;
+    }
+    in += PAGE_SIZE;
+  }
+
+  if (changed) {
+    generation++;
+  }
+}
+
+void Bus::invalidate(const uint8_t *memory, bool mark_dirty) {
+  for (uint32_t page = 0; page < PAGE_COUNT; ++page) {
+    if (read_pages[page] == memory || watched_pages[page] == memory) {
+      page_versions[page]++;
+      dirty_pages[page] |= mark_dirty;
+    }
+  }
+}
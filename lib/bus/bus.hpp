@@ -2,16 +2,174 @@
 
 #include <array>
 #include <cstdint>
+#include <vector>
 
+class StateWriter;
+class StateReader;
+
+// the CPU address space is split into 256 pages of 256 bytes. a page is either
+// backed by host memory (RAM and its mirrors, PRG-ROM, PRG-RAM), in which case
+// an access is one table lookup plus a load/store, or it is routed to the
+// handlers of a memory mapped device (PPU/APU registers, mapper registers)
+//
+// handlers are passed the CPU cycle of the access, so a device can catch up
+// to it lazily instead of being ticked alongside the CPU
 class Bus {
 public:
+  using ReadHandler = uint8_t (*)(void *context, uint16_t addr,
+                                  uint64_t cycle);
+  using WriteHandler = void (*)(void *context, uint16_t addr, uint8_t data,
+                                uint64_t cycle);
+
+  static constexpr uint16_t PAGE_SHIFT = 8;
+  static constexpr uint16_t PAGE_SIZE = 1 << PAGE_SHIFT;
+  static constexpr uint16_t PAGE_COUNT = 0x10000 >> PAGE_SHIFT;
+
   Bus();
+  // pages pointing into the bus' own memory are rebased onto the copy, pages
+  // pointing anywhere else (cartridge, devices) are shared with it
+  Bus(const Bus &other);
+  Bus &operator=(const Bus &other);
 
   uint8_t mem_read(uint16_t addr);
   uint16_t mem_read_u16(uint16_t addr);
   void mem_write(uint16_t addr, uint8_t data);
   void mem_write_u16(uint16_t addr, uint16_t data);
 
+  // all ranges must start and end on a page boundary
+  //
+  // maps the range onto readable and writable host memory
+  void map_memory(uint16_t addr, uint32_t size, uint8_t *memory);
+  // maps reads of the range onto host memory, writes keep going to the
+  // range's write handler (ex: mapper registers sitting on top of PRG-ROM)
+  void map_rom(uint16_t addr, uint32_t size, const uint8_t *memory);
+  // routes every access in the range to the handlers
+  void map_io(uint16_t addr, uint32_t size, ReadHandler read,
+              WriteHandler write, void *context);
+
+  // code caches
+  //
+  // host memory behind a page for reads, nullptr for I/O pages
+  const uint8_t *get_read_page(uint8_t page) const { return read_pages[page]; }
+  // bumped by every remap and every write to a watched page
+  const uint32_t &get_generation() const { return generation; }
+  // bumped by every write to the page while it is watched
+  uint32_t get_page_version(uint8_t page) const { return page_versions[page]; }
+  // counts the writes to the page's memory, through the page itself or any
+  // of its mirrors, on a slower path than plain memory. remapping a page
+  // drops its watch
+  void watch_writes(uint8_t page);
+  // the page tables themselves, for code generated against them
+  const uint8_t *const *read_page_table() const { return read_pages.data(); }
+  uint8_t *const *write_page_table() const { return write_pages.data(); }
+  // one byte per page, set by every write through it. code writing straight
+  // to the page tables has to set it too
+  uint8_t *dirty_page_table() { return dirty_pages.data(); }
+  // backed by memory the CPU can write to (RAM, PRG-RAM), watched or not
+  bool is_writable(uint8_t page) const {
+    return writable_page(page) != nullptr;
+  }
+
+  // save states
+  //
+  // adds a "BUS " section holding every page of writable memory (RAM,
+  // PRG-RAM, memory from load_program) once, through whichever of its
+  // mirrors comes first. a delta only holds the pages written to since the
+  // last full state or delta saved or loaded
+  void save_state(StateWriter &writer);
+  // the memory map has to be the one the state was saved with, the section
+  // only holds memory. a delta has to follow the state the bus is in, a
+  // snapshot counts as writes to every page it restores
+  void load_state(StateReader &reader);
+  // sequence number of the state the memory last matched
+  uint32_t get_state_sequence() const { return state_sequence; }
+
+  // snapshots
+  //
+  // a copy of every page of writable memory, taken and restored several
+  // times a frame (run-ahead). nothing is serialized: the pages are copied
+  // as they are and only go back into the bus they were taken from
+  struct Snapshot {
+    // the unique writable pages, worked out again only when writable memory
+    // was mapped or unmapped since the last snapshot
+    std::vector<uint8_t *> pages;
+    std::vector<uint8_t> memory;
+    uint32_t layout = UINT32_MAX;
+  };
+  void take_snapshot(Snapshot &snapshot) const;
+  // copies back the pages that changed since, like a snapshot state does
+  // (code decoded out of them is dropped, they count as written)
+  void restore_snapshot(const Snapshot &snapshot);
+
+  // points the bus at the cycle counter of the CPU driving it
+  void set_clock(uint64_t *cycles) { clock = cycles; }
+  uint64_t get_cycle() const { return *clock; }
+  // holds the CPU for `cycles` more cycles (ex: OAM DMA)
+  void stall(uint32_t cycles) { *clock += cycles; }
+
+  // copies the program into memory, backing any page of the range that is not
+  // writable yet with memory owned by the bus
+  void load_program(const std::vector<uint8_t> &program, uint16_t start_addr);
+
 private:
-  std::array<uint8_t, 65536> ram;
-};
\ No newline at end of file
+  struct IoHandler {
+    ReadHandler read;
+    WriteHandler write;
+    void *context;
+  };
+
+  std::array<const uint8_t *, PAGE_COUNT> read_pages;
+  std::array<uint8_t *, PAGE_COUNT> write_pages;
+  std::array<IoHandler, PAGE_COUNT> io_pages;
+  // memory behind the watched pages, their write_pages entry is cleared and
+  // their handlers are set aside
+  std::array<uint8_t *, PAGE_COUNT> watched_pages;
+  std::array<IoHandler, PAGE_COUNT> watched_io;
+  std::array<uint32_t, PAGE_COUNT> page_versions;
+  uint32_t generation;
+  // bumped when the set of writable pages changes (map_memory, or ROM / I/O
+  // mapped over writable memory), unlike generation. a bank switch doesn't
+  // bump it, so snapshots don't work out their page list again
+  uint32_t layout;
+  std::array<uint8_t, PAGE_COUNT> dirty_pages;
+  uint32_t state_sequence;
+
+  std::array<uint8_t, 0x800> ram;
+  std::vector<uint8_t> program_memory;
+  // counts nothing until a CPU is attached
+  uint64_t idle_clock;
+  uint64_t *clock;
+
+  void rebase(const Bus &other);
+  void unwatch(uint32_t page);
+  uint8_t *writable_page(uint32_t page) const;
+  void unmap_writable(uint32_t page);
+  // code decoded out of the memory is stale, on every page mapping it
+  void invalidate(const uint8_t *memory, bool mark_dirty);
+
+  static void watched_write(void *context, uint16_t addr, uint8_t data,
+                            uint64_t cycle);
+};
+
+// the fast paths live in the header so that they inline into the CPU handlers
+inline uint8_t Bus::mem_read(uint16_t addr) {
+  const uint8_t *page = read_pages[addr >> PAGE_SHIFT];
+  if (page != nullptr) {
+    return page[addr & (PAGE_SIZE - 1)];
+  }
+
+  const auto &io = io_pages[addr >> PAGE_SHIFT];
+  return io.read(io.context, addr, *clock);
+}
+
+inline void Bus::mem_write(uint16_t addr, uint8_t data) {
+  uint8_t *page = write_pages[addr >> PAGE_SHIFT];
+  if (page != nullptr) {
+    page[addr & (PAGE_SIZE - 1)] = data;
+    dirty_pages[addr >> PAGE_SHIFT] = 1;
+    return;
+  }
+
+  const auto &io = io_pages[addr >> PAGE_SHIFT];
+  io.write(io.context, addr, data, *clock);
+}
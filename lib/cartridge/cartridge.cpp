@@ -0,0 +1,117 @@
+#include "cartridge.hpp"
+#include "../error/error.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace {
+// NES 2.0 stores sizes above what the 12-bit unit count can express as
+// 2^exponent * (multiplier * 2 + 1). the exponent goes up to 63, sizes that
+// don't fit a size_t (32 bits on the ESP32) come out as SIZE_MAX, which no
+// image holds
+size_t nes2_rom_size(uint8_t lsb, uint8_t msb_nibble, size_t unit) {
+  if (msb_nibble == 0x0f) {
+    uint8_t exponent = lsb >> 2;
+    uint8_t multiplier = lsb & 0b11;
+    // the factor takes up to 3 more bits
+    if (exponent > std::numeric_limits<size_t>::digits - 3) {
+      return SIZE_MAX;
+    }
+    return (static_cast<size_t>(1) << exponent) * (multiplier * 2 + 1);
+  }
+
+  return ((static_cast<size_t>(msb_nibble) << 8) | lsb) * unit;
+}
+
+size_t nes2_ram_size(uint8_t shift) { return shift == 0 ? 0 : 64u << shift; }
+} // namespace
+
+RomHeader ines::parse_header(const uint8_t *data, size_t size) {
+  if (size < HEADER_SIZE || std::memcmp(data, "NES\x1a", 4) != 0) {
+    error::fail("not an iNES image");
+  }
+
+  RomHeader header = {};
+  uint8_t flags6 = data[6];
+  uint8_t flags7 = data[7];
+
+  header.nes2 = (flags7 & 0b00001100) == 0b00001000;
+  header.battery = (flags6 & 0b00000010) != 0;
+  header.trainer = (flags6 & 0b00000100) != 0;
+
+  if (flags6 & 0b00001000) {
+    header.mirroring = Mirroring::FourScreen;
+  } else if (flags6 & 0b00000001) {
+    header.mirroring = Mirroring::Vertical;
+  } else {
+    header.mirroring = Mirroring::Horizontal;
+  }
+
+  if (header.nes2) {
+    header.mapper = (static_cast<uint16_t>(data[8] & 0x0f) << 8) |
+                    (flags7 & 0xf0) | (flags6 >> 4);
+    header.submapper = data[8] >> 4;
+    header.prg_rom_size = nes2_rom_size(data[4], data[9] & 0x0f, PRG_ROM_UNIT);
+    header.chr_rom_size = nes2_rom_size(data[5], data[9] >> 4, CHR_ROM_UNIT);
+    header.prg_ram_size =
+        nes2_ram_size(data[10] & 0x0f) + nes2_ram_size(data[10] >> 4);
+    header.chr_ram_size =
+        nes2_ram_size(data[11] & 0x0f) + nes2_ram_size(data[11] >> 4);
+  } else {
+    // dumps tagged by old tools ("DiskDude!") have garbage past byte 7, the
+    // upper mapper nibble can't be trusted for those
+    bool dirty = data[12] != 0 || data[13] != 0 || data[14] != 0 ||
+                 data[15] != 0;
+
+    header.mapper = (dirty ? 0 : (flags7 & 0xf0)) | (flags6 >> 4);
+    header.prg_rom_size = data[4] * PRG_ROM_UNIT;
+    header.chr_rom_size = data[5] * CHR_ROM_UNIT;
+    // iNES 1.0 can't tell whether there is PRG-RAM, 8 KiB is always assumed
+    header.prg_ram_size = (data[8] == 0 ? 1 : data[8]) * 0x2000;
+    header.chr_ram_size = header.chr_rom_size == 0 ? CHR_ROM_UNIT : 0;
+  }
+
+  // CHR is mapped in 1 KiB banks: a smaller CHR-ROM can't fill one, and
+  // without CHR-ROM the PPU reads CHR-RAM, 8 KiB of it when a NES 2.0 header
+  // asks for less or none
+  if (header.chr_rom_size > 0 && header.chr_rom_size < CHR_BANK_UNIT) {
+    error::fail("CHR-ROM of " + std::to_string(header.chr_rom_size) +
+                " bytes, smaller than a 1 KiB bank");
+  }
+  if (header.chr_rom_size == 0) {
+    header.chr_ram_size = std::max(header.chr_ram_size, CHR_ROM_UNIT);
+  }
+
+  // each size is checked against what is left on its own, their sum can
+  // wrap around
+  size_t start = HEADER_SIZE + (header.trainer ? TRAINER_SIZE : 0);
+  size_t available = size < start ? 0 : size - start;
+  if (header.prg_rom_size == 0 || header.prg_rom_size > available ||
+      header.chr_rom_size > available - header.prg_rom_size) {
+    error::fail("truncated iNES image, " + std::to_string(available) +
+                " bytes left for " + std::to_string(header.prg_rom_size) +
+                " bytes of PRG-ROM and " +
+                std::to_string(header.chr_rom_size) + " of CHR-ROM");
+  }
+
+  return header;
+}
+
+Cartridge::Cartridge(RomImage rom_image)
+    : image(std::move(rom_image)),
+      header(ines::parse_header(image.data(), image.size())) {
+  prg_rom = image.data() + ines::HEADER_SIZE +
+            (header.trainer ? ines::TRAINER_SIZE : 0);
+  chr_rom = header.chr_rom_size == 0 ? nullptr : prg_rom + header.prg_rom_size;
+
+  // PRG-RAM is seen through an 8 KiB window. a smaller chip is padded with
+  // zeroed memory to fill it, not mirrored
+  prg_ram.assign(header.prg_ram_size == 0
+                     ? 0
+                     : std::max<size_t>(header.prg_ram_size, 0x2000),
+                 0);
+  chr_ram.assign(header.chr_ram_size, 0);
+}
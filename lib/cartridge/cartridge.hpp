@@ -0,0 +1,67 @@
+#pragma once
+
+#include "rom_image.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum Mirroring : uint8_t {
+  Horizontal,
+  Vertical,
+  FourScreen,
+  SingleScreen_Low,
+  SingleScreen_High,
+};
+
+// everything the iNES / NES 2.0 header says about the cartridge
+struct RomHeader {
+  bool nes2;
+  uint16_t mapper;
+  uint8_t submapper;
+  Mirroring mirroring;
+  bool battery;
+  bool trainer;
+  size_t prg_rom_size;
+  size_t chr_rom_size;
+  size_t prg_ram_size;
+  size_t chr_ram_size;
+};
+
+namespace ines {
+constexpr size_t HEADER_SIZE = 16;
+constexpr size_t TRAINER_SIZE = 512;
+constexpr size_t PRG_ROM_UNIT = 0x4000;
+constexpr size_t CHR_ROM_UNIT = 0x2000;
+constexpr size_t CHR_BANK_UNIT = 0x0400;
+
+// fails (error::fail) if the header is malformed or the image is too short
+// for it
+RomHeader parse_header(const uint8_t *data, size_t size);
+} // namespace ines
+
+// PRG-ROM and CHR-ROM are views into the mapped image, nothing is copied.
+// only PRG-RAM and CHR-RAM, which the game writes to, are allocated
+class Cartridge {
+public:
+  explicit Cartridge(RomImage image);
+
+  const RomHeader &get_header() const { return header; }
+
+  const uint8_t *get_prg_rom() const { return prg_rom; }
+  size_t get_prg_rom_size() const { return header.prg_rom_size; }
+  const uint8_t *get_chr_rom() const { return chr_rom; }
+  size_t get_chr_rom_size() const { return header.chr_rom_size; }
+  uint8_t *get_prg_ram() { return prg_ram.data(); }
+  size_t get_prg_ram_size() const { return prg_ram.size(); }
+  uint8_t *get_chr_ram() { return chr_ram.data(); }
+  const uint8_t *get_chr_ram() const { return chr_ram.data(); }
+  size_t get_chr_ram_size() const { return chr_ram.size(); }
+
+private:
+  RomImage image;
+  RomHeader header;
+  const uint8_t *prg_rom;
+  const uint8_t *chr_rom;
+  std::vector<uint8_t> prg_ram;
+  std::vector<uint8_t> chr_ram;
+};
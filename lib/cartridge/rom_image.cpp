@@ -0,0 +1,120 @@
+#include "rom_image.hpp"
+#include "../error/error.hpp"
+#include <string>
+#include <utility>
+
+#if defined(ESP_PLATFORM)
+#include "esp_idf_version.h"
+#include "esp_partition.h"
+#if ESP_IDF_VERSION_MAJOR < 5
+#include "esp_spi_flash.h"
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RomImage::RomImage(const uint8_t *bytes, size_t length, uint32_t handle,
+                   bool mapped)
+    : bytes(bytes), length(length), handle(handle), mapped(mapped) {}
+
+RomImage::RomImage(RomImage &&other) noexcept
+    : bytes(std::exchange(other.bytes, nullptr)),
+      length(std::exchange(other.length, 0)), handle(other.handle),
+      mapped(std::exchange(other.mapped, false)) {}
+
+RomImage &RomImage::operator=(RomImage &&other) noexcept {
+  if (this != &other) {
+    release();
+    bytes = std::exchange(other.bytes, nullptr);
+    length = std::exchange(other.length, 0);
+    handle = other.handle;
+    mapped = std::exchange(other.mapped, false);
+  }
+
+  return *this;
+}
+
+RomImage::~RomImage() { release(); }
+
+RomImage RomImage::from_memory(const uint8_t *data, size_t size) {
+  return RomImage(data, size, 0, false);
+}
+
+#if defined(ESP_PLATFORM)
+RomImage RomImage::map_file(const char *path) {
+  error::fail(std::string("no filesystem to map ") + path +
+              " from, use a partition");
+}
+
+RomImage RomImage::map_partition(const char *label) {
+  const esp_partition_t *partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (partition == nullptr) {
+    error::fail(std::string("partition not found: ") + label);
+  }
+
+  const void *data = nullptr;
+#if ESP_IDF_VERSION_MAJOR < 5
+  spi_flash_mmap_handle_t flash_handle;
+  esp_err_t err = esp_partition_mmap(partition, 0, partition->size,
+                                     SPI_FLASH_MMAP_DATA, &data, &flash_handle);
+#else
+  esp_partition_mmap_handle_t flash_handle;
+  esp_err_t err =
+      esp_partition_mmap(partition, 0, partition->size,
+                         ESP_PARTITION_MMAP_DATA, &data, &flash_handle);
+#endif
+  if (err != ESP_OK) {
+    error::fail(std::string("failed to map partition: ") + label);
+  }
+
+  return RomImage(static_cast<const uint8_t *>(data), partition->size,
+                  static_cast<uint32_t>(flash_handle), true);
+}
+
+void RomImage::release() {
+  if (mapped) {
+#if ESP_IDF_VERSION_MAJOR < 5
+    spi_flash_munmap(static_cast<spi_flash_mmap_handle_t>(handle));
+#else
+    esp_partition_munmap(static_cast<esp_partition_mmap_handle_t>(handle));
+#endif
+    mapped = false;
+  }
+}
+#else
+RomImage RomImage::map_file(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    error::fail(std::string("failed to open ") + path);
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    error::fail(std::string("failed to stat ") + path);
+  }
+
+  void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps the file alive on its own
+  close(fd);
+  if (data == MAP_FAILED) {
+    error::fail(std::string("failed to map ") + path);
+  }
+
+  return RomImage(static_cast<const uint8_t *>(data),
+                  static_cast<size_t>(info.st_size), 0, true);
+}
+
+RomImage RomImage::map_partition(const char *label) { return map_file(label); }
+
+void RomImage::release() {
+  if (mapped) {
+    munmap(const_cast<uint8_t *>(bytes), length);
+    mapped = false;
+  }
+}
+#endif
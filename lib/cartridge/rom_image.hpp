@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// read-only view of a ROM image that is mapped in place instead of being
+// copied onto the heap: a mmap'd file on native builds, a memory mapped flash
+// partition on the ESP32
+class RomImage {
+public:
+  // maps the whole file read-only (native builds only)
+  static RomImage map_file(const char *path);
+  // maps the data partition with the given label. on native builds the
+  // partition is stood in for by the file at `label`, so tests and tools can
+  // exercise the same path the device takes
+  static RomImage map_partition(const char *label);
+  // wraps memory that outlives the image (ex: a ROM linked into flash)
+  static RomImage from_memory(const uint8_t *data, size_t size);
+
+  RomImage(RomImage &&other) noexcept;
+  RomImage &operator=(RomImage &&other) noexcept;
+  RomImage(const RomImage &) = delete;
+  RomImage &operator=(const RomImage &) = delete;
+  ~RomImage();
+
+  const uint8_t *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  RomImage(const uint8_t *bytes, size_t length, uint32_t handle, bool mapped);
+
+  const uint8_t *bytes;
+  size_t length;
+  // spi_flash_mmap handle on the ESP32, unused on native builds
+  uint32_t handle;
+  bool mapped;
+
+  void release();
+};
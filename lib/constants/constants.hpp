@@ -19,7 +19,10 @@ constexpr uint16_t RAM_START = 0x0000;
 constexpr uint16_t RAM_END = 0x1fff;
 constexpr uint16_t STACK_START = 0x0100;
 constexpr uint16_t STACK_END = 0x01ff;
+constexpr uint16_t PRGRAM_START = 0x6000;
 constexpr uint16_t PRGROM_START = 0x8000;
 } // namespace memory_map
 
+constexpr uint16_t NMI_VECTOR = 0xfffa;
+constexpr uint16_t RESET_VECTOR = 0xfffc;
 constexpr uint16_t INTERRUPT_VECTOR = 0xfffe;
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+class CPU;
+
+// number of blocks the cache holds, a power of two
+#ifndef NES_BLOCK_CACHE_SLOTS
+#if defined(ARDUINO)
+#define NES_BLOCK_CACHE_SLOTS 64
+#else
+#define NES_BLOCK_CACHE_SLOTS 1024
+#endif
+#endif
+
+struct BlockCacheStats {
+  // blocks found decoded and still valid
+  uint64_t hits = 0;
+  // blocks decoded, on first use or after being evicted or invalidated
+  uint64_t misses = 0;
+  // blocks found stale: their page was written to or remapped
+  uint64_t invalidations = 0;
+  // instructions run through CPU::step because their code can't be cached
+  uint64_t uncached = 0;
+
+  double hit_rate() const {
+    uint64_t lookups = hits + misses;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+  }
+};
+
+// straight-line runs of instructions decoded once into (routine, operand)
+// pairs, the routine being the opcode's handler specialized for its
+// addressing mode and the operand the bytes that follow the opcode
+//
+// a block never spans two pages. it remembers the host memory its page was
+// read from and the page's version, so a bank switch (new memory behind the
+// page) or a write into the code (version bumped by the bus) makes it stale
+class BlockCache {
+public:
+  static constexpr uint8_t MAX_LENGTH = 16;
+  static constexpr uint32_t SLOTS = NES_BLOCK_CACHE_SLOTS;
+  static_assert((SLOTS & (SLOTS - 1)) == 0, "slot count must be a power of 2");
+
+  using Routine = void (*)(CPU &cpu, uint16_t operand);
+
+  struct Op {
+    Routine routine;
+    uint16_t operand;
+  };
+
+  struct Block {
+    const uint8_t *source = nullptr;
+    uint32_t version = 0;
+    uint16_t start = 0;
+    uint8_t length = 0;
+    std::array<Op, MAX_LENGTH> ops;
+  };
+
+  // direct mapped, a block evicts whichever block shared its slot
+  Block &slot(uint16_t pc) {
+    return slots[(pc ^ (pc >> 7)) & (SLOTS - 1)];
+  }
+
+  BlockCacheStats stats;
+
+private:
+  std::array<Block, SLOTS> slots;
+};
@@ -1,27 +1,351 @@
 #include "cpu.hpp"
-#include <optional>
-#include <stdexcept>
+#include "../error/error.hpp"
+#include "opcodes.hpp"
 #include <string>
 
 CPU::CPU()
     : pc(0), sp(static_cast<uint8_t>(memory_map::STACK_START)), reg_a(0),
-      reg_x(0), reg_y(0), status(flags::UNUSED) {}
+      reg_x(0), reg_y(0), status(flags::UNUSED), flag_n(0), flag_z(1),
+      flag_c(0), flag_v(0), cycles(0), page_crossed(false),
+      halt_reason(Halt::None), scheduler(nullptr),
+      idle_skip(true), idle_deadline(nullptr), idle_loops{}, idle_registers{},
+      idle_register_count(0) {
+  bus.set_clock(&cycles);
+}
 
-void CPU::load_program(const std::vector<uint8_t> &program,
-                       uint16_t start_addr) {
-  for (size_t i = 0; i < program.size(); ++i) {
-    bus.mem_write(start_addr + i, program[i]);
+CPU::CPU(const CPU &other)
+    : pc(other.pc), sp(other.sp), reg_a(other.reg_a), reg_x(other.reg_x),
+      reg_y(other.reg_y), status(other.status), flag_n(other.flag_n),
+      flag_z(other.flag_z), flag_c(other.flag_c), flag_v(other.flag_v),
+      cycles(other.cycles), page_crossed(other.page_crossed),
+      halt_reason(other.halt_reason), bus(other.bus),
+      scheduler(other.scheduler), idle_skip(other.idle_skip),
+      idle_deadline(nullptr), idle_loops{},
+      idle_registers(other.idle_registers),
+      idle_register_count(other.idle_register_count) {
+  bus.set_clock(&cycles);
+#if NES_BLOCK_CACHE
+  set_block_cache(other.block_cache_enabled());
+#endif
+#if NES_JIT
+  set_jit(other.jit_enabled());
+#endif
+}
+
+CPU &CPU::operator=(const CPU &other) {
+  if (this != &other) {
+    pc = other.pc;
+    sp = other.sp;
+    reg_a = other.reg_a;
+    reg_x = other.reg_x;
+    reg_y = other.reg_y;
+    status = other.status;
+    flag_n = other.flag_n;
+    flag_z = other.flag_z;
+    flag_c = other.flag_c;
+    flag_v = other.flag_v;
+    cycles = other.cycles;
+    page_crossed = other.page_crossed;
+    halt_reason = other.halt_reason;
+    bus = other.bus;
+    bus.set_clock(&cycles);
+    scheduler = other.scheduler;
+    idle_skip = other.idle_skip;
+    idle_loops = {};
+    idle_registers = other.idle_registers;
+    idle_register_count = other.idle_register_count;
+#if NES_BLOCK_CACHE
+    // the blocks may point into the memory the bus was just rebased off
+    block_cache.reset();
+    set_block_cache(other.block_cache_enabled());
+#endif
+#if NES_JIT
+    jit.reset();
+    set_jit(other.jit_enabled());
+#endif
   }
 
+  return *this;
+}
+
+void CPU::load_program(const std::vector<uint8_t> &program,
+                       uint16_t start_addr) {
+  bus.load_program(program, start_addr);
   pc = start_addr;
 }
 
+void CPU::reset() {
+  pc = bus.mem_read_u16(RESET_VECTOR);
+  sp = 0xfd;
+  set_status(flags::UNUSED | flags::INTERRUPT_DISABLE);
+  halt_reason = Halt::None;
+  // the reset sequence takes as long as an interrupt
+  cycles += 7;
+}
+
 void CPU::step() {
+#if NES_TRACE
+  if (tracing) {
+    trace_instruction();
+  }
+#endif
   uint8_t code = fetch_next_byte();
-  const auto &entry = GetOpTable()[code];
-  (this->*entry.handler)(entry.mode);
+  const auto &entry = op_table[code];
+
+  // the base cycles are counted up front so that I/O handlers see the cycle
+  // the instruction accesses the bus on (its last one for most instructions)
+  page_crossed = false;
+  cycles += entry.cycles;
+  (this->*entry.handler())(entry.mode);
+  cycles += entry.page_cycle && page_crossed;
+}
+
+void CPU::nmi() {
+#if NES_PROFILE
+  uint8_t caller_sp = sp;
+#endif
+  interrupt(NMI_VECTOR, (get_status() | flags::UNUSED) & ~flags::BREAK);
+#if NES_PROFILE
+  if (profiling) {
+    profile->call(Profile::Frame::Nmi, pc, caller_sp);
+  }
+#endif
+  set_flag(flags::INTERRUPT_DISABLE, true);
+  cycles += 7;
+}
+
+void CPU::irq() {
+#if NES_PROFILE
+  uint8_t caller_sp = sp;
+#endif
+  interrupt(INTERRUPT_VECTOR,
+            (get_status() | flags::UNUSED) & ~flags::BREAK);
+#if NES_PROFILE
+  if (profiling) {
+    profile->call(Profile::Frame::Irq, pc, caller_sp);
+  }
+#endif
+  set_flag(flags::INTERRUPT_DISABLE, true);
+  cycles += 7;
+}
+
+std::vector<uint8_t> CPU::save_state(state::Kind kind) {
+  uint32_t sequence = bus.get_state_sequence();
+  StateWriter writer(kind,
+                     kind == state::Kind::Snapshot ? sequence : sequence + 1);
+  save_state(writer);
+  return writer.take();
+}
+
+void CPU::load_state(const std::vector<uint8_t> &data) {
+  StateReader reader(data);
+  load_state(reader);
+}
+
+void CPU::save_state(StateWriter &writer) {
+  writer.begin_section(state::tag("CPU "));
+  writer.write_u16(pc);
+  writer.write_u8(sp);
+  writer.write_u8(reg_a);
+  writer.write_u8(reg_x);
+  writer.write_u8(reg_y);
+  writer.write_u8(get_status());
+  writer.write_u64(cycles);
+  writer.end_section();
+  bus.save_state(writer);
+}
+
+// the registers are read first so that a bad section leaves the CPU alone
+void CPU::load_state(StateReader &reader) {
+  if (!reader.find_section(state::tag("CPU "))) {
+    error::fail("save state has no CPU section");
+  }
+  uint16_t saved_pc = reader.read_u16();
+  uint8_t saved_sp = reader.read_u8();
+  uint8_t saved_a = reader.read_u8();
+  uint8_t saved_x = reader.read_u8();
+  uint8_t saved_y = reader.read_u8();
+  uint8_t saved_status = reader.read_u8();
+  uint64_t saved_cycles = reader.read_u64();
+
+  bus.load_state(reader);
+  pc = saved_pc;
+  sp = saved_sp;
+  reg_a = saved_a;
+  reg_x = saved_x;
+  reg_y = saved_y;
+  set_status(saved_status);
+  cycles = saved_cycles;
+}
+
+void CPU::take_snapshot(Snapshot &snapshot) const {
+  snapshot.pc = pc;
+  snapshot.sp = sp;
+  snapshot.reg_a = reg_a;
+  snapshot.reg_x = reg_x;
+  snapshot.reg_y = reg_y;
+  snapshot.status = status;
+  snapshot.flag_n = flag_n;
+  snapshot.flag_z = flag_z;
+  snapshot.flag_c = flag_c;
+  snapshot.flag_v = flag_v;
+  snapshot.cycles = cycles;
+  bus.take_snapshot(snapshot.bus);
+}
+
+void CPU::restore_snapshot(const Snapshot &snapshot) {
+  pc = snapshot.pc;
+  sp = snapshot.sp;
+  reg_a = snapshot.reg_a;
+  reg_x = snapshot.reg_x;
+  reg_y = snapshot.reg_y;
+  status = snapshot.status;
+  flag_n = snapshot.flag_n;
+  flag_z = snapshot.flag_z;
+  flag_c = snapshot.flag_c;
+  flag_v = snapshot.flag_v;
+  cycles = snapshot.cycles;
+  bus.restore_snapshot(snapshot.bus);
+}
+
+void CPU::run(uint32_t instructions) {
+  const uint64_t never = UINT64_MAX;
+  run_engine(instructions, never);
+}
+
+uint32_t CPU::run_cycles(uint32_t budget) {
+  uint64_t target = cycles + budget;
+  idle_deadline = idle_skip ? &target : nullptr;
+  run_engine(UINT64_MAX, target);
+  idle_deadline = nullptr;
+  return static_cast<uint32_t>(cycles - target);
+}
+
+void CPU::run_until(const uint64_t &deadline) {
+  idle_deadline = idle_skip ? &deadline : nullptr;
+  run_engine(UINT64_MAX, deadline);
+  idle_deadline = nullptr;
+}
+
+void CPU::run_engine(uint64_t instructions, const uint64_t &cycle_target) {
+  if (halt_reason != Halt::None) {
+    // nothing runs, the time still passes
+    if (cycle_target != UINT64_MAX && cycles < cycle_target) {
+      cycles = cycle_target;
+    }
+    return;
+  }
+
+#if NES_PROFILE
+  if (profiling) {
+    while (instructions-- > 0 && cycles < cycle_target) {
+      profile_step();
+    }
+    return;
+  }
+#endif
+
+#if NES_TRACE
+  if (tracing) {
+    while (instructions-- > 0 && cycles < cycle_target) {
+      step();
+    }
+    return;
+  }
+#endif
+
+#if NES_JIT
+  if (jit) {
+    jit->run(instructions, cycle_target);
+    return;
+  }
+#endif
+
+#if NES_BLOCK_CACHE
+  if (block_cache) {
+    run_blocks(instructions, cycle_target);
+    return;
+  }
+#endif
+
+#if NES_THREADED_DISPATCH
+  run_threaded(instructions, cycle_target);
+#else
+  while (instructions-- > 0 && cycles < cycle_target) {
+    step();
+  }
+#endif
+}
+
+#if NES_TRACE
+void CPU::set_trace(bool enabled) {
+  if (enabled) {
+    if (!trace) {
+      trace = std::make_unique<Trace>();
+    }
+    trace->clear();
+  }
+  tracing = enabled;
+}
+
+void CPU::trace_instruction() {
+  TraceEntry &entry = trace->next();
+  entry.cycle = cycles;
+  entry.pc = pc;
+  // straight out of the page, not through I/O handlers
+  for (uint16_t i = 0; i < 3; ++i) {
+    auto addr = static_cast<uint16_t>(pc + i);
+    const uint8_t *page = bus.get_read_page(addr >> Bus::PAGE_SHIFT);
+    entry.bytes[i] = page == nullptr ? 0 : page[addr & (Bus::PAGE_SIZE - 1)];
+  }
+  entry.reg_a = reg_a;
+  entry.reg_x = reg_x;
+  entry.reg_y = reg_y;
+  entry.status = get_status();
+  entry.sp = sp;
+}
+#endif
+
+#if NES_PROFILE
+void CPU::set_profile(bool enabled) {
+  if (enabled) {
+    if (!profile) {
+      profile = std::make_unique<Profile>();
+    } else {
+      profile->clear();
+    }
+  }
+  profiling = enabled;
 }
 
+void CPU::profile_step() {
+  uint16_t at = pc;
+  uint8_t caller_sp = sp;
+  uint64_t start = cycles;
+  const uint8_t *page = bus.get_read_page(pc >> Bus::PAGE_SHIFT);
+  // an opcode fetched from I/O counts as BRK's
+  uint8_t code = page == nullptr ? 0 : page[pc & (Bus::PAGE_SIZE - 1)];
+  step();
+  profile->count(at, code, static_cast<uint32_t>(cycles - start));
+
+  // JSR, BRK, RTI, RTS
+  switch (code) {
+  case 0x20:
+    profile->call(Profile::Frame::Subroutine, pc, caller_sp);
+    break;
+  case 0x00:
+    profile->call(Profile::Frame::Brk, pc, caller_sp);
+    break;
+  case 0x40:
+  case 0x60:
+    profile->ret(sp);
+    break;
+  default:
+    break;
+  }
+}
+#endif
+
 // load operations
 void CPU::op_lda(AddressingMode mode) {
   auto addr = get_addr(mode);
@@ -60,9 +384,9 @@ void CPU::op_tya(AddressingMode) { set_register_a(reg_y); }
 void CPU::op_tsx(AddressingMode) { set_register_x(sp); }
 void CPU::op_txs(AddressingMode) { sp = reg_x; }
 void CPU::op_pha(AddressingMode) { stack_push(reg_a); }
+// B only exists in the pushed copy of the status, set by PHP and BRK
 void CPU::op_php(AddressingMode) {
-  set_flag(flags::BREAK, true);
-  stack_push(status);
+  stack_push(get_status() | flags::BREAK | flags::UNUSED);
 }
 void CPU::op_pla(AddressingMode) {
   uint8_t data = stack_pop();
@@ -70,8 +394,9 @@ void CPU::op_pla(AddressingMode) {
 }
 void CPU::op_plp(AddressingMode) {
   uint8_t data = stack_pop();
-  status = data;
-  set_flag(flags::BREAK, false);
+  set_status((data & ~flags::BREAK) | flags::UNUSED);
+  // like CLI, the instruction after PLP still runs first
+  check_irq(cycles + 1);
 }
 // logical operations
 void CPU::op_and(AddressingMode mode) {
@@ -92,11 +417,31 @@ void CPU::op_ora(AddressingMode mode) {
 void CPU::op_bit(AddressingMode mode) {
   auto addr = get_addr(mode);
   uint8_t value = bus.mem_read(addr);
-  auto and_value = reg_a & value;
 
-  set_flag(flags::ZERO, and_value == 0);
-  set_flag(flags::NEGATIVE, (value >> 7) == 1);
-  set_flag(flags::OVERFLOW, (value >> 6) == 1);
+  flag_z = reg_a & value;
+  flag_n = value;
+  flag_v = value;
+}
+// arithmetic operations
+void CPU::op_adc(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  add_with_carry(bus.mem_read(addr));
+}
+void CPU::op_sbc(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  add_with_carry(~bus.mem_read(addr));
+}
+void CPU::op_cmp(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  compare(reg_a, bus.mem_read(addr));
+}
+void CPU::op_cpx(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  compare(reg_x, bus.mem_read(addr));
+}
+void CPU::op_cpy(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  compare(reg_y, bus.mem_read(addr));
 }
 // increment operations
 void CPU::op_inc(AddressingMode mode) {
@@ -105,8 +450,7 @@ void CPU::op_inc(AddressingMode mode) {
   value += 1;
 
   bus.mem_write(addr, value);
-  set_flag(flags::ZERO, value == 0);
-  set_flag(flags::NEGATIVE, (value >> 7) == 1);
+  update_zero_and_negative_flags(value);
 }
 void CPU::op_inx(AddressingMode) { set_register_x(reg_x + 1); }
 void CPU::op_iny(AddressingMode) { set_register_y(reg_y + 1); }
@@ -117,57 +461,56 @@ void CPU::op_dec(AddressingMode mode) {
   value -= 1;
 
   bus.mem_write(addr, value);
-  set_flag(flags::ZERO, value == 0);
-  set_flag(flags::NEGATIVE, (value >> 7) == 1);
+  update_zero_and_negative_flags(value);
 }
 void CPU::op_dex(AddressingMode) { set_register_x(reg_x - 1); }
 void CPU::op_dey(AddressingMode) { set_register_y(reg_y - 1); }
 // shifts
 void CPU::op_asl(AddressingMode mode) {
   uint8_t value = 0;
-  std::optional<uint16_t> addr;
+  uint16_t addr = 0;
 
   if (mode == AddressingMode::Accumulator) {
     value = reg_a;
   } else {
     addr = get_addr(mode);
-    value = bus.mem_read(addr.value());
+    value = bus.mem_read(addr);
   }
 
-  set_flag(flags::CARRY, (value >> 7) == 1);
+  flag_c = value >> 7;
   value <<= 1;
 
   write_to_reg_a_or_mem(mode, addr, value);
 }
 void CPU::op_lsr(AddressingMode mode) {
   uint8_t value = 0;
-  std::optional<uint16_t> addr;
+  uint16_t addr = 0;
 
   if (mode == AddressingMode::Accumulator) {
     value = reg_a;
   } else {
     addr = get_addr(mode);
-    value = bus.mem_read(addr.value());
+    value = bus.mem_read(addr);
   }
 
-  set_flag(flags::CARRY, value & 1);
+  flag_c = value & 1;
   value >>= 1;
 
   write_to_reg_a_or_mem(mode, addr, value);
 }
 void CPU::op_rol(AddressingMode mode) {
   uint8_t value = 0;
-  std::optional<uint16_t> addr;
+  uint16_t addr = 0;
 
   if (mode == AddressingMode::Accumulator) {
     value = reg_a;
   } else {
     addr = get_addr(mode);
-    value = bus.mem_read(addr.value());
+    value = bus.mem_read(addr);
   }
 
-  uint8_t prev_carry_flag = status & flags::CARRY;
-  set_flag(flags::CARRY, (value >> 7) == 1);
+  uint8_t prev_carry_flag = flag_c;
+  flag_c = value >> 7;
 
   value <<= 1;
   value |= prev_carry_flag & 1;
@@ -176,17 +519,17 @@ void CPU::op_rol(AddressingMode mode) {
 }
 void CPU::op_ror(AddressingMode mode) {
   uint8_t value = 0;
-  std::optional<uint16_t> addr;
+  uint16_t addr = 0;
 
   if (mode == AddressingMode::Accumulator) {
     value = reg_a;
   } else {
     addr = get_addr(mode);
-    value = bus.mem_read(addr.value());
+    value = bus.mem_read(addr);
   }
 
-  uint8_t prev_carry_flag = status & flags::CARRY;
-  set_flag(flags::CARRY, (value & 1) == 1);
+  uint8_t prev_carry_flag = flag_c;
+  flag_c = value & 1;
 
   value >>= 1;
   value |= (prev_carry_flag & 1) << 7;
@@ -196,37 +539,198 @@ void CPU::op_ror(AddressingMode mode) {
 // jumps
 void CPU::op_jmp(AddressingMode mode) {
   auto addr = get_addr(mode);
+  bool backwards = addr < pc;
   pc = addr;
+  if (backwards && idle_deadline != nullptr) {
+    check_idle_loop();
+  }
 }
 void CPU::op_jsr(AddressingMode mode) {
   auto addr = get_addr(mode);
-  stack_push_u16(addr - 1);
+  // the return address, less one: the last byte of the JSR
+  stack_push_u16(pc - 1);
   pc = addr;
 }
 void CPU::op_rts(AddressingMode) { pc = stack_pop_u16() + 1; }
+// branches
+void CPU::op_bcc(AddressingMode mode) {
+  branch(mode, (flag_c & flags::CARRY) == 0);
+}
+void CPU::op_bcs(AddressingMode mode) {
+  branch(mode, (flag_c & flags::CARRY) != 0);
+}
+void CPU::op_beq(AddressingMode mode) {
+  branch(mode, flag_z == 0);
+}
+void CPU::op_bmi(AddressingMode mode) {
+  branch(mode, (flag_n & flags::NEGATIVE) != 0);
+}
+void CPU::op_bne(AddressingMode mode) {
+  branch(mode, flag_z != 0);
+}
+void CPU::op_bpl(AddressingMode mode) {
+  branch(mode, (flag_n & flags::NEGATIVE) == 0);
+}
+void CPU::op_bvc(AddressingMode mode) {
+  branch(mode, (flag_v & flags::OVERFLOW) == 0);
+}
+void CPU::op_bvs(AddressingMode mode) {
+  branch(mode, (flag_v & flags::OVERFLOW) != 0);
+}
 
 // status flag changes
-void CPU::op_clc(AddressingMode) { set_flag(flags::CARRY, false); }
+void CPU::op_clc(AddressingMode) { flag_c = 0; }
 void CPU::op_cld(AddressingMode) { set_flag(flags::DECIMAL_MODE, false); }
-void CPU::op_cli(AddressingMode) { set_flag(flags::INTERRUPT_DISABLE, false); }
-void CPU::op_clv(AddressingMode) { set_flag(flags::OVERFLOW, false); }
-void CPU::op_sec(AddressingMode) { set_flag(flags::CARRY, true); }
+void CPU::op_cli(AddressingMode) {
+  set_flag(flags::INTERRUPT_DISABLE, false);
+  check_irq(cycles + 1);
+}
+void CPU::op_clv(AddressingMode) { flag_v = 0; }
+void CPU::op_sec(AddressingMode) { flag_c = 1; }
 void CPU::op_sed(AddressingMode) { set_flag(flags::DECIMAL_MODE, true); }
 void CPU::op_sei(AddressingMode) { set_flag(flags::INTERRUPT_DISABLE, true); }
 // system functions
 void CPU::op_brk(AddressingMode) {
+  // the byte after BRK is skipped
   pc += 1;
-  stack_push_u16(pc);
-  stack_push(status);
-
-  pc = bus.mem_read_u16(INTERRUPT_VECTOR);
-  set_flag(flags::BREAK, true);
+  interrupt(INTERRUPT_VECTOR, get_status() | flags::BREAK | flags::UNUSED);
+  set_flag(flags::INTERRUPT_DISABLE, true);
+}
+void CPU::op_nop(AddressingMode mode) {
+  // the unofficial NOPs with an operand read it, I/O registers included
+  if (mode != AddressingMode::Implied) {
+    bus.mem_read(get_addr(mode));
+  }
 }
-void CPU::op_nop(AddressingMode) {}
 void CPU::op_rti(AddressingMode) {
-  status = stack_pop();
-  set_flag(flags::BREAK, false);
+  set_status((stack_pop() & ~flags::BREAK) | flags::UNUSED);
   pc = stack_pop_u16();
+  check_irq(cycles);
+}
+// unofficial opcodes
+void CPU::op_lax(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr);
+  reg_x = value;
+  set_register_a(value);
+}
+void CPU::op_sax(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  bus.mem_write(addr, reg_a & reg_x);
+}
+void CPU::op_dcp(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr) - 1;
+  bus.mem_write(addr, value);
+  compare(reg_a, value);
+}
+void CPU::op_isb(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr) + 1;
+  bus.mem_write(addr, value);
+  add_with_carry(~value);
+}
+void CPU::op_slo(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr);
+  flag_c = value >> 7;
+  value <<= 1;
+  bus.mem_write(addr, value);
+  set_register_a(reg_a | value);
+}
+void CPU::op_rla(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr);
+  uint8_t prev_carry_flag = flag_c;
+  flag_c = value >> 7;
+  value = (value << 1) | (prev_carry_flag & 1);
+  bus.mem_write(addr, value);
+  set_register_a(reg_a & value);
+}
+void CPU::op_sre(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr);
+  flag_c = value & 1;
+  value >>= 1;
+  bus.mem_write(addr, value);
+  set_register_a(reg_a ^ value);
+}
+void CPU::op_rra(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr);
+  uint8_t prev_carry_flag = flag_c;
+  flag_c = value & 1;
+  value = (value >> 1) | ((prev_carry_flag & 1) << 7);
+  bus.mem_write(addr, value);
+  add_with_carry(value);
+}
+void CPU::op_anc(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  set_register_a(reg_a & bus.mem_read(addr));
+  flag_c = reg_a >> 7;
+}
+void CPU::op_alr(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = reg_a & bus.mem_read(addr);
+  flag_c = value & 1;
+  set_register_a(value >> 1);
+}
+void CPU::op_arr(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = reg_a & bus.mem_read(addr);
+  value = (value >> 1) | ((flag_c & 1) << 7);
+  set_register_a(value);
+  // C is bit 6 of the result, V is bit 6 xor bit 5
+  flag_c = value >> 6;
+  flag_v = value ^ (value << 1);
+}
+void CPU::op_axs(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr);
+  compare(reg_a & reg_x, value);
+  reg_x = (reg_a & reg_x) - value;
+}
+// XAA and LXA depend on the chip (and its temperature), 0xee is the constant
+// most 2A03s OR A with
+void CPU::op_xaa(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  set_register_a((reg_a | 0xee) & reg_x & bus.mem_read(addr));
+}
+void CPU::op_lxa(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = (reg_a | 0xee) & bus.mem_read(addr);
+  reg_x = value;
+  set_register_a(value);
+}
+void CPU::op_las(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  uint8_t value = bus.mem_read(addr) & sp;
+  sp = value;
+  reg_x = value;
+  set_register_a(value);
+}
+void CPU::op_ahx(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  store_and_high(addr, reg_y, reg_a & reg_x);
+}
+void CPU::op_shx(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  store_and_high(addr, reg_y, reg_x);
+}
+void CPU::op_shy(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  store_and_high(addr, reg_x, reg_y);
+}
+void CPU::op_tas(AddressingMode mode) {
+  auto addr = get_addr(mode);
+  sp = reg_a & reg_x;
+  store_and_high(addr, reg_y, sp);
+}
+void CPU::op_stp(AddressingMode) {
+  // stays on the opcode, the run goes on spending cycles on it and the runs
+  // after it are skipped
+  pc -= 1;
+  halt(Halt::Stopped);
 }
 
 // register utils
@@ -247,9 +751,43 @@ void CPU::set_register_y(uint8_t value) {
 void CPU::set_flag(uint8_t mask, bool condition) {
   condition ? status |= mask : status &= ~mask;
 }
+void CPU::set_status(uint8_t value) {
+  status = value;
+  flag_n = value;
+  flag_z = ~value & flags::ZERO;
+  flag_c = value;
+  flag_v = value;
+}
 void CPU::update_zero_and_negative_flags(uint8_t value) {
-  set_flag(flags::ZERO, value == 0);
-  set_flag(flags::NEGATIVE, (value >> 7) == 1);
+  flag_n = value;
+  flag_z = value;
+}
+
+// alu utils
+//
+// C is the carry out of the 9-bit sum, V is set when both inputs have the
+// same sign and the result the other one: the flags come out of a few
+// logical operations rather than compares and branches
+void CPU::add_with_carry(uint8_t value) {
+  uint16_t sum = reg_a + value + (flag_c & flags::CARRY);
+  auto result = static_cast<uint8_t>(sum);
+  flag_c = sum >> 8;
+  flag_v = ((reg_a ^ result) & (value ^ result)) >> 1;
+  set_register_a(result);
+}
+// reg + ~value + 1 carries out when reg >= value
+void CPU::compare(uint8_t reg, uint8_t value) {
+  uint16_t difference = reg + (value ^ 0xff) + 1;
+  flag_c = difference >> 8;
+  update_zero_and_negative_flags(static_cast<uint8_t>(difference));
+}
+void CPU::store_and_high(uint16_t addr, uint8_t index, uint8_t value) {
+  uint16_t base = addr - index;
+  value &= static_cast<uint8_t>((base >> 8) + 1);
+  if ((base ^ addr) & 0xff00) {
+    addr = (addr & 0x00ff) | (value << 8);
+  }
+  bus.mem_write(addr, value);
 }
 
 // stack utils
@@ -275,49 +813,92 @@ uint16_t CPU::stack_pop_u16() {
   return (high << 8) | low;
 }
 
+void CPU::halt(Halt reason) {
+  if (halt_reason == Halt::None) {
+    halt_reason = reason;
+  }
+}
+
+// interrupt utils
+//
+// pushes the return address and the status and jumps through the vector,
+// shared by BRK and the NMI / IRQ lines
+void CPU::interrupt(uint16_t vector, uint8_t pushed_status) {
+  stack_push_u16(pc);
+  stack_push(pushed_status);
+  pc = bus.mem_read_u16(vector);
+}
+void CPU::check_irq(uint64_t cycle) {
+  if (scheduler != nullptr && !(status & flags::INTERRUPT_DISABLE)) {
+    scheduler->schedule(event::IRQ, cycle);
+  }
+}
+
 // mem utils
 uint8_t CPU::mem_read(uint16_t addr) { return bus.mem_read(addr); }
 uint16_t CPU::mem_read_u16(uint16_t addr) { return bus.mem_read_u16(addr); }
 
 // additional utils
 uint8_t CPU::fetch_next_byte() { return bus.mem_read(pc++); }
-void CPU::write_to_reg_a_or_mem(AddressingMode mode,
-                                std::optional<uint16_t> addr, uint8_t value) {
+void CPU::write_to_reg_a_or_mem(AddressingMode mode, uint16_t addr,
+                                uint8_t value) {
   if (mode == AddressingMode::Accumulator) {
     set_register_a(value);
   } else {
-    if (!addr.has_value()) {
-      throw std::runtime_error("failed to extract address");
-    }
-
-    bus.mem_write(addr.value(), value);
+    bus.mem_write(addr, value);
     update_zero_and_negative_flags(value);
   }
 }
+void CPU::branch(AddressingMode mode, bool condition) {
+  auto target = get_addr(mode);
+
+  // a taken branch costs one cycle, and one more if it lands on another page
+  if (condition) {
+    cycles += 1 + page_crossed;
+    bool backwards = target < pc;
+    pc = target;
+    if (backwards && idle_deadline != nullptr) {
+      check_idle_loop();
+    }
+  }
+}
 uint16_t CPU::get_addr(AddressingMode mode) {
+#if NES_PROFILE
+  if (profiling) {
+    profile->count_mode(mode);
+  }
+#endif
   switch (mode) {
   case Immediate:
     return pc++;
-  case Relative:
-    return pc++;
+  case Relative: {
+    auto offset = static_cast<int8_t>(bus.mem_read(pc++));
+    uint16_t target = pc + offset;
+    page_crossed = (pc & 0xFF00) != (target & 0xFF00);
+    return target;
+  }
   case ZeroPage:
     return bus.mem_read(pc++);
   case ZeroPage_X:
-    return bus.mem_read(pc++) + reg_x;
+    return static_cast<uint8_t>(bus.mem_read(pc++) + reg_x);
   case ZeroPage_Y:
-    return bus.mem_read(pc++) + reg_y;
+    return static_cast<uint8_t>(bus.mem_read(pc++) + reg_y);
   case Absolute: {
     uint16_t addr = bus.mem_read_u16(pc);
     pc += 2;
     return addr;
   }
   case Absolute_X: {
-    uint16_t addr = bus.mem_read_u16(pc);
+    uint16_t base = bus.mem_read_u16(pc);
+    uint16_t addr = base + static_cast<uint16_t>(reg_x);
+    page_crossed = (base & 0xFF00) != (addr & 0xFF00);
     pc += 2;
     return addr;
   }
   case Absolute_Y: {
-    uint16_t addr = bus.mem_read_u16(pc++) + static_cast<uint16_t>(reg_y);
+    uint16_t base = bus.mem_read_u16(pc);
+    uint16_t addr = base + static_cast<uint16_t>(reg_y);
+    page_crossed = (base & 0xFF00) != (addr & 0xFF00);
     pc += 2;
     return addr;
   }
@@ -350,10 +931,303 @@ uint16_t CPU::get_addr(AddressingMode mode) {
     uint8_t low = bus.mem_read(zero_page_addr);
     uint8_t high = bus.mem_read((zero_page_addr + 1) & 0xFF);
     uint16_t base_addr = (high << 8) | low;
-    return base_addr + static_cast<uint16_t>(reg_y);
+    uint16_t addr = base_addr + static_cast<uint16_t>(reg_y);
+    page_crossed = (base_addr & 0xFF00) != (addr & 0xFF00);
+    return addr;
   }
+#if NES_DECODED_ROUTINES
+  case Resolved:
+    return resolved;
+#endif
   default:
-    throw std::runtime_error("invalid addressing mode: " +
-                             std::to_string(static_cast<int>(mode)));
+    halt(Halt::InvalidAddressingMode);
+    return 0;
+  }
+}
+
+#if NES_THREADED_DISPATCH || NES_DECODED_ROUTINES
+#define NES_HEX16(X, hi)                                                       \
+  X(hi##0) X(hi##1) X(hi##2) X(hi##3) X(hi##4) X(hi##5) X(hi##6) X(hi##7)      \
+  X(hi##8) X(hi##9) X(hi##a) X(hi##b) X(hi##c) X(hi##d) X(hi##e) X(hi##f)
+#define NES_HEX256(X)                                                          \
+  NES_HEX16(X, 0x0) NES_HEX16(X, 0x1) NES_HEX16(X, 0x2) NES_HEX16(X, 0x3)      \
+  NES_HEX16(X, 0x4) NES_HEX16(X, 0x5) NES_HEX16(X, 0x6) NES_HEX16(X, 0x7)      \
+  NES_HEX16(X, 0x8) NES_HEX16(X, 0x9) NES_HEX16(X, 0xa) NES_HEX16(X, 0xb)      \
+  NES_HEX16(X, 0xc) NES_HEX16(X, 0xd) NES_HEX16(X, 0xe) NES_HEX16(X, 0xf)
+#endif
+
+#if NES_THREADED_DISPATCH
+// threaded dispatch
+//
+// every opcode gets its own instantiation of exec with the handler and the
+// addressing mode known at compile time, so once run_threaded is flattened the
+// switch in get_addr folds away and each opcode is a straight-line routine
+template <uint8_t Code> void CPU::exec() {
+  constexpr OpCode op = op_table[Code];
+  constexpr Handler handler = op.handler();
+
+  cycles += op.cycles;
+  if constexpr (op.page_cycle) {
+    page_crossed = false;
+    (this->*handler)(op.mode);
+    cycles += page_crossed;
+  } else {
+    (this->*handler)(op.mode);
   }
-}
\ No newline at end of file
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+// stops after `instructions` instructions or once the cycle counter reaches
+// `cycle_target`, whichever comes first. the target is read again before
+// every instruction since the scheduler can move it
+[[gnu::flatten]] void CPU::run_threaded(uint64_t instructions,
+                                        const uint64_t &cycle_target) {
+#define NES_LABEL_ADDR(code) &&op_##code,
+  static const void *const labels[256] = {NES_HEX256(NES_LABEL_ADDR)};
+#undef NES_LABEL_ADDR
+
+#define NES_DISPATCH()                                                         \
+  if (instructions-- == 0 || cycles >= cycle_target) {                         \
+    return;                                                                    \
+  }                                                                            \
+  goto *labels[fetch_next_byte()];
+
+  NES_DISPATCH();
+
+#define NES_LABEL_BODY(code)                                                   \
+  op_##code : exec<code>();                                                    \
+  NES_DISPATCH();
+  NES_HEX256(NES_LABEL_BODY)
+#undef NES_LABEL_BODY
+#undef NES_DISPATCH
+}
+
+#pragma GCC diagnostic pop
+#else
+// without computed goto the same specialized routines are reached through a
+// dense table of plain function pointers
+void CPU::run_threaded(uint64_t instructions,
+                       const uint64_t &cycle_target) {
+  using Routine = void (*)(CPU &);
+#define NES_ROUTINE(code) [](CPU &cpu) { cpu.exec<code>(); },
+  static const Routine routines[256] = {NES_HEX256(NES_ROUTINE)};
+#undef NES_ROUTINE
+
+  while (instructions-- > 0 && cycles < cycle_target) {
+    routines[fetch_next_byte()](*this);
+  }
+}
+#endif
+#endif
+
+#if NES_DECODED_ROUTINES
+// decoded instructions
+//
+// the operand was decoded along with the opcode, only the indexing and the
+// pointer reads are left for run time
+template <AddressingMode Mode> uint16_t CPU::resolve(uint16_t operand) {
+  if constexpr (Mode == Relative) {
+    page_crossed = (pc & 0xFF00) != (operand & 0xFF00);
+    return operand;
+  } else if constexpr (Mode == ZeroPage_X) {
+    return static_cast<uint8_t>(operand + reg_x);
+  } else if constexpr (Mode == ZeroPage_Y) {
+    return static_cast<uint8_t>(operand + reg_y);
+  } else if constexpr (Mode == Absolute_X || Mode == Absolute_Y) {
+    uint16_t addr = operand + (Mode == Absolute_X ? reg_x : reg_y);
+    page_crossed = (operand & 0xFF00) != (addr & 0xFF00);
+    return addr;
+  } else if constexpr (Mode == Indirect) {
+    if ((operand & 0x00FF) == 0x00FF) {
+      uint8_t low = bus.mem_read(operand);
+      uint8_t high = bus.mem_read(operand & 0xFF00);
+      return (high << 8) | low;
+    }
+    return bus.mem_read_u16(operand);
+  } else if constexpr (Mode == Indirect_X) {
+    uint8_t zero_page_addr = (operand + reg_x) & 0xFF;
+    uint8_t low = bus.mem_read(zero_page_addr);
+    uint8_t high = bus.mem_read((zero_page_addr + 1) & 0xFF);
+    return (high << 8) | low;
+  } else if constexpr (Mode == Indirect_Y) {
+    uint8_t low = bus.mem_read(operand);
+    uint8_t high = bus.mem_read((operand + 1) & 0xFF);
+    uint16_t base_addr = (high << 8) | low;
+    uint16_t addr = base_addr + static_cast<uint16_t>(reg_y);
+    page_crossed = (base_addr & 0xFF00) != (addr & 0xFF00);
+    return addr;
+  } else {
+    // immediate (the operand's own address), zero page, absolute
+    return operand;
+  }
+}
+
+// same as exec, with the fetch and the operand decoding already done
+template <uint8_t Code>
+[[gnu::flatten]] void CPU::exec_decoded(CPU &cpu, uint16_t operand) {
+  constexpr OpCode op = op_table[Code];
+  constexpr Handler handler = op.handler();
+
+  cpu.pc += op.bytes;
+  cpu.cycles += op.cycles;
+  cpu.page_crossed = false;
+  if constexpr (op.mode == Accumulator || op.mode == Implied) {
+    (cpu.*handler)(op.mode);
+  } else {
+    cpu.resolved = cpu.resolve<op.mode>(operand);
+    (cpu.*handler)(Resolved);
+  }
+  if constexpr (op.page_cycle) {
+    cpu.cycles += cpu.page_crossed;
+  }
+}
+
+CPU::DecodedRoutine CPU::decoded_routine(uint8_t code) {
+#define NES_DECODED(code) &CPU::exec_decoded<code>,
+  static const DecodedRoutine routines[256] = {NES_HEX256(NES_DECODED)};
+#undef NES_DECODED
+
+  return routines[code];
+}
+
+uint16_t CPU::decode_operand(const OpCode &op, const uint8_t *page,
+                             uint32_t offset, uint16_t addr) {
+  uint8_t bytes = op.bytes;
+  uint16_t operand = 0;
+  if (bytes == 2) {
+    operand = page[offset + 1];
+  } else if (bytes == 3) {
+    operand = page[offset + 1] | (page[offset + 2] << 8);
+  }
+
+  if (op.mode == Immediate) {
+    operand = addr + 1;
+  } else if (op.mode == Relative) {
+    operand = addr + 2 + static_cast<int8_t>(operand);
+  }
+  return operand;
+}
+
+bool CPU::ends_block(const OpCode &op) {
+  return op.mode == Relative || op.operation == Operation::Jmp ||
+         op.operation == Operation::Jsr || op.operation == Operation::Rts ||
+         op.operation == Operation::Rti || op.operation == Operation::Brk ||
+         op.operation == Operation::Stp;
+}
+#endif
+
+#if NES_BLOCK_CACHE
+// block cache
+void CPU::set_block_cache(bool enabled) {
+  if (!enabled) {
+    block_cache.reset();
+  } else if (!block_cache) {
+    block_cache = std::make_unique<BlockCache>();
+  }
+}
+
+BlockCacheStats CPU::get_block_cache_stats() const {
+  return block_cache ? block_cache->stats : BlockCacheStats{};
+}
+
+// decodes from pc up to the first jump, branch or interrupt instruction, the
+// end of the page or MAX_LENGTH instructions. pages holding writable memory
+// are watched so that self-modifying code shows up as a new page version
+void CPU::decode_block(BlockCache::Block &block, const uint8_t *source) {
+  auto page = static_cast<uint8_t>(pc >> Bus::PAGE_SHIFT);
+  bus.watch_writes(page);
+
+  block.source = source;
+  block.version = bus.get_page_version(page);
+  block.start = pc;
+  block.length = 0;
+
+  uint32_t offset = pc & (Bus::PAGE_SIZE - 1);
+  while (block.length < BlockCache::MAX_LENGTH) {
+    uint8_t code = source[offset];
+    const OpCode &op = op_table[code];
+    uint8_t bytes = op.bytes;
+    if (offset + bytes > Bus::PAGE_SIZE) {
+      break;
+    }
+
+    uint16_t addr = (pc & 0xFF00) | offset;
+    block.ops[block.length++] = {decoded_routine(code),
+                                 decode_operand(op, source, offset, addr)};
+    offset += bytes;
+
+    if (ends_block(op) || offset == Bus::PAGE_SIZE) {
+      break;
+    }
+  }
+}
+
+// nullptr when pc is on an I/O page or its instruction runs off the page,
+// those go through step
+const BlockCache::Block *CPU::find_block() {
+  auto page = static_cast<uint8_t>(pc >> Bus::PAGE_SHIFT);
+  const uint8_t *source = bus.get_read_page(page);
+  if (source == nullptr) {
+    return nullptr;
+  }
+
+  auto &stats = block_cache->stats;
+  auto &block = block_cache->slot(pc);
+  if (block.start == pc && block.length > 0) {
+    if (block.source == source &&
+        block.version == bus.get_page_version(page)) {
+      stats.hits++;
+      return &block;
+    }
+    stats.invalidations++;
+  }
+
+  stats.misses++;
+  decode_block(block, source);
+  return block.length > 0 ? &block : nullptr;
+}
+
+// same stopping rules as run_threaded. on top of them a block is left as soon
+// as the bus generation moves (a remap or a write to watched code), since the
+// rest of it may be stale
+void CPU::run_blocks(uint64_t instructions, const uint64_t &cycle_target) {
+  while (instructions > 0 && cycles < cycle_target) {
+    const BlockCache::Block *block = find_block();
+    if (block == nullptr) {
+      block_cache->stats.uncached++;
+      step();
+      instructions--;
+      continue;
+    }
+
+    uint32_t generation = bus.get_generation();
+    for (const auto *op = block->ops.data(), *end = op + block->length;
+         op != end;) {
+      op->routine(*this, op->operand);
+      ++op;
+      if (--instructions == 0 || cycles >= cycle_target ||
+          bus.get_generation() != generation) {
+        break;
+      }
+    }
+  }
+}
+#endif
+
+#if NES_JIT
+void CPU::set_jit(bool enabled) {
+  if (!enabled) {
+    jit.reset();
+  } else if (!jit) {
+    jit = std::make_unique<Jit>(*this);
+  }
+}
+
+JitStats CPU::get_jit_stats() const { return jit ? jit->stats : JitStats{}; }
+#endif
+
+#undef NES_HEX256
+#undef NES_HEX16
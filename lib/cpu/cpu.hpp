@@ -2,10 +2,43 @@
 
 #include "../bus/bus.hpp"
 #include "../constants/constants.hpp"
+#include "../scheduler/scheduler.hpp"
+#include "../state/state.hpp"
+#include "block_cache.hpp"
+#include "idle_loop.hpp"
+#include "jit.hpp"
+#include "profile.hpp"
+#include "trace.hpp"
 #include <cstdint>
-#include <optional>
+#include <memory>
 #include <vector>
 
+// selects the engine behind CPU::run. the threaded engine compiles a
+// specialized routine for every (opcode, addressing mode) pair and dispatches
+// to it with a computed goto, while CPU::step stays the reference table path
+#ifndef NES_THREADED_DISPATCH
+#define NES_THREADED_DISPATCH 1
+#endif
+
+// compiles in the decoded block cache, switched on at runtime with
+// CPU::set_block_cache
+#ifndef NES_BLOCK_CACHE
+#define NES_BLOCK_CACHE 1
+#endif
+
+// compiles in the x86-64 recompiler, switched on at runtime with CPU::set_jit.
+// only for the native build on linux
+#ifndef NES_JIT
+#if defined(__x86_64__) && defined(__linux__) && !defined(ARDUINO)
+#define NES_JIT 1
+#else
+#define NES_JIT 0
+#endif
+#endif
+
+// both run instructions decoded ahead of time, through the same routines
+#define NES_DECODED_ROUTINES (NES_BLOCK_CACHE || NES_JIT)
+
 enum AddressingMode : uint8_t {
   Accumulator,
   Implied,
@@ -20,44 +53,283 @@ enum AddressingMode : uint8_t {
   Indirect,
   Indirect_X, // indexed indirect
   Indirect_Y, // indirect indexed
+  Resolved,   // address already worked out by the block cache
 };
 
 class CPU {
 public:
   CPU();
+  // the bus of a copy counts the copy's cycles
+  CPU(const CPU &other);
+  CPU &operator=(const CPU &other);
 
   void load_program(const std::vector<uint8_t> &program,
                     uint16_t start_addr = memory_map::PRGROM_START);
+  // starts executing from the address stored in the reset vector, as the
+  // console does on power up
+  void reset();
   void step();
+  // take an interrupt before the next instruction, irq doesn't check the
+  // interrupt disable flag
+  void nmi();
+  void irq();
+  void run(uint32_t instructions);
+  // runs whole instructions until `budget` cycles have elapsed and returns how
+  // many cycles the last one ran past it, so the caller can shorten the next
+  // budget (ex: one NTSC frame is 29780 cycles)
+  uint32_t run_cycles(uint32_t budget);
+  // runs whole instructions until the cycle counter reaches `deadline`, which
+  // may be pulled in while running (ex: a register write raising an NMI)
+  void run_until(const uint64_t &deadline);
+
+  // errors don't throw out of the instruction loop, they halt the CPU: the run
+  // in progress finishes, the runs after it only let the cycles pass, until
+  // reset. the firmware builds with -fno-exceptions
+  enum class Halt : uint8_t {
+    None,
+    // an instruction got to an addressing mode its handler has no use for,
+    // the op table is wrong
+    InvalidAddressingMode,
+    // the program ran one of the STP opcodes (also known as JAM or KIL),
+    // which lock the 6502 up until reset
+    Stopped,
+  };
+  Halt get_halt() const { return halt_reason; }
+
+  // clearing the interrupt disable flag (CLI, PLP, RTI) asks the scheduler to
+  // check the IRQ line, since nothing polls it per instruction
+  void set_scheduler(Scheduler *target) { scheduler = target; }
+
+  // idle loops (see idle_loop.hpp): while run_until or run_cycles waits for a
+  // deadline, a loop that comes back to its head with the same registers
+  // twice in a row has the iterations left before the deadline counted
+  // instead of run. the CPU lands on the same instruction with the same
+  // cycle count as if it had run them. on by default, off for accuracy tests
+  void set_idle_skip(bool enabled) { idle_skip = enabled; }
+  bool idle_skip_enabled() const { return idle_skip; }
+  // lets idle loops poll the I/O register. set up once, off the instruction
+  // path: one too many fails (`error::fail`)
+  void add_idle_register(uint16_t addr, uint8_t stable);
+  const IdleStats &get_idle_stats() const { return idle_stats; }
+
+#if NES_TRACE
+  // records every instruction run from here on into a ring of the last ones
+  // (see trace.hpp), kept until the next set_trace(true). the block cache and
+  // the JIT step aside while it's on, every instruction goes through step
+  void set_trace(bool enabled);
+  bool trace_enabled() const { return tracing; }
+  const Trace *get_trace() const { return trace.get(); }
+#endif
+
+#if NES_PROFILE
+  // counts the instructions run from here on per opcode, addressing mode,
+  // address and call stack (see profile.hpp), starting over at every
+  // set_profile(true). like the trace, everything goes through step
+  void set_profile(bool enabled);
+  bool profile_enabled() const { return profiling; }
+  const Profile *get_profile() const { return profile.get(); }
+#endif
+
+#if NES_BLOCK_CACHE
+  // runs code out of a cache of decoded blocks instead of fetching and
+  // decoding every instruction. off by default, a copy starts with an empty
+  // cache
+  void set_block_cache(bool enabled);
+  bool block_cache_enabled() const { return block_cache != nullptr; }
+  BlockCacheStats get_block_cache_stats() const;
+#endif
+
+#if NES_JIT
+  // runs code translated to x86-64, falling back to the interpreter for I/O
+  // accesses. takes over from the block cache while on, a copy starts with
+  // nothing compiled
+  void set_jit(bool enabled);
+  bool jit_enabled() const { return jit != nullptr; }
+  JitStats get_jit_stats() const;
+#endif
 
   uint16_t get_pc() const { return pc; }
   uint8_t get_sp() const { return sp; }
   uint8_t get_reg_a() const { return reg_a; }
   uint8_t get_reg_x() const { return reg_x; }
   uint8_t get_reg_y() const { return reg_y; }
-  uint8_t get_status() const { return status; }
+  // folds the lazily kept flags into the status byte
+  uint8_t get_status() const {
+    return (status & ~(flags::NEGATIVE | flags::ZERO | flags::CARRY |
+                       flags::OVERFLOW)) |
+           (flag_n & flags::NEGATIVE) | (flag_z == 0 ? flags::ZERO : 0) |
+           (flag_c & flags::CARRY) | (flag_v & flags::OVERFLOW);
+  }
+  uint64_t get_cycles() const { return cycles; }
+
+  Bus &get_bus() { return bus; }
+
+  // save states of the registers and the bus' memory, see state.hpp. a delta
+  // holds the registers and the pages written since the last full state or
+  // delta
+  std::vector<uint8_t> save_state(state::Kind kind);
+  void load_state(const std::vector<uint8_t> &data);
+  // the "CPU " and "BUS " sections, for states other components add to
+  void save_state(StateWriter &writer);
+  void load_state(StateReader &reader);
+
+  // the registers and the bus' memory copied as they are, for run-ahead
+  // (see Bus::Snapshot). the lazy flags are kept lazy
+  struct Snapshot {
+    uint16_t pc;
+    uint8_t sp;
+    uint8_t reg_a;
+    uint8_t reg_x;
+    uint8_t reg_y;
+    uint8_t status;
+    uint8_t flag_n;
+    uint8_t flag_z;
+    uint8_t flag_c;
+    uint8_t flag_v;
+    uint64_t cycles;
+    Bus::Snapshot bus;
+  };
+  void take_snapshot(Snapshot &snapshot) const;
+  void restore_snapshot(const Snapshot &snapshot);
 
   // mem utils
   uint8_t mem_read(uint16_t addr);
   uint16_t mem_read_u16(uint16_t addr);
 
 private:
+  friend class Jit;
+
   uint16_t pc;
   uint8_t sp;
   uint8_t reg_a;
   uint8_t reg_x;
   uint8_t reg_y;
+  // I, D, B and the unused bit. N, Z, C and V are written by most instructions
+  // and read by few, so they are kept as the values they come from and only
+  // folded in by get_status (PHP, BRK, interrupts)
   uint8_t status;
+  uint8_t flag_n; // N is bit 7
+  uint8_t flag_z; // Z is set while it is 0
+  uint8_t flag_c; // C is bit 0
+  uint8_t flag_v; // V is bit 6
+  uint64_t cycles;
+  bool page_crossed;
+  Halt halt_reason;
   Bus bus;
+  Scheduler *scheduler;
+#if NES_BLOCK_CACHE
+  std::unique_ptr<BlockCache> block_cache;
+#endif
+#if NES_JIT
+  std::unique_ptr<Jit> jit;
+#endif
+#if NES_TRACE
+  std::unique_ptr<Trace> trace;
+  bool tracing = false;
+#endif
+#if NES_PROFILE
+  std::unique_ptr<Profile> profile;
+  bool profiling = false;
+#endif
+#if NES_DECODED_ROUTINES
+  // handed to the handlers in Resolved mode
+  uint16_t resolved;
+#endif
+  // idle loops
+  bool idle_skip;
+  // deadline of the run_until / run_cycles in progress, nullptr otherwise
+  const uint64_t *idle_deadline;
+  std::array<IdleLoop, NES_IDLE_LOOP_SLOTS> idle_loops;
+  std::array<IdleRegister, 4> idle_registers;
+  uint8_t idle_register_count;
+  IdleStats idle_stats;
 
   // opcode helpers
+  using Handler = void (CPU::*)(AddressingMode);
+  // one per handler, in the order of the op_ functions below
+  enum class Operation : uint8_t {
+    // loads and stores
+    Lda, Ldx, Ldy, Sta, Stx, Sty,
+    // register transfers and the stack
+    Tax, Tay, Txa, Tya, Tsx, Txs, Pha, Php, Pla, Plp,
+    // logical and arithmetic operations, increments, decrements and shifts
+    And, Eor, Ora, Bit, Adc, Sbc, Cmp, Cpx, Cpy, Inc, Inx, Iny, Dec, Dex, Dey,
+    Asl, Lsr, Rol, Ror,
+    // jumps and branches
+    Jmp, Jsr, Rts, Bcc, Bcs, Beq, Bmi, Bne, Bpl, Bvc, Bvs,
+    // status flag changes and system functions
+    Clc, Cld, Cli, Clv, Sec, Sed, Sei, Brk, Nop, Rti,
+    // unofficial opcodes
+    Lax, Sax, Dcp, Isb, Slo, Rla, Sre, Rra, Anc, Alr, Arr, Axs, Xaa, Lxa, Las,
+    Ahx, Shx, Shy, Tas, Stp,
+  };
+  static constexpr size_t OPERATION_COUNT =
+      static_cast<size_t>(Operation::Stp) + 1;
+  static const std::array<Handler, OPERATION_COUNT> handlers;
+
   struct OpCode {
-    void (CPU::*handler)(AddressingMode);
+    Operation operation;
     AddressingMode mode;
     uint8_t bytes;
+    uint8_t cycles;
+    // adds a cycle when the indexed address lands on another page
+    bool page_cycle = false;
+
+    constexpr Handler handler() const {
+      return handlers[static_cast<size_t>(operation)];
+    }
   };
+  static_assert(sizeof(OpCode) == 5, "op table entries grew");
+
+  static const std::array<OpCode, 256> op_table;
+
+  // runs the selected engine
+  void run_engine(uint64_t instructions, const uint64_t &cycle_target);
 
-  static const std::array<OpCode, 256> &GetOpTable();
+#if NES_TRACE
+  // copies the registers and the bytes at pc into the trace
+  void trace_instruction();
+#endif
+#if NES_PROFILE
+  // step, counted
+  void profile_step();
+#endif
+
+  // idle loops
+  //
+  // pc was just jumped back to, skips ahead when it is the head of an idle
+  // loop that went around once without changing anything
+  void check_idle_loop();
+  // cycles of an iteration of the loop starting at `head`, 0 if it isn't one
+  uint8_t idle_loop_length(uint16_t head) const;
+  bool idle_read(uint16_t addr, uint8_t used_bits) const;
+
+#if NES_THREADED_DISPATCH
+  // threaded dispatch
+  void run_threaded(uint64_t instructions, const uint64_t &cycle_target);
+  template <uint8_t Code> void exec();
+#endif
+
+#if NES_DECODED_ROUTINES
+  // decoded instructions
+  using DecodedRoutine = void (*)(CPU &cpu, uint16_t operand);
+  static DecodedRoutine decoded_routine(uint8_t code);
+  // what follows the opcode at `offset` in the page, immediate operands
+  // become their own address and branch offsets their target
+  static uint16_t decode_operand(const OpCode &op, const uint8_t *page,
+                                 uint32_t offset, uint16_t addr);
+  // jumps, branches, interrupts and STP end a run of decoded code
+  static bool ends_block(const OpCode &op);
+  template <uint8_t Code> static void exec_decoded(CPU &cpu, uint16_t operand);
+  template <AddressingMode Mode> uint16_t resolve(uint16_t operand);
+#endif
+
+#if NES_BLOCK_CACHE
+  // block cache
+  void run_blocks(uint64_t instructions, const uint64_t &cycle_target);
+  const BlockCache::Block *find_block();
+  void decode_block(BlockCache::Block &block, const uint8_t *source);
+#endif
 
   // load operations
   void op_lda(AddressingMode mode);
@@ -84,6 +356,12 @@ private:
   void op_eor(AddressingMode mode);
   void op_ora(AddressingMode mode);
   void op_bit(AddressingMode mode);
+  // arithmetic operations
+  void op_adc(AddressingMode mode);
+  void op_sbc(AddressingMode mode);
+  void op_cmp(AddressingMode mode);
+  void op_cpx(AddressingMode mode);
+  void op_cpy(AddressingMode mode);
   // increment operations
   void op_inc(AddressingMode mode);
   void op_inx(AddressingMode);
@@ -102,6 +380,14 @@ private:
   void op_jsr(AddressingMode mode);
   void op_rts(AddressingMode);
   // branches
+  void op_bcc(AddressingMode mode);
+  void op_bcs(AddressingMode mode);
+  void op_beq(AddressingMode mode);
+  void op_bmi(AddressingMode mode);
+  void op_bne(AddressingMode mode);
+  void op_bpl(AddressingMode mode);
+  void op_bvc(AddressingMode mode);
+  void op_bvs(AddressingMode mode);
   // status flag changes
   void op_clc(AddressingMode);
   void op_cld(AddressingMode);
@@ -114,6 +400,27 @@ private:
   void op_brk(AddressingMode);
   void op_nop(AddressingMode);
   void op_rti(AddressingMode);
+  // unofficial opcodes, see docs/cpu.md
+  void op_lax(AddressingMode mode);
+  void op_sax(AddressingMode mode);
+  void op_dcp(AddressingMode mode);
+  void op_isb(AddressingMode mode);
+  void op_slo(AddressingMode mode);
+  void op_rla(AddressingMode mode);
+  void op_sre(AddressingMode mode);
+  void op_rra(AddressingMode mode);
+  void op_anc(AddressingMode mode);
+  void op_alr(AddressingMode mode);
+  void op_arr(AddressingMode mode);
+  void op_axs(AddressingMode mode);
+  void op_xaa(AddressingMode mode);
+  void op_lxa(AddressingMode mode);
+  void op_las(AddressingMode mode);
+  void op_ahx(AddressingMode mode);
+  void op_shx(AddressingMode mode);
+  void op_shy(AddressingMode mode);
+  void op_tas(AddressingMode mode);
+  void op_stp(AddressingMode);
 
   // register utils
   void set_register_a(uint8_t value);
@@ -122,17 +429,39 @@ private:
 
   // flag utils
   void set_flag(uint8_t mask, bool condition);
+  void set_status(uint8_t value);
   void update_zero_and_negative_flags(uint8_t value);
 
+  // alu utils
+  //
+  // A + value + C, SBC adds the complement. there is no decimal mode on the
+  // NES' 2A03
+  void add_with_carry(uint8_t value);
+  // C, Z and N of `reg` - `value`
+  void compare(uint8_t reg, uint8_t value);
+  // the unstable stores (AHX, SHX, SHY, TAS) write `value` & the high byte
+  // of the unindexed address + 1, which also becomes the high byte of the
+  // address when indexing crossed a page
+  void store_and_high(uint16_t addr, uint8_t index, uint8_t value);
+
   // stack utils
   void stack_push(uint8_t data);
   void stack_push_u16(uint16_t data);
   uint8_t stack_pop();
   uint16_t stack_pop_u16();
 
+  // keeps the first reason the CPU halted for
+  void halt(Halt reason);
+
+  // interrupt utils
+  void interrupt(uint16_t vector, uint8_t pushed_status);
+  void check_irq(uint64_t cycle);
+
   // additional utils
   uint8_t fetch_next_byte();
   uint16_t get_addr(AddressingMode mode);
-  void write_to_reg_a_or_mem(AddressingMode mode, std::optional<uint16_t> addr,
+  void branch(AddressingMode mode, bool condition);
+  // `addr` is only used outside of Accumulator mode
+  void write_to_reg_a_or_mem(AddressingMode mode, uint16_t addr,
                              uint8_t value);
 };
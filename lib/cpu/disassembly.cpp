@@ -0,0 +1,256 @@
+#include "disassembly.hpp"
+#include <cstdio>
+
+namespace disassembly {
+namespace {
+constexpr Instruction INSTRUCTIONS[256] = {
+    // 0x
+    {"BRK", Implied, false}, {"ORA", Indirect_X, false},
+    {"STP", Implied, true}, {"SLO", Indirect_X, true},
+    {"NOP", ZeroPage, true}, {"ORA", ZeroPage, false},
+    {"ASL", ZeroPage, false}, {"SLO", ZeroPage, true},
+    {"PHP", Implied, false}, {"ORA", Immediate, false},
+    {"ASL", Accumulator, false}, {"ANC", Immediate, true},
+    {"NOP", Absolute, true}, {"ORA", Absolute, false},
+    {"ASL", Absolute, false}, {"SLO", Absolute, true},
+    // 1x
+    {"BPL", Relative, false}, {"ORA", Indirect_Y, false},
+    {"STP", Implied, true}, {"SLO", Indirect_Y, true},
+    {"NOP", ZeroPage_X, true}, {"ORA", ZeroPage_X, false},
+    {"ASL", ZeroPage_X, false}, {"SLO", ZeroPage_X, true},
+    {"CLC", Implied, false}, {"ORA", Absolute_Y, false},
+    {"NOP", Implied, true}, {"SLO", Absolute_Y, true},
+    {"NOP", Absolute_X, true}, {"ORA", Absolute_X, false},
+    {"ASL", Absolute_X, false}, {"SLO", Absolute_X, true},
+    // 2x
+    {"JSR", Absolute, false}, {"AND", Indirect_X, false},
+    {"STP", Implied, true}, {"RLA", Indirect_X, true},
+    {"BIT", ZeroPage, false}, {"AND", ZeroPage, false},
+    {"ROL", ZeroPage, false}, {"RLA", ZeroPage, true},
+    {"PLP", Implied, false}, {"AND", Immediate, false},
+    {"ROL", Accumulator, false}, {"ANC", Immediate, true},
+    {"BIT", Absolute, false}, {"AND", Absolute, false},
+    {"ROL", Absolute, false}, {"RLA", Absolute, true},
+    // 3x
+    {"BMI", Relative, false}, {"AND", Indirect_Y, false},
+    {"STP", Implied, true}, {"RLA", Indirect_Y, true},
+    {"NOP", ZeroPage_X, true}, {"AND", ZeroPage_X, false},
+    {"ROL", ZeroPage_X, false}, {"RLA", ZeroPage_X, true},
+    {"SEC", Implied, false}, {"AND", Absolute_Y, false},
+    {"NOP", Implied, true}, {"RLA", Absolute_Y, true},
+    {"NOP", Absolute_X, true}, {"AND", Absolute_X, false},
+    {"ROL", Absolute_X, false}, {"RLA", Absolute_X, true},
+    // 4x
+    {"RTI", Implied, false}, {"EOR", Indirect_X, false},
+    {"STP", Implied, true}, {"SRE", Indirect_X, true},
+    {"NOP", ZeroPage, true}, {"EOR", ZeroPage, false},
+    {"LSR", ZeroPage, false}, {"SRE", ZeroPage, true},
+    {"PHA", Implied, false}, {"EOR", Immediate, false},
+    {"LSR", Accumulator, false}, {"ALR", Immediate, true},
+    {"JMP", Absolute, false}, {"EOR", Absolute, false},
+    {"LSR", Absolute, false}, {"SRE", Absolute, true},
+    // 5x
+    {"BVC", Relative, false}, {"EOR", Indirect_Y, false},
+    {"STP", Implied, true}, {"SRE", Indirect_Y, true},
+    {"NOP", ZeroPage_X, true}, {"EOR", ZeroPage_X, false},
+    {"LSR", ZeroPage_X, false}, {"SRE", ZeroPage_X, true},
+    {"CLI", Implied, false}, {"EOR", Absolute_Y, false},
+    {"NOP", Implied, true}, {"SRE", Absolute_Y, true},
+    {"NOP", Absolute_X, true}, {"EOR", Absolute_X, false},
+    {"LSR", Absolute_X, false}, {"SRE", Absolute_X, true},
+    // 6x
+    {"RTS", Implied, false}, {"ADC", Indirect_X, false},
+    {"STP", Implied, true}, {"RRA", Indirect_X, true},
+    {"NOP", ZeroPage, true}, {"ADC", ZeroPage, false},
+    {"ROR", ZeroPage, false}, {"RRA", ZeroPage, true},
+    {"PLA", Implied, false}, {"ADC", Immediate, false},
+    {"ROR", Accumulator, false}, {"ARR", Immediate, true},
+    {"JMP", Indirect, false}, {"ADC", Absolute, false},
+    {"ROR", Absolute, false}, {"RRA", Absolute, true},
+    // 7x
+    {"BVS", Relative, false}, {"ADC", Indirect_Y, false},
+    {"STP", Implied, true}, {"RRA", Indirect_Y, true},
+    {"NOP", ZeroPage_X, true}, {"ADC", ZeroPage_X, false},
+    {"ROR", ZeroPage_X, false}, {"RRA", ZeroPage_X, true},
+    {"SEI", Implied, false}, {"ADC", Absolute_Y, false},
+    {"NOP", Implied, true}, {"RRA", Absolute_Y, true},
+    {"NOP", Absolute_X, true}, {"ADC", Absolute_X, false},
+    {"ROR", Absolute_X, false}, {"RRA", Absolute_X, true},
+    // 8x
+    {"NOP", Immediate, true}, {"STA", Indirect_X, false},
+    {"NOP", Immediate, true}, {"SAX", Indirect_X, true},
+    {"STY", ZeroPage, false}, {"STA", ZeroPage, false},
+    {"STX", ZeroPage, false}, {"SAX", ZeroPage, true},
+    {"DEY", Implied, false}, {"NOP", Immediate, true},
+    {"TXA", Implied, false}, {"XAA", Immediate, true},
+    {"STY", Absolute, false}, {"STA", Absolute, false},
+    {"STX", Absolute, false}, {"SAX", Absolute, true},
+    // 9x
+    {"BCC", Relative, false}, {"STA", Indirect_Y, false},
+    {"STP", Implied, true}, {"AHX", Indirect_Y, true},
+    {"STY", ZeroPage_X, false}, {"STA", ZeroPage_X, false},
+    {"STX", ZeroPage_Y, false}, {"SAX", ZeroPage_Y, true},
+    {"TYA", Implied, false}, {"STA", Absolute_Y, false},
+    {"TXS", Implied, false}, {"TAS", Absolute_Y, true},
+    {"SHY", Absolute_X, true}, {"STA", Absolute_X, false},
+    {"SHX", Absolute_Y, true}, {"AHX", Absolute_Y, true},
+    // Ax
+    {"LDY", Immediate, false}, {"LDA", Indirect_X, false},
+    {"LDX", Immediate, false}, {"LAX", Indirect_X, true},
+    {"LDY", ZeroPage, false}, {"LDA", ZeroPage, false},
+    {"LDX", ZeroPage, false}, {"LAX", ZeroPage, true},
+    {"TAY", Implied, false}, {"LDA", Immediate, false},
+    {"TAX", Implied, false}, {"LAX", Immediate, true},
+    {"LDY", Absolute, false}, {"LDA", Absolute, false},
+    {"LDX", Absolute, false}, {"LAX", Absolute, true},
+    // Bx
+    {"BCS", Relative, false}, {"LDA", Indirect_Y, false},
+    {"STP", Implied, true}, {"LAX", Indirect_Y, true},
+    {"LDY", ZeroPage_X, false}, {"LDA", ZeroPage_X, false},
+    {"LDX", ZeroPage_Y, false}, {"LAX", ZeroPage_Y, true},
+    {"CLV", Implied, false}, {"LDA", Absolute_Y, false},
+    {"TSX", Implied, false}, {"LAS", Absolute_Y, true},
+    {"LDY", Absolute_X, false}, {"LDA", Absolute_X, false},
+    {"LDX", Absolute_Y, false}, {"LAX", Absolute_Y, true},
+    // Cx
+    {"CPY", Immediate, false}, {"CMP", Indirect_X, false},
+    {"NOP", Immediate, true}, {"DCP", Indirect_X, true},
+    {"CPY", ZeroPage, false}, {"CMP", ZeroPage, false},
+    {"DEC", ZeroPage, false}, {"DCP", ZeroPage, true},
+    {"INY", Implied, false}, {"CMP", Immediate, false},
+    {"DEX", Implied, false}, {"AXS", Immediate, true},
+    {"CPY", Absolute, false}, {"CMP", Absolute, false},
+    {"DEC", Absolute, false}, {"DCP", Absolute, true},
+    // Dx
+    {"BNE", Relative, false}, {"CMP", Indirect_Y, false},
+    {"STP", Implied, true}, {"DCP", Indirect_Y, true},
+    {"NOP", ZeroPage_X, true}, {"CMP", ZeroPage_X, false},
+    {"DEC", ZeroPage_X, false}, {"DCP", ZeroPage_X, true},
+    {"CLD", Implied, false}, {"CMP", Absolute_Y, false},
+    {"NOP", Implied, true}, {"DCP", Absolute_Y, true},
+    {"NOP", Absolute_X, true}, {"CMP", Absolute_X, false},
+    {"DEC", Absolute_X, false}, {"DCP", Absolute_X, true},
+    // Ex
+    {"CPX", Immediate, false}, {"SBC", Indirect_X, false},
+    {"NOP", Immediate, true}, {"ISB", Indirect_X, true},
+    {"CPX", ZeroPage, false}, {"SBC", ZeroPage, false},
+    {"INC", ZeroPage, false}, {"ISB", ZeroPage, true},
+    {"INX", Implied, false}, {"SBC", Immediate, false},
+    {"NOP", Implied, false}, {"SBC", Immediate, true},
+    {"CPX", Absolute, false}, {"SBC", Absolute, false},
+    {"INC", Absolute, false}, {"ISB", Absolute, true},
+    // Fx
+    {"BEQ", Relative, false}, {"SBC", Indirect_Y, false},
+    {"STP", Implied, true}, {"ISB", Indirect_Y, true},
+    {"NOP", ZeroPage_X, true}, {"SBC", ZeroPage_X, false},
+    {"INC", ZeroPage_X, false}, {"ISB", ZeroPage_X, true},
+    {"SED", Implied, false}, {"SBC", Absolute_Y, false},
+    {"NOP", Implied, true}, {"ISB", Absolute_Y, true},
+    {"NOP", Absolute_X, true}, {"SBC", Absolute_X, false},
+    {"INC", Absolute_X, false}, {"ISB", Absolute_X, true},
+};
+} // namespace
+
+const Instruction &instruction(uint8_t code) { return INSTRUCTIONS[code]; }
+
+uint8_t length(uint8_t code) {
+  switch (INSTRUCTIONS[code].mode) {
+  case Implied:
+  case Accumulator:
+    return 1;
+  case Absolute:
+  case Absolute_X:
+  case Absolute_Y:
+  case Indirect:
+    return 3;
+  default:
+    return 2;
+  }
+}
+
+std::string format(uint16_t pc, const uint8_t bytes[3]) {
+  const Instruction &instruction = INSTRUCTIONS[bytes[0]];
+  uint8_t low = bytes[1];
+  uint16_t word = bytes[1] | bytes[2] << 8;
+
+  char text[32];
+  const char *name = instruction.name;
+  switch (instruction.mode) {
+  case Implied:
+    std::snprintf(text, sizeof(text), "%s", name);
+    break;
+  case Accumulator:
+    std::snprintf(text, sizeof(text), "%s A", name);
+    break;
+  case Immediate:
+    std::snprintf(text, sizeof(text), "%s #$%02X", name, low);
+    break;
+  case Relative:
+    std::snprintf(text, sizeof(text), "%s $%04X", name,
+                  static_cast<uint16_t>(pc + 2 + static_cast<int8_t>(low)));
+    break;
+  case ZeroPage:
+    std::snprintf(text, sizeof(text), "%s $%02X", name, low);
+    break;
+  case ZeroPage_X:
+    std::snprintf(text, sizeof(text), "%s $%02X,X", name, low);
+    break;
+  case ZeroPage_Y:
+    std::snprintf(text, sizeof(text), "%s $%02X,Y", name, low);
+    break;
+  case Absolute:
+    std::snprintf(text, sizeof(text), "%s $%04X", name, word);
+    break;
+  case Absolute_X:
+    std::snprintf(text, sizeof(text), "%s $%04X,X", name, word);
+    break;
+  case Absolute_Y:
+    std::snprintf(text, sizeof(text), "%s $%04X,Y", name, word);
+    break;
+  case Indirect:
+    std::snprintf(text, sizeof(text), "%s ($%04X)", name, word);
+    break;
+  case Indirect_X:
+    std::snprintf(text, sizeof(text), "%s ($%02X,X)", name, low);
+    break;
+  default:
+    std::snprintf(text, sizeof(text), "%s ($%02X),Y", name, low);
+    break;
+  }
+
+  return text;
+}
+
+const char *mode_name(AddressingMode mode) {
+  switch (mode) {
+  case Accumulator:
+    return "accumulator";
+  case Implied:
+    return "implied";
+  case Immediate:
+    return "immediate";
+  case Relative:
+    return "relative";
+  case ZeroPage:
+    return "zero page";
+  case ZeroPage_X:
+    return "zero page,X";
+  case ZeroPage_Y:
+    return "zero page,Y";
+  case Absolute:
+    return "absolute";
+  case Absolute_X:
+    return "absolute,X";
+  case Absolute_Y:
+    return "absolute,Y";
+  case Indirect:
+    return "indirect";
+  case Indirect_X:
+    return "(indirect,X)";
+  case Indirect_Y:
+    return "(indirect),Y";
+  default:
+    return "resolved";
+  }
+}
+} // namespace disassembly
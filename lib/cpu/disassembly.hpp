@@ -0,0 +1,24 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstdint>
+#include <string>
+
+// names and addressing modes of every opcode, unofficial ones included, for
+// the trace and the profiler
+namespace disassembly {
+struct Instruction {
+  char name[4];
+  AddressingMode mode;
+  // not in the official instruction set, marked with a * in the nestest log
+  bool unofficial;
+};
+
+const Instruction &instruction(uint8_t code);
+// bytes of the instruction, opcode included
+uint8_t length(uint8_t code);
+// the instruction at `pc` in assembly (ex: `LDA ($80),Y`, `BNE $C002`),
+// `bytes` holds its opcode and operands
+std::string format(uint16_t pc, const uint8_t bytes[3]);
+const char *mode_name(AddressingMode mode);
+} // namespace disassembly
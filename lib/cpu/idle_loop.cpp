@@ -0,0 +1,154 @@
+#include "cpu.hpp"
+#include "../error/error.hpp"
+#include "opcodes.hpp"
+
+namespace {
+// instructions of an idle loop, its branch included
+constexpr uint8_t MAX_INSTRUCTIONS = 4;
+} // namespace
+
+void CPU::add_idle_register(uint16_t addr, uint8_t stable) {
+  if (idle_register_count == idle_registers.size()) {
+    error::fail("too many idle registers");
+  }
+  idle_registers[idle_register_count++] = {addr, stable};
+  idle_loops = {};
+}
+
+void CPU::check_idle_loop() {
+  auto page = static_cast<uint8_t>(pc >> Bus::PAGE_SHIFT);
+  const uint8_t *source = bus.get_read_page(page);
+  auto &loop = idle_loops[(pc ^ (pc >> 4)) & (idle_loops.size() - 1)];
+  if (loop.head != pc || loop.source != source) {
+    loop = {};
+    loop.head = pc;
+    loop.source = source;
+    loop.length = idle_loop_length(pc);
+    idle_stats.analyzed++;
+    idle_stats.loops += loop.length > 0;
+  }
+  if (loop.length == 0) {
+    return;
+  }
+
+  // the last iteration ran on its own (no interrupt, no DMA) and changed
+  // nothing, so every iteration until the deadline does the same. only the
+  // ones ending before it are skipped, the rest run and read at their cycle
+  uint8_t now = get_status();
+  if (cycles - loop.arrival == loop.length && reg_a == loop.reg_a &&
+      reg_x == loop.reg_x && reg_y == loop.reg_y && now == loop.status &&
+      cycles + loop.length < *idle_deadline) {
+    uint64_t iterations = (*idle_deadline - 1 - cycles) / loop.length;
+    cycles += iterations * loop.length;
+    idle_stats.skips++;
+    idle_stats.skipped_cycles += iterations * loop.length;
+  }
+
+  loop.arrival = cycles;
+  loop.reg_a = reg_a;
+  loop.reg_x = reg_x;
+  loop.reg_y = reg_y;
+  loop.status = now;
+}
+
+// the loop has to sit in read-only memory, in one page, and end with a
+// branch or a JMP to its head. the instructions before it read memory or an
+// idle register and only change registers and flags
+uint8_t CPU::idle_loop_length(uint16_t head) const {
+  auto page = static_cast<uint8_t>(head >> Bus::PAGE_SHIFT);
+  const uint8_t *code = bus.get_read_page(page);
+  if (code == nullptr || bus.is_writable(page)) {
+    return 0;
+  }
+
+  // an I/O register can only be the first read, and the loop has to test
+  // bits of it the branch looks at (N, V or what an AND leaves of it)
+  uint16_t io_addr = 0;
+  uint8_t io_bits = 0xff;
+  bool io = false;
+
+  uint32_t offset = head & (Bus::PAGE_SIZE - 1);
+  uint32_t length = 0;
+  for (uint8_t i = 0; i < MAX_INSTRUCTIONS; ++i) {
+    const OpCode &op = op_table[code[offset]];
+    Operation operation = op.operation;
+    if (offset + op.bytes > Bus::PAGE_SIZE) {
+      return 0;
+    }
+    uint16_t operand = op.bytes == 3 ? code[offset + 1] | code[offset + 2] << 8
+                       : op.bytes == 2 ? code[offset + 1]
+                                       : 0;
+    uint16_t next = (head & 0xff00) | (offset + op.bytes);
+    length += op.cycles;
+
+    if (op.mode == Relative) {
+      uint16_t target = next + static_cast<int8_t>(operand);
+      if (target != head) {
+        return 0;
+      }
+      length += 1 + ((next & 0xff00) != (target & 0xff00));
+
+      if (io) {
+        uint8_t tested =
+            operation == Operation::Bpl || operation == Operation::Bmi
+                ? flags::NEGATIVE
+            : operation == Operation::Bvc || operation == Operation::Bvs
+                ? flags::OVERFLOW
+                : 0xff;
+        if (!idle_read(io_addr, io_bits & tested)) {
+          return 0;
+        }
+      }
+      return static_cast<uint8_t>(length);
+    }
+    if (operation == Operation::Jmp) {
+      return op.mode == Absolute && operand == head && !io
+                 ? static_cast<uint8_t>(length)
+                 : 0;
+    }
+
+    bool logic = operation == Operation::And || operation == Operation::Ora ||
+                 operation == Operation::Eor;
+    bool compare = operation == Operation::Cmp ||
+                   operation == Operation::Cpx || operation == Operation::Cpy;
+    bool reads = logic || compare || operation == Operation::Lda ||
+                 operation == Operation::Ldx || operation == Operation::Ldy ||
+                 operation == Operation::Bit;
+    if (!reads && operation != Operation::Nop) {
+      return 0;
+    }
+
+    if (op.mode == ZeroPage || op.mode == Absolute) {
+      if (bus.get_read_page(operand >> Bus::PAGE_SHIFT) == nullptr) {
+        // only loads and BIT leave the flags the branch tests as bits of the
+        // register, an AND can still narrow them down
+        if (io || i > 0 || logic || compare ||
+            operation == Operation::Nop) {
+          return 0;
+        }
+        io = true;
+        io_addr = operand;
+      }
+    } else if (op.mode == Immediate) {
+      if (io && operation != Operation::And) {
+        return 0;
+      }
+      if (io) {
+        io_bits &= operand;
+      }
+    } else if (op.mode != Implied) {
+      return 0;
+    }
+    offset += op.bytes;
+  }
+  return 0;
+}
+
+bool CPU::idle_read(uint16_t addr, uint8_t used_bits) const {
+  for (uint8_t i = 0; i < idle_register_count; ++i) {
+    if (idle_registers[i].addr == addr) {
+      return (used_bits & ~idle_registers[i].stable) == 0;
+    }
+  }
+  return false;
+}
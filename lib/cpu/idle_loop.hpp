@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// number of loop heads remembered, a power of two
+#ifndef NES_IDLE_LOOP_SLOTS
+#define NES_IDLE_LOOP_SLOTS 16
+#endif
+
+struct IdleStats {
+  // loop heads looked at, and those found to be idle loops
+  uint64_t analyzed = 0;
+  uint64_t loops = 0;
+  // times the iterations left before a deadline were skipped, and the cycles
+  // they were credited
+  uint64_t skips = 0;
+  uint64_t skipped_cycles = 0;
+};
+
+// a loop of a few loads, logical operations and a branch or jump back to its
+// first instruction (ex: `BIT $2002 / BPL`, `LDA $10 / BEQ`, `JMP *`). it
+// only changes registers and flags, so once an iteration comes back to the
+// registers it started with, every iteration after it does the same thing
+// until what it reads changes
+//
+// what it reads can only change at a scheduler event when it is memory (the
+// CPU is the only one writing to it, and it is busy looping) or an I/O
+// register the system declared stable (see CPU::add_idle_register)
+struct IdleLoop {
+  // host memory behind the head's page when the loop was looked at, a bank
+  // switch makes the entry stale
+  const uint8_t *source = nullptr;
+  uint16_t head = 0;
+  // cycles of one iteration, 0 when the code at the head isn't an idle loop
+  uint8_t length = 0;
+
+  // the registers the last time the CPU jumped back to the head
+  uint64_t arrival = UINT64_MAX;
+  uint8_t reg_a = 0;
+  uint8_t reg_x = 0;
+  uint8_t reg_y = 0;
+  uint8_t status = 0;
+};
+
+// an I/O register an idle loop may poll: the `stable` bits only change at
+// scheduler events, and reading them while they don't change has no effect
+struct IdleRegister {
+  uint16_t addr;
+  uint8_t stable;
+};
@@ -0,0 +1,654 @@
+#include "jit.hpp"
+#include "../error/error.hpp"
+#include "cpu.hpp"
+#include "opcodes.hpp"
+
+#if NES_JIT
+#include <cstring>
+#include <sys/mman.h>
+
+namespace {
+// ModRM reg field of the registers used as operands
+constexpr uint8_t EAX = 0;
+constexpr uint8_t ECX = 1;
+constexpr uint8_t EDX = 2;
+
+// conditional jump opcodes, after 0x0f
+constexpr uint8_t JZ = 0x84;
+constexpr uint8_t JNZ = 0x85;
+constexpr uint8_t JAE = 0x83;
+
+// room left in the buffer below which it is flushed before compiling
+constexpr size_t BLOCK_ROOM = 16 << 10;
+
+int32_t offset_of(const CPU &cpu, const void *field) {
+  return static_cast<int32_t>(static_cast<const char *>(field) -
+                              reinterpret_cast<const char *>(&cpu));
+}
+
+bool native_mode(AddressingMode mode) {
+  switch (mode) {
+  case ZeroPage:
+  case ZeroPage_X:
+  case ZeroPage_Y:
+  case Absolute:
+  case Absolute_X:
+  case Absolute_Y:
+    return true;
+  default:
+    return false;
+  }
+}
+} // namespace
+
+// registers while a block runs:
+//   rbx  the CPU
+//   r12  pointer to the cycle target
+//   r13  instructions left
+//   r14  write page table
+//   r15  read page table
+//   [rsp] bus generation when the block was entered
+Jit::Jit(CPU &cpu)
+    : cpu(cpu), buffer(nullptr), used(0), epilogue(0), entry_size(0),
+      entry(nullptr) {
+  void *memory = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    error::fail("failed to map the JIT code buffer");
+  }
+  buffer = static_cast<uint8_t *>(memory);
+
+  pc_offset = offset_of(cpu, &cpu.pc);
+  a_offset = offset_of(cpu, &cpu.reg_a);
+  x_offset = offset_of(cpu, &cpu.reg_x);
+  y_offset = offset_of(cpu, &cpu.reg_y);
+  sp_offset = offset_of(cpu, &cpu.sp);
+  status_offset = offset_of(cpu, &cpu.status);
+  flag_n_offset = offset_of(cpu, &cpu.flag_n);
+  flag_z_offset = offset_of(cpu, &cpu.flag_z);
+  flag_c_offset = offset_of(cpu, &cpu.flag_c);
+  flag_v_offset = offset_of(cpu, &cpu.flag_v);
+  cycles_offset = offset_of(cpu, &cpu.cycles);
+  generation_offset = offset_of(cpu, &cpu.bus.get_generation());
+  dirty_offset = offset_of(cpu, cpu.bus.dirty_page_table());
+
+  emit_entry();
+  protect(false);
+}
+
+Jit::~Jit() { munmap(buffer, CODE_SIZE); }
+
+void Jit::run(uint64_t instructions, const uint64_t &cycle_target) {
+  const uint8_t *const *read_pages = cpu.bus.read_page_table();
+  uint8_t *const *write_pages = cpu.bus.write_page_table();
+
+  while (instructions > 0 && cpu.cycles < cycle_target) {
+    const uint8_t *code = find_block();
+    bool interpret = code == nullptr;
+    uint16_t from = cpu.pc;
+
+    if (code != nullptr) {
+      stats.runs++;
+      Result result = entry(&cpu, &cycle_target, instructions, read_pages,
+                            write_pages, code);
+      instructions = result.instructions;
+      interpret = result.interpret != 0;
+    }
+
+    if (interpret) {
+      stats.interpreted++;
+      cpu.step();
+      instructions--;
+    }
+
+    // loops polling I/O come back through here, and idle loops leave their
+    // block to (see emit_goto)
+    if (cpu.pc <= from && cpu.idle_deadline != nullptr) {
+      cpu.check_idle_loop();
+    }
+  }
+}
+
+// nullptr when pc is on an I/O page or its instruction runs off the page
+const uint8_t *Jit::find_block() {
+  auto page = static_cast<uint8_t>(cpu.pc >> Bus::PAGE_SHIFT);
+  const uint8_t *source = cpu.bus.get_read_page(page);
+  if (source == nullptr) {
+    return nullptr;
+  }
+
+  auto &slot = slots[(cpu.pc ^ (cpu.pc >> 7)) & (SLOTS - 1)];
+  if (slot.code != nullptr && slot.start == cpu.pc) {
+    if (slot.source == source &&
+        slot.version == cpu.bus.get_page_version(page)) {
+      return slot.code;
+    }
+    stats.invalidations++;
+  }
+
+  cpu.bus.watch_writes(page);
+  const uint8_t *code = compile(source);
+  slot = {source, code, cpu.bus.get_page_version(page), cpu.pc};
+  return code;
+}
+
+void Jit::flush() {
+  slots.fill({});
+  used = entry_size;
+  stats.flushes++;
+}
+
+void Jit::protect(bool writable) {
+  int access = writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC;
+  if (mprotect(buffer, CODE_SIZE, access) != 0) {
+    error::fail("failed to protect the JIT code buffer");
+  }
+}
+
+// shared by every block: saves the callee saved registers, loads the fixed
+// ones and jumps to the block, which jumps back to the epilogue
+void Jit::emit_entry() {
+  // push rbx, r12, r13, r14, r15 / sub rsp, 16 (16-byte aligned calls)
+  emit({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57});
+  emit({0x48, 0x83, 0xec, 0x10});
+  emit({0x48, 0x89, 0xfb}); // mov rbx, rdi
+  emit({0x49, 0x89, 0xf4}); // mov r12, rsi
+  emit({0x49, 0x89, 0xd5}); // mov r13, rdx
+  emit({0x49, 0x89, 0xcf}); // mov r15, rcx
+  emit({0x4d, 0x89, 0xc6}); // mov r14, r8
+  emit({0x41, 0xff, 0xe1}); // jmp r9
+
+  // returns the instructions left in rax, the exit reason is already in rdx
+  epilogue = used;
+  emit({0x4c, 0x89, 0xe8}); // mov rax, r13
+  emit({0x48, 0x83, 0xc4, 0x10});
+  emit({0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b});
+  emit({0xc3});
+
+  entry = reinterpret_cast<Entry>(buffer);
+  entry_size = used;
+}
+
+const uint8_t *Jit::compile(const uint8_t *source) {
+  if (CODE_SIZE - used < BLOCK_ROOM) {
+    flush();
+  }
+  protect(true);
+
+  const uint8_t *code = buffer + used;
+  uint16_t start = cpu.pc;
+  uint32_t offset = start & (Bus::PAGE_SIZE - 1);
+  uint8_t length = 0;
+  bool left = false;
+  fixups.clear();
+  starts.clear();
+
+  // mov eax, [generation] / mov [rsp], eax
+  emit({0x8b});
+  emit_field(EAX, generation_offset);
+  emit({0x89, 0x04, 0x24});
+
+  while (length < MAX_LENGTH) {
+    uint8_t opcode = source[offset];
+    const auto &op = CPU::op_table[opcode];
+    uint8_t bytes = op.bytes;
+    if (offset + bytes > Bus::PAGE_SIZE) {
+      break;
+    }
+
+    auto addr = static_cast<uint16_t>((start & 0xff00) | offset);
+    uint16_t operand = CPU::decode_operand(op, source, offset, addr);
+    uint8_t value = bytes >= 2 ? source[offset + 1] : 0;
+
+    starts.push_back({addr, used});
+    // test r13, r13 / jz stop
+    emit({0x4d, 0x85, 0xed});
+    emit_jump(JZ, Exit::Stop, addr);
+    // mov rax, [cycles] / cmp rax, [r12] / jae stop
+    emit({0x48, 0x8b});
+    emit_field(EAX, cycles_offset);
+    emit({0x49, 0x3b, 0x04, 0x24});
+    emit_jump(JAE, Exit::Stop, addr);
+    // dec r13
+    emit({0x49, 0xff, 0xcd});
+
+    if (!emit_native(opcode, addr, operand, value)) {
+      emit_call(opcode, addr, operand);
+    }
+
+    length++;
+    offset += bytes;
+    if (CPU::ends_block(op)) {
+      left = true;
+      break;
+    }
+    if (offset == Bus::PAGE_SIZE) {
+      break;
+    }
+  }
+
+  if (length == 0) {
+    used = code - buffer;
+    protect(false);
+    return nullptr;
+  }
+
+  if (!left) {
+    emit_set_pc(static_cast<uint16_t>((start & 0xff00) + offset));
+    emit_leave(0);
+  }
+
+  // the exits, shared by the jumps going to the same place
+  std::vector<size_t> stubs(fixups.size());
+  for (size_t i = 0; i < fixups.size(); ++i) {
+    const auto &fixup = fixups[i];
+    size_t stub = used;
+    for (size_t j = 0; j < i; ++j) {
+      if (fixups[j].exit == fixup.exit && fixups[j].pc == fixup.pc) {
+        stub = stubs[j];
+        break;
+      }
+    }
+
+    if (stub == used) {
+      if (fixup.exit == Exit::Interpret) {
+        emit({0x49, 0xff, 0xc5}); // inc r13, step counts the instruction
+      }
+      if (fixup.exit != Exit::Leave) {
+        emit_set_pc(fixup.pc);
+      }
+      emit_leave(fixup.exit == Exit::Interpret);
+    }
+
+    stubs[i] = stub;
+    auto rel = static_cast<uint32_t>(stub - (fixup.at + 4));
+    std::memcpy(buffer + fixup.at, &rel, sizeof(rel));
+  }
+
+  protect(false);
+  stats.compiled++;
+  stats.code_bytes = used;
+  return code;
+}
+
+bool Jit::emit_native(uint8_t code, uint16_t addr, uint16_t operand,
+                      uint8_t value) {
+  using Operation = CPU::Operation;
+  const auto &op = CPU::op_table[code];
+  auto operation = op.operation;
+  auto mode = op.mode;
+
+  // loads and logical operations
+  int32_t load = operation == Operation::Lda   ? a_offset
+                 : operation == Operation::Ldx ? x_offset
+                 : operation == Operation::Ldy ? y_offset
+                                           : -1;
+  uint8_t logic = operation == Operation::And   ? 0x20
+                  : operation == Operation::Eor ? 0x30
+                  : operation == Operation::Ora ? 0x08
+                                            : 0;
+  if (load >= 0 || logic != 0) {
+    if (mode == Immediate) {
+      emit({0xb9}); // mov ecx, imm32
+      emit_u32(value);
+      emit_cycles(op.cycles);
+    } else if (native_mode(mode)) {
+      emit_address(mode, operand);
+      emit_page_check(false, addr);
+      emit_cycles(op.cycles);
+      if (op.page_cycle) {
+        emit_page_cycle(mode, operand);
+      }
+      emit({0x0f, 0xb6, 0xc8});       // movzx ecx, al
+      emit({0x0f, 0xb6, 0x0c, 0x0e}); // movzx ecx, byte [rsi + rcx]
+    } else {
+      return false;
+    }
+
+    if (logic != 0) {
+      emit({0x8a}); // mov al, [a]
+      emit_field(EAX, a_offset);
+      emit({logic, 0xc1}); // and / xor / or cl, al
+      load = a_offset;
+    }
+    emit({0x88}); // mov [register], cl
+    emit_field(ECX, load);
+    emit_zero_and_negative();
+    return true;
+  }
+
+  // stores
+  int32_t store = operation == Operation::Sta   ? a_offset
+                  : operation == Operation::Stx ? x_offset
+                  : operation == Operation::Sty ? y_offset
+                                            : -1;
+  if (store >= 0) {
+    if (!native_mode(mode)) {
+      return false;
+    }
+    emit_address(mode, operand);
+    emit_page_check(true, addr);
+    emit_cycles(op.cycles);
+    emit({0x0f, 0xb6}); // movzx ecx, [register]
+    emit_field(ECX, store);
+    emit({0x0f, 0xb6, 0xd0}); // movzx edx, al
+    emit({0x88, 0x0c, 0x17}); // mov [rdi + rdx], cl
+    emit_dirty();
+    return true;
+  }
+
+  // read-modify-write
+  if (operation == Operation::Inc || operation == Operation::Dec) {
+    if (!native_mode(mode)) {
+      return false;
+    }
+    emit_address(mode, operand);
+    emit_page_check(false, addr);
+    emit_page_check(true, addr);
+    emit_cycles(op.cycles);
+    emit({0x0f, 0xb6, 0xd0});       // movzx edx, al
+    emit({0x0f, 0xb6, 0x0c, 0x16}); // movzx ecx, byte [rsi + rdx]
+    uint8_t step = operation == Operation::Inc ? 0xc1 : 0xc9;
+    emit({0xfe, step});
+    emit({0x88, 0x0c, 0x17}); // mov [rdi + rdx], cl
+    emit_dirty();
+    emit_zero_and_negative();
+    return true;
+  }
+
+  // register transfers, increments and decrements
+  struct Transfer {
+    Operation operation;
+    int32_t from;
+    int32_t to;
+    uint8_t step; // 0, or the ModRM of inc / dec cl
+  };
+  const Transfer transfers[] = {
+      {Operation::Tax, a_offset, x_offset, 0},
+      {Operation::Tay, a_offset, y_offset, 0},
+      {Operation::Txa, x_offset, a_offset, 0},
+      {Operation::Tya, y_offset, a_offset, 0},
+      {Operation::Tsx, sp_offset, x_offset, 0},
+      {Operation::Txs, x_offset, sp_offset, 0},
+      {Operation::Inx, x_offset, x_offset, 0xc1},
+      {Operation::Iny, y_offset, y_offset, 0xc1},
+      {Operation::Dex, x_offset, x_offset, 0xc9},
+      {Operation::Dey, y_offset, y_offset, 0xc9},
+  };
+  for (const auto &transfer : transfers) {
+    if (operation != transfer.operation) {
+      continue;
+    }
+    emit_cycles(op.cycles);
+    emit({0x0f, 0xb6});
+    emit_field(ECX, transfer.from);
+    if (transfer.step != 0) {
+      emit({0xfe, transfer.step});
+    }
+    emit({0x88});
+    emit_field(ECX, transfer.to);
+    if (operation != Operation::Txs) {
+      emit_zero_and_negative();
+    }
+    return true;
+  }
+
+  // flag changes, CLI goes through the interpreter for its IRQ check. C and V
+  // have their own bytes, the others are bits of the status byte
+  struct FlagChange {
+    Operation operation;
+    int32_t offset;
+    uint8_t mask;
+    bool set;
+  };
+  const FlagChange flag_changes[] = {
+      {Operation::Clc, flag_c_offset, flags::CARRY, false},
+      {Operation::Sec, flag_c_offset, flags::CARRY, true},
+      {Operation::Cld, status_offset, flags::DECIMAL_MODE, false},
+      {Operation::Sed, status_offset, flags::DECIMAL_MODE, true},
+      {Operation::Clv, flag_v_offset, flags::OVERFLOW, false},
+      {Operation::Sei, status_offset, flags::INTERRUPT_DISABLE, true},
+  };
+  for (const auto &change : flag_changes) {
+    if (operation != change.operation) {
+      continue;
+    }
+    emit_cycles(op.cycles);
+    if (change.offset != status_offset) {
+      emit({0xc6}); // mov byte [flag], imm8
+      emit_field(0, change.offset);
+      emit({static_cast<uint8_t>(change.set ? change.mask : 0)});
+      return true;
+    }
+    // or / and byte [status], imm8
+    emit({0x80});
+    emit_field(change.set ? 1 : 4, status_offset);
+    emit({static_cast<uint8_t>(change.set ? change.mask : ~change.mask)});
+    return true;
+  }
+
+  if (operation == Operation::Nop && mode == Implied) {
+    emit_cycles(op.cycles);
+    return true;
+  }
+
+  // branches, the target and whether it is on another page are known. Z is
+  // set while its byte is 0, so BNE is the one taken on a non-zero test
+  struct Branch {
+    Operation operation;
+    int32_t offset;
+    uint8_t mask;
+    bool taken_if_set;
+  };
+  const Branch branches[] = {
+      {Operation::Bcc, flag_c_offset, flags::CARRY, false},
+      {Operation::Bcs, flag_c_offset, flags::CARRY, true},
+      {Operation::Bne, flag_z_offset, 0xff, true},
+      {Operation::Beq, flag_z_offset, 0xff, false},
+      {Operation::Bpl, flag_n_offset, flags::NEGATIVE, false},
+      {Operation::Bmi, flag_n_offset, flags::NEGATIVE, true},
+      {Operation::Bvc, flag_v_offset, flags::OVERFLOW, false},
+      {Operation::Bvs, flag_v_offset, flags::OVERFLOW, true},
+  };
+  for (const auto &branch : branches) {
+    if (operation != branch.operation) {
+      continue;
+    }
+    auto next = static_cast<uint16_t>(addr + 2);
+    bool crossed = (next & 0xff00) != (operand & 0xff00);
+
+    emit_cycles(op.cycles);
+    // test byte [flag], mask / j(n)z not taken
+    emit({0xf6});
+    emit_field(0, branch.offset);
+    emit({branch.mask, 0x0f, branch.taken_if_set ? JZ : JNZ});
+    size_t not_taken = used;
+    emit_u32(0);
+
+    emit_cycles(1 + crossed);
+    emit_goto(operand);
+
+    auto rel = static_cast<uint32_t>(used - (not_taken + 4));
+    std::memcpy(buffer + not_taken, &rel, sizeof(rel));
+    emit_set_pc(next);
+    emit_leave(0);
+    return true;
+  }
+
+  if (operation == Operation::Jmp && mode == Absolute) {
+    emit_cycles(op.cycles);
+    emit_goto(operand);
+    return true;
+  }
+
+  return false;
+}
+
+// everything else runs the interpreter's routine for the opcode. a write
+// through it may have remapped a page or hit code, in which case the block
+// is left
+void Jit::emit_call(uint8_t code, uint16_t addr, uint16_t operand) {
+  emit_set_pc(addr);
+  emit({0x48, 0x89, 0xdf}); // mov rdi, rbx
+  emit({0xbe});             // mov esi, imm32
+  emit_u32(operand);
+  emit({0x48, 0xb8}); // mov rax, imm64
+  emit_u64(reinterpret_cast<uint64_t>(CPU::decoded_routine(code)));
+  emit({0xff, 0xd0}); // call rax
+
+  if (CPU::ends_block(CPU::op_table[code])) {
+    emit_leave(0);
+    return;
+  }
+
+  // mov eax, [generation] / cmp eax, [rsp] / jne leave
+  emit({0x8b});
+  emit_field(EAX, generation_offset);
+  emit({0x3b, 0x04, 0x24});
+  emit_jump(JNZ, Exit::Leave, 0);
+}
+
+// leaves the effective address in eax
+void Jit::emit_address(uint8_t mode, uint16_t operand) {
+  switch (mode) {
+  case ZeroPage:
+  case Absolute:
+    emit({0xb8}); // mov eax, imm32
+    emit_u32(operand);
+    break;
+  case ZeroPage_X:
+  case ZeroPage_Y:
+    emit({0x0f, 0xb6}); // movzx eax, [index]
+    emit_field(EAX, mode == ZeroPage_X ? x_offset : y_offset);
+    emit({0x04, static_cast<uint8_t>(operand)}); // add al, imm8
+    break;
+  case Absolute_X:
+  case Absolute_Y:
+    emit({0x0f, 0xb6});
+    emit_field(EAX, mode == Absolute_X ? x_offset : y_offset);
+    emit({0x05}); // add eax, imm32
+    emit_u32(operand);
+    emit({0x25}); // and eax, 0xffff
+    emit_u32(0xffff);
+    break;
+  default:
+    break;
+  }
+}
+
+// one more cycle when indexing moved the address to another page
+void Jit::emit_page_cycle(uint8_t mode, uint16_t operand) {
+  if (mode != Absolute_X && mode != Absolute_Y) {
+    return;
+  }
+  emit({0x80, 0xfc, static_cast<uint8_t>(operand >> 8)}); // cmp ah, imm8
+  emit({0x0f, 0x95, 0xc2});                               // setne dl
+  emit({0x0f, 0xb6, 0xd2});                               // movzx edx, dl
+  emit({0x48, 0x01});                                     // add [cycles], rdx
+  emit_field(EDX, cycles_offset);
+}
+
+// rsi (reads) or rdi (writes) = host page of eax, an I/O page leaves the
+// block for the interpreter
+void Jit::emit_page_check(bool write, uint16_t addr) {
+  if (write) {
+    emit({0x89, 0xc7, 0xc1, 0xef, 0x08}); // mov edi, eax / shr edi, 8
+    emit({0x49, 0x8b, 0x3c, 0xfe});       // mov rdi, [r14 + rdi * 8]
+    emit({0x48, 0x85, 0xff});             // test rdi, rdi
+  } else {
+    emit({0x89, 0xc6, 0xc1, 0xee, 0x08}); // mov esi, eax / shr esi, 8
+    emit({0x49, 0x8b, 0x34, 0xf7});       // mov rsi, [r15 + rsi * 8]
+    emit({0x48, 0x85, 0xf6});             // test rsi, rsi
+  }
+  emit_jump(JZ, Exit::Interpret, addr);
+}
+
+// marks the page of eax written, like Bus::mem_write
+void Jit::emit_dirty() {
+  emit({0x0f, 0xb6, 0xd4}); // movzx edx, ah
+  emit({0xc6, 0x84, 0x13}); // mov byte [rbx + rdx + dirty], 1
+  emit_u32(static_cast<uint32_t>(dirty_offset));
+  emit({0x01});
+}
+
+void Jit::emit_cycles(uint8_t cycles) {
+  emit({0x48, 0x83}); // add qword [cycles], imm8
+  emit_field(0, cycles_offset);
+  emit({cycles});
+}
+
+// from the result in ecx
+void Jit::emit_zero_and_negative() {
+  emit({0x88}); // mov [flag_n], cl
+  emit_field(ECX, flag_n_offset);
+  emit({0x88}); // mov [flag_z], cl
+  emit_field(ECX, flag_z_offset);
+}
+
+void Jit::emit_set_pc(uint16_t pc) {
+  emit({0x66, 0xc7}); // mov word [pc], imm16
+  emit_field(0, pc_offset);
+  emit_u16(pc);
+}
+
+void Jit::emit_leave(uint64_t interpret) {
+  if (interpret) {
+    emit({0xba}); // mov edx, imm32
+    emit_u32(static_cast<uint32_t>(interpret));
+  } else {
+    emit({0x31, 0xd2}); // xor edx, edx
+  }
+  emit({0xe9}); // jmp epilogue
+  emit_u32(static_cast<uint32_t>(epilogue - (used + 4)));
+}
+
+// loops back into the block when the target is one of its instructions,
+// nothing can have changed the code since native instructions don't write
+// to watched pages and the calls leave on a new bus generation. an idle loop
+// leaves instead, run checks it on the way back
+void Jit::emit_goto(uint16_t target) {
+  bool idle = target == starts.front().first && cpu.idle_loop_length(target);
+  for (const auto &start : starts) {
+    if (start.first == target && !idle) {
+      emit({0xe9}); // jmp rel32
+      emit_u32(static_cast<uint32_t>(start.second - (used + 4)));
+      return;
+    }
+  }
+
+  emit_set_pc(target);
+  emit_leave(0);
+}
+
+void Jit::emit_jump(uint8_t opcode, Exit exit, uint16_t pc) {
+  emit({0x0f, opcode});
+  fixups.push_back({used, exit, pc});
+  emit_u32(0);
+}
+
+void Jit::emit(std::initializer_list<uint8_t> bytes) {
+  for (uint8_t byte : bytes) {
+    buffer[used++] = byte;
+  }
+}
+
+void Jit::emit_u16(uint16_t value) {
+  std::memcpy(buffer + used, &value, sizeof(value));
+  used += sizeof(value);
+}
+
+void Jit::emit_u32(uint32_t value) {
+  std::memcpy(buffer + used, &value, sizeof(value));
+  used += sizeof(value);
+}
+
+void Jit::emit_u64(uint64_t value) {
+  std::memcpy(buffer + used, &value, sizeof(value));
+  used += sizeof(value);
+}
+
+void Jit::emit_field(uint8_t reg, int32_t offset) {
+  emit({static_cast<uint8_t>(0x83 | (reg << 3))}); // mod 10, rm rbx
+  emit_u32(static_cast<uint32_t>(offset));
+}
+#endif
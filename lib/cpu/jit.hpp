@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+class CPU;
+
+struct JitStats {
+  // blocks translated, on first use or after their code changed
+  uint64_t compiled = 0;
+  // blocks entered
+  uint64_t runs = 0;
+  // instructions handed to CPU::step: I/O accesses, code on I/O pages
+  uint64_t interpreted = 0;
+  // blocks found stale: their page was written to or remapped
+  uint64_t invalidations = 0;
+  // times the code buffer filled up and everything was thrown away
+  uint64_t flushes = 0;
+  // bytes of x86-64 in the buffer
+  uint64_t code_bytes = 0;
+};
+
+// translates the same straight-line blocks as the block cache into x86-64
+// and runs them natively
+//
+// the 6502 state stays in the CPU object, generated code reaches it through
+// a register holding the CPU's address. loads, stores, read-modify-write,
+// register, flag and branch instructions on RAM / ROM pages are emitted
+// inline. every other instruction becomes a call to its decoded interpreter
+// routine, so the two can't disagree on anything but the fast paths
+//
+// the memory accesses look the page up in the bus' page tables like
+// Bus::mem_read does. an I/O page (or a watched one, for writes) leaves the
+// block before the instruction has done anything and CPU::step runs it, so
+// devices see the exact cycle of the access and writes into code are caught
+// by the bus' page versions
+//
+// cycles are counted per instruction, and the instruction count and the
+// deadline are checked before every one of them, so the CPU stops at the
+// same instruction as the interpreter would
+class Jit {
+public:
+  static constexpr size_t CODE_SIZE = 4 << 20;
+  static constexpr uint32_t SLOTS = 4096;
+  static constexpr uint8_t MAX_LENGTH = 32;
+
+  explicit Jit(CPU &cpu);
+  ~Jit();
+  Jit(const Jit &) = delete;
+  Jit &operator=(const Jit &) = delete;
+
+  // stops after `instructions` instructions or once the cycle counter reaches
+  // `cycle_target`, like CPU::run_threaded
+  void run(uint64_t instructions, const uint64_t &cycle_target);
+
+  JitStats stats;
+
+private:
+  // returned in rax / rdx by the generated code
+  struct Result {
+    uint64_t instructions;
+    uint64_t interpret;
+  };
+  using Entry = Result (*)(CPU *cpu, const uint64_t *cycle_target,
+                           uint64_t instructions,
+                           const uint8_t *const *read_pages,
+                           uint8_t *const *write_pages, const uint8_t *code);
+
+  struct Slot {
+    const uint8_t *source = nullptr;
+    const uint8_t *code = nullptr;
+    uint32_t version = 0;
+    uint16_t start = 0;
+  };
+
+  // exits taken out of a block, emitted after its last instruction
+  enum class Exit : uint8_t {
+    Stop,      // out of instructions or cycles, pc is the instruction's
+    Interpret, // I/O access, CPU::step runs the instruction
+    Leave,     // pc was set by an interpreter routine
+  };
+  struct Fixup {
+    size_t at;
+    Exit exit;
+    uint16_t pc;
+  };
+
+  CPU &cpu;
+  uint8_t *buffer;
+  size_t used;
+  size_t epilogue;
+  size_t entry_size;
+  Entry entry;
+  std::array<Slot, SLOTS> slots;
+  std::vector<Fixup> fixups;
+  // 6502 address and code offset of every instruction of the block
+  std::vector<std::pair<uint16_t, size_t>> starts;
+
+  // where the CPU's fields sit relative to the CPU
+  int32_t pc_offset;
+  int32_t a_offset;
+  int32_t x_offset;
+  int32_t y_offset;
+  int32_t sp_offset;
+  int32_t status_offset;
+  int32_t flag_n_offset;
+  int32_t flag_z_offset;
+  int32_t flag_c_offset;
+  int32_t flag_v_offset;
+  int32_t cycles_offset;
+  int32_t generation_offset;
+  int32_t dirty_offset;
+
+  const uint8_t *find_block();
+  const uint8_t *compile(const uint8_t *source);
+  void flush();
+  void emit_entry();
+  void protect(bool writable);
+
+  // one instruction, false when it has to go through the interpreter
+  bool emit_native(uint8_t code, uint16_t addr, uint16_t operand,
+                   uint8_t value);
+  void emit_call(uint8_t code, uint16_t addr, uint16_t operand);
+  void emit_address(uint8_t mode, uint16_t operand);
+  void emit_page_cycle(uint8_t mode, uint16_t operand);
+  void emit_page_check(bool write, uint16_t addr);
+  void emit_dirty();
+  void emit_cycles(uint8_t cycles);
+  void emit_zero_and_negative();
+  void emit_set_pc(uint16_t pc);
+  void emit_leave(uint64_t interpret);
+  void emit_goto(uint16_t target);
+  void emit_jump(uint8_t opcode, Exit exit, uint16_t pc);
+
+  // raw bytes
+  void emit(std::initializer_list<uint8_t> bytes);
+  void emit_u16(uint16_t value);
+  void emit_u32(uint32_t value);
+  void emit_u64(uint64_t value);
+  // [rbx + offset] as the r/m operand, `reg` in the ModRM reg field
+  void emit_field(uint8_t reg, int32_t offset);
+};
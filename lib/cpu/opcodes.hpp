@@ -0,0 +1,351 @@
+#pragma once
+
+#include "cpu.hpp"
+
+// in the order of CPU::Operation
+inline constexpr std::array<CPU::Handler, CPU::OPERATION_COUNT>
+    CPU::handlers = {
+    // loads and stores
+    &CPU::op_lda, &CPU::op_ldx, &CPU::op_ldy, &CPU::op_sta, &CPU::op_stx,
+    &CPU::op_sty,
+    // register transfers and the stack
+    &CPU::op_tax, &CPU::op_tay, &CPU::op_txa, &CPU::op_tya, &CPU::op_tsx,
+    &CPU::op_txs, &CPU::op_pha, &CPU::op_php, &CPU::op_pla, &CPU::op_plp,
+    // logical and arithmetic operations, increments, decrements and shifts
+    &CPU::op_and, &CPU::op_eor, &CPU::op_ora, &CPU::op_bit, &CPU::op_adc,
+    &CPU::op_sbc, &CPU::op_cmp, &CPU::op_cpx, &CPU::op_cpy, &CPU::op_inc,
+    &CPU::op_inx, &CPU::op_iny, &CPU::op_dec, &CPU::op_dex, &CPU::op_dey,
+    &CPU::op_asl, &CPU::op_lsr, &CPU::op_rol, &CPU::op_ror,
+    // jumps and branches
+    &CPU::op_jmp, &CPU::op_jsr, &CPU::op_rts, &CPU::op_bcc, &CPU::op_bcs,
+    &CPU::op_beq, &CPU::op_bmi, &CPU::op_bne, &CPU::op_bpl, &CPU::op_bvc,
+    &CPU::op_bvs,
+    // status flag changes and system functions
+    &CPU::op_clc, &CPU::op_cld, &CPU::op_cli, &CPU::op_clv, &CPU::op_sec,
+    &CPU::op_sed, &CPU::op_sei, &CPU::op_brk, &CPU::op_nop, &CPU::op_rti,
+    // unofficial opcodes
+    &CPU::op_lax, &CPU::op_sax, &CPU::op_dcp, &CPU::op_isb, &CPU::op_slo,
+    &CPU::op_rla, &CPU::op_sre, &CPU::op_rra, &CPU::op_anc, &CPU::op_alr,
+    &CPU::op_arr, &CPU::op_axs, &CPU::op_xaa, &CPU::op_lxa, &CPU::op_las,
+    &CPU::op_ahx, &CPU::op_shx, &CPU::op_shy, &CPU::op_tas, &CPU::op_stp,
+};
+
+// the table is a compile-time constant so that the threaded engine can
+// specialize a routine per opcode straight out of it. it lands in .rodata
+// (flash on the ESP32), 5 bytes an entry: the handler is an index into the
+// table above rather than a 16-byte member function pointer
+inline constexpr std::array<CPU::OpCode, 256> CPU::op_table = [] {
+  std::array<OpCode, 256> t = {};
+
+  // load instructions
+  // -- LDA
+  t[0xa9] = {Operation::Lda, AddressingMode::Immediate, 2, 2};
+  t[0xa5] = {Operation::Lda, AddressingMode::ZeroPage, 2, 3};
+  t[0xb5] = {Operation::Lda, AddressingMode::ZeroPage_X, 2, 4};
+  t[0xad] = {Operation::Lda, AddressingMode::Absolute, 3, 4};
+  t[0xbd] = {Operation::Lda, AddressingMode::Absolute_X, 3, 4, true};
+  t[0xb9] = {Operation::Lda, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0xa1] = {Operation::Lda, AddressingMode::Indirect_X, 2, 6};
+  t[0xb1] = {Operation::Lda, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- LDX
+  t[0xa2] = {Operation::Ldx, AddressingMode::Immediate, 2, 2};
+  t[0xa6] = {Operation::Ldx, AddressingMode::ZeroPage, 2, 3};
+  t[0xb6] = {Operation::Ldx, AddressingMode::ZeroPage_Y, 2, 4};
+  t[0xae] = {Operation::Ldx, AddressingMode::Absolute, 3, 4};
+  t[0xbe] = {Operation::Ldx, AddressingMode::Absolute_Y, 3, 4, true};
+  // -- LDY
+  t[0xa0] = {Operation::Ldy, AddressingMode::Immediate, 2, 2};
+  t[0xa4] = {Operation::Ldy, AddressingMode::ZeroPage, 2, 3};
+  t[0xb4] = {Operation::Ldy, AddressingMode::ZeroPage_X, 2, 4};
+  t[0xac] = {Operation::Ldy, AddressingMode::Absolute, 3, 4};
+  t[0xbc] = {Operation::Ldy, AddressingMode::Absolute_X, 3, 4, true};
+
+  // store instructions
+  // -- STA
+  t[0x85] = {Operation::Sta, AddressingMode::ZeroPage, 2, 3};
+  t[0x95] = {Operation::Sta, AddressingMode::ZeroPage_X, 2, 4};
+  t[0x8d] = {Operation::Sta, AddressingMode::Absolute, 3, 4};
+  t[0x9d] = {Operation::Sta, AddressingMode::Absolute_X, 3, 5};
+  t[0x99] = {Operation::Sta, AddressingMode::Absolute_Y, 3, 5};
+  t[0x81] = {Operation::Sta, AddressingMode::Indirect_X, 2, 6};
+  t[0x91] = {Operation::Sta, AddressingMode::Indirect_Y, 2, 6};
+  // -- STX
+  t[0x86] = {Operation::Stx, AddressingMode::ZeroPage, 2, 3};
+  t[0x96] = {Operation::Stx, AddressingMode::ZeroPage_Y, 2, 4};
+  t[0x8e] = {Operation::Stx, AddressingMode::Absolute, 3, 4};
+  // -- STY
+  t[0x84] = {Operation::Sty, AddressingMode::ZeroPage, 2, 3};
+  t[0x94] = {Operation::Sty, AddressingMode::ZeroPage_X, 2, 4};
+  t[0x8c] = {Operation::Sty, AddressingMode::Absolute, 3, 4};
+
+  // register transfer instructions
+  // -- TAX
+  t[0xaa] = {Operation::Tax, AddressingMode::Implied, 1, 2};
+  // -- TAY
+  t[0xa8] = {Operation::Tay, AddressingMode::Implied, 1, 2};
+  // -- TXA
+  t[0x8a] = {Operation::Txa, AddressingMode::Implied, 1, 2};
+  // -- TYA
+  t[0x98] = {Operation::Tya, AddressingMode::Implied, 1, 2};
+
+  // stack operations
+  // -- TSX
+  t[0xba] = {Operation::Tsx, AddressingMode::Implied, 1, 2};
+  // -- TXS
+  t[0x9a] = {Operation::Txs, AddressingMode::Implied, 1, 2};
+  // -- PHA
+  t[0x48] = {Operation::Pha, AddressingMode::Implied, 1, 3};
+  // -- PHP
+  t[0x08] = {Operation::Php, AddressingMode::Implied, 1, 3};
+  // -- PLA
+  t[0x68] = {Operation::Pla, AddressingMode::Implied, 1, 4};
+  // -- PLP
+  t[0x28] = {Operation::Plp, AddressingMode::Implied, 1, 4};
+
+  // logical operations
+  // -- AND
+  t[0x29] = {Operation::And, AddressingMode::Immediate, 2, 2};
+  t[0x25] = {Operation::And, AddressingMode::ZeroPage, 2, 3};
+  t[0x35] = {Operation::And, AddressingMode::ZeroPage_X, 2, 4};
+  t[0x2d] = {Operation::And, AddressingMode::Absolute, 3, 4};
+  t[0x3d] = {Operation::And, AddressingMode::Absolute_X, 3, 4, true};
+  t[0x39] = {Operation::And, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0x21] = {Operation::And, AddressingMode::Indirect_X, 2, 6};
+  t[0x31] = {Operation::And, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- EOR
+  t[0x49] = {Operation::Eor, AddressingMode::Immediate, 2, 2};
+  t[0x45] = {Operation::Eor, AddressingMode::ZeroPage, 2, 3};
+  t[0x55] = {Operation::Eor, AddressingMode::ZeroPage_X, 2, 4};
+  t[0x4d] = {Operation::Eor, AddressingMode::Absolute, 3, 4};
+  t[0x5d] = {Operation::Eor, AddressingMode::Absolute_X, 3, 4, true};
+  t[0x59] = {Operation::Eor, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0x41] = {Operation::Eor, AddressingMode::Indirect_X, 2, 6};
+  t[0x51] = {Operation::Eor, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- ORA
+  t[0x09] = {Operation::Ora, AddressingMode::Immediate, 2, 2};
+  t[0x05] = {Operation::Ora, AddressingMode::ZeroPage, 2, 3};
+  t[0x15] = {Operation::Ora, AddressingMode::ZeroPage_X, 2, 4};
+  t[0x0d] = {Operation::Ora, AddressingMode::Absolute, 3, 4};
+  t[0x1d] = {Operation::Ora, AddressingMode::Absolute_X, 3, 4, true};
+  t[0x19] = {Operation::Ora, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0x01] = {Operation::Ora, AddressingMode::Indirect_X, 2, 6};
+  t[0x11] = {Operation::Ora, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- BIT
+  t[0x24] = {Operation::Bit, AddressingMode::ZeroPage, 2, 3};
+  t[0x2c] = {Operation::Bit, AddressingMode::Absolute, 3, 4};
+
+  // arithmetic operations
+  // -- ADC
+  t[0x69] = {Operation::Adc, AddressingMode::Immediate, 2, 2};
+  t[0x65] = {Operation::Adc, AddressingMode::ZeroPage, 2, 3};
+  t[0x75] = {Operation::Adc, AddressingMode::ZeroPage_X, 2, 4};
+  t[0x6d] = {Operation::Adc, AddressingMode::Absolute, 3, 4};
+  t[0x7d] = {Operation::Adc, AddressingMode::Absolute_X, 3, 4, true};
+  t[0x79] = {Operation::Adc, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0x61] = {Operation::Adc, AddressingMode::Indirect_X, 2, 6};
+  t[0x71] = {Operation::Adc, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- SBC
+  t[0xe9] = {Operation::Sbc, AddressingMode::Immediate, 2, 2};
+  t[0xe5] = {Operation::Sbc, AddressingMode::ZeroPage, 2, 3};
+  t[0xf5] = {Operation::Sbc, AddressingMode::ZeroPage_X, 2, 4};
+  t[0xed] = {Operation::Sbc, AddressingMode::Absolute, 3, 4};
+  t[0xfd] = {Operation::Sbc, AddressingMode::Absolute_X, 3, 4, true};
+  t[0xf9] = {Operation::Sbc, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0xe1] = {Operation::Sbc, AddressingMode::Indirect_X, 2, 6};
+  t[0xf1] = {Operation::Sbc, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- CMP
+  t[0xc9] = {Operation::Cmp, AddressingMode::Immediate, 2, 2};
+  t[0xc5] = {Operation::Cmp, AddressingMode::ZeroPage, 2, 3};
+  t[0xd5] = {Operation::Cmp, AddressingMode::ZeroPage_X, 2, 4};
+  t[0xcd] = {Operation::Cmp, AddressingMode::Absolute, 3, 4};
+  t[0xdd] = {Operation::Cmp, AddressingMode::Absolute_X, 3, 4, true};
+  t[0xd9] = {Operation::Cmp, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0xc1] = {Operation::Cmp, AddressingMode::Indirect_X, 2, 6};
+  t[0xd1] = {Operation::Cmp, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- CPX
+  t[0xe0] = {Operation::Cpx, AddressingMode::Immediate, 2, 2};
+  t[0xe4] = {Operation::Cpx, AddressingMode::ZeroPage, 2, 3};
+  t[0xec] = {Operation::Cpx, AddressingMode::Absolute, 3, 4};
+  // -- CPY
+  t[0xc0] = {Operation::Cpy, AddressingMode::Immediate, 2, 2};
+  t[0xc4] = {Operation::Cpy, AddressingMode::ZeroPage, 2, 3};
+  t[0xcc] = {Operation::Cpy, AddressingMode::Absolute, 3, 4};
+
+  // increment operations
+  // -- INC
+  t[0xe6] = {Operation::Inc, AddressingMode::ZeroPage, 2, 5};
+  t[0xf6] = {Operation::Inc, AddressingMode::ZeroPage_X, 2, 6};
+  t[0xee] = {Operation::Inc, AddressingMode::Absolute, 3, 6};
+  t[0xfe] = {Operation::Inc, AddressingMode::Absolute_X, 3, 7};
+  // -- INX
+  t[0xe8] = {Operation::Inx, AddressingMode::Implied, 1, 2};
+  // -- INY
+  t[0xc8] = {Operation::Iny, AddressingMode::Implied, 1, 2};
+
+  // decrement operations
+  // -- DEC
+  t[0xc6] = {Operation::Dec, AddressingMode::ZeroPage, 2, 5};
+  t[0xd6] = {Operation::Dec, AddressingMode::ZeroPage_X, 2, 6};
+  t[0xce] = {Operation::Dec, AddressingMode::Absolute, 3, 6};
+  t[0xde] = {Operation::Dec, AddressingMode::Absolute_X, 3, 7};
+  // -- DEX
+  t[0xca] = {Operation::Dex, AddressingMode::Implied, 1, 2};
+  // -- DEY
+  t[0x88] = {Operation::Dey, AddressingMode::Implied, 1, 2};
+
+  // shifts
+  // -- ASL
+  t[0x0a] = {Operation::Asl, AddressingMode::Accumulator, 1, 2};
+  t[0x06] = {Operation::Asl, AddressingMode::ZeroPage, 2, 5};
+  t[0x16] = {Operation::Asl, AddressingMode::ZeroPage_X, 2, 6};
+  t[0x0e] = {Operation::Asl, AddressingMode::Absolute, 3, 6};
+  t[0x1e] = {Operation::Asl, AddressingMode::Absolute_X, 3, 7};
+  // -- LSR
+  t[0x4a] = {Operation::Lsr, AddressingMode::Accumulator, 1, 2};
+  t[0x46] = {Operation::Lsr, AddressingMode::ZeroPage, 2, 5};
+  t[0x56] = {Operation::Lsr, AddressingMode::ZeroPage_X, 2, 6};
+  t[0x4e] = {Operation::Lsr, AddressingMode::Absolute, 3, 6};
+  t[0x5e] = {Operation::Lsr, AddressingMode::Absolute_X, 3, 7};
+  // -- ROL
+  t[0x2a] = {Operation::Rol, AddressingMode::Accumulator, 1, 2};
+  t[0x26] = {Operation::Rol, AddressingMode::ZeroPage, 2, 5};
+  t[0x36] = {Operation::Rol, AddressingMode::ZeroPage_X, 2, 6};
+  t[0x2e] = {Operation::Rol, AddressingMode::Absolute, 3, 6};
+  t[0x3e] = {Operation::Rol, AddressingMode::Absolute_X, 3, 7};
+  // -- ROR
+  t[0x6a] = {Operation::Ror, AddressingMode::Accumulator, 1, 2};
+  t[0x66] = {Operation::Ror, AddressingMode::ZeroPage, 2, 5};
+  t[0x76] = {Operation::Ror, AddressingMode::ZeroPage_X, 2, 6};
+  t[0x6e] = {Operation::Ror, AddressingMode::Absolute, 3, 6};
+  t[0x7e] = {Operation::Ror, AddressingMode::Absolute_X, 3, 7};
+
+  // jumps & calls
+  // -- JMP
+  t[0x4c] = {Operation::Jmp, AddressingMode::Absolute, 3, 3};
+  t[0x6c] = {Operation::Jmp, AddressingMode::Indirect, 3, 5};
+  // -- JSR
+  t[0x20] = {Operation::Jsr, AddressingMode::Absolute, 3, 6};
+  // -- RTS
+  t[0x60] = {Operation::Rts, AddressingMode::Implied, 1, 6};
+
+  // branches
+  // -- BCC
+  t[0x90] = {Operation::Bcc, AddressingMode::Relative, 2, 2};
+  // -- BCS
+  t[0xb0] = {Operation::Bcs, AddressingMode::Relative, 2, 2};
+  // -- BEQ
+  t[0xf0] = {Operation::Beq, AddressingMode::Relative, 2, 2};
+  // -- BMI
+  t[0x30] = {Operation::Bmi, AddressingMode::Relative, 2, 2};
+  // -- BNE
+  t[0xd0] = {Operation::Bne, AddressingMode::Relative, 2, 2};
+  // -- BPL
+  t[0x10] = {Operation::Bpl, AddressingMode::Relative, 2, 2};
+  // -- BVC
+  t[0x50] = {Operation::Bvc, AddressingMode::Relative, 2, 2};
+  // -- BVS
+  t[0x70] = {Operation::Bvs, AddressingMode::Relative, 2, 2};
+
+  // status flag changes
+  // -- CLC
+  t[0x18] = {Operation::Clc, AddressingMode::Implied, 1, 2};
+  // -- CLD
+  t[0xd8] = {Operation::Cld, AddressingMode::Implied, 1, 2};
+  // -- CLI
+  t[0x58] = {Operation::Cli, AddressingMode::Implied, 1, 2};
+  // -- CLV
+  t[0xb8] = {Operation::Clv, AddressingMode::Implied, 1, 2};
+  // -- SEC
+  t[0x38] = {Operation::Sec, AddressingMode::Implied, 1, 2};
+  // -- SED
+  t[0xf8] = {Operation::Sed, AddressingMode::Implied, 1, 2};
+  // -- SEI
+  t[0x78] = {Operation::Sei, AddressingMode::Implied, 1, 2};
+
+  // system functions
+  // -- BRK
+  t[0x00] = {Operation::Brk, AddressingMode::Implied, 1, 7};
+  // -- NOP
+  t[0xea] = {Operation::Nop, AddressingMode::Implied, 1, 2};
+  // -- RTI
+  t[0x40] = {Operation::Rti, AddressingMode::Implied, 1, 6};
+
+  // unofficial opcodes
+  // -- NOP
+  for (uint8_t code : {0x1a, 0x3a, 0x5a, 0x7a, 0xda, 0xfa}) {
+    t[code] = {Operation::Nop, AddressingMode::Implied, 1, 2};
+  }
+  for (uint8_t code : {0x80, 0x82, 0x89, 0xc2, 0xe2}) {
+    t[code] = {Operation::Nop, AddressingMode::Immediate, 2, 2};
+  }
+  for (uint8_t code : {0x04, 0x44, 0x64}) {
+    t[code] = {Operation::Nop, AddressingMode::ZeroPage, 2, 3};
+  }
+  for (uint8_t code : {0x14, 0x34, 0x54, 0x74, 0xd4, 0xf4}) {
+    t[code] = {Operation::Nop, AddressingMode::ZeroPage_X, 2, 4};
+  }
+  t[0x0c] = {Operation::Nop, AddressingMode::Absolute, 3, 4};
+  for (uint8_t code : {0x1c, 0x3c, 0x5c, 0x7c, 0xdc, 0xfc}) {
+    t[code] = {Operation::Nop, AddressingMode::Absolute_X, 3, 4, true};
+  }
+  // -- STP
+  for (uint8_t code :
+       {0x02, 0x12, 0x22, 0x32, 0x42, 0x52, 0x62, 0x72, 0x92, 0xb2, 0xd2,
+        0xf2}) {
+    t[code] = {Operation::Stp, AddressingMode::Implied, 1, 2};
+  }
+  // -- LAX
+  t[0xa7] = {Operation::Lax, AddressingMode::ZeroPage, 2, 3};
+  t[0xb7] = {Operation::Lax, AddressingMode::ZeroPage_Y, 2, 4};
+  t[0xaf] = {Operation::Lax, AddressingMode::Absolute, 3, 4};
+  t[0xbf] = {Operation::Lax, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0xa3] = {Operation::Lax, AddressingMode::Indirect_X, 2, 6};
+  t[0xb3] = {Operation::Lax, AddressingMode::Indirect_Y, 2, 5, true};
+  // -- SAX
+  t[0x87] = {Operation::Sax, AddressingMode::ZeroPage, 2, 3};
+  t[0x97] = {Operation::Sax, AddressingMode::ZeroPage_Y, 2, 4};
+  t[0x8f] = {Operation::Sax, AddressingMode::Absolute, 3, 4};
+  t[0x83] = {Operation::Sax, AddressingMode::Indirect_X, 2, 6};
+  // -- SBC
+  t[0xeb] = {Operation::Sbc, AddressingMode::Immediate, 2, 2};
+  // -- DCP, ISB, SLO, RLA, SRE, RRA
+  //
+  // read-modify-write then an operation on A, the same seven addressing
+  // modes and cycles for all of them
+  struct ReadModifyWrite {
+    uint8_t base;
+    Operation operation;
+  };
+  for (auto rmw : {ReadModifyWrite{0x03, Operation::Slo},
+                   ReadModifyWrite{0x23, Operation::Rla},
+                   ReadModifyWrite{0x43, Operation::Sre},
+                   ReadModifyWrite{0x63, Operation::Rra},
+                   ReadModifyWrite{0xc3, Operation::Dcp},
+                   ReadModifyWrite{0xe3, Operation::Isb}}) {
+    uint8_t b = rmw.base;
+    t[b] = {rmw.operation, AddressingMode::Indirect_X, 2, 8};
+    t[b + 0x04] = {rmw.operation, AddressingMode::ZeroPage, 2, 5};
+    t[b + 0x0c] = {rmw.operation, AddressingMode::Absolute, 3, 6};
+    t[b + 0x10] = {rmw.operation, AddressingMode::Indirect_Y, 2, 8};
+    t[b + 0x14] = {rmw.operation, AddressingMode::ZeroPage_X, 2, 6};
+    t[b + 0x18] = {rmw.operation, AddressingMode::Absolute_Y, 3, 7};
+    t[b + 0x1c] = {rmw.operation, AddressingMode::Absolute_X, 3, 7};
+  }
+  // -- ANC, ALR, ARR, AXS, XAA, LXA (LAX #imm)
+  t[0x0b] = {Operation::Anc, AddressingMode::Immediate, 2, 2};
+  t[0x2b] = {Operation::Anc, AddressingMode::Immediate, 2, 2};
+  t[0x4b] = {Operation::Alr, AddressingMode::Immediate, 2, 2};
+  t[0x6b] = {Operation::Arr, AddressingMode::Immediate, 2, 2};
+  t[0xcb] = {Operation::Axs, AddressingMode::Immediate, 2, 2};
+  t[0x8b] = {Operation::Xaa, AddressingMode::Immediate, 2, 2};
+  t[0xab] = {Operation::Lxa, AddressingMode::Immediate, 2, 2};
+  // -- LAS, AHX, SHX, SHY, TAS
+  t[0xbb] = {Operation::Las, AddressingMode::Absolute_Y, 3, 4, true};
+  t[0x93] = {Operation::Ahx, AddressingMode::Indirect_Y, 2, 6};
+  t[0x9f] = {Operation::Ahx, AddressingMode::Absolute_Y, 3, 5};
+  t[0x9e] = {Operation::Shx, AddressingMode::Absolute_Y, 3, 5};
+  t[0x9c] = {Operation::Shy, AddressingMode::Absolute_X, 3, 5};
+  t[0x9b] = {Operation::Tas, AddressingMode::Absolute_Y, 3, 5};
+
+  return t;
+}();
@@ -0,0 +1,185 @@
+#include "profile.hpp"
+#include "disassembly.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+Profile::Profile() { clear(); }
+
+void Profile::clear() {
+  opcode_counts = {};
+  opcode_cycles = {};
+  mode_counts = {};
+  pc_hits = {};
+  nodes[0] = {0, 0, Frame::Root, 0};
+  node_count = 1;
+  current = 0;
+  children = {};
+  depth = 0;
+}
+
+void Profile::call(Frame frame, uint16_t addr, uint8_t sp) {
+  if (depth == calls.size()) {
+    return;
+  }
+  calls[depth++] = {current, sp};
+  current = find_child(current, frame, addr);
+}
+
+void Profile::ret(uint8_t sp) {
+  // a call pushes below the stack pointer it was made at, getting back to it
+  // (or above it, the stack unwound by hand) leaves the call. the stack
+  // wraps around the page, so above means less than half a page above
+  while (depth > 0 && static_cast<uint8_t>(sp - calls[depth - 1].sp) < 0x80) {
+    current = calls[--depth].node;
+  }
+}
+
+uint16_t Profile::find_child(uint16_t parent, Frame frame, uint16_t addr) {
+  uint32_t key = (static_cast<uint32_t>(parent) * 31 +
+                  static_cast<uint32_t>(frame)) * 0x9e3779b1u ^ addr;
+  uint32_t mask = children.size() - 1;
+  for (uint32_t slot = key & mask;; slot = (slot + 1) & mask) {
+    uint16_t index = children[slot];
+    if (index == 0) {
+      // out of nodes, the call counts in its caller
+      if (node_count == NODE_COUNT) {
+        return parent;
+      }
+      index = node_count++;
+      nodes[index] = {parent, addr, frame, 0};
+      children[slot] = index;
+      return index;
+    }
+    const Node &node = nodes[index];
+    if (node.parent == parent && node.frame == frame && node.addr == addr) {
+      return index;
+    }
+  }
+}
+
+uint64_t Profile::instructions() const {
+  uint64_t total = 0;
+  for (uint64_t count : opcode_counts) {
+    total += count;
+  }
+  return total;
+}
+
+uint64_t Profile::cycles() const {
+  uint64_t total = 0;
+  for (uint64_t count : opcode_cycles) {
+    total += count;
+  }
+  return total;
+}
+
+namespace {
+double percent(uint64_t part, uint64_t total) {
+  return total == 0 ? 0.0 : 100.0 * part / total;
+}
+
+// indices of the `top` largest values, largest first
+template <typename Values>
+std::vector<uint32_t> busiest(const Values &values, size_t top) {
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < values.size(); ++i) {
+    if (values[i] != 0) {
+      indices.push_back(i);
+    }
+  }
+  top = std::min(top, indices.size());
+  std::partial_sort(indices.begin(), indices.begin() + top, indices.end(),
+                    [&](uint32_t a, uint32_t b) {
+                      return values[a] != values[b] ? values[a] > values[b]
+                                                    : a < b;
+                    });
+  indices.resize(top);
+  return indices;
+}
+
+template <typename... Args>
+void append(std::string &out, const char *format, Args... args) {
+  char line[128];
+  std::snprintf(line, sizeof(line), format, args...);
+  out += line;
+}
+} // namespace
+
+std::string Profile::report(size_t top) const {
+  uint64_t total_instructions = instructions();
+  uint64_t total_cycles = cycles();
+  std::string out;
+  append(out, "%llu instructions, %llu cycles\n",
+         static_cast<unsigned long long>(total_instructions),
+         static_cast<unsigned long long>(total_cycles));
+
+  out += "\nopcodes by cycles\n";
+  for (uint32_t code : busiest(opcode_cycles, top)) {
+    const auto &instruction = disassembly::instruction(code);
+    append(out, "  %02X %-3s %-13s %12llu %14llu %6.2f%%\n", code,
+           instruction.name, disassembly::mode_name(instruction.mode),
+           static_cast<unsigned long long>(opcode_counts[code]),
+           static_cast<unsigned long long>(opcode_cycles[code]),
+           percent(opcode_cycles[code], total_cycles));
+  }
+
+  out += "\naddressing modes by addresses worked out\n";
+  for (uint32_t mode : busiest(mode_counts, top)) {
+    append(out, "  %-13s %12llu\n",
+           disassembly::mode_name(static_cast<AddressingMode>(mode)),
+           static_cast<unsigned long long>(mode_counts[mode]));
+  }
+
+  out += "\naddresses by instructions run\n";
+  for (uint32_t bucket : busiest(pc_hits, top)) {
+    append(out, "  $%04X %12llu %6.2f%%\n", bucket << NES_PROFILE_PC_SHIFT,
+           static_cast<unsigned long long>(pc_hits[bucket]),
+           percent(pc_hits[bucket], total_instructions));
+  }
+  return out;
+}
+
+std::string Profile::frame_name(const Node &node) const {
+  char name[16];
+  switch (node.frame) {
+  case Frame::Root:
+    return "main";
+  case Frame::Nmi:
+    std::snprintf(name, sizeof(name), "nmi $%04X", node.addr);
+    break;
+  case Frame::Irq:
+    std::snprintf(name, sizeof(name), "irq $%04X", node.addr);
+    break;
+  case Frame::Brk:
+    std::snprintf(name, sizeof(name), "brk $%04X", node.addr);
+    break;
+  default:
+    std::snprintf(name, sizeof(name), "$%04X", node.addr);
+    break;
+  }
+  return name;
+}
+
+std::string Profile::folded() const {
+  std::string out;
+  std::vector<uint16_t> chain;
+  for (uint16_t index = 0; index < node_count; ++index) {
+    if (nodes[index].cycles == 0) {
+      continue;
+    }
+    chain.clear();
+    for (uint16_t at = index; at != 0; at = nodes[at].parent) {
+      chain.push_back(at);
+    }
+    chain.push_back(0);
+
+    for (size_t i = chain.size(); i-- > 0;) {
+      out += frame_name(nodes[chain[i]]);
+      out += i == 0 ? ' ' : ';';
+    }
+    out += std::to_string(nodes[index].cycles);
+    out += '\n';
+  }
+  return out;
+}
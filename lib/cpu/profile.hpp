@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// compiles in the profiler, switched on at runtime with CPU::set_profile.
+// compiled out, CPU::step and the engines are left as they are
+#ifndef NES_PROFILE
+#define NES_PROFILE 0
+#endif
+
+// the PC histogram counts 1 << NES_PROFILE_PC_SHIFT bytes per bucket, every
+// address on native, 16-byte blocks on the ESP32
+#ifndef NES_PROFILE_PC_SHIFT
+#if defined(ARDUINO)
+#define NES_PROFILE_PC_SHIFT 4
+#else
+#define NES_PROFILE_PC_SHIFT 0
+#endif
+#endif
+
+// call stack nodes: every distinct chain of subroutines and interrupts
+// takes one. once they are all taken, new chains count in their caller
+#ifndef NES_PROFILE_NODES
+#if defined(ARDUINO)
+#define NES_PROFILE_NODES 256
+#else
+#define NES_PROFILE_NODES 4096
+#endif
+#endif
+
+// calls deep, deeper ones count in their caller
+#ifndef NES_PROFILE_DEPTH
+#define NES_PROFILE_DEPTH 64
+#endif
+
+// where the cycles of a run went: per opcode, per address and per call
+// stack. counting is a few array increments per instruction, sorting and
+// formatting wait for report / folded
+class Profile {
+public:
+  static constexpr uint32_t PC_BUCKETS = 0x10000 >> NES_PROFILE_PC_SHIFT;
+  static constexpr uint16_t NODE_COUNT = NES_PROFILE_NODES;
+  // call stack nodes are subroutines (JSR), interrupts or BRK
+  enum class Frame : uint8_t { Root, Subroutine, Nmi, Irq, Brk };
+
+  Profile();
+  void clear();
+
+  // one instruction of `code` at `pc`, that took `cycles` cycles (stalls and
+  // idle loop skips included)
+  void count(uint16_t pc, uint8_t code, uint32_t cycles) {
+    opcode_counts[code]++;
+    opcode_cycles[code] += cycles;
+    pc_hits[pc >> NES_PROFILE_PC_SHIFT]++;
+    nodes[current].cycles += cycles;
+  }
+  // the addressing mode get_addr just worked out an address for
+  void count_mode(uint8_t mode) { mode_counts[mode]++; }
+  // enters the frame starting at `addr`, `sp` being the stack pointer
+  // before the call pushed anything
+  void call(Frame frame, uint16_t addr, uint8_t sp);
+  // RTS / RTI left the stack pointer at `sp`: leaves the frames whose call
+  // it is back above. an RTS used as a jump (its address pushed by hand)
+  // leaves nothing
+  void ret(uint8_t sp);
+
+  uint64_t instructions() const;
+  uint64_t cycles() const;
+
+  // the busiest opcodes, addressing modes and addresses, `top` of each
+  std::string report(size_t top = 20) const;
+  // one line per call stack with its cycles, `main;$C123;$C456 1234`, for
+  // flamegraph.pl and speedscope
+  std::string folded() const;
+
+  std::array<uint64_t, 256> opcode_counts;
+  std::array<uint64_t, 256> opcode_cycles;
+  // indexed by AddressingMode
+  std::array<uint64_t, 16> mode_counts;
+  std::array<uint32_t, PC_BUCKETS> pc_hits;
+
+private:
+  struct Node {
+    uint16_t parent;
+    uint16_t addr;
+    Frame frame;
+    uint64_t cycles;
+  };
+
+  struct Call {
+    uint16_t node;
+    uint8_t sp;
+  };
+
+  // node 0 is the root
+  std::array<Node, NODE_COUNT> nodes;
+  uint16_t node_count;
+  uint16_t current;
+  // open addressing from (parent, frame, addr) to the node, 0 is empty
+  std::array<uint16_t, NODE_COUNT * 2> children;
+  // the calls being run, the node of each one's caller
+  std::array<Call, NES_PROFILE_DEPTH> calls;
+  uint8_t depth;
+
+  uint16_t find_child(uint16_t parent, Frame frame, uint16_t addr);
+  std::string frame_name(const Node &node) const;
+};
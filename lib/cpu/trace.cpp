@@ -0,0 +1,47 @@
+#include "trace.hpp"
+#include "disassembly.hpp"
+#include <cstdio>
+
+namespace {
+constexpr uint32_t DOTS_PER_SCANLINE = 341;
+constexpr uint32_t SCANLINES_PER_FRAME = 262;
+} // namespace
+
+std::string Trace::format(const TraceEntry &entry) {
+  uint8_t length = disassembly::length(entry.bytes[0]);
+  char bytes[9];
+  if (length == 1) {
+    std::snprintf(bytes, sizeof(bytes), "%02X", entry.bytes[0]);
+  } else if (length == 2) {
+    std::snprintf(bytes, sizeof(bytes), "%02X %02X", entry.bytes[0],
+                  entry.bytes[1]);
+  } else {
+    std::snprintf(bytes, sizeof(bytes), "%02X %02X %02X", entry.bytes[0],
+                  entry.bytes[1], entry.bytes[2]);
+  }
+  bool unofficial = disassembly::instruction(entry.bytes[0]).unofficial;
+  std::string text = disassembly::format(entry.pc, entry.bytes);
+
+  uint64_t dots = entry.cycle * 3;
+  auto scanline =
+      static_cast<uint32_t>(dots / DOTS_PER_SCANLINE % SCANLINES_PER_FRAME);
+  auto dot = static_cast<uint32_t>(dots % DOTS_PER_SCANLINE);
+
+  char line[96];
+  std::snprintf(line, sizeof(line),
+                "%04X  %-8s %c%-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X "
+                "PPU:%3u,%3u CYC:%llu",
+                entry.pc, bytes, unofficial ? '*' : ' ', text.c_str(),
+                entry.reg_a, entry.reg_x, entry.reg_y, entry.status, entry.sp,
+                scanline, dot, static_cast<unsigned long long>(entry.cycle));
+  return line;
+}
+
+std::string Trace::dump() const {
+  std::string out;
+  for (uint32_t i = 0; i < size(); ++i) {
+    out += format((*this)[i]);
+    out += '\n';
+  }
+  return out;
+}
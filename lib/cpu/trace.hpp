@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// compiles in the instruction tracer, switched on at runtime with
+// CPU::set_trace. compiled out, CPU::step is left as it is
+#ifndef NES_TRACE
+#define NES_TRACE 0
+#endif
+
+// instructions the trace keeps, the newest ones, a power of two
+#ifndef NES_TRACE_ENTRIES
+#if defined(ARDUINO)
+#define NES_TRACE_ENTRIES 256
+#else
+#define NES_TRACE_ENTRIES 4096
+#endif
+#endif
+
+// the CPU as an instruction found it, before it ran. the three bytes at pc
+// are copied whichever length the instruction has
+struct TraceEntry {
+  uint64_t cycle;
+  uint16_t pc;
+  uint8_t bytes[3];
+  uint8_t reg_a;
+  uint8_t reg_x;
+  uint8_t reg_y;
+  uint8_t status;
+  uint8_t sp;
+};
+
+// a ring of the last NES_TRACE_ENTRIES instructions the CPU ran. recording
+// copies the registers into the next slot, nothing is allocated or formatted
+// until the trace is dumped
+class Trace {
+public:
+  static constexpr uint32_t CAPACITY = NES_TRACE_ENTRIES;
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                "NES_TRACE_ENTRIES must be a power of two");
+
+  // the slot of the next instruction, overwriting the oldest one when full
+  TraceEntry &next() { return entries[count++ & (CAPACITY - 1)]; }
+  void clear() { count = 0; }
+
+  // instructions held, and recorded since the last clear
+  uint32_t size() const {
+    return count < CAPACITY ? static_cast<uint32_t>(count) : CAPACITY;
+  }
+  uint64_t recorded() const { return count; }
+  // oldest first
+  const TraceEntry &operator[](uint32_t index) const {
+    return entries[(count - size() + index) & (CAPACITY - 1)];
+  }
+
+  // one line in the format of the nestest log:
+  //
+  //   C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7
+  //
+  // the memory annotations of the reference log (`= 00`, `@ 0300`) are left
+  // out, the PPU position is worked out from the cycle with rendering off
+  static std::string format(const TraceEntry &entry);
+  // every instruction held, oldest first, one line each
+  std::string dump() const;
+
+private:
+  std::array<TraceEntry, CAPACITY> entries;
+  uint64_t count = 0;
+};
@@ -0,0 +1,81 @@
+#include "display.hpp"
+#include <cstring>
+
+void CountingDisplay::write_lines(uint16_t, uint16_t count, const uint16_t *) {
+  bytes += WINDOW_BYTES + uint64_t{count} * PPU::WIDTH * sizeof(uint16_t);
+  ++windows;
+  lines += count;
+}
+
+DisplayOutput::DisplayOutput(Display &display, ByteOrder order)
+    : display(display), palette(order), hashes{}, valid{}, band{}, band_y(0),
+      band_lines(0), lines_seen(0), lines_sent(0) {}
+
+void DisplayOutput::present(void *context, const Scanline &line) {
+  static_cast<DisplayOutput *>(context)->present_line(line.y,
+                                                      line.pixels.data());
+}
+
+void DisplayOutput::invalidate() { valid.fill(false); }
+
+// multiply-xorshift over machine words, 32 words a line on the desktop and
+// 64 on the ESP32
+size_t DisplayOutput::hash_line(const uint8_t *pixels) {
+  constexpr size_t MULTIPLIER = sizeof(size_t) == 8
+                                    ? size_t(0x9e3779b97f4a7c15ull)
+                                    : size_t(0x9e3779b1u);
+  constexpr unsigned SHIFT = sizeof(size_t) * 4;
+
+  size_t hash = 0;
+  for (size_t offset = 0; offset < PPU::WIDTH; offset += sizeof(size_t)) {
+    size_t word;
+    std::memcpy(&word, pixels + offset, sizeof(word));
+    hash = (hash ^ word) * MULTIPLIER;
+    hash ^= hash >> SHIFT;
+  }
+  return hash;
+}
+
+void DisplayOutput::present_line(uint16_t y, const uint8_t *pixels) {
+  if (y >= PPU::HEIGHT) {
+    return;
+  }
+  ++lines_seen;
+
+  size_t hash = hash_line(pixels);
+  if (valid[y] && hashes[y] == hash) {
+    // a clean line ends the band, the next dirty one needs a new window
+    flush();
+  } else {
+    hashes[y] = hash;
+    valid[y] = true;
+
+    if (band_lines > 0 && band_y + band_lines != y) {
+      flush();
+    }
+    if (band_lines == 0) {
+      band_y = y;
+    }
+    palette.convert(pixels, band.data() + band_lines * PPU::WIDTH, PPU::WIDTH);
+    ++band_lines;
+
+    if (band_lines == BAND_LINES) {
+      flush();
+    }
+  }
+
+  if (y == PPU::HEIGHT - 1) {
+    flush();
+    display.end_frame();
+  }
+}
+
+void DisplayOutput::flush() {
+  if (band_lines == 0) {
+    return;
+  }
+
+  display.write_lines(band_y, band_lines, band.data());
+  lines_sent += band_lines;
+  band_lines = 0;
+}
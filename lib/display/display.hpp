@@ -0,0 +1,87 @@
+#pragma once
+
+#include "../pipeline/pipeline.hpp"
+#include "../ppu/ppu.hpp"
+#include "rgb565.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// an RGB565 panel, lines are written in bands of consecutive lines so a
+// driver can set its address window once per band
+class Display {
+public:
+  virtual ~Display() = default;
+
+  // `count` lines of PPU::WIDTH pixels, starting at line `y`
+  virtual void write_lines(uint16_t y, uint16_t count,
+                           const uint16_t *pixels) = 0;
+  // after the last line of every frame
+  virtual void end_frame() {}
+};
+
+// stands in for a panel: counts what a SPI LCD would have been sent
+class CountingDisplay : public Display {
+public:
+  // column / row address set and memory write: 3 command bytes + 8 parameter
+  // bytes before every band (ILI9341, ST7789)
+  static constexpr uint32_t WINDOW_BYTES = 11;
+
+  void write_lines(uint16_t y, uint16_t count,
+                   const uint16_t *pixels) override;
+  void end_frame() override { ++frames; }
+
+  uint64_t get_bytes() const { return bytes; }
+  uint64_t get_windows() const { return windows; }
+  uint64_t get_lines() const { return lines; }
+  uint64_t get_frames() const { return frames; }
+  // what a panel redrawn in full every frame would have been sent
+  uint64_t get_full_bytes() const {
+    return frames * (WINDOW_BYTES +
+                     uint64_t{PPU::WIDTH} * PPU::HEIGHT * sizeof(uint16_t));
+  }
+
+private:
+  uint64_t bytes = 0;
+  uint64_t windows = 0;
+  uint64_t lines = 0;
+  uint64_t frames = 0;
+};
+
+// the output stage: converts scanlines to RGB565 and only sends the lines
+// that changed since the last frame. a line is compared through a hash of
+// its color indices, so no copy of the previous frame is kept
+class DisplayOutput {
+public:
+  // lines converted ahead of a write, 8 KiB of RGB565
+  static constexpr uint16_t BAND_LINES = 16;
+
+  DisplayOutput(Display &display, ByteOrder order = ByteOrder::Little);
+
+  // Pipeline line sink, context is the DisplayOutput
+  static void present(void *context, const Scanline &line);
+  void present_line(uint16_t y, const uint8_t *pixels);
+  // sends every line of the next frame (ex: after the panel was cleared)
+  void invalidate();
+
+  uint64_t get_lines_seen() const { return lines_seen; }
+  uint64_t get_lines_sent() const { return lines_sent; }
+  const Rgb565Palette &get_palette() const { return palette; }
+
+  static size_t hash_line(const uint8_t *pixels);
+
+private:
+  Display &display;
+  Rgb565Palette palette;
+
+  std::array<size_t, PPU::HEIGHT> hashes;
+  std::array<bool, PPU::HEIGHT> valid;
+  std::array<uint16_t, BAND_LINES * PPU::WIDTH> band;
+  uint16_t band_y;
+  uint16_t band_lines;
+
+  uint64_t lines_seen;
+  uint64_t lines_sent;
+
+  void flush();
+};
@@ -0,0 +1,132 @@
+#include "rgb565.hpp"
+#include <cstring>
+
+#if NES_RGB565_SSSE3
+#include <immintrin.h>
+#endif
+
+namespace {
+struct Rgb {
+  uint8_t r, g, b;
+};
+
+// 2C02 palette, ref: https://www.nesdev.org/wiki/PPU_palettes
+constexpr Rgb NES_COLORS[64] = {
+    {84, 84, 84},    {0, 30, 116},    {8, 16, 144},    {48, 0, 136},
+    {68, 0, 100},    {92, 0, 48},     {84, 4, 0},      {60, 24, 0},
+    {32, 42, 0},     {8, 58, 0},      {0, 64, 0},      {0, 60, 0},
+    {0, 50, 60},     {0, 0, 0},       {0, 0, 0},       {0, 0, 0},
+    {152, 150, 152}, {8, 76, 196},    {48, 50, 236},   {92, 30, 228},
+    {136, 20, 176},  {160, 20, 100},  {152, 34, 32},   {120, 60, 0},
+    {84, 90, 0},     {40, 114, 0},    {8, 124, 0},     {0, 118, 40},
+    {0, 102, 120},   {0, 0, 0},       {0, 0, 0},       {0, 0, 0},
+    {236, 238, 236}, {76, 154, 236},  {120, 124, 236}, {176, 98, 236},
+    {228, 84, 236},  {236, 88, 180},  {236, 106, 100}, {212, 136, 32},
+    {160, 170, 0},   {116, 196, 0},   {76, 208, 32},   {56, 204, 108},
+    {56, 180, 204},  {60, 60, 60},    {0, 0, 0},       {0, 0, 0},
+    {236, 238, 236}, {168, 204, 236}, {188, 188, 236}, {212, 178, 236},
+    {236, 174, 236}, {236, 174, 212}, {236, 180, 176}, {228, 196, 144},
+    {204, 210, 120}, {180, 222, 120}, {168, 226, 144}, {152, 226, 180},
+    {160, 214, 228}, {160, 162, 160}, {0, 0, 0},       {0, 0, 0},
+};
+
+constexpr uint16_t to_rgb565(Rgb color) {
+  return ((color.r >> 3) << 11) | ((color.g >> 2) << 5) | (color.b >> 3);
+}
+} // namespace
+
+Rgb565Palette::Rgb565Palette(ByteOrder order)
+    : converter(&Rgb565Palette::convert_packed) {
+  for (uint8_t index = 0; index < colors.size(); ++index) {
+    uint16_t color = to_rgb565(NES_COLORS[index]);
+    if (order == ByteOrder::Big) {
+      color = static_cast<uint16_t>((color << 8) | (color >> 8));
+    }
+
+    colors[index] = color;
+    low_bytes[index] = color & 0xff;
+    high_bytes[index] = color >> 8;
+  }
+
+#if NES_RGB565_SSSE3
+  if (has_ssse3()) {
+    converter = &Rgb565Palette::convert_ssse3;
+  }
+#endif
+}
+
+void Rgb565Palette::convert_scalar(const uint8_t *indices, uint16_t *pixels,
+                                   size_t count) const {
+  for (size_t i = 0; i < count; ++i) {
+    pixels[i] = colors[indices[i] & 0x3f];
+  }
+}
+
+// one 32-bit load for 4 indices and two 32-bit stores for 4 pixels, little
+// endian word order (the ESP32 and x86 both are)
+void Rgb565Palette::convert_packed(const uint8_t *indices, uint16_t *pixels,
+                                   size_t count) const {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32_t four;
+    std::memcpy(&four, indices + i, sizeof(four));
+
+    uint32_t words[2] = {
+        colors[four & 0x3f] |
+            (static_cast<uint32_t>(colors[(four >> 8) & 0x3f]) << 16),
+        colors[(four >> 16) & 0x3f] |
+            (static_cast<uint32_t>(colors[(four >> 24) & 0x3f]) << 16),
+    };
+    std::memcpy(pixels + i, words, sizeof(words));
+  }
+
+  convert_scalar(indices + i, pixels + i, count - i);
+}
+
+#if NES_RGB565_SSSE3
+bool Rgb565Palette::has_ssse3() { return __builtin_cpu_supports("ssse3"); }
+
+// pshufb looks up 16 bytes at once in a 16 entry table. the 64 colors are 4
+// such tables per byte, each index picks its table by its bits 4-5, then the
+// low and high bytes are interleaved into 16-bit pixels
+[[gnu::target("ssse3")]] void
+Rgb565Palette::convert_ssse3(const uint8_t *indices, uint16_t *pixels,
+                             size_t count) const {
+  __m128i low_tables[4];
+  __m128i high_tables[4];
+  for (int table = 0; table < 4; ++table) {
+    low_tables[table] = _mm_load_si128(
+        reinterpret_cast<const __m128i *>(low_bytes.data() + table * 16));
+    high_tables[table] = _mm_load_si128(
+        reinterpret_cast<const __m128i *>(high_bytes.data() + table * 16));
+  }
+
+  const __m128i low_nibble = _mm_set1_epi8(0x0f);
+  const __m128i table_bits = _mm_set1_epi8(0x03);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i index =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + i));
+    __m128i entry = _mm_and_si128(index, low_nibble);
+    __m128i table = _mm_and_si128(_mm_srli_epi16(index, 4), table_bits);
+
+    __m128i low = _mm_setzero_si128();
+    __m128i high = _mm_setzero_si128();
+    for (int t = 0; t < 4; ++t) {
+      __m128i selected = _mm_cmpeq_epi8(table, _mm_set1_epi8(t));
+      low = _mm_or_si128(
+          low, _mm_and_si128(selected, _mm_shuffle_epi8(low_tables[t], entry)));
+      high = _mm_or_si128(
+          high,
+          _mm_and_si128(selected, _mm_shuffle_epi8(high_tables[t], entry)));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i),
+                     _mm_unpacklo_epi8(low, high));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i + 8),
+                     _mm_unpackhi_epi8(low, high));
+  }
+
+  convert_scalar(indices + i, pixels + i, count - i);
+}
+#endif
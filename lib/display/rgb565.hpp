@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NES_RGB565_SSSE3 1
+#else
+#define NES_RGB565_SSSE3 0
+#endif
+
+// byte order of the converted pixels. SPI LCD controllers (ILI9341, ST7789)
+// take RGB565 most significant byte first, so a buffer in big endian order
+// can be sent as is
+enum class ByteOrder : uint8_t {
+  Little,
+  Big,
+};
+
+// NES color index (0..63) to RGB565 lookup. a line is converted with the
+// fastest routine for the target: SSSE3 byte shuffles on x86 (picked at
+// runtime), otherwise 4 indices are read and 2 pixels written per 32-bit word,
+// which keeps the Xtensa cores on aligned word accesses
+class Rgb565Palette {
+public:
+  explicit Rgb565Palette(ByteOrder order = ByteOrder::Little);
+
+  uint16_t operator[](uint8_t index) const { return colors[index & 0x3f]; }
+
+  // converts `count` pixels, the fast paths want a multiple of 16 and
+  // finish the rest one pixel at a time
+  void convert(const uint8_t *indices, uint16_t *pixels, size_t count) const {
+    (this->*converter)(indices, pixels, count);
+  }
+
+  // every routine, for tests and benchmarks
+  void convert_scalar(const uint8_t *indices, uint16_t *pixels,
+                      size_t count) const;
+  void convert_packed(const uint8_t *indices, uint16_t *pixels,
+                      size_t count) const;
+#if NES_RGB565_SSSE3
+  void convert_ssse3(const uint8_t *indices, uint16_t *pixels,
+                     size_t count) const;
+  static bool has_ssse3();
+#endif
+
+private:
+  using Converter = void (Rgb565Palette::*)(const uint8_t *, uint16_t *,
+                                            size_t) const;
+
+  std::array<uint16_t, 64> colors;
+  // the same colors split into low and high bytes, 4 shuffle tables each
+  alignas(16) std::array<uint8_t, 64> low_bytes;
+  alignas(16) std::array<uint8_t, 64> high_bytes;
+  Converter converter;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#if defined(__cpp_exceptions)
+#include <stdexcept>
+#else
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+namespace error {
+// reports an error the caller can't go on from (a malformed ROM, a bad save
+// state, a full scheduler): throws std::runtime_error, or built with
+// -fno-exceptions, prints the message and aborts. nothing on the CPU's
+// instruction path calls it, see CPU::Halt
+[[noreturn]] inline void fail(const std::string &message) {
+#if defined(__cpp_exceptions)
+  throw std::runtime_error(message);
+#else
+  std::fprintf(stderr, "fatal: %s\n", message.c_str());
+  std::abort();
+#endif
+}
+} // namespace error
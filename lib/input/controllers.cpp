@@ -0,0 +1,47 @@
+#include "controllers.hpp"
+
+namespace {
+// the upper bits aren't driven, they keep the high byte of the address
+constexpr uint8_t OPEN_BUS = 0x40;
+// an official controller shifts in 1s after the last button
+constexpr uint8_t SHIFT_IN = 0x80;
+} // namespace
+
+Controllers::Controllers() : buttons{}, shifters{}, strobe(false) {}
+
+void Controllers::attach(APU &apu) {
+  apu.set_port(PORT1, port_read, port_write, this);
+  apu.set_port(PORT2, port_read, nullptr, this);
+}
+
+void Controllers::set_buttons(uint8_t port, uint8_t pressed) {
+  buttons[port] = pressed;
+  if (strobe) {
+    shifters[port] = pressed;
+  }
+}
+
+uint8_t Controllers::read(uint16_t addr) {
+  uint8_t &shifter = shifters[addr - PORT1];
+  uint8_t bit = shifter & 1;
+  if (!strobe) {
+    shifter = shifter >> 1 | SHIFT_IN;
+  }
+  return OPEN_BUS | bit;
+}
+
+void Controllers::write(uint8_t data) {
+  strobe = data & 1;
+  if (strobe) {
+    shifters = buttons;
+  }
+}
+
+uint8_t Controllers::port_read(void *context, uint16_t addr, uint64_t) {
+  return static_cast<Controllers *>(context)->read(addr);
+}
+
+void Controllers::port_write(void *context, uint16_t, uint8_t data,
+                             uint64_t) {
+  static_cast<Controllers *>(context)->write(data);
+}
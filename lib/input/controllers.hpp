@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../apu/apu.hpp"
+#include <array>
+#include <cstdint>
+
+// the buttons of a standard controller, in the order its shift register
+// hands them out
+namespace button {
+constexpr uint8_t A = 0x01;
+constexpr uint8_t B = 0x02;
+constexpr uint8_t SELECT = 0x04;
+constexpr uint8_t START = 0x08;
+constexpr uint8_t UP = 0x10;
+constexpr uint8_t DOWN = 0x20;
+constexpr uint8_t LEFT = 0x40;
+constexpr uint8_t RIGHT = 0x80;
+} // namespace button
+
+// two standard controllers on $4016 / $4017. while bit 0 of the last $4016
+// write is set both shift registers keep reloading the buttons, once it is
+// clear every read shifts the next button out into bit 0, and 1s after the
+// eighth. writes to $4017 still go to the APU frame counter
+//
+// the frontend sets the buttons between frames, the game only sees them
+// through the shift registers, so a frame's input is whatever was set before
+// it ran (see Movie)
+class Controllers {
+public:
+  static constexpr uint16_t PORT1 = 0x4016;
+  static constexpr uint16_t PORT2 = 0x4017;
+  static constexpr uint8_t PORT_COUNT = 2;
+
+  Controllers();
+
+  // plugs into the APU's I/O registers
+  void attach(APU &apu);
+
+  // port 0 or 1
+  void set_buttons(uint8_t port, uint8_t buttons);
+  uint8_t get_buttons(uint8_t port) const { return buttons[port]; }
+
+  uint8_t read(uint16_t addr);
+  void write(uint8_t data);
+
+private:
+  std::array<uint8_t, PORT_COUNT> buttons;
+  std::array<uint8_t, PORT_COUNT> shifters;
+  bool strobe;
+
+  static uint8_t port_read(void *context, uint16_t addr, uint64_t cycle);
+  static void port_write(void *context, uint16_t addr, uint8_t data,
+                         uint64_t cycle);
+};
@@ -0,0 +1,173 @@
+#include "movie.hpp"
+#include "../error/error.hpp"
+#include "../state/state.hpp"
+
+namespace {
+constexpr uint32_t MAGIC = state::tag("NESM");
+constexpr size_t HEADER_SIZE = 24;
+constexpr uint32_t MAX_RUN = 256;
+constexpr uint32_t FNV_OFFSET = 0x811c9dc5;
+constexpr uint32_t FNV_PRIME = 0x01000193;
+constexpr uint16_t RAM_SIZE = 0x800;
+
+uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+void put_u16(std::vector<uint8_t> &out, uint16_t value) {
+  out.push_back(static_cast<uint8_t>(value));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void put_u32(std::vector<uint8_t> &out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+  }
+}
+
+uint16_t get_u16(const uint8_t *at) { return at[0] | at[1] << 8; }
+
+uint32_t get_u32(const uint8_t *at) {
+  return at[0] | at[1] << 8 | at[2] << 16 | static_cast<uint32_t>(at[3]) << 24;
+}
+} // namespace
+
+namespace movie {
+// a snapshot state is kept out of the delta numbering, taking one changes
+// nothing
+uint32_t start_hash(NES &nes) {
+  const Cartridge &cartridge = nes.get_cartridge();
+  uint32_t hash = fnv1a(FNV_OFFSET, cartridge.get_prg_rom(),
+                        cartridge.get_prg_rom_size());
+  hash = fnv1a(hash, cartridge.get_chr_rom(), cartridge.get_chr_rom_size());
+  auto state = nes.get_cpu().save_state(state::Kind::Snapshot);
+  return fnv1a(hash, state.data(), state.size());
+}
+
+uint32_t ram_hash(CPU &cpu) {
+  uint8_t ram[RAM_SIZE];
+  for (uint16_t addr = 0; addr < RAM_SIZE; ++addr) {
+    ram[addr] = cpu.mem_read(addr);
+  }
+  return fnv1a(FNV_OFFSET, ram, RAM_SIZE);
+}
+} // namespace movie
+
+MovieRecorder::MovieRecorder(NES &nes, uint16_t hash_interval)
+    : nes(nes), hash_interval(hash_interval),
+      start(movie::start_hash(nes)), frames(0), runs(), last_run(0),
+      hashes() {}
+
+void MovieRecorder::record_frame() {
+  Controllers &controllers = nes.get_controllers();
+  bool extend = frames > 0 && runs[last_run] < MAX_RUN - 1;
+  for (uint8_t port = 0; extend && port < Controllers::PORT_COUNT; ++port) {
+    extend = runs[last_run + 1 + port] == controllers.get_buttons(port);
+  }
+
+  if (extend) {
+    runs[last_run]++;
+  } else {
+    last_run = runs.size();
+    runs.push_back(0);
+    for (uint8_t port = 0; port < Controllers::PORT_COUNT; ++port) {
+      runs.push_back(controllers.get_buttons(port));
+    }
+  }
+
+  frames++;
+  if (hash_interval > 0 && frames % hash_interval == 0) {
+    hashes.push_back(movie::ram_hash(nes.get_cpu()));
+  }
+}
+
+std::vector<uint8_t> MovieRecorder::encode() const {
+  std::vector<uint8_t> out;
+  out.reserve(HEADER_SIZE + runs.size() + hashes.size() * 4);
+  put_u32(out, MAGIC);
+  put_u16(out, movie::VERSION);
+  out.push_back(Controllers::PORT_COUNT);
+  out.push_back(0);
+  put_u32(out, start);
+  put_u32(out, frames);
+  put_u16(out, hash_interval);
+  put_u16(out, 0);
+  put_u32(out, runs.size());
+  out.insert(out.end(), runs.begin(), runs.end());
+  for (uint32_t hash : hashes) {
+    put_u32(out, hash);
+  }
+  return out;
+}
+
+MoviePlayer::MoviePlayer(const uint8_t *data, size_t size)
+    : ports(0), start(0), frames(0), hash_interval(0), run(nullptr),
+      hashes(nullptr), run_left(0), frame(0) {
+  if (size < HEADER_SIZE || get_u32(data) != MAGIC) {
+    error::fail("not a movie");
+  }
+  if (get_u16(data + 4) != movie::VERSION) {
+    error::fail("unsupported movie version");
+  }
+  ports = data[6];
+  if (ports == 0 || ports > Controllers::PORT_COUNT) {
+    error::fail("bad movie port count");
+  }
+  start = get_u32(data + 8);
+  frames = get_u32(data + 12);
+  hash_interval = get_u16(data + 16);
+
+  // the runs have to add up to the frames, and the hashes to fill the rest
+  size_t runs_size = get_u32(data + 20);
+  size_t hash_count = hash_interval > 0 ? frames / hash_interval : 0;
+  if (size - HEADER_SIZE < runs_size ||
+      size - HEADER_SIZE - runs_size != hash_count * 4) {
+    error::fail("truncated movie");
+  }
+  uint64_t covered = 0;
+  for (size_t at = 0; at < runs_size; at += 1 + ports) {
+    if (runs_size - at < 1u + ports) {
+      error::fail("truncated movie");
+    }
+    covered += data[HEADER_SIZE + at] + 1;
+  }
+  if (covered != frames) {
+    error::fail("movie runs don't add up to its frames");
+  }
+  run = data + HEADER_SIZE;
+  hashes = run + runs_size;
+}
+
+bool MoviePlayer::matches_start(NES &nes) const {
+  return movie::start_hash(nes) == start;
+}
+
+MoviePlayer::Step MoviePlayer::play_frame(NES &nes) {
+  if (frame == frames) {
+    return Step::End;
+  }
+  if (run_left == 0) {
+    if (frame > 0) {
+      run += 1 + ports;
+    }
+    run_left = run[0] + 1;
+    Controllers &controllers = nes.get_controllers();
+    for (uint8_t port = 0; port < ports; ++port) {
+      controllers.set_buttons(port, run[1 + port]);
+    }
+  }
+
+  nes.run_frame();
+  run_left--;
+  frame++;
+  if (hash_interval > 0 && frame % hash_interval == 0) {
+    uint32_t expected = get_u32(hashes + (frame / hash_interval - 1) * 4);
+    if (movie::ram_hash(nes.get_cpu()) != expected) {
+      return Step::Desync;
+    }
+  }
+  return Step::Ran;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../cpu/cpu.hpp"
+#include "../nes/nes.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// an input movie: the buttons of every frame from power-on, and hashes of
+// the RAM after the frames to check a replay against
+//
+//   header  "NESM"  u16 version  u8 ports  u8 0  u32 start hash
+//           u32 frames  u16 hash interval  u16 0  u32 runs size
+//   runs    u8 frames - 1, then a button byte per port
+//   hashes  u32 per `hash interval` frames
+//
+// everything is little endian. a run covers up to 256 frames holding the
+// same buttons, so a movie is a few bytes per change of input plus its
+// hashes. the start hash is of the ROM and the console's power-on state, a
+// movie only replays on the game it was recorded on
+namespace movie {
+constexpr uint16_t VERSION = 1;
+
+// FNV-1a of the ROM and the CPU and its memory at power-on
+uint32_t start_hash(NES &nes);
+// FNV-1a of the 2 KiB of RAM
+uint32_t ram_hash(CPU &cpu);
+} // namespace movie
+
+// records a movie of the console from power-on. small enough to keep on the
+// device: the runs grow with the input, the hashes with the frames, one
+// every `hash_interval` (0 for none)
+class MovieRecorder {
+public:
+  explicit MovieRecorder(NES &nes, uint16_t hash_interval = 1);
+
+  // after every run_frame: adds the buttons the frame ran with, and the RAM
+  // hash when one is due
+  void record_frame();
+  uint32_t get_frames() const { return frames; }
+
+  // the movie so far
+  std::vector<uint8_t> encode() const;
+
+private:
+  NES &nes;
+  uint16_t hash_interval;
+  uint32_t start;
+  uint32_t frames;
+  std::vector<uint8_t> runs;
+  // where the last run starts in `runs`
+  size_t last_run;
+  std::vector<uint32_t> hashes;
+};
+
+// plays a movie back into a console at power-on, reading it in place (the
+// data has to outlive the player). malformed data fails (`error::fail`)
+class MoviePlayer {
+public:
+  enum class Step : uint8_t {
+    Ran,
+    // the RAM hash after the frame isn't the recorded one
+    Desync,
+    // every frame of the movie ran already
+    End,
+  };
+
+  MoviePlayer(const uint8_t *data, size_t size);
+  explicit MoviePlayer(const std::vector<uint8_t> &data)
+      : MoviePlayer(data.data(), data.size()) {}
+
+  // whether the console is where the movie was recorded from
+  bool matches_start(NES &nes) const;
+  // sets the frame's buttons, runs it and checks the RAM hash when one is due
+  Step play_frame(NES &nes);
+
+  uint32_t get_frames() const { return frames; }
+  // frames played so far
+  uint32_t get_frame() const { return frame; }
+  uint16_t get_hash_interval() const { return hash_interval; }
+
+private:
+  uint8_t ports;
+  uint32_t start;
+  uint32_t frames;
+  uint16_t hash_interval;
+  const uint8_t *run;
+  const uint8_t *hashes;
+  // frames left in the current run
+  uint32_t run_left;
+  uint32_t frame;
+};
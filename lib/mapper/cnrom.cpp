@@ -0,0 +1,16 @@
+#include "mappers.hpp"
+
+void CNROM::reset_banks() {
+  for (uint8_t slot = 0; slot < 4; ++slot) {
+    set_prg_bank(slot, slot);
+  }
+  for (uint8_t slot = 0; slot < 8; ++slot) {
+    set_chr_bank(slot, slot);
+  }
+}
+
+void CNROM::write_register(uint16_t, uint8_t data) {
+  for (uint8_t slot = 0; slot < 8; ++slot) {
+    set_chr_bank(slot, data * 8 + slot);
+  }
+}
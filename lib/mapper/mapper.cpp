@@ -0,0 +1,139 @@
+#include "mapper.hpp"
+#include "../constants/constants.hpp"
+#include "../error/error.hpp"
+#include "mappers.hpp"
+#include <string>
+
+Mapper::Mapper(Cartridge &cartridge)
+    : cartridge(cartridge), bus(nullptr),
+      mirroring(cartridge.get_header().mirroring), irq(false), prg_banks{},
+      chr_banks{}, chr_generation(0) {
+  // a linear layout until attach installs the mapper's own
+  for (uint8_t slot = 0; slot < prg_banks.size(); ++slot) {
+    set_prg_bank(slot, slot);
+  }
+  for (uint8_t slot = 0; slot < chr_banks.size(); ++slot) {
+    set_chr_bank(slot, slot);
+  }
+}
+
+void Mapper::attach(Bus &target) {
+  bus = &target;
+
+  if (cartridge.get_prg_ram_size() > 0) {
+    bus->map_memory(memory_map::PRGRAM_START,
+                    memory_map::PRGROM_START - memory_map::PRGRAM_START,
+                    cartridge.get_prg_ram());
+  }
+
+  // reads of the range are redirected to the PRG banks right after
+  bus->map_io(
+      memory_map::PRGROM_START, 0x10000 - memory_map::PRGROM_START,
+      [](void *, uint16_t, uint64_t) -> uint8_t { return 0; },
+      register_write, this);
+  reset_banks();
+}
+
+bool Mapper::chr_write(uint16_t addr, uint8_t data) {
+  if (cartridge.get_chr_ram_size() == 0) {
+    return false;
+  }
+
+  const_cast<uint8_t *>(chr_banks[addr >> 10])[addr & (CHR_BANK_SIZE - 1)] =
+      data;
+  return true;
+}
+
+void Mapper::take_snapshot(Snapshot &snapshot) const {
+  snapshot.prg_banks = prg_banks;
+  snapshot.chr_banks = chr_banks;
+  snapshot.mirroring = mirroring;
+  snapshot.irq = irq;
+  save_registers(snapshot.registers);
+}
+
+// only the windows that moved are remapped, so that code decoded out of the
+// others is kept
+void Mapper::restore_snapshot(const Snapshot &snapshot) {
+  for (uint8_t slot = 0; slot < prg_banks.size(); ++slot) {
+    if (prg_banks[slot] != snapshot.prg_banks[slot]) {
+      prg_banks[slot] = snapshot.prg_banks[slot];
+      bus->map_rom(memory_map::PRGROM_START + slot * PRG_BANK_SIZE,
+                   PRG_BANK_SIZE, prg_banks[slot]);
+    }
+  }
+  // the generation moves on, the PPU's tiles of the old banks are stale
+  if (chr_banks != snapshot.chr_banks) {
+    chr_banks = snapshot.chr_banks;
+    chr_generation++;
+  }
+  mirroring = snapshot.mirroring;
+  irq = snapshot.irq;
+  load_registers(snapshot.registers);
+}
+
+void Mapper::set_prg_bank(uint8_t slot, int bank) {
+  int count = prg_bank_count();
+  if (count == 0) {
+    return;
+  }
+  bank = ((bank % count) + count) % count;
+
+  prg_banks[slot] = cartridge.get_prg_rom() + bank * PRG_BANK_SIZE;
+  if (bus != nullptr) {
+    bus->map_rom(memory_map::PRGROM_START + slot * PRG_BANK_SIZE,
+                 PRG_BANK_SIZE, prg_banks[slot]);
+  }
+}
+
+void Mapper::set_chr_bank(uint8_t slot, int bank) {
+  int count = chr_bank_count();
+  if (count == 0) {
+    return;
+  }
+  bank = ((bank % count) + count) % count;
+
+  const uint8_t *chr = cartridge.get_chr_rom_size() > 0
+                           ? cartridge.get_chr_rom()
+                           : cartridge.get_chr_ram();
+  const uint8_t *target = chr + bank * CHR_BANK_SIZE;
+  if (chr_banks[slot] != target) {
+    chr_banks[slot] = target;
+    chr_generation++;
+  }
+}
+
+int Mapper::prg_bank_count() const {
+  return static_cast<int>(cartridge.get_prg_rom_size() / PRG_BANK_SIZE);
+}
+
+int Mapper::chr_bank_count() const {
+  size_t size = cartridge.get_chr_rom_size() > 0
+                    ? cartridge.get_chr_rom_size()
+                    : cartridge.get_chr_ram_size();
+  return static_cast<int>(size / CHR_BANK_SIZE);
+}
+
+void Mapper::register_write(void *context, uint16_t addr, uint8_t data,
+                            uint64_t) {
+  static_cast<Mapper *>(context)->write_register(addr, data);
+}
+
+std::unique_ptr<Mapper> make_mapper(Cartridge &cartridge) {
+  switch (cartridge.get_header().mapper) {
+  case 0:
+    return std::make_unique<NROM>(cartridge);
+  case 1:
+    return std::make_unique<MMC1>(cartridge);
+  case 2:
+    return std::make_unique<UxROM>(cartridge);
+  case 3:
+    return std::make_unique<CNROM>(cartridge);
+  case 4:
+    return std::make_unique<MMC3>(cartridge);
+  default:
+    error::fail(
+        "unsupported mapper: " +
+        std::to_string(static_cast<int>(cartridge.get_header().mapper)));
+  }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "../bus/bus.hpp"
+#include "../cartridge/cartridge.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// a mapper decides which PRG/CHR banks of the cartridge are visible. a bank
+// switch re-points the affected 8 KiB PRG windows in the bus page table and
+// the 1 KiB CHR windows cached here once, so ordinary reads stay a pointer
+// dereference and only writes to the mapper registers reach virtual code
+class Mapper {
+public:
+  static constexpr uint16_t PRG_BANK_SIZE = 0x2000;
+  static constexpr uint16_t CHR_BANK_SIZE = 0x0400;
+
+  explicit Mapper(Cartridge &cartridge);
+  virtual ~Mapper() = default;
+  Mapper(const Mapper &) = delete;
+  Mapper &operator=(const Mapper &) = delete;
+
+  // maps PRG-RAM and the initial PRG-ROM banks and routes writes to
+  // [0x8000..0x10000] to the mapper registers
+  void attach(Bus &bus);
+
+  // pattern tables as seen by the PPU, [0x0000..0x2000] in 1 KiB windows
+  uint8_t chr_read(uint16_t addr) const {
+    return chr_banks[addr >> 10][addr & (CHR_BANK_SIZE - 1)];
+  }
+  const uint8_t *get_chr_bank(uint8_t slot) const { return chr_banks[slot]; }
+  // returns false when the window is backed by CHR-ROM
+  bool chr_write(uint16_t addr, uint8_t data);
+
+  Mirroring get_mirroring() const { return mirroring; }
+  // bumped on every CHR bank switch, lets the PPU drop cached tiles
+  uint32_t get_chr_generation() const { return chr_generation; }
+
+  // called by the PPU once per rendered scanline (MMC3 counts A12 rises)
+  virtual void clock_scanline() {}
+  // the PPU has to sync every scanline to deliver the IRQ in time
+  virtual bool has_scanline_irq() const { return false; }
+  bool irq_pending() const { return irq; }
+
+  // the bank layout, mirroring, IRQ line and registers, for run-ahead. only
+  // goes back into the mapper it was taken from
+  struct Snapshot {
+    std::array<const uint8_t *, 4> prg_banks;
+    std::array<const uint8_t *, 8> chr_banks;
+    Mirroring mirroring;
+    bool irq;
+    std::array<uint8_t, 16> registers;
+  };
+  void take_snapshot(Snapshot &snapshot) const;
+  void restore_snapshot(const Snapshot &snapshot);
+
+protected:
+  Cartridge &cartridge;
+  Bus *bus;
+  Mirroring mirroring;
+  bool irq;
+
+  virtual void write_register(uint16_t addr, uint8_t data) = 0;
+  // installs the power up bank layout
+  virtual void reset_banks() = 0;
+  // the mapper's own registers in and out of a snapshot, the banks they
+  // select are restored on their own
+  virtual void save_registers(std::array<uint8_t, 16> &) const {}
+  virtual void load_registers(const std::array<uint8_t, 16> &) {}
+
+  // negative banks count from the end (-1 is the last bank)
+  void set_prg_bank(uint8_t slot, int bank);
+  void set_chr_bank(uint8_t slot, int bank);
+  int prg_bank_count() const;
+  int chr_bank_count() const;
+
+private:
+  std::array<const uint8_t *, 4> prg_banks;
+  std::array<const uint8_t *, 8> chr_banks;
+  uint32_t chr_generation;
+
+  static void register_write(void *context, uint16_t addr, uint8_t data,
+                             uint64_t cycle);
+};
+
+// fails (error::fail) for mappers that aren't supported
+std::unique_ptr<Mapper> make_mapper(Cartridge &cartridge);
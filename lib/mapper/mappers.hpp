@@ -0,0 +1,82 @@
+#pragma once
+
+#include "mapper.hpp"
+#include <array>
+#include <cstdint>
+
+// mapper 0: 16 or 32 KiB of PRG-ROM, 8 KiB of CHR, no registers
+class NROM : public Mapper {
+public:
+  using Mapper::Mapper;
+
+protected:
+  void write_register(uint16_t, uint8_t) override {}
+  void reset_banks() override;
+};
+
+// mapper 1: everything is written one bit at a time through a shift register
+class MMC1 : public Mapper {
+public:
+  using Mapper::Mapper;
+
+protected:
+  void write_register(uint16_t addr, uint8_t data) override;
+  void reset_banks() override;
+  void save_registers(std::array<uint8_t, 16> &out) const override;
+  void load_registers(const std::array<uint8_t, 16> &in) override;
+
+private:
+  uint8_t shift = 0;
+  uint8_t shift_count = 0;
+  uint8_t control = 0x0c;
+  uint8_t chr_bank_0 = 0;
+  uint8_t chr_bank_1 = 0;
+  uint8_t prg_bank = 0;
+
+  void update_banks();
+};
+
+// mapper 2: switchable 16 KiB at 0x8000, last 16 KiB fixed at 0xc000
+class UxROM : public Mapper {
+public:
+  using Mapper::Mapper;
+
+protected:
+  void write_register(uint16_t addr, uint8_t data) override;
+  void reset_banks() override;
+};
+
+// mapper 3: fixed PRG-ROM, switchable 8 KiB of CHR-ROM
+class CNROM : public Mapper {
+public:
+  using Mapper::Mapper;
+
+protected:
+  void write_register(uint16_t addr, uint8_t data) override;
+  void reset_banks() override;
+};
+
+// mapper 4: 8 KiB PRG / 1-2 KiB CHR banks plus a scanline counter raising IRQs
+class MMC3 : public Mapper {
+public:
+  using Mapper::Mapper;
+
+  void clock_scanline() override;
+  bool has_scanline_irq() const override { return true; }
+
+protected:
+  void write_register(uint16_t addr, uint8_t data) override;
+  void reset_banks() override;
+  void save_registers(std::array<uint8_t, 16> &out) const override;
+  void load_registers(const std::array<uint8_t, 16> &in) override;
+
+private:
+  uint8_t bank_select = 0;
+  std::array<uint8_t, 8> registers = {0, 2, 4, 5, 6, 7, 0, 1};
+  uint8_t irq_latch = 0;
+  uint8_t irq_counter = 0;
+  bool irq_reload = false;
+  bool irq_enabled = false;
+
+  void update_banks();
+};
@@ -0,0 +1,120 @@
+#include "mappers.hpp"
+
+// ref: https://www.nesdev.org/wiki/MMC1
+
+void MMC1::reset_banks() {
+  shift = 0;
+  shift_count = 0;
+  control = 0x0c;
+  update_banks();
+}
+
+void MMC1::write_register(uint16_t addr, uint8_t data) {
+  // writing a value with bit 7 set clears the shift register and goes back to
+  // fixing the last bank at 0xc000
+  if (data & 0x80) {
+    shift = 0;
+    shift_count = 0;
+    control |= 0x0c;
+    update_banks();
+    return;
+  }
+
+  shift |= (data & 1) << shift_count;
+  if (++shift_count < 5) {
+    return;
+  }
+
+  // the fifth write picks the register from bits 13-14 of its address
+  switch ((addr >> 13) & 0b11) {
+  case 0:
+    control = shift;
+    break;
+  case 1:
+    chr_bank_0 = shift;
+    break;
+  case 2:
+    chr_bank_1 = shift;
+    break;
+  case 3:
+    prg_bank = shift;
+    break;
+  }
+
+  shift = 0;
+  shift_count = 0;
+  update_banks();
+}
+
+void MMC1::save_registers(std::array<uint8_t, 16> &out) const {
+  out[0] = shift;
+  out[1] = shift_count;
+  out[2] = control;
+  out[3] = chr_bank_0;
+  out[4] = chr_bank_1;
+  out[5] = prg_bank;
+}
+
+void MMC1::load_registers(const std::array<uint8_t, 16> &in) {
+  shift = in[0];
+  shift_count = in[1];
+  control = in[2];
+  chr_bank_0 = in[3];
+  chr_bank_1 = in[4];
+  prg_bank = in[5];
+}
+
+void MMC1::update_banks() {
+  switch (control & 0b11) {
+  case 0:
+    mirroring = Mirroring::SingleScreen_Low;
+    break;
+  case 1:
+    mirroring = Mirroring::SingleScreen_High;
+    break;
+  case 2:
+    mirroring = Mirroring::Vertical;
+    break;
+  case 3:
+    mirroring = Mirroring::Horizontal;
+    break;
+  }
+
+  // 512 KiB boards (SUROM) use bit 4 of the CHR bank to pick a 256 KiB half
+  int outer = prg_bank_count() > 32 ? (chr_bank_0 & 0x10) * 2 : 0;
+  int bank_16k = prg_bank & 0x0f;
+
+  switch ((control >> 2) & 0b11) {
+  case 0:
+  case 1:
+    // 32 KiB switched at once, the low bit of the bank number is ignored
+    for (uint8_t slot = 0; slot < 4; ++slot) {
+      set_prg_bank(slot, outer + (bank_16k & ~1) * 2 + slot);
+    }
+    break;
+  case 2:
+    set_prg_bank(0, outer);
+    set_prg_bank(1, outer + 1);
+    set_prg_bank(2, outer + bank_16k * 2);
+    set_prg_bank(3, outer + bank_16k * 2 + 1);
+    break;
+  case 3:
+    set_prg_bank(0, outer + bank_16k * 2);
+    set_prg_bank(1, outer + bank_16k * 2 + 1);
+    set_prg_bank(2, outer + 30);
+    set_prg_bank(3, outer + 31);
+    break;
+  }
+
+  if (control & 0x10) {
+    // two independent 4 KiB banks
+    for (uint8_t slot = 0; slot < 4; ++slot) {
+      set_chr_bank(slot, chr_bank_0 * 4 + slot);
+      set_chr_bank(slot + 4, chr_bank_1 * 4 + slot);
+    }
+  } else {
+    for (uint8_t slot = 0; slot < 8; ++slot) {
+      set_chr_bank(slot, (chr_bank_0 & ~1) * 4 + slot);
+    }
+  }
+}
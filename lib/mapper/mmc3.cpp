@@ -0,0 +1,98 @@
+#include "mappers.hpp"
+#include <algorithm>
+
+// ref: https://www.nesdev.org/wiki/MMC3
+
+void MMC3::reset_banks() { update_banks(); }
+
+void MMC3::write_register(uint16_t addr, uint8_t data) {
+  // registers come in even/odd pairs in every 8 KiB window
+  bool odd = addr & 1;
+
+  switch (addr & 0xe000) {
+  case 0x8000:
+    if (odd) {
+      registers[bank_select & 0b111] = data;
+    } else {
+      bank_select = data;
+    }
+    update_banks();
+    break;
+  case 0xa000:
+    // odd writes are PRG-RAM protection, which isn't emulated
+    if (!odd && mirroring != Mirroring::FourScreen) {
+      mirroring = (data & 1) ? Mirroring::Horizontal : Mirroring::Vertical;
+    }
+    break;
+  case 0xc000:
+    if (odd) {
+      irq_counter = 0;
+      irq_reload = true;
+    } else {
+      irq_latch = data;
+    }
+    break;
+  case 0xe000:
+    irq_enabled = odd;
+    if (!odd) {
+      irq = false;
+    }
+    break;
+  }
+}
+
+void MMC3::clock_scanline() {
+  if (irq_counter == 0 || irq_reload) {
+    irq_counter = irq_latch;
+    irq_reload = false;
+  } else {
+    irq_counter--;
+  }
+
+  if (irq_counter == 0 && irq_enabled) {
+    irq = true;
+  }
+}
+
+void MMC3::save_registers(std::array<uint8_t, 16> &out) const {
+  out[0] = bank_select;
+  std::copy(registers.begin(), registers.end(), out.begin() + 1);
+  out[9] = irq_latch;
+  out[10] = irq_counter;
+  out[11] = irq_reload;
+  out[12] = irq_enabled;
+}
+
+void MMC3::load_registers(const std::array<uint8_t, 16> &in) {
+  bank_select = in[0];
+  std::copy(in.begin() + 1, in.begin() + 9, registers.begin());
+  irq_latch = in[9];
+  irq_counter = in[10];
+  irq_reload = in[11];
+  irq_enabled = in[12];
+}
+
+void MMC3::update_banks() {
+  // bit 6 swaps the switchable 0x8000 window with the fixed 0xc000 one
+  if (bank_select & 0x40) {
+    set_prg_bank(0, -2);
+    set_prg_bank(2, registers[6]);
+  } else {
+    set_prg_bank(0, registers[6]);
+    set_prg_bank(2, -2);
+  }
+  set_prg_bank(1, registers[7]);
+  set_prg_bank(3, -1);
+
+  // bit 7 swaps the 2 KiB banks in [0x0000..0x1000] with the 1 KiB banks in
+  // [0x1000..0x2000]
+  uint8_t inversion = (bank_select & 0x80) ? 4 : 0;
+  set_chr_bank(0 ^ inversion, registers[0] & 0xfe);
+  set_chr_bank(1 ^ inversion, registers[0] | 0x01);
+  set_chr_bank(2 ^ inversion, registers[1] & 0xfe);
+  set_chr_bank(3 ^ inversion, registers[1] | 0x01);
+  set_chr_bank(4 ^ inversion, registers[2]);
+  set_chr_bank(5 ^ inversion, registers[3]);
+  set_chr_bank(6 ^ inversion, registers[4]);
+  set_chr_bank(7 ^ inversion, registers[5]);
+}
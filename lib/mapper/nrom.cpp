@@ -0,0 +1,11 @@
+#include "mappers.hpp"
+
+void NROM::reset_banks() {
+  // a 16 KiB PRG-ROM shows up in both halves
+  for (uint8_t slot = 0; slot < 4; ++slot) {
+    set_prg_bank(slot, slot);
+  }
+  for (uint8_t slot = 0; slot < 8; ++slot) {
+    set_chr_bank(slot, slot);
+  }
+}
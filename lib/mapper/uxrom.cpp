@@ -0,0 +1,16 @@
+#include "mappers.hpp"
+
+void UxROM::reset_banks() {
+  set_prg_bank(0, 0);
+  set_prg_bank(1, 1);
+  set_prg_bank(2, -2);
+  set_prg_bank(3, -1);
+  for (uint8_t slot = 0; slot < 8; ++slot) {
+    set_chr_bank(slot, slot);
+  }
+}
+
+void UxROM::write_register(uint16_t, uint8_t data) {
+  set_prg_bank(0, data * 2);
+  set_prg_bank(1, data * 2 + 1);
+}
@@ -0,0 +1,143 @@
+#include "nes.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr uint16_t PPUSTATUS = 0x2002;
+constexpr uint16_t OAM_DMA = 0x4014;
+} // namespace
+
+NES::NES(RomImage image)
+    : scheduler(), cartridge(std::move(image)),
+      mapper(make_mapper(cartridge)), cpu(), ppu(*mapper), apu(),
+      controllers(), sync(Sync::CatchUp), run_ahead(0), frame_idle_cycles(0) {
+  mapper->attach(cpu.get_bus());
+  ppu.attach(cpu.get_bus());
+  apu.attach(cpu.get_bus());
+  apu.set_port(OAM_DMA, nullptr, PPU::dma_write, &ppu);
+  controllers.attach(apu);
+
+  scheduler.set_handler(event::NMI, nmi_event, this);
+  scheduler.set_handler(event::IRQ, irq_event, this);
+  cpu.set_scheduler(&scheduler);
+  // the vblank flag is only set at the PPU's event, and a read while it is
+  // clear changes nothing
+  cpu.add_idle_register(PPUSTATUS, ppu_status::VBLANK);
+  ppu.set_scheduler(scheduler);
+  apu.set_scheduler(scheduler);
+  reset();
+}
+
+// silences every channel, like the reset line does
+void NES::reset() {
+  cpu.reset();
+  apu.write_register(APU::STATUS, 0);
+}
+
+void NES::set_run_ahead(uint8_t frames) {
+  run_ahead = frames;
+  if (run_ahead > 0 && !ahead) {
+    ahead = std::make_unique<Snapshot>();
+  }
+}
+
+void NES::take_snapshot(Snapshot &snapshot) const {
+  cpu.take_snapshot(snapshot.cpu);
+  ppu.take_snapshot(snapshot.ppu);
+  apu.take_snapshot(snapshot.apu);
+  mapper->take_snapshot(snapshot.mapper);
+  snapshot.scheduler = scheduler;
+  snapshot.controllers = controllers;
+  const uint8_t *chr_ram = cartridge.get_chr_ram();
+  snapshot.chr_ram.assign(chr_ram, chr_ram + cartridge.get_chr_ram_size());
+}
+
+void NES::restore_snapshot(const Snapshot &snapshot) {
+  cpu.restore_snapshot(snapshot.cpu);
+  ppu.restore_snapshot(snapshot.ppu);
+  apu.restore_snapshot(snapshot.apu);
+  mapper->restore_snapshot(snapshot.mapper);
+  scheduler = snapshot.scheduler;
+  controllers = snapshot.controllers;
+  uint8_t *chr_ram = cartridge.get_chr_ram();
+  if (!std::equal(snapshot.chr_ram.begin(), snapshot.chr_ram.end(),
+                  chr_ram)) {
+    std::copy(snapshot.chr_ram.begin(), snapshot.chr_ram.end(), chr_ram);
+    ppu.invalidate_tiles();
+  }
+}
+
+// the frame the game is at is heard but not shown, the frames past it are
+// thrown away but for the picture of the last one
+void NES::run_frame() {
+  if (run_ahead == 0) {
+    emulate_frame();
+    return;
+  }
+
+  ppu.set_output_enabled(false);
+  emulate_frame();
+  uint64_t idle_cycles = frame_idle_cycles;
+  take_snapshot(*ahead);
+
+  apu.set_output_enabled(false);
+  for (uint8_t frame = 1; frame <= run_ahead; ++frame) {
+    ppu.set_output_enabled(frame == run_ahead);
+    emulate_frame();
+  }
+  apu.set_output_enabled(true);
+  restore_snapshot(*ahead);
+  frame_idle_cycles = idle_cycles;
+}
+
+void NES::emulate_frame() {
+  uint64_t skipped = cpu.get_idle_stats().skipped_cycles;
+  if (sync == Sync::Lockstep) {
+    run_frame_lockstep();
+  } else {
+    run_frame_catch_up();
+  }
+  frame_idle_cycles = cpu.get_idle_stats().skipped_cycles - skipped;
+}
+
+void NES::run_frame_catch_up() {
+  // the PPU's own event brings it up to date at the end of the frame
+  uint64_t frame = ppu.get_frame();
+  while (ppu.get_frame() == frame) {
+    cpu.run_until(scheduler.get_deadline());
+    scheduler.run_due(cpu.get_cycles());
+  }
+  apu.end_frame(cpu.get_cycles());
+}
+
+void NES::run_frame_lockstep() {
+  uint64_t frame = ppu.get_frame();
+  while (ppu.get_frame() == frame) {
+    cpu.run(1);
+
+    uint64_t target = cpu.get_cycles() * PPU::DOTS_PER_CYCLE;
+    while (ppu.get_dots() < target) {
+      ppu.tick();
+    }
+    scheduler.run_due(cpu.get_cycles());
+  }
+  apu.end_frame(cpu.get_cycles());
+}
+
+void NES::nmi_event(void *context, uint64_t) {
+  static_cast<NES *>(context)->cpu.nmi();
+}
+
+// the IRQ line is level triggered: the event only says it may have changed
+// (or that the CPU cleared the interrupt disable flag), the sources are looked
+// at here
+void NES::irq_event(void *context, uint64_t) {
+  auto *nes = static_cast<NES *>(context);
+  if (nes->cpu.get_status() & flags::INTERRUPT_DISABLE) {
+    return;
+  }
+
+  if (nes->mapper->irq_pending() || nes->apu.irq_pending()) {
+    nes->cpu.irq();
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../apu/apu.hpp"
+#include "../cartridge/cartridge.hpp"
+#include "../cpu/cpu.hpp"
+#include "../input/controllers.hpp"
+#include "../mapper/mapper.hpp"
+#include "../ppu/ppu.hpp"
+#include "../scheduler/scheduler.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// how the PPU is kept in time with the CPU
+enum class Sync : uint8_t {
+  // the PPU only runs when the CPU touches one of its registers, or when its
+  // scheduler event is due
+  CatchUp,
+  // the PPU is ticked 3 dots per CPU cycle after every instruction
+  Lockstep,
+};
+
+// the console: puts the cartridge's mapper, the PPU and the APU on the CPU bus
+// and runs everything a frame at a time. it owns the scheduler, the CPU runs
+// flat out until the next event is due and interrupts are only looked at then
+class NES {
+public:
+  explicit NES(RomImage image);
+  NES(const NES &) = delete;
+  NES &operator=(const NES &) = delete;
+
+  void reset();
+  // runs until the PPU wraps around to the next frame
+  void run_frame();
+  void set_sync(Sync mode) { sync = mode; }
+  // cycles the CPU skipped in idle loops during the last frame (the frame
+  // the game is at, with run-ahead), see CPU::set_idle_skip
+  uint64_t get_frame_idle_cycles() const { return frame_idle_cycles; }
+
+  // run-ahead: every run_frame also runs `frames` frames past the one the
+  // game is at, with the same input, and shows the last of them instead,
+  // then goes back. a game that reacts to input a frame or two late shows it
+  // that many frames earlier. the sound is the frame the game is at, 0 turns
+  // it off
+  void set_run_ahead(uint8_t frames);
+  uint8_t get_run_ahead() const { return run_ahead; }
+
+  // everything a frame changes, copied as it is, for run-ahead. only goes
+  // back into the console it was taken from
+  struct Snapshot {
+    CPU::Snapshot cpu;
+    PPU::Snapshot ppu;
+    APU::Snapshot apu;
+    Mapper::Snapshot mapper;
+    Scheduler scheduler;
+    Controllers controllers;
+    std::vector<uint8_t> chr_ram;
+  };
+  void take_snapshot(Snapshot &snapshot) const;
+  void restore_snapshot(const Snapshot &snapshot);
+
+  Cartridge &get_cartridge() { return cartridge; }
+  Mapper &get_mapper() { return *mapper; }
+  CPU &get_cpu() { return cpu; }
+  PPU &get_ppu() { return ppu; }
+  APU &get_apu() { return apu; }
+  Controllers &get_controllers() { return controllers; }
+  Scheduler &get_scheduler() { return scheduler; }
+
+private:
+  Scheduler scheduler;
+  Cartridge cartridge;
+  std::unique_ptr<Mapper> mapper;
+  CPU cpu;
+  PPU ppu;
+  APU apu;
+  Controllers controllers;
+  Sync sync;
+  uint8_t run_ahead;
+  std::unique_ptr<Snapshot> ahead;
+  uint64_t frame_idle_cycles;
+
+  void emulate_frame();
+  void run_frame_catch_up();
+  void run_frame_lockstep();
+
+  static void nmi_event(void *context, uint64_t cycle);
+  static void irq_event(void *context, uint64_t cycle);
+};
@@ -0,0 +1,158 @@
+#include "pipeline.hpp"
+#include <cstring>
+
+namespace {
+constexpr size_t AUDIO_CHUNK = 256;
+
+void ignore_line(void *, const Scanline &) {}
+void ignore_audio(void *, const int16_t *, size_t) {}
+} // namespace
+
+Pipeline::Pipeline(NES &nes, Backpressure policy)
+    : nes(nes), policy(policy), line_sink(ignore_line), line_context(nullptr),
+      audio_sink(ignore_audio), audio_context(nullptr),
+      frame_limit(UNLIMITED), frame(0), skip_frame(false), stopping(false),
+      emulation_done(false) {
+  static_assert(NES_PIPELINE_LINES >= PPU::HEIGHT,
+                "the line queue has to fit a frame");
+  nes.get_ppu().set_scanline_handler(queue_line, this);
+  nes.get_apu().set_sample_handler(queue_audio, this);
+}
+
+Pipeline::~Pipeline() {
+  stop();
+  nes.get_ppu().set_scanline_handler(nullptr, nullptr);
+  nes.get_apu().set_sample_handler(nullptr, nullptr);
+}
+
+void Pipeline::set_line_sink(LineSink sink, void *context) {
+  line_sink = sink;
+  line_context = context;
+}
+
+void Pipeline::set_audio_sink(AudioSink sink, void *context) {
+  audio_sink = sink;
+  audio_context = context;
+}
+
+void Pipeline::start(uint64_t frames) {
+  frame_limit = frames;
+  stopping.store(false, std::memory_order_relaxed);
+  emulation_done.store(false, std::memory_order_relaxed);
+
+  output.start(
+      "nes output",
+      [](void *self) { static_cast<Pipeline *>(self)->present(); }, this,
+      OUTPUT_CORE);
+  emulation.start(
+      "nes emulation",
+      [](void *self) { static_cast<Pipeline *>(self)->emulate(); }, this,
+      EMULATION_CORE);
+}
+
+void Pipeline::join() {
+  emulation.join();
+  output.join();
+}
+
+void Pipeline::stop() {
+  stopping.store(true, std::memory_order_relaxed);
+  join();
+}
+
+size_t Pipeline::push_audio(const int16_t *values, size_t count) {
+  size_t pushed = samples.push(values, count);
+  if (pushed < count) {
+    stats.audio_dropped.fetch_add(count - pushed, std::memory_order_relaxed);
+  }
+  return pushed;
+}
+
+// emulation core
+void Pipeline::emulate() {
+  for (uint64_t emulated = 0;
+       emulated < frame_limit && !stopping.load(std::memory_order_relaxed);
+       ++emulated) {
+    // the whole frame goes out or none of it, a half old half new frame looks
+    // worse than a repeated one
+    skip_frame = policy == Backpressure::Drop &&
+                 lines.free_slots() < PPU::HEIGHT;
+    if (skip_frame) {
+      stats.frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    nes.run_frame();
+    frame++;
+    stats.frames_emulated.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  emulation_done.store(true, std::memory_order_release);
+}
+
+void Pipeline::queue_line(void *context, uint16_t y, const uint8_t *pixels) {
+  auto *self = static_cast<Pipeline *>(context);
+  if (self->skip_frame) {
+    return;
+  }
+
+  Scanline *slot = self->lines.claim();
+  if (slot == nullptr) {
+    self->stats.producer_waits.fetch_add(1, std::memory_order_relaxed);
+    while ((slot = self->lines.claim()) == nullptr) {
+      if (self->stopping.load(std::memory_order_relaxed)) {
+        return;
+      }
+      Worker::idle();
+    }
+  }
+
+  slot->frame = self->frame;
+  slot->y = y;
+  slot->completed_us = y == PPU::HEIGHT - 1 ? Worker::now_us() : 0;
+  std::memcpy(slot->pixels.data(), pixels, PPU::WIDTH);
+  self->lines.publish();
+}
+
+void Pipeline::queue_audio(void *context, const int16_t *values,
+                           size_t count) {
+  static_cast<Pipeline *>(context)->push_audio(values, count);
+}
+
+// output core
+void Pipeline::present() {
+  while (true) {
+    drain_audio();
+
+    const Scanline *line = lines.front();
+    if (line == nullptr) {
+      // everything queued before the flag was set is visible once it is
+      if (emulation_done.load(std::memory_order_acquire) &&
+          lines.front() == nullptr) {
+        break;
+      }
+      Worker::idle();
+      continue;
+    }
+
+    line_sink(line_context, *line);
+    if (line->y == PPU::HEIGHT - 1) {
+      uint64_t latency = Worker::now_us() - line->completed_us;
+      stats.latency_total_us.fetch_add(latency, std::memory_order_relaxed);
+      if (latency > stats.latency_max_us.load(std::memory_order_relaxed)) {
+        stats.latency_max_us.store(latency, std::memory_order_relaxed);
+      }
+      stats.frames_presented.fetch_add(1, std::memory_order_relaxed);
+    }
+    lines.pop();
+  }
+
+  drain_audio();
+}
+
+void Pipeline::drain_audio() {
+  std::array<int16_t, AUDIO_CHUNK> chunk;
+  size_t count;
+  while ((count = samples.pop(chunk.data(), chunk.size())) > 0) {
+    audio_sink(audio_context, chunk.data(), count);
+  }
+}
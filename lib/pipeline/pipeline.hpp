@@ -0,0 +1,112 @@
+#pragma once
+
+#include "../nes/nes.hpp"
+#include "../ppu/ppu.hpp"
+#include "spsc_queue.hpp"
+#include "worker.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// queue sizes, a power of two. the line queue holds at least a whole frame
+// so the drop policy can tell up front whether a frame fits
+#ifndef NES_PIPELINE_LINES
+#if defined(ESP_PLATFORM)
+#define NES_PIPELINE_LINES 256
+#else
+#define NES_PIPELINE_LINES 512
+#endif
+#endif
+#ifndef NES_PIPELINE_SAMPLES
+#define NES_PIPELINE_SAMPLES 4096
+#endif
+
+struct Scanline {
+  uint32_t frame;
+  uint16_t y;
+  // when the emulation finished the frame, set on its last line only
+  uint64_t completed_us;
+  std::array<uint8_t, PPU::WIDTH> pixels;
+};
+
+// what the emulation does when the output side falls behind
+enum class Backpressure : uint8_t {
+  // skips whole frames that don't fit in the queue, emulation keeps its pace
+  Drop,
+  // waits for room, no frame is lost
+  Wait,
+};
+
+struct PipelineStats {
+  std::atomic<uint64_t> frames_emulated{0};
+  std::atomic<uint64_t> frames_presented{0};
+  std::atomic<uint64_t> frames_dropped{0};
+  // lines the emulation had to wait for room on
+  std::atomic<uint64_t> producer_waits{0};
+  std::atomic<uint64_t> audio_dropped{0};
+  // from the emulation finishing a frame to the output presenting it
+  std::atomic<uint64_t> latency_total_us{0};
+  std::atomic<uint64_t> latency_max_us{0};
+};
+
+// splits the console across the two cores: core 0 emulates CPU + PPU + APU
+// and queues every finished scanline and block of audio samples, core 1 takes
+// them off the queues and hands them to the display / audio sinks
+class Pipeline {
+public:
+  static constexpr uint8_t EMULATION_CORE = 0;
+  static constexpr uint8_t OUTPUT_CORE = 1;
+  static constexpr uint64_t UNLIMITED = UINT64_MAX;
+
+  using LineSink = void (*)(void *context, const Scanline &line);
+  using AudioSink = void (*)(void *context, const int16_t *samples,
+                             size_t count);
+
+  Pipeline(NES &nes, Backpressure policy);
+  ~Pipeline();
+  Pipeline(const Pipeline &) = delete;
+  Pipeline &operator=(const Pipeline &) = delete;
+
+  void set_line_sink(LineSink sink, void *context);
+  void set_audio_sink(AudioSink sink, void *context);
+
+  // starts both sides, the emulation stops after `frames` frames
+  void start(uint64_t frames = UNLIMITED);
+  // waits until every emulated frame has been presented
+  void join();
+  // stops both sides early and waits for them
+  void stop();
+
+  // emulation side, drops what doesn't fit and returns how many samples did
+  size_t push_audio(const int16_t *samples, size_t count);
+
+  const PipelineStats &get_stats() const { return stats; }
+
+private:
+  NES &nes;
+  Backpressure policy;
+  LineSink line_sink;
+  void *line_context;
+  AudioSink audio_sink;
+  void *audio_context;
+
+  SpscQueue<Scanline, NES_PIPELINE_LINES> lines;
+  SpscQueue<int16_t, NES_PIPELINE_SAMPLES> samples;
+  Worker emulation;
+  Worker output;
+
+  uint64_t frame_limit;
+  uint32_t frame;
+  bool skip_frame;
+  std::atomic<bool> stopping;
+  std::atomic<bool> emulation_done;
+  PipelineStats stats;
+
+  void emulate();
+  void present();
+  void drain_audio();
+
+  static void queue_line(void *context, uint16_t y, const uint8_t *pixels);
+  static void queue_audio(void *context, const int16_t *values, size_t count);
+};
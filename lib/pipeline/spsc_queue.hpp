@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// bounded lock-free ring buffer between exactly one producer thread and one
+// consumer thread. both sides keep a private copy of the other side's index
+// and only reload it when the queue looks full / empty, so in the steady
+// state a push or a pop touches no cache line owned by the other core
+//
+// items can be written and read in place (claim / publish, front / pop) to
+// avoid copying big ones
+template <typename T, size_t Capacity> class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+
+public:
+  SpscQueue() : head(0), cached_tail(0), tail(0), cached_head(0) {}
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  static constexpr size_t capacity() { return Capacity; }
+
+  // producer side
+  //
+  // returns the next free slot, or nullptr when the queue is full
+  T *claim() {
+    size_t position = tail.load(std::memory_order_relaxed);
+    if (position - cached_head == Capacity) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (position - cached_head == Capacity) {
+        return nullptr;
+      }
+    }
+    return &items[position & (Capacity - 1)];
+  }
+  // makes the claimed slot visible to the consumer
+  void publish() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+  bool try_push(const T &value) {
+    T *slot = claim();
+    if (slot == nullptr) {
+      return false;
+    }
+    *slot = value;
+    publish();
+    return true;
+  }
+  // pushes as many of the values as fit and returns how many did
+  size_t push(const T *values, size_t count) {
+    size_t position = tail.load(std::memory_order_relaxed);
+    cached_head = head.load(std::memory_order_acquire);
+    size_t free = Capacity - (position - cached_head);
+    if (count > free) {
+      count = free;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      items[(position + i) & (Capacity - 1)] = values[i];
+    }
+    tail.store(position + count, std::memory_order_release);
+    return count;
+  }
+  // free slots as seen by the producer
+  size_t free_slots() {
+    cached_head = head.load(std::memory_order_acquire);
+    return Capacity - (tail.load(std::memory_order_relaxed) - cached_head);
+  }
+
+  // consumer side
+  //
+  // returns the oldest item, or nullptr when the queue is empty
+  const T *front() {
+    size_t position = head.load(std::memory_order_relaxed);
+    if (position == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (position == cached_tail) {
+        return nullptr;
+      }
+    }
+    return &items[position & (Capacity - 1)];
+  }
+  // releases the item returned by front
+  void pop() {
+    head.store(head.load(std::memory_order_relaxed) + 1,
+               std::memory_order_release);
+  }
+  bool try_pop(T &value) {
+    const T *item = front();
+    if (item == nullptr) {
+      return false;
+    }
+    value = *item;
+    pop();
+    return true;
+  }
+  // pops up to `count` values and returns how many it did
+  size_t pop(T *values, size_t count) {
+    size_t position = head.load(std::memory_order_relaxed);
+    cached_tail = tail.load(std::memory_order_acquire);
+    size_t used = cached_tail - position;
+    if (count > used) {
+      count = used;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = items[(position + i) & (Capacity - 1)];
+    }
+    head.store(position + count, std::memory_order_release);
+    return count;
+  }
+
+private:
+  // producer and consumer state on separate cache lines
+  alignas(64) std::atomic<size_t> head;
+  size_t cached_tail;
+  alignas(64) std::atomic<size_t> tail;
+  size_t cached_head;
+  alignas(64) std::array<T, Capacity> items;
+};
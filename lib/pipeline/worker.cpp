@@ -0,0 +1,81 @@
+#include "worker.hpp"
+#include "../error/error.hpp"
+
+#if defined(ESP_PLATFORM)
+#include "esp_timer.h"
+#else
+#include <chrono>
+#endif
+
+namespace {
+#if defined(ESP_PLATFORM)
+constexpr uint32_t STACK_SIZE = 8192;
+constexpr UBaseType_t PRIORITY = 5;
+#endif
+} // namespace
+
+#if defined(ESP_PLATFORM)
+Worker::Worker()
+    : running(false), entry(nullptr), context(nullptr),
+      done(xSemaphoreCreateBinary()) {}
+
+Worker::~Worker() {
+  join();
+  vSemaphoreDelete(done);
+}
+
+void Worker::start(const char *name, Entry target, void *target_context,
+                   uint8_t core) {
+  entry = target;
+  context = target_context;
+  running = true;
+
+  if (xTaskCreatePinnedToCore(run, name, STACK_SIZE, this, PRIORITY, nullptr,
+                              core) != pdPASS) {
+    running = false;
+    error::fail("failed to create task");
+  }
+}
+
+void Worker::join() {
+  if (running) {
+    xSemaphoreTake(done, portMAX_DELAY);
+    running = false;
+  }
+}
+
+void Worker::idle() { vTaskDelay(1); }
+
+uint64_t Worker::now_us() { return esp_timer_get_time(); }
+
+void Worker::run(void *worker) {
+  auto *self = static_cast<Worker *>(worker);
+  self->entry(self->context);
+  xSemaphoreGive(self->done);
+  vTaskDelete(nullptr);
+}
+#else
+Worker::Worker() : running(false) {}
+
+Worker::~Worker() { join(); }
+
+void Worker::start(const char *, Entry entry, void *context, uint8_t) {
+  thread = std::thread(entry, context);
+  running = true;
+}
+
+void Worker::join() {
+  if (running) {
+    thread.join();
+    running = false;
+  }
+}
+
+void Worker::idle() { std::this_thread::yield(); }
+
+uint64_t Worker::now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+// runs a function on its own thread. on the ESP32 it is a FreeRTOS task
+// pinned to one of the two cores, on native builds a std::thread (the core
+// is only a hint there)
+class Worker {
+public:
+  using Entry = void (*)(void *context);
+
+  Worker();
+  ~Worker();
+  Worker(const Worker &) = delete;
+  Worker &operator=(const Worker &) = delete;
+
+  void start(const char *name, Entry entry, void *context, uint8_t core);
+  // waits for the function to return
+  void join();
+
+  // gives the core away while waiting on the other side of a queue
+  static void idle();
+  static uint64_t now_us();
+
+private:
+  bool running;
+#if defined(ESP_PLATFORM)
+  Entry entry;
+  void *context;
+  SemaphoreHandle_t done;
+
+  static void run(void *worker);
+#else
+  std::thread thread;
+#endif
+};
@@ -0,0 +1,620 @@
+#include "ppu.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr uint64_t LOW_BITS = 0x0101010101010101;
+constexpr uint16_t PALETTE_START = 0x3f00;
+constexpr uint16_t OAM_DMA = 0x4014;
+// the CPU is halted for 513 cycles, plus one to align on an odd cycle
+constexpr uint32_t OAM_DMA_CYCLES = 513;
+
+uint64_t load_pixels(const uint8_t *pixels) {
+  uint64_t value;
+  std::memcpy(&value, pixels, sizeof(value));
+  return value;
+}
+} // namespace
+
+PPU::PPU(Mapper &mapper)
+    : mapper(mapper), bus(nullptr), scheduler(nullptr), sync_event(0),
+      scanline_handler(nullptr), scanline_context(nullptr),
+      output_enabled(true), ctrl(0), mask(0), status(0), oam_addr(0),
+      read_buffer(0), open_bus(0), v(0), t(0), fine_x(0), w(false), dots(0),
+      scanline(0), dot(0), vram{}, palette{}, oam{}, frame(0), tiles{},
+      tile_valid{}, cached_chr_banks{},
+      cached_chr_generation(mapper.get_chr_generation()), tiles_decoded(0),
+      background{}, line{} {
+  for (uint8_t slot = 0; slot < cached_chr_banks.size(); ++slot) {
+    cached_chr_banks[slot] = mapper.get_chr_bank(slot);
+  }
+}
+
+void PPU::attach(Bus &target) {
+  bus = &target;
+
+  // the 8 registers are mirrored all the way up to 0x4000
+  bus->map_io(0x2000, 0x2000, register_read, register_write, this);
+}
+
+void PPU::set_scanline_handler(ScanlineHandler handler, void *context) {
+  scanline_handler = handler;
+  scanline_context = context;
+}
+
+void PPU::set_scheduler(Scheduler &target) {
+  scheduler = &target;
+  sync_event = scheduler->add_event(sync, this);
+  scheduler->schedule(sync_event, next_sync_cycle());
+}
+
+void PPU::take_snapshot(Snapshot &snapshot) const {
+  snapshot.ctrl = ctrl;
+  snapshot.mask = mask;
+  snapshot.status = status;
+  snapshot.oam_addr = oam_addr;
+  snapshot.read_buffer = read_buffer;
+  snapshot.open_bus = open_bus;
+  snapshot.v = v;
+  snapshot.t = t;
+  snapshot.fine_x = fine_x;
+  snapshot.w = w;
+  snapshot.dots = dots;
+  snapshot.scanline = scanline;
+  snapshot.dot = dot;
+  snapshot.vram = vram;
+  snapshot.palette = palette;
+  snapshot.oam = oam;
+  snapshot.frame = frame;
+}
+
+void PPU::restore_snapshot(const Snapshot &snapshot) {
+  ctrl = snapshot.ctrl;
+  mask = snapshot.mask;
+  status = snapshot.status;
+  oam_addr = snapshot.oam_addr;
+  read_buffer = snapshot.read_buffer;
+  open_bus = snapshot.open_bus;
+  v = snapshot.v;
+  t = snapshot.t;
+  fine_x = snapshot.fine_x;
+  w = snapshot.w;
+  dots = snapshot.dots;
+  scanline = snapshot.scanline;
+  dot = snapshot.dot;
+  vram = snapshot.vram;
+  palette = snapshot.palette;
+  oam = snapshot.oam;
+  frame = snapshot.frame;
+}
+
+// timing
+void PPU::catch_up(uint64_t cycle) { run_to(cycle * DOTS_PER_CYCLE); }
+
+void PPU::tick() { run_to(dots + 1); }
+
+void PPU::render_frame() { run_to(dots + dots_until_vblank()); }
+
+uint64_t PPU::next_sync_cycle() const {
+  uint32_t until_frame_end =
+      (LINES_PER_FRAME - scanline) * DOTS_PER_LINE - dot - skips_dot();
+  uint64_t target = dots + std::min(dots_until_vblank(), until_frame_end);
+  if (mapper.has_scanline_irq()) {
+    target = std::min(target, dots + dots_until_scanline_clock());
+  }
+
+  // rounded up, the CPU has to run at least until the PPU gets there
+  return (target + DOTS_PER_CYCLE - 1) / DOTS_PER_CYCLE;
+}
+
+// schedules an interrupt for the cycle the PPU is at, which the CPU is
+// already at or past, so it is taken after the current instruction
+void PPU::raise(uint8_t id) {
+  if (scheduler != nullptr) {
+    scheduler->schedule(id, dots / DOTS_PER_CYCLE);
+  }
+}
+
+// jumps from event to event instead of going through every dot
+void PPU::run_to(uint64_t target) {
+  while (dots < target) {
+    uint16_t next = next_event();
+    uint64_t step = std::min<uint64_t>(next - dot, target - dots);
+
+    dot += step;
+    dots += step;
+    if (dot == next) {
+      run_event();
+    }
+  }
+}
+
+// the next dot of the current line where something happens
+uint16_t PPU::next_event() const {
+  if (scanline < HEIGHT) {
+    // the line is rendered at once when the real PPU is done fetching it,
+    // MMC3 sees the sprite fetches a few dots later
+    if (dot < 256) {
+      return 256;
+    }
+    if (dot < 260) {
+      return 260;
+    }
+  } else if (scanline == VBLANK_LINE) {
+    if (dot < 1) {
+      return 1;
+    }
+  } else if (scanline == PRE_RENDER_LINE) {
+    if (dot < 1) {
+      return 1;
+    }
+    if (dot < 260) {
+      return 260;
+    }
+    if (dot < 280) {
+      return 280;
+    }
+  }
+
+  return line_length();
+}
+
+void PPU::run_event() {
+  if (dot == line_length()) {
+    dot = 0;
+    if (++scanline == LINES_PER_FRAME) {
+      scanline = 0;
+      frame++;
+    }
+    return;
+  }
+
+  bool rendering = rendering_enabled();
+  if (scanline < HEIGHT && dot == 256) {
+    render_scanline(scanline);
+  }
+  if (dot == 260 && rendering &&
+      (scanline < HEIGHT || scanline == PRE_RENDER_LINE)) {
+    mapper.clock_scanline();
+    if (mapper.irq_pending()) {
+      raise(event::IRQ);
+    }
+  }
+
+  if (scanline == VBLANK_LINE && dot == 1) {
+    status |= ppu_status::VBLANK;
+    if (ctrl & ppu_ctrl::NMI_ENABLE) {
+      raise(event::NMI);
+    }
+  } else if (scanline == PRE_RENDER_LINE && dot == 1) {
+    status &= ~(ppu_status::VBLANK | ppu_status::SPRITE_ZERO_HIT |
+                ppu_status::SPRITE_OVERFLOW);
+  } else if (scanline == PRE_RENDER_LINE && dot == 280 && rendering) {
+    // copies the vertical scroll bits for the new frame
+    v = (v & 0x841f) | (t & 0x7be0);
+  }
+}
+
+uint16_t PPU::line_length() const {
+  return scanline == PRE_RENDER_LINE ? DOTS_PER_LINE - skips_dot()
+                                     : DOTS_PER_LINE;
+}
+
+// the pre-render line is a dot shorter on odd frames while rendering
+bool PPU::skips_dot() const { return (frame & 1) && rendering_enabled(); }
+
+uint32_t PPU::dots_until_vblank() const {
+  int32_t remaining =
+      (VBLANK_LINE - scanline) * DOTS_PER_LINE + 1 - static_cast<int>(dot);
+  if (remaining <= 0) {
+    remaining += LINES_PER_FRAME * DOTS_PER_LINE - skips_dot();
+  }
+  return remaining;
+}
+
+// dots until the next scanline clock at dot 260 of a rendered line
+uint32_t PPU::dots_until_scanline_clock() const {
+  uint32_t remaining = 0;
+  uint16_t line = scanline;
+  uint16_t position = dot;
+
+  while (!((line < HEIGHT || line == PRE_RENDER_LINE) && position < 260)) {
+    remaining += (line == PRE_RENDER_LINE ? line_length() : DOTS_PER_LINE) -
+                 position;
+    line = (line + 1) % LINES_PER_FRAME;
+    position = 0;
+  }
+  return remaining + 260 - position;
+}
+
+// rendering
+void PPU::render_scanline(uint16_t y) {
+  sync_tile_cache();
+
+  if (!rendering_enabled()) {
+    // with rendering off the backdrop is shown, or the palette entry v points
+    // at if it points into the palette
+    uint16_t addr = (v & 0x3f00) == PALETTE_START ? v : PALETTE_START;
+    line.fill(palette[palette_index(addr)]);
+  } else {
+    render_background(y);
+    render_sprites(y);
+
+    uint8_t color_mask = (mask & ppu_mask::GRAYSCALE) ? 0x30 : 0x3f;
+    for (uint16_t x = 0; x < WIDTH; ++x) {
+      line[x] = palette[palette_index(line[x])] & color_mask;
+    }
+
+    increment_y();
+    // copy the horizontal scroll bits back for the next line
+    v = (v & ~0x041f) | (t & 0x041f);
+  }
+
+  if (scanline_handler != nullptr && output_enabled) {
+    scanline_handler(scanline_context, y, line.data());
+  }
+}
+
+// fills `line` with palette addresses (0..15) of the background
+void PPU::render_background(uint16_t) {
+  if (!(mask & ppu_mask::BACKGROUND)) {
+    line.fill(0);
+    return;
+  }
+
+  uint16_t addr = v;
+  uint16_t table = (ctrl & ppu_ctrl::BACKGROUND_TABLE) ? 256 : 0;
+  uint8_t fine_y = (addr >> 12) & 0b111;
+
+  // 33 tiles since a fine x scroll shows parts of one more tile
+  for (uint16_t i = 0; i < 33; ++i) {
+    uint8_t tile = *nametable(0x2000 | (addr & 0x0fff));
+    uint8_t attribute = *nametable(0x23c0 | (addr & 0x0c00) |
+                                   ((addr >> 4) & 0x38) | ((addr >> 2) & 0x07));
+    uint8_t shift = ((addr >> 4) & 4) | (addr & 2);
+    uint8_t palette_bits = ((attribute >> shift) & 0b11) << 2;
+
+    // adds the palette bits to the 8 pixels at once, leaving the transparent
+    // ones at 0
+    uint64_t pixels = load_pixels(tile_row(table + tile, fine_y));
+    uint64_t opaque = (pixels | (pixels >> 1)) & LOW_BITS;
+    pixels |= opaque * palette_bits;
+    std::memcpy(&background[i * 8], &pixels, sizeof(pixels));
+
+    // coarse x, wrapping into the horizontally adjacent nametable
+    if ((addr & 0x001f) == 31) {
+      addr &= ~0x001f;
+      addr ^= 0x0400;
+    } else {
+      addr++;
+    }
+  }
+
+  std::memcpy(line.data(), background.data() + fine_x, WIDTH);
+  if (!(mask & ppu_mask::BACKGROUND_LEFT)) {
+    std::memset(line.data(), 0, 8);
+  }
+}
+
+// draws the sprites of the line over the background palette addresses
+void PPU::render_sprites(uint16_t y) {
+  if (!(mask & ppu_mask::SPRITES)) {
+    return;
+  }
+
+  uint8_t height = (ctrl & ppu_ctrl::SPRITE_8X16) ? 16 : 8;
+  // palette address of the frontmost sprite pixel (0 = none), whether it sits
+  // behind the background and whether it belongs to sprite 0
+  std::array<uint8_t, WIDTH> sprite_pixels = {};
+  std::array<bool, WIDTH> sprite_behind = {};
+  std::array<bool, WIDTH> sprite_zero = {};
+  uint8_t found = 0;
+
+  for (uint16_t i = 0; i < 64; ++i) {
+    const uint8_t *sprite = &oam[i * 4];
+    // sprites show up one line below their Y coordinate
+    int row = static_cast<int>(y) - sprite[0] - 1;
+    if (row < 0 || row >= height) {
+      continue;
+    }
+
+    if (found++ == 8) {
+      status |= ppu_status::SPRITE_OVERFLOW;
+      break;
+    }
+
+    uint8_t tile = sprite[1];
+    uint8_t attributes = sprite[2];
+    uint8_t x = sprite[3];
+    if (attributes & 0x80) {
+      row = height - 1 - row;
+    }
+
+    uint16_t pattern;
+    if (height == 16) {
+      pattern = ((tile & 1) ? 256 : 0) + (tile & 0xfe) + (row >= 8);
+      row &= 0b111;
+    } else {
+      pattern = ((ctrl & ppu_ctrl::SPRITE_TABLE) ? 256 : 0) + tile;
+    }
+
+    const uint8_t *pixels = tile_row(pattern, row);
+    bool flip = attributes & 0x40;
+    uint8_t palette_bits = 0x10 | ((attributes & 0b11) << 2);
+
+    for (uint8_t column = 0; column < 8 && x + column < WIDTH; ++column) {
+      uint8_t pixel = pixels[flip ? 7 - column : column];
+      uint16_t screen_x = x + column;
+
+      // the first sprite in OAM wins, even over sprites that are in front
+      if (pixel == 0 || sprite_pixels[screen_x] != 0) {
+        continue;
+      }
+      sprite_pixels[screen_x] = palette_bits | pixel;
+      sprite_behind[screen_x] = attributes & 0x20;
+      sprite_zero[screen_x] = i == 0;
+    }
+  }
+
+  uint16_t start = (mask & ppu_mask::SPRITES_LEFT) ? 0 : 8;
+  for (uint16_t x = start; x < WIDTH; ++x) {
+    if (sprite_pixels[x] == 0) {
+      continue;
+    }
+
+    bool background_opaque = (line[x] & 0b11) != 0;
+    if (sprite_zero[x] && background_opaque && x != 255) {
+      status |= ppu_status::SPRITE_ZERO_HIT;
+    }
+    if (!background_opaque || !sprite_behind[x]) {
+      line[x] = sprite_pixels[x];
+    }
+  }
+}
+
+void PPU::increment_y() {
+  if ((v & 0x7000) != 0x7000) {
+    v += 0x1000;
+    return;
+  }
+
+  // fine y wraps into coarse y, and coarse y wraps at the 30th row into the
+  // vertically adjacent nametable (rows 30, 31 are attribute bytes)
+  v &= ~0x7000;
+  uint16_t coarse_y = (v & 0x03e0) >> 5;
+  if (coarse_y == 29) {
+    coarse_y = 0;
+    v ^= 0x0800;
+  } else if (coarse_y == 31) {
+    coarse_y = 0;
+  } else {
+    coarse_y++;
+  }
+  v = (v & ~0x03e0) | (coarse_y << 5);
+}
+
+// tile cache
+const uint8_t *PPU::tile_row(uint16_t tile, uint8_t row) {
+  if (!tile_valid[tile]) {
+    decode_tile(tile);
+  }
+
+  return &tiles[tile][row * 8];
+}
+
+void PPU::decode_tile(uint16_t tile) {
+  uint16_t addr = tile * 16;
+
+  // bitplane 0 holds bit 0 of every pixel, bitplane 1 bit 1, leftmost pixel
+  // in bit 7
+  for (uint8_t row = 0; row < 8; ++row) {
+    uint8_t low = mapper.chr_read(addr + row);
+    uint8_t high = mapper.chr_read(addr + row + 8);
+
+    for (uint8_t column = 0; column < 8; ++column) {
+      uint8_t bit = 7 - column;
+      tiles[tile][row * 8 + column] =
+          ((low >> bit) & 1) | (((high >> bit) & 1) << 1);
+    }
+  }
+
+  tile_valid[tile] = true;
+  tiles_decoded++;
+}
+
+// drops the tiles of every CHR window the mapper switched since the last line
+void PPU::sync_tile_cache() {
+  if (mapper.get_chr_generation() == cached_chr_generation) {
+    return;
+  }
+
+  for (uint8_t slot = 0; slot < cached_chr_banks.size(); ++slot) {
+    const uint8_t *bank = mapper.get_chr_bank(slot);
+    if (bank != cached_chr_banks[slot]) {
+      cached_chr_banks[slot] = bank;
+      std::fill_n(tile_valid.begin() + slot * 64, 64, false);
+    }
+  }
+  cached_chr_generation = mapper.get_chr_generation();
+}
+
+// memory
+uint8_t *PPU::nametable(uint16_t addr) {
+  uint16_t table = (addr >> 10) & 0b11;
+
+  switch (mapper.get_mirroring()) {
+  case Mirroring::Horizontal:
+    table >>= 1;
+    break;
+  case Mirroring::Vertical:
+    table &= 1;
+    break;
+  case Mirroring::SingleScreen_Low:
+    table = 0;
+    break;
+  case Mirroring::SingleScreen_High:
+    table = 1;
+    break;
+  case Mirroring::FourScreen:
+    break;
+  }
+
+  return &vram[(table << 10) | (addr & 0x03ff)];
+}
+
+uint8_t PPU::palette_index(uint16_t addr) const {
+  uint8_t index = addr & 0x1f;
+
+  // the backdrop entries of the sprite palettes mirror the background ones
+  if ((index & 0x13) == 0x10) {
+    index &= ~0x10;
+  }
+  return index;
+}
+
+uint8_t PPU::mem_read(uint16_t addr) {
+  addr &= 0x3fff;
+
+  if (addr < 0x2000) {
+    return mapper.chr_read(addr);
+  }
+  if (addr < PALETTE_START) {
+    return *nametable(addr);
+  }
+  return palette[palette_index(addr)];
+}
+
+void PPU::mem_write(uint16_t addr, uint8_t data) {
+  addr &= 0x3fff;
+
+  if (addr < 0x2000) {
+    if (mapper.chr_write(addr, data)) {
+      tile_valid[addr >> 4] = false;
+    }
+  } else if (addr < PALETTE_START) {
+    *nametable(addr) = data;
+  } else {
+    palette[palette_index(addr)] = data & 0x3f;
+  }
+}
+
+// registers
+uint8_t PPU::read_register(uint16_t addr) {
+  uint8_t result = open_bus;
+
+  switch (addr & 0b111) {
+  case 2:
+    // the low 5 bits are whatever was last on the PPU data bus
+    result = (status & 0xe0) | (open_bus & 0x1f);
+    status &= ~ppu_status::VBLANK;
+    w = false;
+    break;
+  case 4:
+    result = oam[oam_addr];
+    break;
+  case 7:
+    // reads below the palette return the previous read, palette reads are
+    // immediate but still refill the buffer with the nametable underneath
+    if ((v & 0x3fff) < PALETTE_START) {
+      result = read_buffer;
+      read_buffer = mem_read(v);
+    } else {
+      result = (open_bus & 0xc0) | mem_read(v);
+      read_buffer = mem_read(v - 0x1000);
+    }
+    v += (ctrl & ppu_ctrl::INCREMENT_32) ? 32 : 1;
+    break;
+  }
+
+  open_bus = result;
+  return result;
+}
+
+void PPU::write_register(uint16_t addr, uint8_t data) {
+  open_bus = data;
+
+  switch (addr & 0b111) {
+  case 0:
+    // enabling NMI during vblank raises one right away
+    if (!(ctrl & ppu_ctrl::NMI_ENABLE) && (data & ppu_ctrl::NMI_ENABLE) &&
+        (status & ppu_status::VBLANK)) {
+      raise(event::NMI);
+    }
+    ctrl = data;
+    t = (t & ~0x0c00) | ((data & ppu_ctrl::NAMETABLE) << 10);
+    break;
+  case 1:
+    mask = data;
+    break;
+  case 3:
+    oam_addr = data;
+    break;
+  case 4:
+    oam[oam_addr++] = data;
+    break;
+  case 5:
+    if (!w) {
+      t = (t & ~0x001f) | (data >> 3);
+      fine_x = data & 0b111;
+    } else {
+      t = (t & ~0x73e0) | ((data & 0b111) << 12) | ((data & 0xf8) << 2);
+    }
+    w = !w;
+    break;
+  case 6:
+    if (!w) {
+      t = (t & 0x00ff) | ((data & 0x3f) << 8);
+    } else {
+      t = (t & 0xff00) | data;
+      v = t;
+    }
+    w = !w;
+    break;
+  case 7:
+    mem_write(v, data);
+    v += (ctrl & ppu_ctrl::INCREMENT_32) ? 32 : 1;
+    break;
+  }
+}
+
+void PPU::oam_dma(const uint8_t *page) {
+  for (uint16_t i = 0; i < 256; ++i) {
+    oam[(oam_addr + i) & 0xff] = page[i];
+  }
+}
+
+uint8_t PPU::register_read(void *context, uint16_t addr, uint64_t cycle) {
+  auto *ppu = static_cast<PPU *>(context);
+  ppu->catch_up(cycle);
+  return ppu->read_register(addr);
+}
+
+void PPU::register_write(void *context, uint16_t addr, uint8_t data,
+                         uint64_t cycle) {
+  auto *ppu = static_cast<PPU *>(context);
+  ppu->catch_up(cycle);
+  ppu->write_register(addr, data);
+}
+
+void PPU::sync(void *context, uint64_t cycle) {
+  auto *ppu = static_cast<PPU *>(context);
+  ppu->catch_up(cycle);
+  ppu->scheduler->schedule(ppu->sync_event, ppu->next_sync_cycle());
+}
+
+void PPU::dma_write(void *context, uint16_t addr, uint8_t data,
+                    uint64_t cycle) {
+  if (addr != OAM_DMA) {
+    return;
+  }
+
+  auto *ppu = static_cast<PPU *>(context);
+  ppu->catch_up(cycle);
+  ppu->bus->stall(OAM_DMA_CYCLES + (cycle & 1));
+
+  std::array<uint8_t, 256> page;
+  for (uint16_t i = 0; i < page.size(); ++i) {
+    page[i] = ppu->bus->mem_read((data << 8) | i);
+  }
+  ppu->oam_dma(page.data());
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "../bus/bus.hpp"
+#include "../mapper/mapper.hpp"
+#include "../scheduler/scheduler.hpp"
+#include <array>
+#include <cstdint>
+
+// bit masks for the PPU registers
+namespace ppu_ctrl {
+constexpr uint8_t NAMETABLE = 0b00000011;
+constexpr uint8_t INCREMENT_32 = (1 << 2);
+constexpr uint8_t SPRITE_TABLE = (1 << 3);
+constexpr uint8_t BACKGROUND_TABLE = (1 << 4);
+constexpr uint8_t SPRITE_8X16 = (1 << 5);
+constexpr uint8_t NMI_ENABLE = (1 << 7);
+} // namespace ppu_ctrl
+
+namespace ppu_mask {
+constexpr uint8_t GRAYSCALE = (1 << 0);
+constexpr uint8_t BACKGROUND_LEFT = (1 << 1);
+constexpr uint8_t SPRITES_LEFT = (1 << 2);
+constexpr uint8_t BACKGROUND = (1 << 3);
+constexpr uint8_t SPRITES = (1 << 4);
+} // namespace ppu_mask
+
+namespace ppu_status {
+constexpr uint8_t SPRITE_OVERFLOW = (1 << 5);
+constexpr uint8_t SPRITE_ZERO_HIT = (1 << 6);
+constexpr uint8_t VBLANK = (1 << 7);
+} // namespace ppu_status
+
+// renders a whole scanline at a time into a line buffer of NES color indices
+// (0..63). pattern tiles are decoded once into 2-bit pixels and kept in a
+// tile cache, so the renderer never touches bitplanes per pixel
+//
+// the PPU isn't ticked alongside the CPU. it remembers the dot it ran up to
+// and catches up to the CPU cycle whenever the CPU touches one of its
+// registers, or when the system reaches a point where it could raise an NMI
+class PPU {
+public:
+  static constexpr uint16_t WIDTH = 256;
+  static constexpr uint16_t HEIGHT = 240;
+  // NTSC timing
+  static constexpr uint16_t DOTS_PER_LINE = 341;
+  static constexpr uint16_t LINES_PER_FRAME = 262;
+  static constexpr uint16_t VBLANK_LINE = 241;
+  static constexpr uint16_t PRE_RENDER_LINE = 261;
+  static constexpr uint8_t DOTS_PER_CYCLE = 3;
+
+  // receives every rendered scanline
+  using ScanlineHandler = void (*)(void *context, uint16_t y,
+                                   const uint8_t *pixels);
+
+  explicit PPU(Mapper &mapper);
+
+  // maps the registers at [0x2000..0x4000], OAM DMA is plugged in at 0x4014
+  // through dma_write
+  void attach(Bus &bus);
+  void set_scanline_handler(ScanlineHandler handler, void *context);
+  // off still renders every scanline (sprite 0 hits depend on it) but hands
+  // none to the handler, for frames that are never shown
+  void set_output_enabled(bool enabled) { output_enabled = enabled; }
+  // adds the PPU's sync event, the PPU raises NMI and IRQ (for the mapper)
+  // through the scheduler. without one it runs on its own
+  void set_scheduler(Scheduler &target);
+
+  // runs the PPU on its own up to the start of the next vblank, for use
+  // without a CPU driving it
+  void render_frame();
+  // renders one visible scanline, `y` must follow the previous one
+  void render_scanline(uint16_t y);
+
+  // timing
+  //
+  // runs every scanline, vblank and NMI up to the CPU cycle, never goes back
+  void catch_up(uint64_t cycle);
+  // runs a single dot
+  void tick();
+  // CPU cycle at which the PPU reaches the next vblank or the end of the
+  // frame, the only points where it raises an NMI on its own (and every
+  // scanline for mappers with a scanline IRQ)
+  uint64_t next_sync_cycle() const;
+
+  uint8_t read_register(uint16_t addr);
+  void write_register(uint16_t addr, uint8_t data);
+  // copies 256 bytes into OAM starting at the current OAM address
+  void oam_dma(const uint8_t *page);
+  // the 0x4014 register: copies a CPU page into OAM and stalls the CPU
+  static void dma_write(void *context, uint16_t addr, uint8_t data,
+                        uint64_t cycle);
+
+  // PPU address space: pattern tables, nametables, palette
+  uint8_t mem_read(uint16_t addr);
+  void mem_write(uint16_t addr, uint8_t data);
+
+  const std::array<uint8_t, WIDTH> &get_line() const { return line; }
+  uint8_t get_status() const { return status; }
+  bool rendering_enabled() const {
+    return mask & (ppu_mask::BACKGROUND | ppu_mask::SPRITES);
+  }
+  uint64_t get_frame() const { return frame; }
+  uint16_t get_scanline() const { return scanline; }
+  uint16_t get_dot() const { return dot; }
+  uint64_t get_dots() const { return dots; }
+  // number of tiles decoded so far, stays flat while the cache is warm
+  uint64_t get_tiles_decoded() const { return tiles_decoded; }
+  // drops every decoded tile, for when CHR-RAM changes behind the PPU's back
+  void invalidate_tiles() { tile_valid.fill(false); }
+
+  // registers, position and memory, for run-ahead. the tile cache follows
+  // the mapper's banks on its own
+  struct Snapshot {
+    uint8_t ctrl;
+    uint8_t mask;
+    uint8_t status;
+    uint8_t oam_addr;
+    uint8_t read_buffer;
+    uint8_t open_bus;
+    uint16_t v;
+    uint16_t t;
+    uint8_t fine_x;
+    bool w;
+    uint64_t dots;
+    uint16_t scanline;
+    uint16_t dot;
+    std::array<uint8_t, 0x1000> vram;
+    std::array<uint8_t, 32> palette;
+    std::array<uint8_t, 256> oam;
+    uint64_t frame;
+  };
+  void take_snapshot(Snapshot &snapshot) const;
+  void restore_snapshot(const Snapshot &snapshot);
+
+private:
+  static constexpr uint16_t TILE_COUNT = 512;
+
+  Mapper &mapper;
+  Bus *bus;
+  Scheduler *scheduler;
+  uint8_t sync_event;
+  ScanlineHandler scanline_handler;
+  void *scanline_context;
+  bool output_enabled;
+
+  // registers
+  uint8_t ctrl;
+  uint8_t mask;
+  uint8_t status;
+  uint8_t oam_addr;
+  uint8_t read_buffer;
+  uint8_t open_bus;
+  // loopy registers: current / temporary VRAM address, fine x scroll and the
+  // shared $2005/$2006 write toggle
+  uint16_t v;
+  uint16_t t;
+  uint8_t fine_x;
+  bool w;
+
+  // timing: dots run since power up, position in the frame
+  uint64_t dots;
+  uint16_t scanline;
+  uint16_t dot;
+
+  std::array<uint8_t, 0x1000> vram;
+  std::array<uint8_t, 32> palette;
+  std::array<uint8_t, 256> oam;
+  uint64_t frame;
+
+  // tile cache, one byte per pixel holding the 2-bit pattern value
+  std::array<std::array<uint8_t, 64>, TILE_COUNT> tiles;
+  std::array<bool, TILE_COUNT> tile_valid;
+  std::array<const uint8_t *, 8> cached_chr_banks;
+  uint32_t cached_chr_generation;
+  uint64_t tiles_decoded;
+
+  // scanline buffers
+  std::array<uint8_t, WIDTH + 16> background;
+  std::array<uint8_t, WIDTH> line;
+
+  const uint8_t *tile_row(uint16_t tile, uint8_t row);
+  void decode_tile(uint16_t tile);
+  void sync_tile_cache();
+
+  uint8_t *nametable(uint16_t addr);
+  uint8_t palette_index(uint16_t addr) const;
+
+  void run_to(uint64_t target);
+  uint16_t next_event() const;
+  void run_event();
+  uint16_t line_length() const;
+  bool skips_dot() const;
+  uint32_t dots_until_vblank() const;
+  uint32_t dots_until_scanline_clock() const;
+  void raise(uint8_t id);
+
+  void render_background(uint16_t y);
+  void render_sprites(uint16_t y);
+  void increment_y();
+
+  static uint8_t register_read(void *context, uint16_t addr, uint64_t cycle);
+  static void register_write(void *context, uint16_t addr, uint8_t data,
+                             uint64_t cycle);
+  static void sync(void *context, uint64_t cycle);
+};
@@ -0,0 +1,61 @@
+#include "scheduler.hpp"
+#include "../error/error.hpp"
+
+namespace {
+void ignore_event(void *, uint64_t) {}
+} // namespace
+
+Scheduler::Scheduler() : count(event::IRQ + 1), deadline(NEVER) {
+  slots.fill({NEVER, ignore_event, nullptr});
+}
+
+void Scheduler::set_handler(uint8_t id, Handler handler, void *context) {
+  slots[id].handler = handler;
+  slots[id].context = context;
+}
+
+uint8_t Scheduler::add_event(Handler handler, void *context) {
+  if (count == MAX_EVENTS) {
+    error::fail("too many scheduler events");
+  }
+
+  slots[count] = {NEVER, handler, context};
+  return count++;
+}
+
+void Scheduler::schedule(uint8_t id, uint64_t cycle) {
+  slots[id].cycle = cycle;
+  if (cycle < deadline) {
+    deadline = cycle;
+  } else {
+    update_deadline();
+  }
+}
+
+void Scheduler::cancel(uint8_t id) { schedule(id, NEVER); }
+
+void Scheduler::run_due(uint64_t cycle) {
+  while (deadline <= cycle) {
+    // the slot order breaks ties, so NMI goes before IRQ before devices
+    uint8_t next = 0;
+    for (uint8_t id = 1; id < count; ++id) {
+      if (slots[id].cycle < slots[next].cycle) {
+        next = id;
+      }
+    }
+
+    Slot &slot = slots[next];
+    slot.cycle = NEVER;
+    update_deadline();
+    slot.handler(slot.context, cycle);
+  }
+}
+
+void Scheduler::update_deadline() {
+  deadline = NEVER;
+  for (uint8_t id = 0; id < count; ++id) {
+    if (slots[id].cycle < deadline) {
+      deadline = slots[id].cycle;
+    }
+  }
+}
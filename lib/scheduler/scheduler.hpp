@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// ids of the interrupt events, the system sets their handlers
+namespace event {
+constexpr uint8_t NMI = 0;
+constexpr uint8_t IRQ = 1;
+} // namespace event
+
+// timestamped events in a fixed array of slots, one per source. the CPU runs
+// until its cycle counter reaches the earliest deadline and only then are the
+// due events handled, so nothing is polled per instruction
+//
+// a device gets a slot with add_event and (re)schedules it for a CPU cycle.
+// handlers are passed the current cycle, which can be past the deadline by
+// up to an instruction, and may schedule events again (even for that cycle)
+class Scheduler {
+public:
+  using Handler = void (*)(void *context, uint64_t cycle);
+
+  static constexpr uint8_t MAX_EVENTS = 8;
+  static constexpr uint64_t NEVER = UINT64_MAX;
+
+  Scheduler();
+
+  // sets the handler of a fixed event (NMI, IRQ)
+  void set_handler(uint8_t id, Handler handler, void *context);
+  // adds an event for a device and returns its id, fails (error::fail) when
+  // full
+  uint8_t add_event(Handler handler, void *context);
+
+  // an event is pending once, scheduling it again moves it
+  void schedule(uint8_t id, uint64_t cycle);
+  void cancel(uint8_t id);
+  uint64_t get_cycle(uint8_t id) const { return slots[id].cycle; }
+
+  // the earliest deadline, stays valid while events move
+  const uint64_t &get_deadline() const { return deadline; }
+  // runs every event due at `cycle`, earliest first
+  void run_due(uint64_t cycle);
+
+private:
+  struct Slot {
+    uint64_t cycle;
+    Handler handler;
+    void *context;
+  };
+
+  std::array<Slot, MAX_EVENTS> slots;
+  uint8_t count;
+  uint64_t deadline;
+
+  void update_deadline();
+};
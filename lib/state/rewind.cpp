@@ -0,0 +1,226 @@
+#include "rewind.hpp"
+#include "../cpu/cpu.hpp"
+#include "../error/error.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// a control byte below 0x80 is followed by that many + 1 literal bytes, from
+// 0x80 up it is followed by one byte repeated that many - 0x80 + 3 times
+constexpr uint32_t MAX_LITERALS = 0x80;
+constexpr uint32_t MIN_RUN = 3;
+constexpr uint32_t MAX_RUN = 0x7f + MIN_RUN;
+
+size_t max_packed_size(size_t size) {
+  return size + (size + MAX_LITERALS - 1) / MAX_LITERALS;
+}
+
+// encodes data XOR base, or data alone when there is no base
+size_t pack(const uint8_t *data, const uint8_t *base, size_t size,
+            uint8_t *out) {
+  auto value = [&](size_t i) -> uint8_t {
+    return base != nullptr ? data[i] ^ base[i] : data[i];
+  };
+
+  size_t written = 0;
+  size_t literals = 0;
+  auto flush = [&](size_t end) {
+    while (literals < end) {
+      auto length = std::min<size_t>(end - literals, MAX_LITERALS);
+      out[written++] = static_cast<uint8_t>(length - 1);
+      for (size_t i = 0; i < length; ++i) {
+        out[written++] = value(literals + i);
+      }
+      literals += length;
+    }
+  };
+
+  size_t i = 0;
+  while (i < size) {
+    uint8_t repeated = value(i);
+    size_t run = 1;
+    while (i + run < size && run < MAX_RUN && value(i + run) == repeated) {
+      run++;
+    }
+
+    if (run >= MIN_RUN) {
+      flush(i);
+      out[written++] = static_cast<uint8_t>(0x80 + run - MIN_RUN);
+      out[written++] = repeated;
+      literals = i + run;
+    }
+    i += run;
+  }
+  flush(size);
+  return written;
+}
+
+// decodes into out, XORing with what is there when `delta`
+void unpack(const uint8_t *in, size_t size, uint8_t *out, size_t out_size,
+            bool delta) {
+  size_t read = 0;
+  size_t written = 0;
+  while (read < size) {
+    uint8_t control = in[read++];
+    bool run = control >= 0x80;
+    size_t length = run ? control - 0x80 + MIN_RUN : control + 1u;
+    if (out_size - written < length || size - read < (run ? 1 : length)) {
+      error::fail("corrupt rewind entry");
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+      uint8_t value = in[run ? read : read + i];
+      out[written + i] = delta ? out[written + i] ^ value : value;
+    }
+    read += run ? 1 : length;
+    written += length;
+  }
+}
+} // namespace
+
+Rewind::Rewind(size_t budget, uint32_t seconds, uint32_t keyframe_interval)
+    : ring(budget), entries(seconds * FRAMES_PER_SECOND), first(0), count(0),
+      keyframe_interval(keyframe_interval), since_keyframe(0) {
+  if (entries.empty() || keyframe_interval == 0) {
+    error::fail("rewind needs a length and a keyframe interval");
+  }
+}
+
+void Rewind::push(CPU &cpu) { push(cpu.save_state(state::Kind::Snapshot)); }
+
+void Rewind::push(const std::vector<uint8_t> &snapshot) {
+  bool keyframe = count == 0 || since_keyframe + 1 >= keyframe_interval ||
+                  snapshot.size() != newest.size();
+  if (packed.size() < max_packed_size(snapshot.size())) {
+    packed.resize(max_packed_size(snapshot.size()));
+  }
+
+  auto size = static_cast<uint32_t>(
+      pack(snapshot.data(), keyframe ? nullptr : newest.data(),
+           snapshot.size(), packed.data()));
+  uint32_t offset = make_room(size);
+  // the room was made by dropping the snapshot this one is a delta of
+  if (count == 0 && !keyframe) {
+    keyframe = true;
+    size = static_cast<uint32_t>(
+        pack(snapshot.data(), nullptr, snapshot.size(), packed.data()));
+    offset = make_room(size);
+  }
+
+  std::memcpy(ring.data() + offset, packed.data(), size);
+  count++;
+  entry(count - 1) = {offset, size, static_cast<uint32_t>(snapshot.size()),
+                      keyframe};
+  newest = snapshot;
+  since_keyframe = keyframe ? 0 : since_keyframe + 1;
+
+  stats.pushes++;
+  stats.keyframes += keyframe;
+  stats.raw_bytes += snapshot.size();
+  stats.stored_bytes += size;
+}
+
+bool Rewind::rewind(CPU &cpu) {
+  if (!rewind(popped)) {
+    return false;
+  }
+
+  cpu.load_state(popped);
+  return true;
+}
+
+bool Rewind::rewind(std::vector<uint8_t> &snapshot) {
+  if (count == 0) {
+    return false;
+  }
+
+  snapshot = newest;
+  Entry last = entry(count - 1);
+  count--;
+
+  // the snapshot before it becomes the newest one
+  uint32_t decoded = 0;
+  if (count > 0 && !last.keyframe) {
+    decode(last, newest);
+    decoded = 1;
+    since_keyframe--;
+  } else if (count > 0) {
+    uint32_t keyframe = count - 1;
+    while (!entry(keyframe).keyframe) {
+      keyframe--;
+    }
+    for (uint32_t i = keyframe; i < count; ++i) {
+      decode(entry(i), newest);
+    }
+    decoded = count - keyframe;
+    since_keyframe = count - 1 - keyframe;
+  }
+
+  stats.rewinds++;
+  stats.last_step_decoded = decoded;
+  stats.max_step_decoded = std::max(stats.max_step_decoded, decoded);
+  return true;
+}
+
+void Rewind::clear() {
+  count = 0;
+  since_keyframe = 0;
+}
+
+size_t Rewind::bytes_used() const {
+  size_t used = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    used += entries[(first + i) % entries.size()].size;
+  }
+  return used;
+}
+
+uint32_t Rewind::make_room(uint32_t size) {
+  if (size > ring.size()) {
+    error::fail("rewind budget is smaller than a snapshot");
+  }
+
+  while (count > 0) {
+    if (count < entries.size()) {
+      const Entry &oldest = entry(0);
+      const Entry &last = entry(count - 1);
+      uint32_t head = last.offset + last.size;
+      uint32_t tail = oldest.offset;
+
+      // in one piece, free space after the newest entry and before the oldest
+      if (tail < head) {
+        if (ring.size() - head >= size) {
+          return head;
+        }
+        if (tail >= size) {
+          return 0;
+        }
+      } else if (tail - head >= size) {
+        return head;
+      }
+    }
+    evict_oldest();
+  }
+  return 0;
+}
+
+// the deltas after the oldest keyframe can't be decoded without it
+void Rewind::evict_oldest() {
+  do {
+    first = (first + 1) % entries.size();
+    count--;
+    stats.evicted++;
+  } while (count > 0 && !entry(0).keyframe);
+
+  if (count == 0) {
+    since_keyframe = 0;
+  }
+}
+
+void Rewind::decode(const Entry &at, std::vector<uint8_t> &snapshot) {
+  if (at.keyframe) {
+    snapshot.resize(at.raw_size);
+  }
+  unpack(ring.data() + at.offset, at.size, snapshot.data(), snapshot.size(),
+         !at.keyframe);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CPU;
+
+struct RewindStats {
+  // snapshots pushed, and how many of them were stored whole
+  uint64_t pushes = 0;
+  uint64_t keyframes = 0;
+  // snapshots popped by rewind
+  uint64_t rewinds = 0;
+  // snapshots dropped, oldest first, to make room
+  uint64_t evicted = 0;
+  // bytes of snapshots pushed, and what they took in the ring
+  uint64_t raw_bytes = 0;
+  uint64_t stored_bytes = 0;
+  // entries decoded by the last rewind and the worst one so far: 1 after a
+  // delta, up to the keyframe interval after a keyframe
+  uint32_t last_step_decoded = 0;
+  uint32_t max_step_decoded = 0;
+
+  double compression() const {
+    return stored_bytes == 0 ? 0.0
+                             : static_cast<double>(raw_bytes) / stored_bytes;
+  }
+};
+
+// the last few seconds of snapshots, in a ring of a fixed number of bytes
+//
+// a snapshot is stored as the run-length encoded XOR with the one before it,
+// mostly zeros since a frame only writes a few pages. every `keyframe_interval`
+// snapshots (and whenever the size changes) one is stored whole instead
+//
+// the newest snapshot is kept decoded. rewinding loads it and works out the
+// one before it: XOR with the delta it was stored as, or when it was a
+// keyframe, decoding forward from the previous keyframe. the oldest keyframe
+// and its deltas are dropped together when the ring is full
+class Rewind {
+public:
+  static constexpr uint32_t FRAMES_PER_SECOND = 60;
+
+  // `budget` bytes of snapshots, at most `seconds` of them
+  Rewind(size_t budget, uint32_t seconds, uint32_t keyframe_interval = 30);
+
+  // takes a snapshot of the CPU and its bus, once a frame
+  void push(CPU &cpu);
+  void push(const std::vector<uint8_t> &snapshot);
+  // loads the newest snapshot into the CPU and drops it, false when there is
+  // none left
+  bool rewind(CPU &cpu);
+  bool rewind(std::vector<uint8_t> &snapshot);
+  void clear();
+
+  uint32_t frames() const { return count; }
+  double seconds() const {
+    return static_cast<double>(count) / FRAMES_PER_SECOND;
+  }
+  size_t bytes_used() const;
+
+  RewindStats stats;
+
+private:
+  struct Entry {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t raw_size;
+    bool keyframe;
+  };
+
+  std::vector<uint8_t> ring;
+  // oldest first, `first` is the oldest one's index
+  std::vector<Entry> entries;
+  uint32_t first;
+  uint32_t count;
+  uint32_t keyframe_interval;
+  uint32_t since_keyframe;
+  // the newest snapshot, decoded
+  std::vector<uint8_t> newest;
+  // scratch space for push / rewind, kept to not allocate every frame
+  std::vector<uint8_t> packed;
+  std::vector<uint8_t> popped;
+
+  Entry &entry(uint32_t index) {
+    return entries[(first + index) % entries.size()];
+  }
+  // where an entry of `size` bytes goes once the oldest entries in the way
+  // are dropped
+  uint32_t make_room(uint32_t size);
+  void evict_oldest();
+  void decode(const Entry &at, std::vector<uint8_t> &snapshot);
+};
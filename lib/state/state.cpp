@@ -0,0 +1,129 @@
+#include "state.hpp"
+#include "../error/error.hpp"
+#include <cstring>
+
+namespace {
+constexpr uint32_t MAGIC = state::tag("NESS");
+constexpr size_t HEADER_SIZE = 12;
+constexpr size_t SECTION_HEADER_SIZE = 8;
+
+void put_u32(uint8_t *at, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    at[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+uint32_t get_u32(const uint8_t *at) {
+  return at[0] | at[1] << 8 | at[2] << 16 | static_cast<uint32_t>(at[3]) << 24;
+}
+} // namespace
+
+StateWriter::StateWriter(state::Kind kind, uint32_t sequence)
+    : kind(kind), sequence(sequence), section_start(0) {
+  write_u32(MAGIC);
+  write_u16(state::VERSION);
+  write_u8(static_cast<uint8_t>(kind));
+  write_u8(0);
+  write_u32(sequence);
+}
+
+void StateWriter::begin_section(uint32_t tag) {
+  write_u32(tag);
+  write_u32(0);
+  section_start = buffer.size();
+}
+
+void StateWriter::end_section() {
+  put_u32(buffer.data() + section_start - 4,
+          static_cast<uint32_t>(buffer.size() - section_start));
+}
+
+void StateWriter::write_u8(uint8_t value) { buffer.push_back(value); }
+
+void StateWriter::write_u16(uint16_t value) {
+  write_u8(static_cast<uint8_t>(value));
+  write_u8(static_cast<uint8_t>(value >> 8));
+}
+
+void StateWriter::write_u32(uint32_t value) {
+  write_u16(static_cast<uint16_t>(value));
+  write_u16(static_cast<uint16_t>(value >> 16));
+}
+
+void StateWriter::write_u64(uint64_t value) {
+  write_u32(static_cast<uint32_t>(value));
+  write_u32(static_cast<uint32_t>(value >> 32));
+}
+
+void StateWriter::write_bytes(const uint8_t *bytes, size_t size) {
+  buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+StateReader::StateReader(const uint8_t *data, size_t size)
+    : data(data), size(size), kind(state::Kind::Full), sequence(0),
+      position(0), end(0) {
+  if (size < HEADER_SIZE || get_u32(data) != MAGIC) {
+    error::fail("not a save state");
+  }
+  if ((data[4] | data[5] << 8) != state::VERSION) {
+    error::fail("unsupported save state version");
+  }
+  if (data[6] > static_cast<uint8_t>(state::Kind::Snapshot)) {
+    error::fail("unknown save state kind");
+  }
+  kind = static_cast<state::Kind>(data[6]);
+  sequence = get_u32(data + 8);
+
+  // the sections have to tile the rest of the data exactly
+  size_t at = HEADER_SIZE;
+  while (at < size) {
+    if (size - at < SECTION_HEADER_SIZE ||
+        size - at - SECTION_HEADER_SIZE < get_u32(data + at + 4)) {
+      error::fail("truncated save state");
+    }
+    at += SECTION_HEADER_SIZE + get_u32(data + at + 4);
+  }
+}
+
+bool StateReader::find_section(uint32_t tag) {
+  size_t at = HEADER_SIZE;
+  while (at < size) {
+    uint32_t length = get_u32(data + at + 4);
+    if (get_u32(data + at) == tag) {
+      position = at + SECTION_HEADER_SIZE;
+      end = position + length;
+      return true;
+    }
+    at += SECTION_HEADER_SIZE + length;
+  }
+
+  position = end = 0;
+  return false;
+}
+
+const uint8_t *StateReader::take(size_t count) {
+  if (end - position < count) {
+    error::fail("save state section too short");
+  }
+  const uint8_t *at = data + position;
+  position += count;
+  return at;
+}
+
+uint8_t StateReader::read_u8() { return *take(1); }
+
+uint16_t StateReader::read_u16() {
+  const uint8_t *at = take(2);
+  return static_cast<uint16_t>(at[0] | at[1] << 8);
+}
+
+uint32_t StateReader::read_u32() { return get_u32(take(4)); }
+
+uint64_t StateReader::read_u64() {
+  uint64_t low = read_u32();
+  return low | static_cast<uint64_t>(read_u32()) << 32;
+}
+
+void StateReader::read_bytes(uint8_t *bytes, size_t size) {
+  std::memcpy(bytes, take(size), size);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// save states are a header followed by tagged sections, one or more per
+// component:
+//
+//   header   "NESS", u16 version, u8 kind, u8 0, u32 sequence
+//   section  u32 tag, u32 size, `size` bytes
+//
+// everything is little endian. a reader skips the sections it doesn't know,
+// so components can add theirs without breaking older states
+//
+// a full state holds everything. a delta only holds what changed since the
+// state numbered `sequence - 1` (ex: the RAM pages written to since), and is
+// applied on top of it. a snapshot holds everything too, but is kept out of
+// that numbering: saving or loading one doesn't change what the next delta
+// is taken against (rewind, run-ahead)
+namespace state {
+constexpr uint16_t VERSION = 1;
+
+enum class Kind : uint8_t { Full, Delta, Snapshot };
+
+// four characters packed the way they are stored
+constexpr uint32_t tag(const char (&name)[5]) {
+  return static_cast<uint8_t>(name[0]) |
+         static_cast<uint8_t>(name[1]) << 8 |
+         static_cast<uint8_t>(name[2]) << 16 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[3])) << 24;
+}
+} // namespace state
+
+class StateWriter {
+public:
+  StateWriter(state::Kind kind, uint32_t sequence);
+
+  state::Kind get_kind() const { return kind; }
+  uint32_t get_sequence() const { return sequence; }
+
+  // sections can't nest, the size is filled in by end_section
+  void begin_section(uint32_t tag);
+  void end_section();
+
+  void write_u8(uint8_t value);
+  void write_u16(uint16_t value);
+  void write_u32(uint32_t value);
+  void write_u64(uint64_t value);
+  void write_bytes(const uint8_t *bytes, size_t size);
+
+  const std::vector<uint8_t> &data() const { return buffer; }
+  std::vector<uint8_t> take() { return std::move(buffer); }
+
+private:
+  std::vector<uint8_t> buffer;
+  state::Kind kind;
+  uint32_t sequence;
+  size_t section_start;
+};
+
+// reads a state in place, the data has to outlive the reader. malformed data
+// (bad magic, unknown version, sections running past the end) fails
+// (error::fail)
+class StateReader {
+public:
+  StateReader(const uint8_t *data, size_t size);
+  explicit StateReader(const std::vector<uint8_t> &data)
+      : StateReader(data.data(), data.size()) {}
+
+  state::Kind get_kind() const { return kind; }
+  uint32_t get_sequence() const { return sequence; }
+
+  // moves to the first section with the tag, false when there is none
+  bool find_section(uint32_t tag);
+  // reading past the end of the current section fails (error::fail)
+  uint8_t read_u8();
+  uint16_t read_u16();
+  uint32_t read_u32();
+  uint64_t read_u64();
+  void read_bytes(uint8_t *bytes, size_t size);
+  size_t remaining() const { return end - position; }
+
+private:
+  const uint8_t *data;
+  size_t size;
+  state::Kind kind;
+  uint32_t sequence;
+  // the current section
+  size_t position;
+  size_t end;
+
+  const uint8_t *take(size_t count);
+};
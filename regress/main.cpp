@@ -0,0 +1,184 @@
+#include "../lib/batch/rom_test.hpp"
+#include "../lib/batch/work_pool.hpp"
+#include "../lib/pipeline/worker.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// what the manifest says about a ROM, on top of the defaults
+struct Entry {
+  uint32_t frames = 0;
+  uint64_t cycles = 0;
+  bool has_hash = false;
+  uint64_t hash = 0;
+};
+
+static const char *MANIFEST = "regress.txt";
+
+static void usage(const char *program) {
+  std::fprintf(
+      stderr,
+      "usage: %s [--jobs N] [--frames N] [--cycles N] [--record FILE] DIR\n"
+      "  --jobs N       threads, one per core by default\n"
+      "  --frames N     frame limit per ROM (default 3600)\n"
+      "  --cycles N     CPU cycle limit per ROM, none by default\n"
+      "  --record FILE  runs every ROM in hash mode and writes a manifest\n"
+      "                 with the hashes to FILE\n",
+      program);
+}
+
+// lines of `ROM [frames=N] [cycles=N] [hash=HEX]`, the ROM relative to the
+// directory, # starts a comment
+static std::map<std::string, Entry> read_manifest(const fs::path &path) {
+  std::map<std::string, Entry> entries;
+  std::ifstream file(path);
+  std::string line;
+
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::string rom, word;
+    if (!(words >> rom)) {
+      continue;
+    }
+
+    Entry &entry = entries[rom];
+    while (words >> word) {
+      const char *value = word.c_str() + word.find('=') + 1;
+      if (word.rfind("frames=", 0) == 0) {
+        entry.frames = std::strtoul(value, nullptr, 10);
+      } else if (word.rfind("cycles=", 0) == 0) {
+        entry.cycles = std::strtoull(value, nullptr, 10);
+      } else if (word.rfind("hash=", 0) == 0) {
+        entry.has_hash = true;
+        entry.hash = std::strtoull(value, nullptr, 16);
+      } else {
+        std::fprintf(stderr, "%s: unknown option %s for %s\n",
+                     path.c_str(), word.c_str(), rom.c_str());
+      }
+    }
+  }
+  return entries;
+}
+
+// every .nes file under the directory, sorted so runs line up
+static std::vector<std::string> find_roms(const fs::path &dir) {
+  std::vector<std::string> roms;
+  for (const auto &file : fs::recursive_directory_iterator(dir)) {
+    if (file.is_regular_file() && file.path().extension() == ".nes") {
+      roms.push_back(fs::relative(file.path(), dir).generic_string());
+    }
+  }
+  std::sort(roms.begin(), roms.end());
+  return roms;
+}
+
+// the ROM's message on one line
+static std::string one_line(std::string message) {
+  std::replace(message.begin(), message.end(), '\n', ' ');
+  return message;
+}
+
+// runs every ROM in a directory, each on an emulator of its own, across all
+// cores. a ROM is judged by the $6000 result protocol, or with a hash of its
+// RAM and picture after a number of frames when the manifest gives one.
+// exits with 1 if any ROM did not pass
+int main(int argc, char **argv) {
+  unsigned jobs = 0;
+  uint32_t frames = 3600;
+  uint64_t cycles = 0;
+  const char *record_path = nullptr;
+  const char *dir = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      jobs = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      cycles = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (argv[i][0] == '-' || dir != nullptr) {
+      usage(argv[0]);
+      return 1;
+    } else {
+      dir = argv[i];
+    }
+  }
+  if (dir == nullptr || !fs::is_directory(dir)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<std::string> roms = find_roms(dir);
+  std::map<std::string, Entry> manifest =
+      read_manifest(fs::path(dir) / MANIFEST);
+  std::vector<RomTest> tests;
+  for (const auto &rom : roms) {
+    const Entry &entry = manifest[rom];
+    RomTest test{(fs::path(dir) / rom).string(),
+                 entry.frames > 0 ? entry.frames : frames,
+                 entry.cycles > 0 ? entry.cycles : cycles,
+                 record_path != nullptr || entry.has_hash,
+                 record_path == nullptr && entry.has_hash, entry.hash};
+    tests.push_back(test);
+  }
+
+  WorkPool pool(jobs);
+  uint64_t start = Worker::now_us();
+  std::vector<RomResult> results = run_rom_tests(tests, pool);
+  uint64_t wall_us = Worker::now_us() - start;
+
+  size_t passed = 0;
+  uint64_t rom_us = 0;
+  for (size_t i = 0; i < roms.size(); ++i) {
+    const RomResult &result = results[i];
+    passed += result.verdict == Verdict::Pass ||
+              result.verdict == Verdict::Recorded;
+    rom_us += result.wall_us;
+
+    std::printf("%-8s %9.1f ms %6" PRIu32 " frames  %s",
+                verdict_name(result.verdict), result.wall_us / 1e3,
+                result.frames, roms[i].c_str());
+    if (result.verdict == Verdict::Fail) {
+      std::printf("  (#%u)", result.code);
+    }
+    if (!result.message.empty()) {
+      std::printf("  %s", one_line(result.message).c_str());
+    }
+    std::printf("\n");
+  }
+  std::printf("%zu of %zu passed in %.2f s on %u thread%s (%.2f s of ROM "
+              "time, %" PRIu64 " steals)\n",
+              passed, roms.size(), wall_us / 1e6, pool.get_threads(),
+              pool.get_threads() == 1 ? "" : "s", rom_us / 1e6,
+              pool.get_steals());
+
+  if (record_path != nullptr) {
+    std::FILE *file = std::fopen(record_path, "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "failed to write %s\n", record_path);
+      return 1;
+    }
+    for (size_t i = 0; i < roms.size(); ++i) {
+      if (results[i].verdict != Verdict::Recorded) {
+        continue;
+      }
+      std::fprintf(file, "%s frames=%" PRIu32 " hash=%016" PRIx64 "\n",
+                   roms[i].c_str(), tests[i].frames, results[i].hash);
+    }
+    std::fclose(file);
+  }
+  return passed == roms.size() ? 0 : 1;
+}
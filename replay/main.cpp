@@ -0,0 +1,140 @@
+#include "../lib/input/movie.hpp"
+#include "../lib/nes/nes.hpp"
+#include "../lib/pipeline/worker.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// NTSC: a frame is 262 lines of 341 dots, 3 dots a CPU cycle
+static const double FRAME_RATE =
+    APU::CLOCK_RATE / (PPU::LINES_PER_FRAME * PPU::DOTS_PER_LINE /
+                       static_cast<double>(PPU::DOTS_PER_CYCLE));
+
+static void usage(const char *program) {
+  std::fprintf(
+      stderr,
+      "usage: %s ROM MOVIE\n"
+      "       %s --record FRAMES [--hash-interval N] ROM MOVIE\n"
+      "  replays the movie headless as fast as it runs, checking the RAM\n"
+      "  hashes it holds. --record writes a movie of FRAMES frames of\n"
+      "  random input instead, with a hash every N frames (default 1)\n",
+      program, program);
+}
+
+static bool read_file(const char *path, std::vector<uint8_t> &data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  data.assign(std::istreambuf_iterator<char>(file), {});
+  return true;
+}
+
+// buttons held for a random number of frames, like a player mashing through
+// a game, so runs of every length end up in the movie
+static int record(NES &nes, uint32_t frames, uint16_t hash_interval,
+                  const char *path) {
+  MovieRecorder recorder(nes, hash_interval);
+  uint32_t seed = 1;
+  uint32_t hold = 0;
+  for (uint32_t frame = 0; frame < frames; ++frame) {
+    if (hold == 0) {
+      seed = seed * 1664525 + 1013904223;
+      hold = (seed >> 26) + 1;
+      nes.get_controllers().set_buttons(0, seed >> 8);
+    }
+    hold--;
+    nes.run_frame();
+    recorder.record_frame();
+  }
+
+  std::vector<uint8_t> movie = recorder.encode();
+  std::FILE *file = std::fopen(path, "wb");
+  if (file == nullptr) {
+    std::fprintf(stderr, "failed to write %s\n", path);
+    return 1;
+  }
+  std::fwrite(movie.data(), 1, movie.size(), file);
+  std::fclose(file);
+  std::printf("%" PRIu32 " frames, %zu bytes\n", frames, movie.size());
+  return 0;
+}
+
+// nothing is drawn or heard: without handlers the PPU and the APU hand
+// their output to no one. scanlines are still rendered, sprite 0 hits
+// depend on them
+static int replay(NES &nes, const std::vector<uint8_t> &data) {
+  MoviePlayer player(data);
+  if (!player.matches_start(nes)) {
+    std::fprintf(stderr, "the movie was recorded on another ROM\n");
+    return 1;
+  }
+
+  uint64_t start = Worker::now_us();
+  MoviePlayer::Step step;
+  do {
+    step = player.play_frame(nes);
+  } while (step == MoviePlayer::Step::Ran);
+  double seconds = (Worker::now_us() - start) / 1e6;
+
+  uint32_t frames = player.get_frame();
+  double fps = frames / seconds;
+  std::printf("%" PRIu32 " frames in %.3f s, %.0f fps, %.1fx real time\n",
+              frames, seconds, fps, fps / FRAME_RATE);
+  if (step == MoviePlayer::Step::Desync) {
+    std::printf("desync: the RAM after frame %" PRIu32
+                " doesn't match the recording\n",
+                frames);
+    return 1;
+  }
+  uint16_t interval = player.get_hash_interval();
+  std::printf("%" PRIu32 " RAM hashes matched\n",
+              interval > 0 ? frames / interval : 0);
+  return 0;
+}
+
+// replays a movie recorded on the device, or records one
+int main(int argc, char **argv) {
+  uint32_t record_frames = 0;
+  uint16_t hash_interval = 1;
+  std::vector<const char *> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_frames = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--hash-interval") == 0 && i + 1 < argc) {
+      hash_interval = std::strtoul(argv[++i], nullptr, 10);
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 1;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.size() != 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    NES nes(RomImage::map_file(paths[0]));
+    if (record_frames > 0) {
+      return record(nes, record_frames, hash_interval, paths[1]);
+    }
+
+    std::vector<uint8_t> data;
+    if (!read_file(paths[1], data)) {
+      std::fprintf(stderr, "failed to read %s\n", paths[1]);
+      return 1;
+    }
+    return replay(nes, data);
+  } catch (const std::exception &error) {
+    std::fprintf(stderr, "%s\n", error.what());
+    return 1;
+  }
+}
@@ -1,12 +1,59 @@
+#include "../lib/display/display.hpp"
+#include "../lib/nes/nes.hpp"
+#include "../lib/pipeline/pipeline.hpp"
 #include "Arduino.h"
+#include <exception>
+
+namespace {
+// the game is flashed into a data partition, ex:
+// parttool.py write_partition --partition-name rom --input game.nes
+constexpr const char *ROM_PARTITION = "rom";
+
+NES *nes = nullptr;
+Pipeline *pipeline = nullptr;
+// no panel driver yet, what it would be sent is only counted
+CountingDisplay display;
+DisplayOutput *output = nullptr;
+uint64_t last_presented = 0;
+uint64_t last_bytes = 0;
+} // namespace
 
 void setup() {
   Serial.begin(115200);
   delay(1000);
-  Serial.println("hello, world!");
+
+#if defined(__cpp_exceptions)
+  try {
+    nes = new NES(RomImage::map_partition(ROM_PARTITION));
+  } catch (const std::exception &error) {
+    Serial.printf("failed to load the ROM: %s\n", error.what());
+    return;
+  }
+#else
+  // error::fail prints the reason and aborts
+  nes = new NES(RomImage::map_partition(ROM_PARTITION));
+#endif
+
+  // core 0 emulates, core 1 takes care of the output
+  pipeline = new Pipeline(*nes, Backpressure::Drop);
+  output = new DisplayOutput(display, ByteOrder::Big);
+  pipeline->set_line_sink(DisplayOutput::present, output);
+  pipeline->start();
 }
 
 void loop() {
-  Serial.println("loop running...");
   delay(1000);
-}
\ No newline at end of file
+  if (pipeline == nullptr) {
+    return;
+  }
+
+  const auto &stats = pipeline->get_stats();
+  uint64_t presented = stats.frames_presented.load();
+  uint64_t bytes = display.get_bytes();
+  Serial.printf("fps %llu, dropped %llu, max latency %llu us, display %llu "
+                "KiB/s\n",
+                presented - last_presented, stats.frames_dropped.load(),
+                stats.latency_max_us.load(), (bytes - last_bytes) / 1024);
+  last_presented = presented;
+  last_bytes = bytes;
+}
@@ -0,0 +1,20 @@
+#include "nrom_image.hpp"
+#include "../lib/cartridge/cartridge.hpp"
+#include <cstring>
+
+std::vector<uint8_t> nrom_image(const uint8_t *program, size_t size,
+                                uint16_t nmi_handler, uint16_t irq_handler) {
+  std::vector<uint8_t> image(ines::HEADER_SIZE + 2 * ines::PRG_ROM_UNIT);
+  std::memcpy(image.data(), "NES\x1a", 4);
+  image[4] = 2;
+
+  uint8_t *prg = image.data() + ines::HEADER_SIZE;
+  std::memcpy(prg, program, size);
+  prg[0x7ffa] = nmi_handler & 0xff;
+  prg[0x7ffb] = nmi_handler >> 8;
+  prg[0x7ffc] = 0x00;
+  prg[0x7ffd] = 0x80;
+  prg[0x7ffe] = irq_handler & 0xff;
+  prg[0x7fff] = irq_handler >> 8;
+  return image;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// NROM image of a test program: 32 KiB of PRG-ROM holding the program at
+// $8000, which it resets to. the NMI and IRQ vectors point at the handlers
+// given, or at $0000 when there are none
+std::vector<uint8_t> nrom_image(const uint8_t *program, size_t size,
+                                uint16_t nmi_handler = 0,
+                                uint16_t irq_handler = 0);
@@ -0,0 +1,196 @@
+#include "../lib/apu/apu.hpp"
+#include "../lib/bus/bus.hpp"
+#include "../lib/nes/nes.hpp"
+#include "nrom_image.hpp"
+#include <cstdint>
+#include <unity.h>
+#include <vector>
+
+namespace {
+// a bit more than an NTSC frame
+constexpr uint32_t FRAME_CYCLES = 29781;
+
+struct Recorder {
+  std::vector<int16_t> samples;
+
+  static void record(void *context, const int16_t *samples, size_t count) {
+    auto &out = static_cast<Recorder *>(context)->samples;
+    out.insert(out.end(), samples, samples + count);
+  }
+};
+
+void run_frames(APU &apu, uint64_t &cycle, int frames) {
+  for (int frame = 0; frame < frames; ++frame) {
+    cycle += FRAME_CYCLES;
+    apu.end_frame(cycle);
+  }
+}
+
+// rising edges through 0, the high-pass keeps the wave centered. the
+// threshold steps over the ringing of the band-limited steps
+uint32_t rising_edges(const std::vector<int16_t> &samples) {
+  constexpr int16_t THRESHOLD = 500;
+  uint32_t edges = 0;
+  bool high = true;
+  for (int16_t sample : samples) {
+    if (high && sample < -THRESHOLD) {
+      high = false;
+    } else if (!high && sample > THRESHOLD) {
+      high = true;
+      edges++;
+    }
+  }
+  return edges;
+}
+
+// NROM test ROM: turns the APU frame IRQ on and spins with IRQs enabled. the
+// IRQ handler counts in $00 and acknowledges by reading $4015
+const uint8_t IRQ_PROGRAM[] = {
+    0x78,             // 8000: SEI
+    0xa9, 0x00,       // 8001: LDA #$00
+    0x8d, 0x17, 0x40, // 8003: STA $4017
+    0x58,             // 8006: CLI
+    0x4c, 0x07, 0x80, // 8007: JMP $8007
+    0xe6, 0x00,       // 800a: INC $00
+    0xad, 0x15, 0x40, // 800c: LDA $4015
+    0x40,             // 800f: RTI
+};
+constexpr uint16_t IRQ_HANDLER = 0x800a;
+} // namespace
+
+// -- synthesis
+void test_apu_sample_count() {
+  APU apu(44100);
+  Recorder recorder;
+  apu.set_sample_handler(Recorder::record, &recorder);
+  uint64_t cycle = 0;
+  run_frames(apu, cycle, 60);
+
+  // 60 frames of 29781 cycles are 0.9984 s
+  TEST_ASSERT_INT_WITHIN(1, 44029, recorder.samples.size());
+  TEST_ASSERT_EQUAL(recorder.samples.size(), apu.get_samples());
+  for (int16_t sample : recorder.samples) {
+    TEST_ASSERT_EQUAL_MESSAGE(0, sample, "silence expected");
+  }
+}
+void test_apu_pulse_pitch() {
+  APU apu(22050);
+  Recorder recorder;
+  apu.set_sample_handler(Recorder::record, &recorder);
+
+  // 1789773 / (16 * (253 + 1)) = 440.4 Hz, constant volume, 50% duty
+  apu.write_register(0x4015, 0x01);
+  apu.write_register(0x4000, 0xbf);
+  apu.write_register(0x4002, 253);
+  apu.write_register(0x4003, 0x08); // length 254, halted anyway
+  uint64_t cycle = 0;
+  run_frames(apu, cycle, 60);
+
+  TEST_ASSERT_INT_WITHIN(2, 439, rising_edges(recorder.samples));
+  int16_t peak = 0;
+  for (int16_t sample : recorder.samples) {
+    peak = std::max<int16_t>(peak, sample);
+  }
+  TEST_ASSERT_GREATER_THAN(1000, peak);
+}
+void test_apu_triangle_pitch() {
+  APU apu(44100);
+  Recorder recorder;
+  apu.set_sample_handler(Recorder::record, &recorder);
+
+  // 1789773 / (32 * (200 + 1)) = 278.3 Hz
+  apu.write_register(0x4015, 0x04);
+  apu.write_register(0x4008, 0xff);
+  apu.write_register(0x400a, 200);
+  apu.write_register(0x400b, 0x08);
+  uint64_t cycle = 0;
+  run_frames(apu, cycle, 60);
+
+  TEST_ASSERT_INT_WITHIN(2, 278, rising_edges(recorder.samples));
+}
+
+// -- frame counter
+void test_apu_length_counter() {
+  APU apu;
+  apu.write_register(0x4015, 0x0f);
+  apu.write_register(0x4000, 0x10);
+  apu.write_register(0x4003, 0x18); // length index 3: 2 half frames
+  apu.write_register(0x400f, 0x08); // noise, 254
+  TEST_ASSERT_EQUAL_HEX8(0x09, apu.read_register(APU::STATUS) & 0x0f);
+
+  apu.run_to(14914); // first half frame
+  TEST_ASSERT_EQUAL_HEX8(0x09, apu.read_register(APU::STATUS) & 0x0f);
+  apu.run_to(29830); // second one
+  TEST_ASSERT_EQUAL_HEX8(0x08, apu.read_register(APU::STATUS) & 0x0f);
+
+  apu.write_register(0x4015, 0x00);
+  TEST_ASSERT_EQUAL_HEX8(0x00, apu.read_register(APU::STATUS) & 0x0f);
+}
+void test_apu_frame_irq() {
+  APU apu;
+  apu.run_to(29828);
+  TEST_ASSERT_FALSE(apu.irq_pending());
+  apu.run_to(29830);
+  TEST_ASSERT_TRUE_MESSAGE(apu.irq_pending(), "frame IRQ not raised");
+
+  // reading the status acknowledges it
+  TEST_ASSERT_BITS_HIGH(0x40, apu.read_register(APU::STATUS));
+  TEST_ASSERT_FALSE(apu.irq_pending());
+
+  apu.write_register(APU::FRAME_COUNTER, 0x40);
+  apu.run_to(3 * 29830);
+  TEST_ASSERT_FALSE_MESSAGE(apu.irq_pending(), "inhibited IRQ raised");
+}
+void test_apu_dmc_irq() {
+  Bus bus;
+  std::vector<uint8_t> sample(Bus::PAGE_SIZE, 0xff);
+  bus.map_memory(0xc000, Bus::PAGE_SIZE, sample.data());
+  APU apu;
+  apu.attach(bus);
+  apu.write_register(APU::FRAME_COUNTER, 0x40);
+
+  apu.write_register(0x4010, 0x8f); // IRQ, fastest rate: 54 cycles a bit
+  apu.write_register(0x4012, 0x00);
+  apu.write_register(0x4013, 0x00); // 1 byte
+  apu.write_register(APU::STATUS, 0x10);
+  TEST_ASSERT_BITS_HIGH(0x10, apu.read_register(APU::STATUS));
+
+  // the byte is fetched once the first 8 (silent) bits have gone by
+  apu.run_to(8 * 54 + 1);
+  TEST_ASSERT_TRUE_MESSAGE(apu.irq_pending(), "DMC IRQ not raised");
+  TEST_ASSERT_EQUAL_HEX8(0x80, apu.read_register(APU::STATUS) & 0x90);
+
+  apu.write_register(APU::STATUS, 0x00);
+  TEST_ASSERT_FALSE(apu.irq_pending());
+}
+
+// -- system
+void test_apu_irq_reaches_cpu() {
+  auto image = nrom_image(IRQ_PROGRAM, sizeof(IRQ_PROGRAM), 0, IRQ_HANDLER);
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  for (int frame = 0; frame < 10; ++frame) {
+    nes.run_frame();
+  }
+
+  // one IRQ every 29830 cycles
+  uint64_t expected = nes.get_cpu().get_cycles() / 29830;
+  TEST_ASSERT_EQUAL_MESSAGE(expected, nes.get_cpu().mem_read(0x00),
+                            "IRQ count");
+  TEST_ASSERT_INT_WITHIN(1, 29781ull * 10 * 44100 / 1789773,
+                         nes.get_apu().get_samples());
+}
+
+void run_apu_tests() {
+  // synthesis
+  RUN_TEST(test_apu_sample_count);
+  RUN_TEST(test_apu_pulse_pitch);
+  RUN_TEST(test_apu_triangle_pitch);
+
+  // frame counter
+  RUN_TEST(test_apu_length_counter);
+  RUN_TEST(test_apu_frame_irq);
+  RUN_TEST(test_apu_dmc_irq);
+
+  // system
+  RUN_TEST(test_apu_irq_reaches_cpu);
+}
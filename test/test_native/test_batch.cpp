@@ -0,0 +1,244 @@
+#include "../lib/batch/rom_test.hpp"
+#include "../lib/batch/work_pool.hpp"
+#include "../lib/cartridge/cartridge.hpp"
+#include "nrom_image.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+namespace {
+// sets $6000 to running, then writes the signature
+const uint8_t PROLOGUE[] = {
+    0xa9, 0x80,       // 8000: LDA #$80
+    0x8d, 0x00, 0x60, // 8002: STA $6000
+    0xa9, 0xde,       // 8005: LDA #$de
+    0x8d, 0x01, 0x60, // 8007: STA $6001
+    0xa9, 0xb0,       // 800a: LDA #$b0
+    0x8d, 0x02, 0x60, // 800c: STA $6002
+    0xa9, 0x61,       // 800f: LDA #$61
+    0x8d, 0x03, 0x60, // 8011: STA $6003
+};
+
+// copies the message at $8040 to $6004, then sets the result at $8022
+const uint8_t REPORT[] = {
+    0xa2, 0x00,       // 8014: LDX #$00
+    0xbd, 0x40, 0x80, // 8016: LDA $8040,X
+    0x9d, 0x04, 0x60, // 8019: STA $6004,X
+    0xe8,             // 801c: INX
+    0xc9, 0x00,       // 801d: CMP #$00
+    0xd0, 0xf5,       // 801f: BNE $8016
+    0xa9, 0x00,       // 8021: LDA #result
+    0x8d, 0x00, 0x60, // 8023: STA $6000
+    0x4c, 0x26, 0x80, // 8026: JMP $8026
+};
+constexpr uint16_t RESULT = 0x8022;
+constexpr uint16_t MESSAGE = 0x8040;
+
+// asks for a reset, and passes once it had one (PRG-RAM outlives it)
+const uint8_t RESET[] = {
+    0xad, 0x10, 0x60, // 8014: LDA $6010
+    0xd0, 0x0b,       // 8017: BNE $8024
+    0xee, 0x10, 0x60, // 8019: INC $6010
+    0xa9, 0x81,       // 801c: LDA #$81
+    0x8d, 0x00, 0x60, // 801e: STA $6000
+    0x4c, 0x21, 0x80, // 8021: JMP $8021
+    0xa9, 0x00,       // 8024: LDA #$00
+    0x8d, 0x00, 0x60, // 8026: STA $6000
+    0x4c, 0x29, 0x80, // 8029: JMP $8029
+};
+
+// never reports, counts in $00-$01
+const uint8_t COUNT[] = {
+    0xe6, 0x00,       // 8014: INC $00
+    0xd0, 0xfc,       // 8016: BNE $8014
+    0xe6, 0x01,       // 8018: INC $01
+    0x4c, 0x14, 0x80, // 801a: JMP $8014
+};
+
+const uint8_t STOP[] = {
+    0x02, // 8014: STP
+};
+
+// NROM with 8 KiB of PRG-RAM, running the prologue and then the program
+template <size_t N>
+std::vector<uint8_t> make_image(const uint8_t (&program)[N]) {
+  std::vector<uint8_t> code(PROLOGUE, PROLOGUE + sizeof(PROLOGUE));
+  code.insert(code.end(), program, program + N);
+  return nrom_image(code.data(), code.size());
+}
+
+std::vector<uint8_t> make_report(uint8_t result, const char *message) {
+  auto image = make_image(REPORT);
+  uint8_t *prg = image.data() + ines::HEADER_SIZE;
+  prg[RESULT - 0x8000] = result;
+  std::strcpy(reinterpret_cast<char *>(prg + MESSAGE - 0x8000), message);
+  return image;
+}
+
+RomResult run(const std::vector<uint8_t> &image, const RomTest &test) {
+  return run_rom_test(RomImage::from_memory(image.data(), image.size()),
+                      test);
+}
+
+RomTest protocol_test(uint32_t frames, uint64_t cycles = 0) {
+  return {"", frames, cycles, false, false, 0};
+}
+
+RomTest hash_test(uint32_t frames, bool check = false, uint64_t hash = 0) {
+  return {"", frames, 0, true, check, hash};
+}
+
+struct Counts {
+  std::vector<std::atomic<int>> runs;
+  explicit Counts(size_t count) : runs(count) {}
+};
+
+void count_job(void *context, size_t index) {
+  static_cast<Counts *>(context)->runs[index]++;
+}
+
+// the even jobs all land on thread 0 and are slow
+void uneven_job(void *context, size_t index) {
+  if (index % 2 == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  count_job(context, index);
+}
+
+struct Consoles {
+  const std::vector<uint8_t> *image;
+  std::vector<RomResult> results;
+};
+
+void console_job(void *context, size_t index) {
+  auto *consoles = static_cast<Consoles *>(context);
+  consoles->results[index] =
+      run(*consoles->image, hash_test(20 + static_cast<uint32_t>(index)));
+}
+} // namespace
+
+// -- pool
+void test_work_pool_runs_every_job_once() {
+  WorkPool pool(4);
+  TEST_ASSERT_EQUAL(4, pool.get_threads());
+
+  // the same pool runs any number of batches
+  for (size_t count : {0, 1, 3, 1000}) {
+    Counts counts(count);
+    pool.run(count, count_job, &counts);
+    for (size_t i = 0; i < count; ++i) {
+      TEST_ASSERT_EQUAL_MESSAGE(1, counts.runs[i].load(), "job run count");
+    }
+  }
+}
+void test_work_pool_steals() {
+  WorkPool pool(2);
+  Counts counts(40);
+  pool.run(40, uneven_job, &counts);
+
+  for (size_t i = 0; i < 40; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(1, counts.runs[i].load(), "job run count");
+  }
+  // thread 1 is done with its fast jobs long before thread 0
+  TEST_ASSERT_GREATER_THAN(0, pool.get_steals());
+}
+
+// -- result protocol
+void test_rom_test_pass() {
+  auto result = run(make_report(0, "Passed\n"), protocol_test(60));
+  TEST_ASSERT_EQUAL(Verdict::Pass, result.verdict);
+  TEST_ASSERT_EQUAL(0, result.code);
+  TEST_ASSERT_EQUAL_STRING("Passed", result.message.c_str());
+  // reported in the first frame
+  TEST_ASSERT_EQUAL(1, result.frames);
+}
+void test_rom_test_fail() {
+  auto result = run(make_report(3, "\nbad timing\n\n"), protocol_test(60));
+  TEST_ASSERT_EQUAL(Verdict::Fail, result.verdict);
+  TEST_ASSERT_EQUAL(3, result.code);
+  TEST_ASSERT_EQUAL_STRING("\nbad timing", result.message.c_str());
+}
+void test_rom_test_reset() {
+  auto result = run(make_image(RESET), protocol_test(60));
+  TEST_ASSERT_EQUAL(Verdict::Pass, result.verdict);
+  // waited about 100 ms before the reset
+  TEST_ASSERT_GREATER_OR_EQUAL(6, result.frames);
+}
+void test_rom_test_limits() {
+  auto image = make_image(COUNT);
+  auto result = run(image, protocol_test(10));
+  TEST_ASSERT_EQUAL(Verdict::Timeout, result.verdict);
+  TEST_ASSERT_EQUAL(10, result.frames);
+
+  // a frame is 29780.67 cycles
+  result = run(image, protocol_test(10, 50000));
+  TEST_ASSERT_EQUAL(Verdict::Timeout, result.verdict);
+  TEST_ASSERT_EQUAL(2, result.frames);
+  TEST_ASSERT_GREATER_OR_EQUAL(50000, result.cycles);
+}
+void test_rom_test_errors() {
+  auto result = run(make_image(STOP), protocol_test(10));
+  TEST_ASSERT_EQUAL(Verdict::Error, result.verdict);
+  TEST_ASSERT_EQUAL_STRING("CPU stopped at $8014", result.message.c_str());
+  TEST_ASSERT_EQUAL(1, result.frames);
+
+#if defined(__cpp_exceptions)
+  RomTest missing = protocol_test(10);
+  missing.path = "/nonexistent/rom.nes";
+  TEST_ASSERT_EQUAL(Verdict::Error, run_rom_test(missing).verdict);
+#endif
+}
+
+// -- hashes
+void test_rom_test_hash() {
+  auto image = make_image(COUNT);
+  auto recorded = run(image, hash_test(30));
+  TEST_ASSERT_EQUAL(Verdict::Recorded, recorded.verdict);
+  TEST_ASSERT_EQUAL(30, recorded.frames);
+
+  auto again = run(image, hash_test(30, true, recorded.hash));
+  TEST_ASSERT_EQUAL(Verdict::Pass, again.verdict);
+  auto wrong = run(image, hash_test(30, true, recorded.hash ^ 1));
+  TEST_ASSERT_EQUAL(Verdict::Mismatch, wrong.verdict);
+  // the counter moved on
+  TEST_ASSERT_NOT_EQUAL(recorded.hash, run(image, hash_test(31)).hash);
+}
+void test_rom_tests_parallel_match_sequential() {
+  auto image = make_image(COUNT);
+  Consoles sequential{&image, std::vector<RomResult>(16)};
+  Consoles parallel{&image, std::vector<RomResult>(16)};
+  for (size_t i = 0; i < 16; ++i) {
+    console_job(&sequential, i);
+  }
+  WorkPool pool(4);
+  pool.run(16, console_job, &parallel);
+
+  for (size_t i = 0; i < 16; ++i) {
+    TEST_ASSERT_EQUAL_MESSAGE(sequential.results[i].hash,
+                              parallel.results[i].hash, "hash mismatch");
+    TEST_ASSERT_EQUAL_MESSAGE(sequential.results[i].cycles,
+                              parallel.results[i].cycles, "cycles mismatch");
+  }
+}
+
+void run_batch_tests() {
+  // pool
+  RUN_TEST(test_work_pool_runs_every_job_once);
+  RUN_TEST(test_work_pool_steals);
+
+  // result protocol
+  RUN_TEST(test_rom_test_pass);
+  RUN_TEST(test_rom_test_fail);
+  RUN_TEST(test_rom_test_reset);
+  RUN_TEST(test_rom_test_limits);
+  RUN_TEST(test_rom_test_errors);
+
+  // hashes
+  RUN_TEST(test_rom_test_hash);
+  RUN_TEST(test_rom_tests_parallel_match_sequential);
+}
@@ -0,0 +1,175 @@
+#include "../lib/cartridge/cartridge.hpp"
+#include "../lib/cpu/cpu.hpp"
+#include "../lib/mapper/mapper.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
+#include <unity.h>
+#include <vector>
+
+namespace {
+std::vector<uint8_t> make_image(std::vector<uint8_t> header, size_t prg_units,
+                                size_t chr_units) {
+  header.resize(ines::HEADER_SIZE, 0);
+  std::vector<uint8_t> image = header;
+  image.resize(ines::HEADER_SIZE + prg_units * ines::PRG_ROM_UNIT +
+                   chr_units * ines::CHR_ROM_UNIT,
+               0);
+  return image;
+}
+} // namespace
+
+// -- header parsing
+void test_parse_ines_header() {
+  auto image = make_image({'N', 'E', 'S', 0x1a, 2, 1, 0b00010011, 0x40}, 2, 1);
+  auto header = ines::parse_header(image.data(), image.size());
+
+  TEST_ASSERT_FALSE(header.nes2);
+  TEST_ASSERT_EQUAL_MESSAGE(0x41, header.mapper, "mapper mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(Mirroring::Vertical, header.mirroring,
+                            "mirroring mismatch");
+  TEST_ASSERT_TRUE(header.battery);
+  TEST_ASSERT_EQUAL_MESSAGE(0x8000, header.prg_rom_size, "PRG-ROM mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x2000, header.chr_rom_size, "CHR-ROM mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x2000, header.prg_ram_size, "PRG-RAM mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0, header.chr_ram_size, "CHR-RAM mismatch");
+}
+void test_parse_nes2_header() {
+  auto image = make_image(
+      {'N', 'E', 'S', 0x1a, 0x10, 0, 0x40, 0x08, 0x21, 0x00, 0x07, 0x07}, 16,
+      0);
+  auto header = ines::parse_header(image.data(), image.size());
+
+  TEST_ASSERT_TRUE(header.nes2);
+  TEST_ASSERT_EQUAL_MESSAGE(0x104, header.mapper, "mapper mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(2, header.submapper, "submapper mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(Mirroring::Horizontal, header.mirroring,
+                            "mirroring mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x40000, header.prg_rom_size, "PRG-ROM mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x2000, header.prg_ram_size, "PRG-RAM mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x2000, header.chr_ram_size, "CHR-RAM mismatch");
+}
+void test_parse_truncated_image() {
+  auto image = make_image({'N', 'E', 'S', 0x1a, 2, 1}, 1, 0);
+  bool thrown = false;
+
+  try {
+    ines::parse_header(image.data(), image.size());
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  TEST_ASSERT_TRUE_MESSAGE(thrown, "truncated image accepted");
+}
+
+// a NES 2.0 exponent of 63 is past what a size_t holds, and sizes that wrap
+// when added up don't pass for a short image
+void test_parse_nes2_huge_sizes() {
+  const std::vector<std::vector<uint8_t>> headers = {
+      // PRG-ROM 2^63 * 7
+      {'N', 'E', 'S', 0x1a, 0xff, 0, 0, 0x08, 0, 0x0f},
+      // CHR-ROM 2^63 * 7
+      {'N', 'E', 'S', 0x1a, 1, 0xff, 0, 0x08, 0, 0xf0},
+      // 2^63 of PRG-ROM and 2^63 of CHR-ROM add up to 0
+      {'N', 'E', 'S', 0x1a, 0xfc, 0xfc, 0, 0x08, 0, 0xff},
+  };
+  for (const auto &header : headers) {
+    auto image = make_image(header, 1, 1);
+    bool thrown = false;
+    try {
+      ines::parse_header(image.data(), image.size());
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    TEST_ASSERT_TRUE_MESSAGE(thrown, "huge size accepted");
+  }
+}
+
+// a NES 2.0 CHR-ROM of 512 bytes doesn't fill a 1 KiB bank
+void test_parse_nes2_small_chr_rom() {
+  auto image = make_image({'N', 'E', 'S', 0x1a, 1, 0x24, 0, 0x08, 0, 0xf0},
+                          1, 1);
+  bool thrown = false;
+
+  try {
+    ines::parse_header(image.data(), image.size());
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  TEST_ASSERT_TRUE_MESSAGE(thrown, "CHR-ROM under 1 KiB accepted");
+}
+// a NES 2.0 image with neither CHR-ROM nor CHR-RAM gets 8 KiB of CHR-RAM
+void test_parse_nes2_no_chr() {
+  auto image = make_image({'N', 'E', 'S', 0x1a, 1, 0, 0, 0x08}, 1, 0);
+  auto header = ines::parse_header(image.data(), image.size());
+  TEST_ASSERT_EQUAL_MESSAGE(0x2000, header.chr_ram_size, "CHR-RAM mismatch");
+
+  Cartridge cartridge(RomImage::from_memory(image.data(), image.size()));
+  auto mapper = make_mapper(cartridge);
+  TEST_ASSERT_TRUE_MESSAGE(mapper->chr_write(0x1fff, 0x5a), "CHR not written");
+  TEST_ASSERT_EQUAL_MESSAGE(0x5a, mapper->chr_read(0x1fff), "CHR mismatch");
+}
+
+// -- mapping
+void test_cartridge_maps_rom_in_place() {
+  auto image = make_image({'N', 'E', 'S', 0x1a, 1, 0}, 1, 0);
+  uint8_t *prg = image.data() + ines::HEADER_SIZE;
+  prg[0x0000] = 0xa9; // LDA #$42
+  prg[0x0001] = 0x42;
+  prg[0x3ffc] = 0x00; // reset vector -> $0x8000
+  prg[0x3ffd] = 0x80;
+
+  Cartridge cartridge(RomImage::from_memory(image.data(), image.size()));
+  TEST_ASSERT_TRUE_MESSAGE(cartridge.get_prg_rom() == prg, "PRG-ROM copied");
+
+  CPU cpu;
+  auto mapper = make_mapper(cartridge);
+  mapper->attach(cpu.get_bus());
+  cpu.reset();
+  TEST_ASSERT_EQUAL_MESSAGE(0x8000, cpu.get_pc(), "pc mismatch");
+
+  cpu.step();
+  TEST_ASSERT_EQUAL_MESSAGE(0x42, cpu.get_reg_a(), "register A mismatch");
+  // a 16 KiB PRG-ROM is mirrored into [0xc000..0x10000]
+  TEST_ASSERT_EQUAL_MESSAGE(0xa9, cpu.mem_read(0xc000), "mirror mismatch");
+
+  // PRG-RAM is writable, PRG-ROM isn't
+  cpu.get_bus().mem_write(0x6000, 0x55);
+  cpu.get_bus().mem_write(0x8000, 0x55);
+  TEST_ASSERT_EQUAL_MESSAGE(0x55, cpu.mem_read(0x6000), "PRG-RAM mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0xa9, cpu.mem_read(0x8000), "PRG-ROM written");
+}
+void test_cartridge_from_partition() {
+  auto image = make_image({'N', 'E', 'S', 0x1a, 1, 1}, 1, 1);
+  image[ines::HEADER_SIZE + ines::PRG_ROM_UNIT] = 0x3c;
+
+  char path[] = "/tmp/nes-partition-XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  TEST_ASSERT_TRUE(write(fd, image.data(), image.size()) ==
+                   static_cast<ssize_t>(image.size()));
+  close(fd);
+
+  {
+    Cartridge cartridge(RomImage::map_partition(path));
+    TEST_ASSERT_EQUAL_MESSAGE(0x2000, cartridge.get_chr_rom_size(),
+                              "CHR-ROM mismatch");
+    TEST_ASSERT_EQUAL_MESSAGE(0x3c, cartridge.get_chr_rom()[0],
+                              "CHR-ROM content mismatch");
+  }
+  std::remove(path);
+}
+
+void run_cartridge_tests() {
+  // header parsing
+  RUN_TEST(test_parse_ines_header);
+  RUN_TEST(test_parse_nes2_header);
+  RUN_TEST(test_parse_truncated_image);
+  RUN_TEST(test_parse_nes2_huge_sizes);
+  RUN_TEST(test_parse_nes2_small_chr_rom);
+  RUN_TEST(test_parse_nes2_no_chr);
+
+  // mapping
+  RUN_TEST(test_cartridge_maps_rom_in_place);
+  RUN_TEST(test_cartridge_from_partition);
+}
@@ -1,5 +1,8 @@
 #include "../lib/cpu/cpu.hpp"
+#include "../lib/cpu/disassembly.hpp"
 #include <cstdint>
+#include <random>
+#include <string>
 #include <unity.h>
 #include <vector>
 
@@ -25,8 +28,9 @@ void test_load_acc_immediate() {
   auto cpu = simulate_program({0xa9, 0x01, // loads 0x01 into register A
                                0x00});
   TEST_ASSERT_EQUAL_MESSAGE(0x01, cpu.get_reg_a(), REGISTER_A_MISMATCH);
-  TEST_ASSERT_EQUAL_MESSAGE(flags::UNUSED | flags::BREAK, cpu.get_status(),
-                            STATUS_MISMATCH);
+  // BRK only sets B in the status it pushes, and sets I
+  TEST_ASSERT_EQUAL_MESSAGE(flags::UNUSED | flags::INTERRUPT_DISABLE,
+                            cpu.get_status(), STATUS_MISMATCH);
 }
 void test_load_acc_zero_flag() {
   auto cpu = simulate_program({0xa9, 0x00, // loads 0x00 into register A
@@ -206,6 +210,971 @@ void test_bit_test() {
                             STATUS_MISMATCH);
 }
 
+// runs `steps` instructions of the program
+CPU run_steps(const std::vector<uint8_t> &program, uint32_t steps) {
+  CPU cpu;
+  cpu.load_program(program);
+  for (uint32_t i = 0; i < steps; ++i) {
+    cpu.step();
+  }
+  return cpu;
+}
+
+constexpr uint8_t NZCV =
+    flags::NEGATIVE | flags::ZERO | flags::CARRY | flags::OVERFLOW;
+
+// -- ADC / SBC
+// A, the operand and C in, A and N / Z / C / V out: the cases nestest checks
+struct ArithmeticCase {
+  uint8_t a;
+  uint8_t value;
+  bool carry;
+  uint8_t result;
+  uint8_t flags;
+};
+
+void assert_arithmetic(uint8_t opcode, const ArithmeticCase &c) {
+  auto cpu = run_steps({static_cast<uint8_t>(c.carry ? 0x38 : 0x18), // SEC
+                        0xa9, c.a,                                    // LDA
+                        opcode, c.value},
+                       3);
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.result, cpu.get_reg_a(),
+                                 REGISTER_A_MISMATCH);
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.flags, cpu.get_status() & NZCV,
+                                 STATUS_MISMATCH);
+}
+
+void test_adc_flags() {
+  const ArithmeticCase cases[] = {
+      {0x50, 0x10, false, 0x60, 0},
+      {0x50, 0x50, false, 0xa0, flags::NEGATIVE | flags::OVERFLOW},
+      {0x50, 0x90, false, 0xe0, flags::NEGATIVE},
+      {0x50, 0xd0, false, 0x20, flags::CARRY},
+      {0xd0, 0x90, false, 0x60, flags::CARRY | flags::OVERFLOW},
+      {0xff, 0x00, true, 0x00, flags::ZERO | flags::CARRY},
+      {0x7f, 0x00, true, 0x80, flags::NEGATIVE | flags::OVERFLOW},
+  };
+  for (const auto &c : cases) {
+    assert_arithmetic(0x69, c);
+  }
+}
+void test_sbc_flags() {
+  const ArithmeticCase cases[] = {
+      {0x50, 0xf0, true, 0x60, 0},
+      {0x50, 0xb0, true, 0xa0, flags::NEGATIVE | flags::OVERFLOW},
+      {0x50, 0x70, true, 0xe0, flags::NEGATIVE},
+      {0xd0, 0x70, true, 0x60, flags::CARRY | flags::OVERFLOW},
+      {0x50, 0x50, true, 0x00, flags::ZERO | flags::CARRY},
+      {0x50, 0x4f, false, 0x00, flags::ZERO | flags::CARRY},
+  };
+  for (const auto &c : cases) {
+    assert_arithmetic(0xe9, c);
+    // the unofficial SBC #imm
+    assert_arithmetic(0xeb, c);
+  }
+}
+// every A, operand and carry against the arithmetic done on ints
+void test_adc_sbc_all_inputs() {
+  CPU cpu;
+  for (uint32_t input = 0; input < 0x20000; ++input) {
+    auto a = static_cast<uint8_t>(input);
+    auto value = static_cast<uint8_t>(input >> 8);
+    bool carry = input >> 16;
+    for (bool subtract : {false, true}) {
+      cpu.load_program({static_cast<uint8_t>(carry ? 0x38 : 0x18), 0xa9, a,
+                        static_cast<uint8_t>(subtract ? 0xe9 : 0x69), value});
+      for (int i = 0; i < 3; ++i) {
+        cpu.step();
+      }
+
+      int operand = subtract ? -value - 1 + 256 : value;
+      int sum = a + operand + carry;
+      int signed_sum = static_cast<int8_t>(a) +
+                       (subtract ? -static_cast<int8_t>(value) - 1
+                                 : static_cast<int8_t>(value)) +
+                       carry;
+      auto result = static_cast<uint8_t>(sum);
+      uint8_t expected = (result & flags::NEGATIVE) |
+                         (result == 0 ? flags::ZERO : 0) |
+                         (sum > 0xff ? flags::CARRY : 0) |
+                         (signed_sum < -128 || signed_sum > 127
+                              ? flags::OVERFLOW
+                              : 0);
+      if (cpu.get_reg_a() != result ||
+          (cpu.get_status() & NZCV) != expected) {
+        TEST_FAIL_MESSAGE(
+            ("mismatch on " + std::string(subtract ? "SBC" : "ADC") +
+             " a=" + std::to_string(a) + " value=" + std::to_string(value) +
+             " carry=" + std::to_string(carry))
+                .c_str());
+      }
+    }
+  }
+}
+
+// -- CMP / CPX / CPY
+void test_compare_flags() {
+  struct Case {
+    uint8_t reg;
+    uint8_t value;
+    uint8_t flags;
+  };
+  const Case cases[] = {
+      {0x40, 0x41, flags::NEGATIVE},
+      {0x40, 0x40, flags::ZERO | flags::CARRY},
+      {0x40, 0x3f, flags::CARRY},
+      {0x80, 0x00, flags::NEGATIVE | flags::CARRY},
+      {0x00, 0x80, flags::NEGATIVE},
+  };
+  // CMP, CPX, CPY against the register loaded by LDA, LDX, LDY
+  const uint8_t pairs[][2] = {{0xa9, 0xc9}, {0xa2, 0xe0}, {0xa0, 0xc0}};
+  for (const auto &pair : pairs) {
+    for (const auto &c : cases) {
+      auto cpu = run_steps({pair[0], c.reg, pair[1], c.value}, 2);
+      TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.flags, cpu.get_status() & NZCV,
+                                     STATUS_MISMATCH);
+    }
+  }
+}
+
+// -- BRK / PHP / PLP
+void test_brk_pushes_break_flag() {
+  CPU cpu;
+  cpu.load_program({0x00, 0xff}); // BRK and its padding byte
+  cpu.step();
+  uint8_t pushed =
+      cpu.mem_read(0x0100 | static_cast<uint8_t>(cpu.get_sp() + 1));
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::BREAK | flags::UNUSED, pushed,
+                                 STATUS_MISMATCH);
+  uint16_t return_addr =
+      cpu.mem_read(0x0100 | static_cast<uint8_t>(cpu.get_sp() + 2)) |
+      cpu.mem_read(0x0100 | static_cast<uint8_t>(cpu.get_sp() + 3)) << 8;
+  TEST_ASSERT_EQUAL_HEX16_MESSAGE(0x8002, return_addr, "pc mismatch");
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::INTERRUPT_DISABLE | flags::UNUSED,
+                                 cpu.get_status(), STATUS_MISMATCH);
+}
+void test_php_plp_break_flag() {
+  CPU cpu;
+  cpu.load_program({0x08,       // PHP
+                    0xa9, 0xff, // LDA #$ff
+                    0x48,       // PHA
+                    0x28,       // PLP
+                    0x28});     // PLP
+  cpu.step();
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::BREAK | flags::UNUSED,
+                                 cpu.mem_read(0x0100 | (cpu.get_sp() + 1)),
+                                 STATUS_MISMATCH);
+  // only the pushed copy has B
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::UNUSED, cpu.get_status(),
+                                 STATUS_MISMATCH);
+  for (int i = 0; i < 3; ++i) {
+    cpu.step();
+  }
+  // B is dropped and the unused bit set on the way back
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(0xef, cpu.get_status(), STATUS_MISMATCH);
+  cpu.step();
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::UNUSED, cpu.get_status(),
+                                 STATUS_MISMATCH);
+}
+void test_bit_overflow_from_bit_6() {
+  auto cpu = run_steps({0xa9, 0x40, // LDA #$40
+                        0x85, 0x10, // STA $10
+                        0xa9, 0x00, // LDA #$00
+                        0x24, 0x10}, // BIT $10
+                       4);
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::OVERFLOW | flags::ZERO,
+                                 cpu.get_status() & NZCV, STATUS_MISMATCH);
+}
+
+// -- unofficial opcodes
+void test_unofficial_loads_and_stores() {
+  auto cpu = run_steps({0xa9, 0x9c, // LDA #$9c
+                        0x85, 0x10, // STA $10
+                        0xa9, 0x00, // LDA #$00
+                        0xa7, 0x10, // LAX $10
+                        0xa9, 0xf0, // LDA #$f0
+                        0x87, 0x11}, // SAX $11
+                       6);
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(0x9c, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(0x90, cpu.mem_read(0x11),
+                                 MEMORY_VALUE_MISMATCH);
+}
+void test_unofficial_read_modify_write() {
+  struct Case {
+    uint8_t opcode;
+    uint8_t memory;
+    uint8_t a;
+    uint8_t status;
+  };
+  // on $10 = 0x81 with A = 0x0f and C set
+  const Case cases[] = {
+      {0xc7, 0x80, 0x0f, flags::NEGATIVE},                 // DCP
+      {0xe7, 0x82, 0x8d, flags::NEGATIVE | flags::OVERFLOW}, // ISB
+      {0x07, 0x02, 0x0f, flags::CARRY},                    // SLO
+      {0x27, 0x03, 0x03, flags::CARRY},                    // RLA
+      {0x47, 0x40, 0x4f, flags::CARRY},                    // SRE
+      {0x67, 0xc0, 0xd0, flags::NEGATIVE},                 // RRA
+  };
+  for (const auto &c : cases) {
+    auto cpu = run_steps({0xa9, 0x81, // LDA #$81
+                          0x85, 0x10, // STA $10
+                          0xa9, 0x0f, // LDA #$0f
+                          0x38,       // SEC
+                          c.opcode, 0x10},
+                         5);
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.memory, cpu.mem_read(0x10),
+                                   MEMORY_VALUE_MISMATCH);
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.a, cpu.get_reg_a(), REGISTER_A_MISMATCH);
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.status, cpu.get_status() & NZCV,
+                                   STATUS_MISMATCH);
+  }
+}
+void test_unofficial_immediates() {
+  struct Case {
+    uint8_t opcode;
+    uint8_t a;
+    uint8_t x;
+    uint8_t status;
+  };
+  // on A = 0xc3, X = 0x5a, the operand 0xf1 and C set
+  const Case cases[] = {
+      {0x0b, 0xc1, 0x5a, flags::NEGATIVE | flags::CARRY},   // ANC
+      {0x4b, 0x60, 0x5a, flags::CARRY},                     // ALR
+      {0x6b, 0xe0, 0x5a, flags::NEGATIVE | flags::CARRY},   // ARR
+      {0xcb, 0xc3, 0x51, 0},                                // AXS
+  };
+  for (const auto &c : cases) {
+    auto cpu = run_steps({0xa9, 0xc3, // LDA #$c3
+                          0xa2, 0x5a, // LDX #$5a
+                          0x38,       // SEC
+                          c.opcode, 0xf1},
+                         4);
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.a, cpu.get_reg_a(), REGISTER_A_MISMATCH);
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.x, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.status, cpu.get_status() & NZCV,
+                                   STATUS_MISMATCH);
+  }
+}
+void test_unofficial_nops_read_operands() {
+  auto cpu = run_steps({0xa2, 0x01,       // LDX #$01
+                        0x1a,             // NOP
+                        0x80, 0xff,       // NOP #$ff
+                        0x04, 0x10,       // NOP $10
+                        0x1c, 0xff, 0x00}, // NOP $00ff,X, crosses a page
+                       5);
+  TEST_ASSERT_EQUAL_HEX16_MESSAGE(0x800a, cpu.get_pc(), "pc mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(2 + 2 + 2 + 3 + 5, cpu.get_cycles(),
+                            "cycles mismatch");
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(0x01, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+}
+// the high byte of the address + 1 masks the value, and replaces the high
+// byte when indexing crosses a page
+void test_unofficial_unstable_stores() {
+  auto cpu = run_steps({0xa2, 0xff,        // LDX #$ff
+                        0xa0, 0x03,        // LDY #$03
+                        0x9c, 0x00, 0x03,  // SHY $0300,X
+                        0xa0, 0x01,        // LDY #$01
+                        0x9e, 0xff, 0x04}, // SHX $04ff,Y, crosses
+                       5);
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(0x00, cpu.mem_read(0x03ff),
+                                 MEMORY_VALUE_MISMATCH);
+  // 0xff & 0x05 = 0x05, stored at $0500 & 0x05ff -> $0500
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(0x05, cpu.mem_read(0x0500),
+                                 MEMORY_VALUE_MISMATCH);
+}
+void test_stp_halts() {
+  CPU cpu;
+  cpu.load_program({0xa9, 0x01, // LDA #$01
+                    0x02,       // STP
+                    0xa9, 0x02}); // LDA #$02, never runs
+  cpu.run_cycles(100);
+  TEST_ASSERT_TRUE_MESSAGE(cpu.get_halt() == CPU::Halt::Stopped, "not halted");
+  TEST_ASSERT_EQUAL_HEX16_MESSAGE(0x8002, cpu.get_pc(), "pc mismatch");
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(0x01, cpu.get_reg_a(), REGISTER_A_MISMATCH);
+
+  // the time still passes
+  uint64_t before = cpu.get_cycles();
+  cpu.run_cycles(1000);
+  TEST_ASSERT_EQUAL_MESSAGE(before + 1000, cpu.get_cycles(),
+                            "cycles mismatch");
+}
+
+// -- instruction set
+// base cycles of every opcode, from the nestest log
+const uint8_t CYCLES[256] = {
+    7, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6, // 0x
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 1x
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6, // 2x
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 3x
+    6, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6, // 4x
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 5x
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6, // 6x
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 7x
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, // 8x
+    2, 6, 2, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5, // 9x
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, // Ax
+    2, 5, 2, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, // Bx
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, // Cx
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // Dx
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, // Ex
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // Fx
+};
+
+// every opcode takes its nestest cycles (no page crossed, branches not
+// taken) and moves pc past its operands unless it jumps
+void test_instruction_set_cycles_and_lengths() {
+  for (uint32_t code = 0; code < 256; ++code) {
+    const auto &instruction = disassembly::instruction(code);
+    CPU cpu;
+    // Z set, N / V / C clear: BNE, BMI, BVS and BCS fall through
+    cpu.load_program({0xa9, 0x00, static_cast<uint8_t>(code), 0x00, 0x00});
+    cpu.step();
+    uint64_t start = cpu.get_cycles();
+    bool branch = instruction.mode == Relative;
+    if (branch && (code == 0xf0 || code == 0x10 || code == 0x50 ||
+                   code == 0x90)) {
+      continue;
+    }
+    cpu.step();
+
+    std::string name = std::to_string(code) + " " + instruction.name;
+    TEST_ASSERT_EQUAL_MESSAGE(CYCLES[code], cpu.get_cycles() - start,
+                              name.c_str());
+    bool jumps = std::string(instruction.name) == "JMP" ||
+                 std::string(instruction.name) == "JSR" ||
+                 std::string(instruction.name) == "RTS" ||
+                 std::string(instruction.name) == "RTI" ||
+                 std::string(instruction.name) == "BRK" ||
+                 std::string(instruction.name) == "STP";
+    if (!jumps) {
+      TEST_ASSERT_EQUAL_HEX16_MESSAGE(0x8002 + disassembly::length(code),
+                                      cpu.get_pc(), name.c_str());
+    }
+  }
+}
+
+// -- lazy flags
+void test_lazy_flags_push_and_pull() {
+  constexpr uint8_t NZCV =
+      flags::NEGATIVE | flags::ZERO | flags::CARRY | flags::OVERFLOW;
+  CPU cpu;
+  cpu.load_program({0xa9, 0x80, // sets N
+                    0x38,       // sets C
+                    0x08,       // pushes the status
+                    0xa9, 0x01, // clears N
+                    0x18,       // clears C
+                    0x28,       // pulls N and C back
+                    0x00});
+  for (int i = 0; i < 6; ++i) {
+    cpu.step();
+  }
+  uint8_t pushed = cpu.mem_read(0x0100 | cpu.get_sp());
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::NEGATIVE | flags::CARRY, pushed & NZCV,
+                                 STATUS_MISMATCH);
+  TEST_ASSERT_EQUAL_HEX8_MESSAGE(flags::NEGATIVE | flags::CARRY,
+                                 cpu.get_status() & NZCV, STATUS_MISMATCH);
+}
+
+// -- memory mirroring
+void test_store_acc_ram_mirror() {
+  auto cpu = simulate_program(
+      {0xa9, 0x01,       // loads 0x01 into register A
+       0x8d, 0x05, 0x18, // stores register A at $0x1805, a mirror of $0x05
+       0x00});
+  TEST_ASSERT_EQUAL_MESSAGE(0x01, cpu.mem_read(0x05), MEMORY_VALUE_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0x01, cpu.mem_read(0x0805), MEMORY_VALUE_MISMATCH);
+}
+
+// -- dispatch engines
+void test_run_matches_step() {
+  std::vector<uint8_t> program = {
+      0xa9, 0x81, // loads 0x81 into register A
+      0x85, 0x10, // stores register A at $0x10
+      0xe6, 0x10, // increments value at $0x10
+      0xa6, 0x10, // loads value at $0x10 into register X
+      0x0a,       // shifts register A left
+      0x48,       // pushes register A
+      0xa8,       // transfers register A to Y
+      0x68,       // pops register A
+  };
+  CPU stepped;
+  stepped.load_program(program);
+  for (int i = 0; i < 8; ++i) {
+    stepped.step();
+  }
+
+  CPU ran;
+  ran.load_program(program);
+  ran.run(8);
+
+  TEST_ASSERT_EQUAL_MESSAGE(stepped.get_pc(), ran.get_pc(), "pc mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(stepped.get_sp(), ran.get_sp(), "sp mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(stepped.get_reg_a(), ran.get_reg_a(),
+                            REGISTER_A_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(stepped.get_reg_x(), ran.get_reg_x(),
+                            REGISTER_X_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(stepped.get_reg_y(), ran.get_reg_y(),
+                            REGISTER_Y_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(stepped.get_status(), ran.get_status(),
+                            STATUS_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(stepped.mem_read(0x10), ran.mem_read(0x10),
+                            MEMORY_VALUE_MISMATCH);
+}
+
+// -- block cache
+void test_block_cache_matches_threaded() {
+  std::vector<uint8_t> program = {
+      0xa2, 0x00,       // loads 0x00 into register X
+      0x8a,             // transfers register X to A
+      0x9d, 0x00, 0x02, // stores register A at $(0x0200 + X)
+      0xbd, 0xf0, 0x01, // loads from $(0x01f0 + X), crossing a page
+      0x5d, 0x00, 0x02, // xors with $(0x0200 + X)
+      0x95, 0x10,       // stores register A at $(0x10 + X)
+      0xe8,             // increments register X
+      0xd0, 0xf1,       // loops back to the transfer until X wraps
+      0x4c, 0x00, 0x80, // jumps back to the start
+  };
+  CPU threaded;
+  threaded.load_program(program);
+  threaded.run(5000);
+
+  CPU cached;
+  cached.set_block_cache(true);
+  cached.load_program(program);
+  cached.run(5000);
+
+  TEST_ASSERT_EQUAL_MESSAGE(threaded.get_pc(), cached.get_pc(), "pc mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(threaded.get_reg_a(), cached.get_reg_a(),
+                            REGISTER_A_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(threaded.get_reg_x(), cached.get_reg_x(),
+                            REGISTER_X_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(threaded.get_status(), cached.get_status(),
+                            STATUS_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(threaded.get_cycles(), cached.get_cycles(),
+                            "cycles mismatch");
+  for (uint16_t addr = 0; addr < 0x300; ++addr) {
+    TEST_ASSERT_EQUAL_MESSAGE(threaded.mem_read(addr), cached.mem_read(addr),
+                              MEMORY_VALUE_MISMATCH);
+  }
+
+  auto stats = cached.get_block_cache_stats();
+  TEST_ASSERT_TRUE_MESSAGE(stats.hits > 100 * stats.misses, "hit rate too low");
+}
+void test_block_cache_self_modifying_code() {
+  CPU cpu;
+  cpu.set_block_cache(true);
+  cpu.load_program({0xe8,             // increments register X
+                    0xa9, 0xca,       // loads the opcode of DEX into A
+                    0x8d, 0x00, 0x0b, // overwrites the INX through a mirror
+                    0x4c, 0x00, 0x03}, // jumps back to the start
+                   0x0300);
+  cpu.run(5);
+
+  // the second pass runs the patched instruction, not the decoded one
+  TEST_ASSERT_EQUAL_MESSAGE(0, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(1, cpu.get_block_cache_stats().invalidations,
+                            "invalidations mismatch");
+}
+void test_block_cache_bank_switch() {
+  std::array<uint8_t, 0x100> first = {0xa2, 0x01,        // loads 0x01 into X
+                                      0x4c, 0x00, 0x80}; // jumps to the start
+  std::array<uint8_t, 0x100> second = {0xa2, 0x02, 0x4c, 0x00, 0x80};
+
+  CPU cpu;
+  cpu.set_block_cache(true);
+  cpu.get_bus().map_rom(0x8000, 0x100, first.data());
+  cpu.load_program({}, 0x8000);
+  cpu.run(4);
+  TEST_ASSERT_EQUAL_MESSAGE(1, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+
+  cpu.get_bus().map_rom(0x8000, 0x100, second.data());
+  cpu.run(2);
+  TEST_ASSERT_EQUAL_MESSAGE(2, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(1, cpu.get_block_cache_stats().invalidations,
+                            "invalidations mismatch");
+}
+
+// -- jit
+#if NES_JIT
+void assert_same_state(CPU &expected, CPU &actual) {
+  TEST_ASSERT_EQUAL_HEX16_MESSAGE(expected.get_pc(), actual.get_pc(),
+                                  "pc mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_sp(), actual.get_sp(), "sp mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_reg_a(), actual.get_reg_a(),
+                            REGISTER_A_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_reg_x(), actual.get_reg_x(),
+                            REGISTER_X_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_reg_y(), actual.get_reg_y(),
+                            REGISTER_Y_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_status(), actual.get_status(),
+                            STATUS_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_cycles(), actual.get_cycles(),
+                            "cycles mismatch");
+  for (uint32_t addr = 0; addr < 0x800; ++addr) {
+    TEST_ASSERT_EQUAL_MESSAGE(expected.mem_read(addr), actual.mem_read(addr),
+                              MEMORY_VALUE_MISMATCH);
+  }
+}
+
+// steps one CPU and runs the other through the JIT
+void assert_jit_matches_step(const std::vector<uint8_t> &program,
+                             uint32_t instructions) {
+  CPU stepped;
+  stepped.load_program(program);
+  for (uint32_t i = 0; i < instructions; ++i) {
+    stepped.step();
+  }
+
+  CPU compiled;
+  compiled.set_jit(true);
+  compiled.load_program(program);
+  compiled.run(instructions);
+
+  assert_same_state(stepped, compiled);
+}
+
+void test_jit_matches_step_programs() {
+  const std::vector<std::vector<uint8_t>> programs = {
+      {0xa9, 0x05, 0x00},
+      {0xa9, 0x00, 0x00},
+      {0xa9, 0xff, 0x00},
+      {0xa2, 0x05, 0x00},
+      {0xa0, 0x05, 0x00},
+      {0xa9, 0x05, 0x85, 0x01, 0x00},
+      {0xa2, 0x01, 0xa9, 0x05, 0x95, 0x01, 0x00},
+      {0xa2, 0x05, 0x86, 0x01, 0x00},
+      {0xa0, 0x01, 0xa2, 0x05, 0x96, 0x01, 0x00},
+      {0xa0, 0x05, 0x84, 0x01, 0x00},
+      {0xa2, 0x01, 0xa0, 0x05, 0x94, 0x01, 0x00},
+      {0xa9, 0x05, 0xaa, 0x00},
+      {0xa9, 0x05, 0xa8, 0x00},
+      {0xa2, 0x05, 0x8a, 0x00},
+      {0xa0, 0x05, 0x98, 0x00},
+      {0xa9, 0xc0, 0x85, 0x10, 0xa9, 0x01, 0x24, 0x10, 0x00},
+      {0xa9, 0x01, 0x8d, 0x05, 0x18, 0x00},
+      {0xa9, 0x81, 0x85, 0x10, 0xe6, 0x10, 0xa6, 0x10, 0x0a, 0x48, 0xa8, 0x68},
+      {0xa2, 0x01, 0xbd, 0x10, 0x00, 0xbd, 0xff, 0x00, 0x9d, 0xff, 0x00},
+      {0xa9, 0x01, 0xd0, 0x00, 0xf0, 0x00, 0xd0, 0x80},
+      {0xe6, 0x10, 0x4c, 0x00, 0x80},
+      {0xa2, 0x00, 0x8a, 0x9d, 0x00, 0x02, 0xbd, 0xf0, 0x01, 0x5d, 0x00,
+       0x02, 0x95, 0x10, 0xe8, 0xd0, 0xf1, 0x4c, 0x00, 0x80},
+  };
+
+  // past their BRK too, into the interrupt vector and beyond
+  for (const auto &program : programs) {
+    for (uint32_t instructions = 1; instructions < 64; ++instructions) {
+      assert_jit_matches_step(program, instructions);
+    }
+  }
+}
+void test_jit_matches_step_random() {
+  std::mt19937 random(6502);
+  std::vector<uint8_t> opcodes;
+  for (uint32_t code = 0; code < 256; ++code) {
+    CPU probe;
+    probe.load_program({static_cast<uint8_t>(code), 0x00, 0x00});
+    probe.step();
+    // STP would stop the stream where it is
+    if (probe.get_halt() == CPU::Halt::None) {
+      opcodes.push_back(code);
+    }
+  }
+
+  for (int stream = 0; stream < 200; ++stream) {
+    // random RAM, then a page of random instructions at 0x8000
+    std::vector<uint8_t> ram(0x800);
+    for (auto &byte : ram) {
+      byte = random();
+    }
+    std::vector<uint8_t> program;
+    while (program.size() < 0x100) {
+      program.push_back(opcodes[random() % opcodes.size()]);
+      program.push_back(random());
+      program.push_back(random());
+    }
+
+    CPU stepped;
+    stepped.load_program(ram, 0x0000);
+    stepped.load_program(program);
+    CPU compiled;
+    compiled.set_jit(true);
+    compiled.load_program(ram, 0x0000);
+    compiled.load_program(program);
+
+    uint32_t instructions = 1 + random() % 3000;
+    for (uint32_t i = 0; i < instructions; ++i) {
+      stepped.step();
+    }
+    compiled.run(instructions);
+
+    assert_same_state(stepped, compiled);
+  }
+}
+void test_jit_stops_at_deadline() {
+  std::vector<uint8_t> program = {0xe6, 0x10,       // INC $10
+                                  0xa6, 0x10,       // LDX $10
+                                  0x4c, 0x00, 0x80}; // JMP $8000
+  for (uint64_t deadline = 1; deadline < 200; deadline += 7) {
+    CPU threaded;
+    threaded.load_program(program);
+    threaded.run_until(deadline);
+
+    CPU compiled;
+    compiled.set_jit(true);
+    compiled.load_program(program);
+    compiled.run_until(deadline);
+
+    assert_same_state(threaded, compiled);
+  }
+}
+void test_jit_self_modifying_code() {
+  CPU cpu;
+  cpu.set_jit(true);
+  cpu.load_program({0xe8,             // increments register X
+                    0xa9, 0xca,       // loads the opcode of DEX into A
+                    0x8d, 0x00, 0x0b, // overwrites the INX through a mirror
+                    0x4c, 0x00, 0x03}, // jumps back to the start
+                   0x0300);
+  cpu.run(5);
+
+  TEST_ASSERT_EQUAL_MESSAGE(0, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(1, cpu.get_jit_stats().invalidations,
+                            "invalidations mismatch");
+}
+void test_jit_bank_switch() {
+  std::array<uint8_t, 0x100> first = {0xa2, 0x01,        // loads 0x01 into X
+                                      0x4c, 0x00, 0x80}; // jumps to the start
+  std::array<uint8_t, 0x100> second = {0xa2, 0x02, 0x4c, 0x00, 0x80};
+
+  CPU cpu;
+  cpu.set_jit(true);
+  cpu.get_bus().map_rom(0x8000, 0x100, first.data());
+  cpu.load_program({}, 0x8000);
+  cpu.run(4);
+  TEST_ASSERT_EQUAL_MESSAGE(1, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+
+  cpu.get_bus().map_rom(0x8000, 0x100, second.data());
+  cpu.run(2);
+  TEST_ASSERT_EQUAL_MESSAGE(2, cpu.get_reg_x(), REGISTER_X_MISMATCH);
+}
+#endif
+
+// -- cycles
+void test_cycles_page_cross_penalty() {
+  CPU cpu;
+  cpu.load_program({0xa2, 0x01,       // loads 0x01 into register X
+                    0xbd, 0x10, 0x00, // loads from $(0x0010 + X), same page
+                    0xbd, 0xff, 0x00, // loads from $(0x00ff + X), next page
+                    0x9d, 0xff, 0x00}); // stores to $(0x00ff + X), no penalty
+  cpu.step();
+  TEST_ASSERT_EQUAL_MESSAGE(2, cpu.get_cycles(), "cycles mismatch");
+  cpu.step();
+  TEST_ASSERT_EQUAL_MESSAGE(6, cpu.get_cycles(), "cycles mismatch");
+  cpu.step();
+  TEST_ASSERT_EQUAL_MESSAGE(11, cpu.get_cycles(), "cycles mismatch");
+  cpu.step();
+  TEST_ASSERT_EQUAL_MESSAGE(16, cpu.get_cycles(), "cycles mismatch");
+}
+void test_cycles_branch_penalty() {
+  CPU cpu;
+  cpu.load_program({0xa9, 0x01, // loads 0x01 into register A
+                    0xd0, 0x00, // not zero, branch taken to the next byte
+                    0xf0, 0x00, // not zero, branch not taken
+                    0xd0, 0x80}); // branch taken backwards onto page 0x7f
+  cpu.run(4);
+  TEST_ASSERT_EQUAL_MESSAGE(2 + 3 + 2 + 4, cpu.get_cycles(), "cycles mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x8008 - 0x80, cpu.get_pc(), "pc mismatch");
+}
+void test_run_cycles_overshoot() {
+  CPU cpu;
+  cpu.load_program({0xe6, 0x10,       // increments value at $0x10 (5 cycles)
+                    0x4c, 0x00, 0x80}); // jumps back to the start (3 cycles)
+  uint32_t overshoot = cpu.run_cycles(29780);
+  TEST_ASSERT_EQUAL_MESSAGE(cpu.get_cycles() - 29780, overshoot,
+                            "overshoot mismatch");
+  TEST_ASSERT_TRUE_MESSAGE(overshoot < 5, "ran past the budget");
+
+  overshoot = cpu.run_cycles(29780 - overshoot);
+  TEST_ASSERT_EQUAL_MESSAGE(2 * 29780 + overshoot, cpu.get_cycles(),
+                            "cycles mismatch");
+}
+
+// -- idle loops
+// runs the loop from ROM with and without skipping, for the same budgets
+void assert_idle_loop_skipped(std::array<uint8_t, 0x100> rom, bool idle,
+                              uint16_t io_register = 0) {
+  CPU skipping;
+  CPU running;
+  running.set_idle_skip(false);
+  for (CPU *cpu : {&skipping, &running}) {
+    cpu->get_bus().map_rom(0x8000, 0x100, rom.data());
+    cpu->load_program({}, 0x8000);
+    if (io_register != 0) {
+      cpu->add_idle_register(io_register, 0x80);
+    }
+    cpu->get_bus().mem_write(0x10, 0x00);
+    cpu->run_cycles(10000);
+    cpu->get_bus().mem_write(0x10, 0x01);
+    cpu->run_cycles(333);
+  }
+
+  TEST_ASSERT_EQUAL_MESSAGE(running.get_pc(), skipping.get_pc(),
+                            "pc mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(running.get_reg_a(), skipping.get_reg_a(),
+                            REGISTER_A_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(running.get_status(), skipping.get_status(),
+                            STATUS_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(running.get_cycles(), skipping.get_cycles(),
+                            "cycles mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0, running.get_idle_stats().skipped_cycles,
+                            "skipped with skipping off");
+  if (idle) {
+    TEST_ASSERT_TRUE_MESSAGE(skipping.get_idle_stats().skipped_cycles > 9900,
+                             "idle loop run");
+  } else {
+    TEST_ASSERT_EQUAL_MESSAGE(0, skipping.get_idle_stats().skipped_cycles,
+                              "busy loop skipped");
+  }
+}
+void test_idle_loop_polling_ram() {
+  assert_idle_loop_skipped({0xa5, 0x10,       // loads $10 into A
+                            0x29, 0x01,       // keeps bit 0
+                            0xf0, 0xfa,       // loops while it is 0
+                            0x4c, 0x06, 0x80}, // then spins on itself
+                           true);
+}
+void test_idle_loop_jump_to_itself() {
+  assert_idle_loop_skipped({0x4c, 0x00, 0x80}, true);
+}
+void test_idle_loop_busy_loop() {
+  assert_idle_loop_skipped({0xe8,             // increments register X
+                            0xa5, 0x10,       // loads $10 into A
+                            0xf0, 0xfb,       // loops while it is 0
+                            0x4c, 0x00, 0x80}, // then starts over
+                           false);
+}
+// I/O only counts once declared, and only for the bits declared stable
+void test_idle_loop_polling_io() {
+  std::array<uint8_t, 0x100> negative = {0x2c, 0x02, 0x20, // BIT $2002
+                                         0x10, 0xfb};      // BPL
+  std::array<uint8_t, 0x100> overflow = {0x2c, 0x02, 0x20, // BIT $2002
+                                         0x50, 0xfb};      // BVC
+  assert_idle_loop_skipped(negative, false);
+  assert_idle_loop_skipped(negative, true, 0x2002);
+  assert_idle_loop_skipped(overflow, false, 0x2002);
+}
+#if NES_DECODED_ROUTINES
+void test_idle_loop_engines() {
+  std::array<uint8_t, 0x100> rom = {0xa5, 0x10,  // loads $10 into A
+                                    0xf0, 0xfc}; // loops while it is 0
+  for (int engine = 0; engine < 2; ++engine) {
+    CPU cpu;
+#if NES_BLOCK_CACHE
+    cpu.set_block_cache(engine == 0);
+#endif
+#if NES_JIT
+    cpu.set_jit(engine == 1);
+#endif
+    cpu.get_bus().map_rom(0x8000, 0x100, rom.data());
+    cpu.load_program({}, 0x8000);
+    cpu.run_cycles(10000);
+    TEST_ASSERT_TRUE_MESSAGE(cpu.get_idle_stats().skipped_cycles > 9900,
+                             "idle loop run");
+  }
+}
+#endif
+
+// -- trace
+#if NES_TRACE
+namespace {
+// counts X down from 5, forever
+const std::vector<uint8_t> COUNTDOWN = {
+    0xa2, 0x05,       // C000: LDX #$05
+    0xca,             // C002: DEX
+    0xd0, 0xfd,       // C003: BNE $C002
+    0x4c, 0x00, 0xc0, // C005: JMP $C000
+};
+
+std::vector<std::string> trace_lines(const Trace &trace) {
+  std::vector<std::string> lines;
+  for (uint32_t i = 0; i < trace.size(); ++i) {
+    lines.push_back(Trace::format(trace[i]));
+  }
+  return lines;
+}
+} // namespace
+
+void test_trace_nestest_format() {
+  CPU cpu;
+  cpu.load_program(COUNTDOWN, 0xc000);
+  cpu.set_trace(true);
+  cpu.run(4);
+
+  auto lines = trace_lines(*cpu.get_trace());
+  TEST_ASSERT_EQUAL(4, lines.size());
+  TEST_ASSERT_EQUAL_STRING("C000  A2 05     LDX #$05                        "
+                           "A:00 X:00 Y:00 P:20 SP:00 PPU:  0,  0 CYC:0",
+                           lines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("C002  CA        DEX                             "
+                           "A:00 X:05 Y:00 P:20 SP:00 PPU:  0,  6 CYC:2",
+                           lines[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("C003  D0 FD     BNE $C002                       "
+                           "A:00 X:04 Y:00 P:20 SP:00 PPU:  0, 12 CYC:4",
+                           lines[2].c_str());
+  TEST_ASSERT_EQUAL_STRING("C002  CA        DEX                             "
+                           "A:00 X:04 Y:00 P:20 SP:00 PPU:  0, 21 CYC:7",
+                           lines[3].c_str());
+}
+
+// unofficial opcodes are starred, the PPU position wraps per scanline
+void test_trace_format_unofficial() {
+  TraceEntry entry = {341, 0xc6a2, {0x04, 0xa9, 0x00}, 0xaa, 0, 0x6e, 0xa5,
+                      0xfb};
+  TEST_ASSERT_EQUAL_STRING("C6A2  04 A9    *NOP $A9                         "
+                           "A:AA X:00 Y:6E P:A5 SP:FB PPU:  3,  0 CYC:341",
+                           Trace::format(entry).c_str());
+}
+
+void test_trace_keeps_newest() {
+  CPU cpu;
+  cpu.load_program(COUNTDOWN, 0xc000);
+  cpu.set_trace(true);
+  cpu.run(Trace::CAPACITY + 10);
+
+  const Trace &trace = *cpu.get_trace();
+  TEST_ASSERT_EQUAL(Trace::CAPACITY, trace.size());
+  TEST_ASSERT_EQUAL(Trace::CAPACITY + 10, trace.recorded());
+  for (uint32_t i = 1; i < trace.size(); ++i) {
+    TEST_ASSERT_TRUE_MESSAGE(trace[i - 1].cycle < trace[i].cycle,
+                             "entries out of order");
+  }
+  TEST_ASSERT_TRUE_MESSAGE(trace[trace.size() - 1].cycle < cpu.get_cycles(),
+                           "newest entry missing");
+}
+
+// every instruction goes through step while tracing, whichever engine is on
+void test_trace_every_engine() {
+  CPU cpu;
+  cpu.load_program(COUNTDOWN, 0xc000);
+#if NES_BLOCK_CACHE
+  cpu.set_block_cache(true);
+#endif
+#if NES_JIT
+  cpu.set_jit(true);
+#endif
+  cpu.set_trace(true);
+  cpu.run(100);
+  TEST_ASSERT_EQUAL(100, cpu.get_trace()->recorded());
+
+  cpu.set_trace(false);
+  cpu.run(100);
+  TEST_ASSERT_EQUAL(100, cpu.get_trace()->recorded());
+}
+#endif
+
+// -- profile
+#if NES_PROFILE
+namespace {
+// calls a subroutine counting X down from 3, forever
+const std::vector<uint8_t> CALLER = {
+    0x20, 0x10, 0xc0, // C000: JSR $C010
+    0x4c, 0x00, 0xc0, // C003: JMP $C000
+};
+const std::vector<uint8_t> COUNTDOWN_SUBROUTINE = {
+    0xa2, 0x03, // C010: LDX #$03
+    0xca,       // C012: DEX
+    0xd0, 0xfd, // C013: BNE $C012
+    0x60,       // C015: RTS
+};
+
+CPU profiled_cpu(const std::vector<uint8_t> &subroutine) {
+  CPU cpu;
+  cpu.load_program(subroutine, 0xc010);
+  cpu.load_program(CALLER, 0xc000);
+  cpu.set_profile(true);
+  return cpu;
+}
+} // namespace
+
+void test_profile_counts() {
+  CPU cpu = profiled_cpu(COUNTDOWN_SUBROUTINE);
+  // 10 calls
+  cpu.run(100);
+
+  const Profile &profile = *cpu.get_profile();
+  TEST_ASSERT_EQUAL(100, profile.instructions());
+  TEST_ASSERT_EQUAL(310, profile.cycles());
+  TEST_ASSERT_EQUAL(30, profile.opcode_counts[0xca]);
+  TEST_ASSERT_EQUAL(60, profile.opcode_cycles[0x20]);
+  TEST_ASSERT_EQUAL(80, profile.opcode_cycles[0xd0]);
+  TEST_ASSERT_EQUAL(30, profile.pc_hits[0xc012 >> NES_PROFILE_PC_SHIFT]);
+  TEST_ASSERT_EQUAL(30, profile.mode_counts[Relative]);
+  TEST_ASSERT_EQUAL(10, profile.mode_counts[Immediate]);
+
+  std::string report = profile.report(3);
+  TEST_ASSERT_TRUE_MESSAGE(report.find("D0 BNE relative") != std::string::npos,
+                           "busiest opcode missing");
+}
+
+// the subroutine's cycles count under its caller, JSR and JMP in main
+void test_profile_folded_stacks() {
+  CPU cpu = profiled_cpu(COUNTDOWN_SUBROUTINE);
+  cpu.run(100);
+  TEST_ASSERT_EQUAL_STRING("main 90\n"
+                           "main;$C010 220\n",
+                           cpu.get_profile()->folded().c_str());
+}
+
+// an RTS to an address pushed by hand jumps, it doesn't return
+void test_profile_rts_jump() {
+  CPU cpu = profiled_cpu({
+      0xa9, 0xc0, // C010: LDA #$C0
+      0x48,       // C012: PHA
+      0xa9, 0x1f, // C013: LDA #$1F
+      0x48,       // C015: PHA
+      0x60,       // C016: RTS, to $C020
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x60,       // C020: RTS
+  });
+  cpu.run(80);
+  TEST_ASSERT_EQUAL_STRING("main 90\n"
+                           "main;$C010 220\n",
+                           cpu.get_profile()->folded().c_str());
+}
+
+void test_profile_interrupts() {
+  std::vector<uint8_t> program(0x4000, 0);
+  program[0x0000] = 0x4c; // C000: JMP $C000
+  program[0x0001] = 0x00;
+  program[0x0002] = 0xc0;
+  program[0x0100] = 0x40; // C100: RTI
+  program[0x3ffa] = 0x00; // NMI vector
+  program[0x3ffb] = 0xc1;
+  CPU cpu;
+  cpu.load_program(program, 0xc000);
+  cpu.set_profile(true);
+  cpu.run(2);
+  cpu.nmi();
+  cpu.run(3);
+  TEST_ASSERT_EQUAL_STRING("main 12\n"
+                           "main;nmi $C100 6\n",
+                           cpu.get_profile()->folded().c_str());
+}
+#endif
+
+// other modules
+void run_cartridge_tests();
+void run_mapper_tests();
+void run_ppu_tests();
+void run_scheduler_tests();
+void run_nes_tests();
+void run_pipeline_tests();
+void run_display_tests();
+void run_apu_tests();
+void run_state_tests();
+void run_batch_tests();
+void run_input_tests();
+
 int main() {
   UNITY_BEGIN();
   // load operations
@@ -234,6 +1203,93 @@ int main() {
   // logical operations
   RUN_TEST(test_bit_test);
 
+  // arithmetic
+  RUN_TEST(test_adc_flags);
+  RUN_TEST(test_sbc_flags);
+  RUN_TEST(test_adc_sbc_all_inputs);
+  RUN_TEST(test_compare_flags);
+
+  // interrupts and the stack
+  RUN_TEST(test_brk_pushes_break_flag);
+  RUN_TEST(test_php_plp_break_flag);
+  RUN_TEST(test_bit_overflow_from_bit_6);
+
+  // unofficial opcodes
+  RUN_TEST(test_unofficial_loads_and_stores);
+  RUN_TEST(test_unofficial_read_modify_write);
+  RUN_TEST(test_unofficial_immediates);
+  RUN_TEST(test_unofficial_nops_read_operands);
+  RUN_TEST(test_unofficial_unstable_stores);
+  RUN_TEST(test_stp_halts);
+
+  // instruction set
+  RUN_TEST(test_instruction_set_cycles_and_lengths);
+
+  // lazy flags
+  RUN_TEST(test_lazy_flags_push_and_pull);
+
+  // memory mirroring
+  RUN_TEST(test_store_acc_ram_mirror);
+
+  // dispatch engines
+  RUN_TEST(test_run_matches_step);
+
+  // block cache
+  RUN_TEST(test_block_cache_matches_threaded);
+  RUN_TEST(test_block_cache_self_modifying_code);
+  RUN_TEST(test_block_cache_bank_switch);
+
+#if NES_JIT
+  // jit
+  RUN_TEST(test_jit_matches_step_programs);
+  RUN_TEST(test_jit_matches_step_random);
+  RUN_TEST(test_jit_stops_at_deadline);
+  RUN_TEST(test_jit_self_modifying_code);
+  RUN_TEST(test_jit_bank_switch);
+#endif
+
+  // cycles
+  RUN_TEST(test_cycles_page_cross_penalty);
+  RUN_TEST(test_cycles_branch_penalty);
+  RUN_TEST(test_run_cycles_overshoot);
+
+  // idle loops
+  RUN_TEST(test_idle_loop_polling_ram);
+  RUN_TEST(test_idle_loop_jump_to_itself);
+  RUN_TEST(test_idle_loop_busy_loop);
+  RUN_TEST(test_idle_loop_polling_io);
+#if NES_DECODED_ROUTINES
+  RUN_TEST(test_idle_loop_engines);
+#endif
+
+#if NES_TRACE
+  // trace
+  RUN_TEST(test_trace_nestest_format);
+  RUN_TEST(test_trace_format_unofficial);
+  RUN_TEST(test_trace_keeps_newest);
+  RUN_TEST(test_trace_every_engine);
+#endif
+
+#if NES_PROFILE
+  // profile
+  RUN_TEST(test_profile_counts);
+  RUN_TEST(test_profile_folded_stacks);
+  RUN_TEST(test_profile_rts_jump);
+  RUN_TEST(test_profile_interrupts);
+#endif
+
+  run_cartridge_tests();
+  run_mapper_tests();
+  run_ppu_tests();
+  run_scheduler_tests();
+  run_nes_tests();
+  run_pipeline_tests();
+  run_display_tests();
+  run_apu_tests();
+  run_state_tests();
+  run_batch_tests();
+  run_input_tests();
+
   UNITY_END();
 
   return 0;
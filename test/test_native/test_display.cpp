@@ -0,0 +1,127 @@
+#include "../lib/display/display.hpp"
+#include "../lib/display/rgb565.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unity.h>
+
+namespace {
+// every color index in a shuffled order, plus garbage in the upper bits
+std::array<uint8_t, PPU::WIDTH + 5> test_line() {
+  std::array<uint8_t, PPU::WIDTH + 5> line;
+  for (size_t x = 0; x < line.size(); ++x) {
+    line[x] = static_cast<uint8_t>((x * 37 + 11) ^ (x & 0xc0));
+  }
+  return line;
+}
+
+// keeps what was sent
+struct ScreenDisplay : CountingDisplay {
+  std::array<uint16_t, PPU::WIDTH * PPU::HEIGHT> screen{};
+
+  void write_lines(uint16_t y, uint16_t count,
+                   const uint16_t *pixels) override {
+    CountingDisplay::write_lines(y, count, pixels);
+    std::copy(pixels, pixels + count * PPU::WIDTH,
+              screen.begin() + y * PPU::WIDTH);
+  }
+};
+
+void fill_frame(DisplayOutput &output, uint8_t color) {
+  std::array<uint8_t, PPU::WIDTH> line;
+  line.fill(color);
+  for (uint16_t y = 0; y < PPU::HEIGHT; ++y) {
+    output.present_line(y, line.data());
+  }
+}
+} // namespace
+
+// -- palette
+void test_palette_colors() {
+  Rgb565Palette palette;
+  TEST_ASSERT_EQUAL_HEX16(0x0000, palette[0x0f]);
+  TEST_ASSERT_EQUAL_HEX16(0xef7d, palette[0x20]); // 236, 238, 236
+  TEST_ASSERT_EQUAL_HEX16(palette[0x20], palette[0x60]);
+
+  Rgb565Palette swapped(ByteOrder::Big);
+  TEST_ASSERT_EQUAL_HEX16(0x7def, swapped[0x20]);
+}
+void test_converters_match() {
+  Rgb565Palette palette(ByteOrder::Big);
+  auto line = test_line();
+  std::array<uint16_t, PPU::WIDTH + 5> expected;
+  std::array<uint16_t, PPU::WIDTH + 5> pixels;
+  palette.convert_scalar(line.data(), expected.data(), line.size());
+
+  pixels.fill(0);
+  palette.convert_packed(line.data(), pixels.data(), line.size());
+  TEST_ASSERT_EQUAL_HEX16_ARRAY(expected.data(), pixels.data(), line.size());
+
+#if NES_RGB565_SSSE3
+  if (Rgb565Palette::has_ssse3()) {
+    pixels.fill(0);
+    palette.convert_ssse3(line.data(), pixels.data(), line.size());
+    TEST_ASSERT_EQUAL_HEX16_ARRAY(expected.data(), pixels.data(), line.size());
+  }
+#endif
+
+  pixels.fill(0);
+  palette.convert(line.data(), pixels.data(), line.size());
+  TEST_ASSERT_EQUAL_HEX16_ARRAY(expected.data(), pixels.data(), line.size());
+}
+
+// -- dirty lines
+void test_static_frame_not_resent() {
+  CountingDisplay display;
+  DisplayOutput output(display);
+
+  fill_frame(output, 0x21);
+  TEST_ASSERT_EQUAL_MESSAGE(PPU::HEIGHT, display.get_lines(),
+                            "first frame not sent in full");
+  TEST_ASSERT_EQUAL_MESSAGE(PPU::HEIGHT / DisplayOutput::BAND_LINES,
+                            display.get_windows(), "lines not banded");
+  uint64_t bytes = display.get_bytes();
+
+  fill_frame(output, 0x21);
+  TEST_ASSERT_EQUAL_MESSAGE(bytes, display.get_bytes(), "clean frame sent");
+  TEST_ASSERT_EQUAL(2, display.get_frames());
+
+  output.invalidate();
+  fill_frame(output, 0x21);
+  TEST_ASSERT_EQUAL_MESSAGE(2 * PPU::HEIGHT, display.get_lines(),
+                            "invalidate ignored");
+}
+void test_only_dirty_lines_sent() {
+  ScreenDisplay display;
+  DisplayOutput output(display);
+  fill_frame(output, 0x21);
+  uint64_t lines = display.get_lines();
+  uint64_t windows = display.get_windows();
+
+  // a sprite over lines 100..103 and a single changed line further down
+  std::array<uint8_t, PPU::WIDTH> line;
+  for (uint16_t y = 0; y < PPU::HEIGHT; ++y) {
+    line.fill(0x21);
+    if ((y >= 100 && y < 104) || y == 200) {
+      line[40] = 0x16;
+    }
+    output.present_line(y, line.data());
+  }
+
+  TEST_ASSERT_EQUAL_MESSAGE(lines + 5, display.get_lines(), "lines sent");
+  TEST_ASSERT_EQUAL_MESSAGE(windows + 2, display.get_windows(), "windows");
+  TEST_ASSERT_EQUAL_HEX16(output.get_palette()[0x16],
+                          display.screen[102 * PPU::WIDTH + 40]);
+  TEST_ASSERT_EQUAL_HEX16(output.get_palette()[0x21],
+                          display.screen[102 * PPU::WIDTH + 41]);
+}
+
+void run_display_tests() {
+  // palette
+  RUN_TEST(test_palette_colors);
+  RUN_TEST(test_converters_match);
+
+  // dirty lines
+  RUN_TEST(test_static_frame_not_resent);
+  RUN_TEST(test_only_dirty_lines_sent);
+}
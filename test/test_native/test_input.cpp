@@ -0,0 +1,246 @@
+#include "../lib/apu/apu.hpp"
+#include "../lib/cpu/cpu.hpp"
+#include "../lib/input/controllers.hpp"
+#include "../lib/input/movie.hpp"
+#include "../lib/nes/nes.hpp"
+#include "nrom_image.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <unity.h>
+#include <vector>
+
+namespace {
+// NROM test ROM: waits for vblank, enables NMI and spins. the NMI handler
+// reads controller 1 into $00 (A in bit 7), adds it to $01 and counts
+// frames in $02
+const uint8_t PROGRAM[] = {
+    0x78,             // 8000: SEI
+    0xa2, 0xff,       // 8001: LDX #$ff
+    0x9a,             // 8003: TXS
+    0x2c, 0x02, 0x20, // 8004: BIT $2002
+    0x10, 0xfb,       // 8007: BPL $8004
+    0xa9, 0x80,       // 8009: LDA #$80
+    0x8d, 0x00, 0x20, // 800b: STA $2000
+    0x4c, 0x0e, 0x80, // 800e: JMP $800e
+    0xa9, 0x01,       // 8011: LDA #$01
+    0x8d, 0x16, 0x40, // 8013: STA $4016
+    0xa9, 0x00,       // 8016: LDA #$00
+    0x8d, 0x16, 0x40, // 8018: STA $4016
+    0xa2, 0x08,       // 801b: LDX #$08
+    0xad, 0x16, 0x40, // 801d: LDA $4016
+    0x4a,             // 8020: LSR A
+    0x26, 0x00,       // 8021: ROL $00
+    0xca,             // 8023: DEX
+    0xd0, 0xf7,       // 8024: BNE $801d
+    0xa5, 0x00,       // 8026: LDA $00
+    0x18,             // 8028: CLC
+    0x65, 0x01,       // 8029: ADC $01
+    0x85, 0x01,       // 802b: STA $01
+    0xe6, 0x02,       // 802d: INC $02
+    0x40,             // 802f: RTI
+};
+constexpr uint16_t NMI_HANDLER = 0x8011;
+
+std::vector<uint8_t> make_image() {
+  return nrom_image(PROGRAM, sizeof(PROGRAM), NMI_HANDLER);
+}
+
+// changes the buttons every few frames, holding some of them for a while
+uint8_t buttons_at(uint32_t frame) {
+  return frame < 30 ? 0 : static_cast<uint8_t>((frame / 7) * 0x35);
+}
+
+std::vector<uint8_t> record_movie(const std::vector<uint8_t> &image,
+                                  uint32_t frames,
+                                  uint16_t hash_interval = 1) {
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  MovieRecorder recorder(nes, hash_interval);
+  for (uint32_t frame = 0; frame < frames; ++frame) {
+    nes.get_controllers().set_buttons(0, buttons_at(frame));
+    nes.run_frame();
+    recorder.record_frame();
+  }
+  return recorder.encode();
+}
+
+bool decode_fails(const std::vector<uint8_t> &data) {
+  try {
+    MoviePlayer player(data);
+  } catch (const std::runtime_error &) {
+    return true;
+  }
+  return false;
+}
+} // namespace
+
+// -- controllers
+void test_controller_shift_register() {
+  CPU cpu;
+  APU apu;
+  Controllers controllers;
+  apu.attach(cpu.get_bus());
+  controllers.attach(apu);
+  Bus &bus = cpu.get_bus();
+
+  controllers.set_buttons(0, button::A | button::START | button::RIGHT);
+  controllers.set_buttons(1, button::B);
+  bus.mem_write(Controllers::PORT1, 1);
+  // while strobed, every read is A
+  TEST_ASSERT_EQUAL_HEX8(0x41, bus.mem_read(Controllers::PORT1));
+  TEST_ASSERT_EQUAL_HEX8(0x41, bus.mem_read(Controllers::PORT1));
+  bus.mem_write(Controllers::PORT1, 0);
+
+  const uint8_t port1[] = {1, 0, 0, 1, 0, 0, 0, 1, 1, 1};
+  for (uint8_t bit : port1) {
+    TEST_ASSERT_EQUAL_HEX8(0x40 | bit, bus.mem_read(Controllers::PORT1));
+  }
+  const uint8_t port2[] = {0, 1, 0, 0, 0, 0, 0, 0, 1};
+  for (uint8_t bit : port2) {
+    TEST_ASSERT_EQUAL_HEX8(0x40 | bit, bus.mem_read(Controllers::PORT2));
+  }
+
+  // buttons set after the latch only show up at the next one
+  controllers.set_buttons(0, button::A);
+  bus.mem_write(Controllers::PORT1, 1);
+  bus.mem_write(Controllers::PORT1, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x41, bus.mem_read(Controllers::PORT1));
+  TEST_ASSERT_EQUAL_HEX8(0x40, bus.mem_read(Controllers::PORT1));
+}
+void test_controller_4017_writes_reach_apu() {
+  CPU cpu;
+  APU apu;
+  Controllers controllers;
+  apu.attach(cpu.get_bus());
+  controllers.attach(apu);
+  Bus &bus = cpu.get_bus();
+
+  // 4-step mode with the IRQ on raises it after a frame
+  bus.mem_write(APU::FRAME_COUNTER, 0x00);
+  apu.run_to(30000);
+  TEST_ASSERT_TRUE(apu.irq_pending());
+  // inhibiting it clears it
+  bus.mem_write(APU::FRAME_COUNTER, 0x40);
+  TEST_ASSERT_FALSE(apu.irq_pending());
+}
+void test_controller_read_by_game() {
+  auto image = make_image();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  nes.get_controllers().set_buttons(0, button::A | button::LEFT);
+  for (int frame = 0; frame < 4; ++frame) {
+    nes.run_frame();
+  }
+
+  // A in bit 7, LEFT (bit 6 of the buttons) in bit 1
+  TEST_ASSERT_EQUAL_HEX8(0x82, nes.get_cpu().mem_read(0x00));
+  TEST_ASSERT_GREATER_THAN(0, nes.get_cpu().mem_read(0x02));
+}
+
+// -- movies
+void test_movie_round_trip() {
+  auto image = make_image();
+  auto data = record_movie(image, 600);
+
+  // a run per change of input plus a hash a frame
+  TEST_ASSERT_LESS_THAN(24 + 3 * 100 + 600 * 4, data.size());
+
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  MoviePlayer player(data);
+  TEST_ASSERT_TRUE(player.matches_start(nes));
+  TEST_ASSERT_EQUAL(600, player.get_frames());
+  for (uint32_t frame = 0; frame < 600; ++frame) {
+    TEST_ASSERT_EQUAL_MESSAGE(MoviePlayer::Step::Ran, player.play_frame(nes),
+                              "frame didn't replay");
+  }
+  TEST_ASSERT_EQUAL(MoviePlayer::Step::End, player.play_frame(nes));
+  TEST_ASSERT_EQUAL(600, player.get_frame());
+
+  // the input made it into the game
+  NES expected(RomImage::from_memory(image.data(), image.size()));
+  for (uint32_t frame = 0; frame < 600; ++frame) {
+    expected.get_controllers().set_buttons(0, buttons_at(frame));
+    expected.run_frame();
+  }
+  TEST_ASSERT_EQUAL(expected.get_cpu().mem_read(0x01),
+                    nes.get_cpu().mem_read(0x01));
+}
+void test_movie_long_runs() {
+  auto image = make_image();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  MovieRecorder recorder(nes, 0);
+  for (int frame = 0; frame < 1000; ++frame) {
+    nes.run_frame();
+    recorder.record_frame();
+  }
+
+  // 1000 frames of the same input are 4 runs of at most 256 frames
+  auto data = recorder.encode();
+  TEST_ASSERT_EQUAL(24 + 4 * 3, data.size());
+
+  NES replay(RomImage::from_memory(image.data(), image.size()));
+  MoviePlayer player(data);
+  uint32_t frames = 0;
+  while (player.play_frame(replay) == MoviePlayer::Step::Ran) {
+    frames++;
+  }
+  TEST_ASSERT_EQUAL(1000, frames);
+}
+void test_movie_detects_desync() {
+  auto image = make_image();
+  auto data = record_movie(image, 200, 10);
+
+  // another button in the third run
+  auto edited = data;
+  edited[24 + 2 * 3 + 1] ^= button::B;
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  MoviePlayer player(edited);
+  MoviePlayer::Step step;
+  do {
+    step = player.play_frame(nes);
+  } while (step == MoviePlayer::Step::Ran);
+
+  TEST_ASSERT_EQUAL(MoviePlayer::Step::Desync, step);
+  // caught at the first hash after it
+  TEST_ASSERT_EQUAL(40, player.get_frame());
+}
+void test_movie_rejects_other_rom() {
+  auto image = make_image();
+  auto data = record_movie(image, 10);
+
+  auto other = image;
+  other[ines::HEADER_SIZE + 0x100] = 0xea;
+  NES nes(RomImage::from_memory(other.data(), other.size()));
+  TEST_ASSERT_FALSE(MoviePlayer(data).matches_start(nes));
+
+  // nor a console that ran already
+  NES ran(RomImage::from_memory(image.data(), image.size()));
+  ran.run_frame();
+  TEST_ASSERT_FALSE(MoviePlayer(data).matches_start(ran));
+}
+void test_movie_rejects_bad_data() {
+  auto data = record_movie(make_image(), 100);
+
+  auto bad_magic = data;
+  bad_magic[0] = 'X';
+  TEST_ASSERT_TRUE_MESSAGE(decode_fails(bad_magic), "bad magic accepted");
+  auto truncated = data;
+  truncated.pop_back();
+  TEST_ASSERT_TRUE_MESSAGE(decode_fails(truncated), "truncated accepted");
+  auto short_runs = data;
+  short_runs[24] ^= 1;
+  TEST_ASSERT_TRUE_MESSAGE(decode_fails(short_runs),
+                           "runs not adding up accepted");
+}
+
+void run_input_tests() {
+  // controllers
+  RUN_TEST(test_controller_shift_register);
+  RUN_TEST(test_controller_4017_writes_reach_apu);
+  RUN_TEST(test_controller_read_by_game);
+
+  // movies
+  RUN_TEST(test_movie_round_trip);
+  RUN_TEST(test_movie_long_runs);
+  RUN_TEST(test_movie_detects_desync);
+  RUN_TEST(test_movie_rejects_other_rom);
+  RUN_TEST(test_movie_rejects_bad_data);
+}
@@ -0,0 +1,202 @@
+#include "../lib/bus/bus.hpp"
+#include "../lib/cartridge/cartridge.hpp"
+#include "../lib/mapper/mapper.hpp"
+#include <cstdint>
+#include <memory>
+#include <unity.h>
+#include <vector>
+
+namespace {
+const char *PRG_BANK_MISMATCH = "PRG bank mismatch";
+const char *CHR_BANK_MISMATCH = "CHR bank mismatch";
+
+// every 8 KiB PRG bank starts with its index, every 1 KiB CHR bank too
+struct Board {
+  std::vector<uint8_t> image;
+  std::unique_ptr<Cartridge> cartridge;
+  std::unique_ptr<Mapper> mapper;
+  Bus bus;
+
+  Board(uint8_t mapper_number, uint8_t prg_units, uint8_t chr_units) {
+    image.assign(ines::HEADER_SIZE + prg_units * ines::PRG_ROM_UNIT +
+                     chr_units * ines::CHR_ROM_UNIT,
+                 0);
+    image[0] = 'N';
+    image[1] = 'E';
+    image[2] = 'S';
+    image[3] = 0x1a;
+    image[4] = prg_units;
+    image[5] = chr_units;
+    image[6] = (mapper_number & 0x0f) << 4;
+    image[7] = mapper_number & 0xf0;
+
+    uint8_t *prg = image.data() + ines::HEADER_SIZE;
+    for (int bank = 0; bank < prg_units * 2; ++bank) {
+      prg[bank * Mapper::PRG_BANK_SIZE] = bank;
+    }
+    uint8_t *chr = prg + prg_units * ines::PRG_ROM_UNIT;
+    for (int bank = 0; bank < chr_units * 8; ++bank) {
+      chr[bank * Mapper::CHR_BANK_SIZE] = bank;
+    }
+
+    cartridge = std::make_unique<Cartridge>(
+        RomImage::from_memory(image.data(), image.size()));
+    mapper = make_mapper(*cartridge);
+    mapper->attach(bus);
+  }
+
+  uint8_t prg_bank_at(uint16_t addr) { return bus.mem_read(addr); }
+  uint8_t chr_bank_at(uint16_t addr) { return mapper->chr_read(addr); }
+
+  // MMC1 registers are loaded one bit per write, LSB first
+  void mmc1_write(uint16_t addr, uint8_t value) {
+    for (int bit = 0; bit < 5; ++bit) {
+      bus.mem_write(addr, (value >> bit) & 1);
+    }
+  }
+};
+} // namespace
+
+// -- NROM
+void test_nrom_mirrors_16k() {
+  Board board(0, 1, 1);
+  TEST_ASSERT_EQUAL_MESSAGE(0, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(1, board.prg_bank_at(0xa000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0, board.prg_bank_at(0xc000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(1, board.prg_bank_at(0xe000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(7, board.chr_bank_at(0x1c00), CHR_BANK_MISMATCH);
+}
+void test_nrom_chr_ram() {
+  Board board(0, 2, 0);
+  TEST_ASSERT_TRUE(board.mapper->chr_write(0x1234, 0x5a));
+  TEST_ASSERT_EQUAL_MESSAGE(0x5a, board.mapper->chr_read(0x1234),
+                            "CHR-RAM mismatch");
+}
+
+// -- MMC1
+void test_mmc1_prg_modes() {
+  Board board(1, 8, 2);
+  // power up: last bank fixed at 0xc000
+  TEST_ASSERT_EQUAL_MESSAGE(14, board.prg_bank_at(0xc000), PRG_BANK_MISMATCH);
+
+  board.mmc1_write(0xe000, 3);
+  TEST_ASSERT_EQUAL_MESSAGE(6, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(7, board.prg_bank_at(0xa000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(15, board.prg_bank_at(0xe000), PRG_BANK_MISMATCH);
+
+  // mode 2: first bank fixed at 0x8000, switchable at 0xc000
+  board.mmc1_write(0x8000, 0b01000);
+  TEST_ASSERT_EQUAL_MESSAGE(0, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(6, board.prg_bank_at(0xc000), PRG_BANK_MISMATCH);
+
+  // mode 0: 32 KiB, the low bit of the bank number is ignored
+  board.mmc1_write(0x8000, 0b00000);
+  TEST_ASSERT_EQUAL_MESSAGE(4, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(7, board.prg_bank_at(0xe000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(Mirroring::SingleScreen_Low,
+                            board.mapper->get_mirroring(),
+                            "mirroring mismatch");
+}
+void test_mmc1_reset_and_chr() {
+  Board board(1, 2, 4);
+  // a write with bit 7 set drops the bits shifted in so far
+  board.bus.mem_write(0x8000, 1);
+  board.bus.mem_write(0x8000, 0x80);
+  board.mmc1_write(0x8000, 0b10010); // vertical, 4 KiB CHR banks
+  board.mmc1_write(0xa000, 3);
+  board.mmc1_write(0xc000, 5);
+
+  TEST_ASSERT_EQUAL_MESSAGE(Mirroring::Vertical, board.mapper->get_mirroring(),
+                            "mirroring mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(12, board.chr_bank_at(0x0000), CHR_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(20, board.chr_bank_at(0x1000), CHR_BANK_MISMATCH);
+}
+
+// -- UxROM
+void test_uxrom_switches_low_bank() {
+  Board board(2, 8, 0);
+  TEST_ASSERT_EQUAL_MESSAGE(14, board.prg_bank_at(0xc000), PRG_BANK_MISMATCH);
+
+  uint32_t generation = board.mapper->get_chr_generation();
+  board.bus.mem_write(0x8000, 5);
+  TEST_ASSERT_EQUAL_MESSAGE(10, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(11, board.prg_bank_at(0xa000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(15, board.prg_bank_at(0xe000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(generation, board.mapper->get_chr_generation(),
+                            "CHR changed on a PRG switch");
+}
+
+// -- CNROM
+void test_cnrom_switches_chr() {
+  Board board(3, 2, 4);
+  uint32_t generation = board.mapper->get_chr_generation();
+
+  board.bus.mem_write(0x8000, 2);
+  TEST_ASSERT_EQUAL_MESSAGE(16, board.chr_bank_at(0x0000), CHR_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(23, board.chr_bank_at(0x1c00), CHR_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_TRUE_MESSAGE(board.mapper->get_chr_generation() != generation,
+                           "CHR switch not reported");
+  TEST_ASSERT_FALSE(board.mapper->chr_write(0x0000, 0xff));
+}
+
+// -- MMC3
+void test_mmc3_banks() {
+  Board board(4, 8, 8);
+  board.bus.mem_write(0x8000, 6);
+  board.bus.mem_write(0x8001, 3);
+  board.bus.mem_write(0x8000, 7);
+  board.bus.mem_write(0x8001, 4);
+  TEST_ASSERT_EQUAL_MESSAGE(3, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(4, board.prg_bank_at(0xa000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(14, board.prg_bank_at(0xc000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(15, board.prg_bank_at(0xe000), PRG_BANK_MISMATCH);
+
+  // PRG mode 1 swaps 0x8000 and 0xc000, CHR inversion swaps the halves
+  board.bus.mem_write(0x8000, 0xc2);
+  board.bus.mem_write(0x8001, 9);
+  TEST_ASSERT_EQUAL_MESSAGE(14, board.prg_bank_at(0x8000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(3, board.prg_bank_at(0xc000), PRG_BANK_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(9, board.chr_bank_at(0x0000), CHR_BANK_MISMATCH);
+
+  board.bus.mem_write(0xa000, 1);
+  TEST_ASSERT_EQUAL_MESSAGE(Mirroring::Horizontal,
+                            board.mapper->get_mirroring(),
+                            "mirroring mismatch");
+}
+void test_mmc3_scanline_irq() {
+  Board board(4, 2, 1);
+  board.bus.mem_write(0xc000, 3); // latch
+  board.bus.mem_write(0xc001, 0); // reload on the next scanline
+  board.bus.mem_write(0xe001, 0); // enable
+
+  board.mapper->clock_scanline(); // reloads to 3
+  board.mapper->clock_scanline();
+  board.mapper->clock_scanline();
+  TEST_ASSERT_FALSE(board.mapper->irq_pending());
+  board.mapper->clock_scanline();
+  TEST_ASSERT_TRUE_MESSAGE(board.mapper->irq_pending(), "IRQ not raised");
+
+  board.bus.mem_write(0xe000, 0); // disable and acknowledge
+  TEST_ASSERT_FALSE(board.mapper->irq_pending());
+}
+
+void run_mapper_tests() {
+  // NROM
+  RUN_TEST(test_nrom_mirrors_16k);
+  RUN_TEST(test_nrom_chr_ram);
+
+  // MMC1
+  RUN_TEST(test_mmc1_prg_modes);
+  RUN_TEST(test_mmc1_reset_and_chr);
+
+  // UxROM
+  RUN_TEST(test_uxrom_switches_low_bank);
+
+  // CNROM
+  RUN_TEST(test_cnrom_switches_chr);
+
+  // MMC3
+  RUN_TEST(test_mmc3_banks);
+  RUN_TEST(test_mmc3_scanline_irq);
+}
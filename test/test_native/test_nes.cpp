@@ -0,0 +1,335 @@
+#include "../lib/nes/nes.hpp"
+#include "nrom_image.hpp"
+#include <cstdint>
+#include <cstring>
+#include <unity.h>
+#include <vector>
+
+namespace {
+// NROM test ROM: waits for two vblanks by polling PPUSTATUS, enables NMI and
+// then counts loop iterations in $01/$02. the NMI handler counts frames in
+// $00, snapshots the loop counter into $03 and reads PPUSTATUS
+const uint8_t PROGRAM[] = {
+    0x78,             // 8000: SEI
+    0xa2, 0xff,       // 8001: LDX #$ff
+    0x9a,             // 8003: TXS
+    0x2c, 0x02, 0x20, // 8004: BIT $2002
+    0x10, 0xfb,       // 8007: BPL $8004
+    0x2c, 0x02, 0x20, // 8009: BIT $2002
+    0x10, 0xfb,       // 800c: BPL $8009
+    0xa9, 0x80,       // 800e: LDA #$80
+    0x8d, 0x00, 0x20, // 8010: STA $2000
+    0xe6, 0x01,       // 8013: INC $01
+    0xd0, 0x02,       // 8015: BNE $8019
+    0xe6, 0x02,       // 8017: INC $02
+    0x4c, 0x13, 0x80, // 8019: JMP $8013
+    0xe6, 0x00,       // 801c: INC $00
+    0xa5, 0x01,       // 801e: LDA $01
+    0x85, 0x03,       // 8020: STA $03
+    0xad, 0x02, 0x20, // 8022: LDA $2002
+    0x40,             // 8025: RTI
+};
+constexpr uint16_t NMI_HANDLER = 0x801c;
+
+std::vector<uint8_t> make_image() {
+  return nrom_image(PROGRAM, sizeof(PROGRAM), NMI_HANDLER);
+}
+
+// MMC3 test ROM running from the fixed bank at 0xe000: turns the APU frame
+// IRQ off, sets the scanline IRQ to fire every 100 scanlines, turns rendering
+// on during the first vblank and spins with IRQs enabled. the IRQ handler
+// counts in $04 and re-arms
+const uint8_t MMC3_PROGRAM[] = {
+    0x78,             // e000: SEI
+    0xa2, 0xff,       // e001: LDX #$ff
+    0x9a,             // e003: TXS
+    0xa9, 0x40,       // e004: LDA #$40
+    0x8d, 0x17, 0x40, // e006: STA $4017 (no APU frame IRQ)
+    0x2c, 0x02, 0x20, // e009: BIT $2002
+    0x10, 0xfb,       // e00c: BPL $e009
+    0xa9, 0x63,       // e00e: LDA #99
+    0x8d, 0x00, 0xc0, // e010: STA $c000 (latch)
+    0x8d, 0x01, 0xc0, // e013: STA $c001 (reload)
+    0x8d, 0x01, 0xe0, // e016: STA $e001 (enable)
+    0xa9, 0x18,       // e019: LDA #$18
+    0x8d, 0x01, 0x20, // e01b: STA $2001
+    0x58,             // e01e: CLI
+    0x4c, 0x1f, 0xe0, // e01f: JMP $e01f
+    0xe6, 0x04,       // e022: INC $04
+    0x8d, 0x00, 0xe0, // e024: STA $e000 (acknowledge)
+    0x8d, 0x01, 0xe0, // e027: STA $e001 (enable)
+    0x40,             // e02a: RTI
+};
+constexpr uint16_t IRQ_HANDLER = 0xe022;
+
+std::vector<uint8_t> make_mmc3_image() {
+  std::vector<uint8_t> image(ines::HEADER_SIZE + 2 * ines::PRG_ROM_UNIT +
+                             ines::CHR_ROM_UNIT);
+  std::memcpy(image.data(), "NES\x1a", 4);
+  image[4] = 2;
+  image[5] = 1;
+  image[6] = 0x40;
+
+  uint8_t *prg = image.data() + ines::HEADER_SIZE;
+  std::memcpy(prg + 0x6000, MMC3_PROGRAM, sizeof(MMC3_PROGRAM));
+  prg[0x7ffc] = 0x00;
+  prg[0x7ffd] = 0xe0;
+  prg[0x7ffe] = IRQ_HANDLER & 0xff;
+  prg[0x7fff] = IRQ_HANDLER >> 8;
+  return image;
+}
+
+void run_frames(NES &nes, int frames) {
+  for (int frame = 0; frame < frames; ++frame) {
+    nes.run_frame();
+  }
+}
+
+// what a console shows and plays
+struct Output {
+  NES *nes;
+  std::vector<uint64_t> shown_frames;
+  uint32_t lines = 0;
+  size_t samples = 0;
+};
+
+void record_line(void *context, uint16_t y, const uint8_t *) {
+  auto *output = static_cast<Output *>(context);
+  output->lines++;
+  if (y == 0) {
+    output->shown_frames.push_back(output->nes->get_ppu().get_frame());
+  }
+}
+
+void record_samples(void *context, const int16_t *, size_t count) {
+  static_cast<Output *>(context)->samples += count;
+}
+
+void attach_output(NES &nes, Output &output) {
+  output.nes = &nes;
+  nes.get_ppu().set_scanline_handler(record_line, &output);
+  nes.get_apu().set_sample_handler(record_samples, &output);
+}
+
+void assert_same_console(NES &expected, NES &actual) {
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_cpu().get_cycles(),
+                            actual.get_cpu().get_cycles(), "cycles mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_ppu().get_dots(),
+                            actual.get_ppu().get_dots(), "dots mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_apu().get_samples(),
+                            actual.get_apu().get_samples(),
+                            "samples mismatch");
+  for (uint16_t addr = 0x00; addr < 0x800; ++addr) {
+    TEST_ASSERT_EQUAL_MESSAGE(expected.get_cpu().mem_read(addr),
+                              actual.get_cpu().mem_read(addr), "RAM mismatch");
+  }
+}
+} // namespace
+
+// -- timing
+void test_nes_frame_length() {
+  auto image = make_image();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  run_frames(nes, 10);
+
+  // rendering stays off, so every frame is 262 * 341 dots
+  uint64_t expected = (10 * PPU::LINES_PER_FRAME * PPU::DOTS_PER_LINE + 2) /
+                      PPU::DOTS_PER_CYCLE;
+  TEST_ASSERT_EQUAL_MESSAGE(10, nes.get_ppu().get_frame(), "frame mismatch");
+  TEST_ASSERT_GREATER_OR_EQUAL(expected, nes.get_cpu().get_cycles());
+  // at most an instruction and an NMI past the end of the frame
+  TEST_ASSERT_LESS_THAN(expected + 14, nes.get_cpu().get_cycles());
+}
+void test_nes_vblank_nmi() {
+  auto image = make_image();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  run_frames(nes, 10);
+
+  // frames 0 and 1 are spent polling for vblank
+  TEST_ASSERT_EQUAL_MESSAGE(8, nes.get_cpu().mem_read(0x00), "NMI count");
+  TEST_ASSERT_NOT_EQUAL(0, nes.get_cpu().mem_read(0x03));
+}
+
+// -- sync
+void test_nes_catch_up_matches_lockstep() {
+  auto image = make_image();
+  NES catch_up(RomImage::from_memory(image.data(), image.size()));
+  NES lockstep(RomImage::from_memory(image.data(), image.size()));
+  lockstep.set_sync(Sync::Lockstep);
+
+  for (int frame = 0; frame < 20; ++frame) {
+    catch_up.run_frame();
+    lockstep.run_frame();
+
+    TEST_ASSERT_EQUAL_MESSAGE(lockstep.get_cpu().get_cycles(),
+                              catch_up.get_cpu().get_cycles(),
+                              "cycles mismatch");
+    TEST_ASSERT_EQUAL_MESSAGE(lockstep.get_ppu().get_dots(),
+                              catch_up.get_ppu().get_dots(), "dots mismatch");
+    for (uint16_t addr = 0x00; addr < 0x04; ++addr) {
+      TEST_ASSERT_EQUAL_MESSAGE(lockstep.get_cpu().mem_read(addr),
+                                catch_up.get_cpu().mem_read(addr),
+                                "RAM mismatch");
+    }
+  }
+}
+
+// -- interrupts
+void test_nes_mmc3_irq() {
+  auto image = make_mmc3_image();
+  NES catch_up(RomImage::from_memory(image.data(), image.size()));
+  NES lockstep(RomImage::from_memory(image.data(), image.size()));
+  lockstep.set_sync(Sync::Lockstep);
+  run_frames(catch_up, 10);
+  run_frames(lockstep, 10);
+
+  // rendering starts in the first vblank, so the counter is clocked by the
+  // pre-render line of frame 0 and 241 lines of the 9 frames after it
+  TEST_ASSERT_EQUAL_MESSAGE(21, catch_up.get_cpu().mem_read(0x04),
+                            "IRQ count");
+  TEST_ASSERT_EQUAL_MESSAGE(lockstep.get_cpu().get_cycles(),
+                            catch_up.get_cpu().get_cycles(),
+                            "cycles mismatch");
+}
+
+// -- idle loops
+// the vblank wait of the first ROM, the JMP to itself between IRQs of the
+// second: skipping them leaves the console where running them does
+void test_nes_idle_skip_matches_running() {
+  auto images = {make_image(), make_mmc3_image()};
+  for (const auto &image : images) {
+    NES skipping(RomImage::from_memory(image.data(), image.size()));
+    NES running(RomImage::from_memory(image.data(), image.size()));
+    running.get_cpu().set_idle_skip(false);
+
+    uint64_t skipped = 0;
+    for (int frame = 0; frame < 10; ++frame) {
+      skipping.run_frame();
+      running.run_frame();
+      assert_same_console(running, skipping);
+      skipped += skipping.get_frame_idle_cycles();
+      TEST_ASSERT_EQUAL_MESSAGE(0, running.get_frame_idle_cycles(),
+                                "skipped with skipping off");
+    }
+    TEST_ASSERT_TRUE_MESSAGE(skipped > 10000, "idle loops run");
+  }
+}
+
+// -- run-ahead
+void test_nes_snapshot_round_trip() {
+  auto image = make_mmc3_image();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  NES reference(RomImage::from_memory(image.data(), image.size()));
+  run_frames(nes, 3);
+  run_frames(reference, 3);
+
+  NES::Snapshot snapshot;
+  nes.take_snapshot(snapshot);
+  run_frames(nes, 4);
+  nes.restore_snapshot(snapshot);
+  run_frames(nes, 5);
+  run_frames(reference, 5);
+  assert_same_console(reference, nes);
+}
+
+// memory mapped after the first snapshot is in the ones after it, bank
+// switches don't make the bus work out its pages again
+void test_bus_snapshot_layout() {
+  Bus bus;
+  Bus::Snapshot snapshot;
+  bus.take_snapshot(snapshot);
+  uint32_t layout = snapshot.layout;
+
+  std::vector<uint8_t> prg_rom(0x4000, 0xea);
+  bus.map_rom(0x8000, 0x4000, prg_rom.data());
+  bus.map_rom(0xc000, 0x4000, prg_rom.data());
+  bus.take_snapshot(snapshot);
+  TEST_ASSERT_EQUAL_MESSAGE(layout, snapshot.layout, "page list rebuilt");
+
+  std::vector<uint8_t> prg_ram(0x2000, 0);
+  bus.map_memory(0x6000, 0x2000, prg_ram.data());
+  bus.mem_write(0x6000, 1);
+  bus.take_snapshot(snapshot);
+  bus.mem_write(0x6000, 2);
+  bus.restore_snapshot(snapshot);
+  TEST_ASSERT_EQUAL_MESSAGE(1, bus.mem_read(0x6000), "PRG-RAM not restored");
+}
+
+// a second load doesn't move or clear the pages backed by the first
+void test_bus_load_program_regions() {
+  Bus bus;
+  bus.load_program({0xea, 0xea}, 0x8000);
+  bus.load_program({0x00, 0x80}, 0xfffc);
+  TEST_ASSERT_EQUAL_HEX8(0xea, bus.mem_read(0x8000));
+  TEST_ASSERT_EQUAL_HEX8(0xea, bus.mem_read(0x8001));
+  TEST_ASSERT_EQUAL_HEX8(0x00, bus.mem_read(0xfffc));
+  TEST_ASSERT_EQUAL_HEX8(0x80, bus.mem_read(0xfffd));
+
+  Bus copy(bus);
+  bus.mem_write(0x8000, 0x4c);
+  TEST_ASSERT_EQUAL_HEX8(0xea, copy.mem_read(0x8000));
+  TEST_ASSERT_EQUAL_HEX8(0x80, copy.mem_read(0xfffd));
+}
+
+// the frames run ahead leave no trace: the console is where it would be
+// without them and plays the same samples
+void test_nes_run_ahead_keeps_state() {
+  auto images = {make_image(), make_mmc3_image()};
+  for (const auto &image : images) {
+    NES plain(RomImage::from_memory(image.data(), image.size()));
+    NES ahead(RomImage::from_memory(image.data(), image.size()));
+    Output plain_output;
+    Output ahead_output;
+    attach_output(plain, plain_output);
+    attach_output(ahead, ahead_output);
+    ahead.set_run_ahead(2);
+
+    for (int frame = 0; frame < 12; ++frame) {
+      plain.run_frame();
+      ahead.run_frame();
+      assert_same_console(plain, ahead);
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(plain_output.samples, ahead_output.samples,
+                              "samples played mismatch");
+  }
+}
+
+// one frame shown per frame run, the one `frames` past the game's
+void test_nes_run_ahead_shows_later_frame() {
+  auto image = make_mmc3_image();
+  for (uint8_t frames = 0; frames <= 2; ++frames) {
+    NES nes(RomImage::from_memory(image.data(), image.size()));
+    Output output;
+    attach_output(nes, output);
+    nes.set_run_ahead(frames);
+    run_frames(nes, 5);
+
+    TEST_ASSERT_EQUAL_MESSAGE(5 * PPU::HEIGHT, output.lines, "lines shown");
+    for (uint64_t frame = 0; frame < 5; ++frame) {
+      TEST_ASSERT_EQUAL_MESSAGE(frame + frames, output.shown_frames[frame],
+                                "frame shown");
+    }
+  }
+}
+
+void run_nes_tests() {
+  // timing
+  RUN_TEST(test_nes_frame_length);
+  RUN_TEST(test_nes_vblank_nmi);
+
+  // sync
+  RUN_TEST(test_nes_catch_up_matches_lockstep);
+
+  // interrupts
+  RUN_TEST(test_nes_mmc3_irq);
+
+  // idle loops
+  RUN_TEST(test_nes_idle_skip_matches_running);
+
+  // run-ahead
+  RUN_TEST(test_nes_snapshot_round_trip);
+  RUN_TEST(test_bus_snapshot_layout);
+  RUN_TEST(test_bus_load_program_regions);
+  RUN_TEST(test_nes_run_ahead_keeps_state);
+  RUN_TEST(test_nes_run_ahead_shows_later_frame);
+}
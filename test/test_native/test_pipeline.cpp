@@ -0,0 +1,152 @@
+#include "../lib/nes/nes.hpp"
+#include "../lib/pipeline/pipeline.hpp"
+#include "../lib/pipeline/spsc_queue.hpp"
+#include "../lib/pipeline/worker.hpp"
+#include "nrom_image.hpp"
+#include <cstdint>
+#include <unity.h>
+#include <vector>
+
+// -- queue
+void test_spsc_full_and_empty() {
+  SpscQueue<int, 4> queue;
+  int value = 0;
+  TEST_ASSERT_FALSE(queue.try_pop(value));
+
+  for (int i = 0; i < 4; ++i) {
+    TEST_ASSERT_TRUE(queue.try_push(i));
+  }
+  TEST_ASSERT_FALSE_MESSAGE(queue.try_push(4), "pushed into a full queue");
+
+  // wraps around the end of the ring
+  for (int round = 0; round < 10; ++round) {
+    TEST_ASSERT_TRUE(queue.try_pop(value));
+    TEST_ASSERT_EQUAL_MESSAGE(round, value, "order mismatch");
+    TEST_ASSERT_TRUE(queue.try_push(round + 4));
+  }
+}
+void test_spsc_bulk() {
+  SpscQueue<int16_t, 8> queue;
+  int16_t in[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  TEST_ASSERT_EQUAL_MESSAGE(8, queue.push(in, 10), "bulk push count");
+
+  int16_t out[10] = {};
+  TEST_ASSERT_EQUAL_MESSAGE(8, queue.pop(out, 10), "bulk pop count");
+  TEST_ASSERT_EQUAL_MEMORY(in, out, 8 * sizeof(int16_t));
+}
+void test_spsc_two_threads() {
+  static SpscQueue<uint32_t, 64> queue;
+  static constexpr uint32_t COUNT = 200000;
+  static bool ordered;
+  ordered = true;
+
+  Worker consumer;
+  consumer.start(
+      "consumer",
+      [](void *) {
+        for (uint32_t expected = 0; expected < COUNT;) {
+          uint32_t value;
+          if (!queue.try_pop(value)) {
+            Worker::idle();
+            continue;
+          }
+          ordered &= value == expected++;
+        }
+      },
+      nullptr, 1);
+
+  for (uint32_t value = 0; value < COUNT;) {
+    if (queue.try_push(value)) {
+      value++;
+    } else {
+      Worker::idle();
+    }
+  }
+  consumer.join();
+  TEST_ASSERT_TRUE_MESSAGE(ordered, "values lost or reordered");
+}
+
+// -- pipeline
+namespace {
+// NROM image spinning in place with rendering off
+std::vector<uint8_t> make_image() {
+  const uint8_t loop[] = {0x4c, 0x00, 0x80}; // JMP $8000
+  return nrom_image(loop, sizeof(loop));
+}
+
+struct Received {
+  uint32_t lines = 0;
+  bool ordered = true;
+  uint32_t next_frame = 0;
+  uint16_t next_y = 0;
+};
+} // namespace
+
+void test_pipeline_delivers_every_line() {
+  auto image = make_image();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  Received received;
+
+  Pipeline pipeline(nes, Backpressure::Wait);
+  pipeline.set_line_sink(
+      [](void *context, const Scanline &line) {
+        auto *received = static_cast<Received *>(context);
+        received->ordered &= line.frame == received->next_frame &&
+                             line.y == received->next_y;
+        received->lines++;
+        if (++received->next_y == PPU::HEIGHT) {
+          received->next_y = 0;
+          received->next_frame++;
+        }
+      },
+      &received);
+  pipeline.start(5);
+  pipeline.join();
+
+  const auto &stats = pipeline.get_stats();
+  TEST_ASSERT_EQUAL_MESSAGE(5 * PPU::HEIGHT, received.lines, "line count");
+  TEST_ASSERT_TRUE_MESSAGE(received.ordered, "lines out of order");
+  TEST_ASSERT_EQUAL_MESSAGE(5, stats.frames_presented.load(), "presented");
+  TEST_ASSERT_EQUAL_MESSAGE(0, stats.frames_dropped.load(), "dropped");
+}
+void test_pipeline_drops_whole_frames() {
+  auto image = make_image();
+  NES nes(RomImage::from_memory(image.data(), image.size()));
+  static uint32_t partial;
+  static uint32_t lines;
+  partial = 0;
+  lines = 0;
+
+  // a display far slower than the emulation
+  Pipeline pipeline(nes, Backpressure::Drop);
+  pipeline.set_line_sink(
+      [](void *, const Scanline &line) {
+        partial += line.y != lines % PPU::HEIGHT;
+        lines++;
+        uint64_t until = Worker::now_us() + 50;
+        while (Worker::now_us() < until) {
+        }
+      },
+      nullptr);
+  pipeline.start(20);
+  pipeline.join();
+
+  const auto &stats = pipeline.get_stats();
+  TEST_ASSERT_EQUAL_MESSAGE(20, stats.frames_emulated.load(), "emulated");
+  TEST_ASSERT_GREATER_THAN(0, stats.frames_dropped.load());
+  TEST_ASSERT_EQUAL_MESSAGE(20, stats.frames_presented.load() +
+                                    stats.frames_dropped.load(),
+                            "frames lost");
+  TEST_ASSERT_EQUAL_MESSAGE(0, partial, "partial frame presented");
+}
+
+void run_pipeline_tests() {
+  // queue
+  RUN_TEST(test_spsc_full_and_empty);
+  RUN_TEST(test_spsc_bulk);
+  RUN_TEST(test_spsc_two_threads);
+
+  // pipeline
+  RUN_TEST(test_pipeline_delivers_every_line);
+  RUN_TEST(test_pipeline_drops_whole_frames);
+}
@@ -0,0 +1,267 @@
+#include "../lib/bus/bus.hpp"
+#include "../lib/cartridge/cartridge.hpp"
+#include "../lib/mapper/mapper.hpp"
+#include "../lib/ppu/ppu.hpp"
+#include <cstdint>
+#include <memory>
+#include <unity.h>
+#include <vector>
+
+namespace {
+const char *PIXEL_MISMATCH = "pixel mismatch";
+constexpr uint8_t SHOW_BACKGROUND =
+    ppu_mask::BACKGROUND | ppu_mask::BACKGROUND_LEFT;
+
+struct Console {
+  std::vector<uint8_t> image;
+  std::unique_ptr<Cartridge> cartridge;
+  std::unique_ptr<Mapper> mapper;
+  std::unique_ptr<PPU> ppu;
+  Bus bus;
+
+  // CHR-RAM unless `chr_units` is given, every CHR ROM bank filled with its
+  // index so tile rows of bank n decode to the bits of n
+  explicit Console(bool vertical, uint8_t mapper_number = 0,
+                   uint8_t chr_units = 0) {
+    image.assign(ines::HEADER_SIZE + ines::PRG_ROM_UNIT +
+                     chr_units * ines::CHR_ROM_UNIT,
+                 0);
+    image[0] = 'N';
+    image[1] = 'E';
+    image[2] = 'S';
+    image[3] = 0x1a;
+    image[4] = 1;
+    image[5] = chr_units;
+    image[6] = ((mapper_number & 0x0f) << 4) | vertical;
+
+    uint8_t *chr = image.data() + ines::HEADER_SIZE + ines::PRG_ROM_UNIT;
+    for (int bank = 0; bank < chr_units; ++bank) {
+      std::fill_n(chr + bank * ines::CHR_ROM_UNIT, ines::CHR_ROM_UNIT, bank);
+    }
+
+    cartridge = std::make_unique<Cartridge>(
+        RomImage::from_memory(image.data(), image.size()));
+    mapper = make_mapper(*cartridge);
+    mapper->attach(bus);
+    ppu = std::make_unique<PPU>(*mapper);
+    ppu->attach(bus);
+  }
+
+  void set_address(uint16_t addr) {
+    bus.mem_read(0x2002);
+    bus.mem_write(0x2006, addr >> 8);
+    bus.mem_write(0x2006, addr & 0xff);
+  }
+  void write_data(uint16_t addr, uint8_t data) {
+    set_address(addr);
+    bus.mem_write(0x2007, data);
+  }
+};
+} // namespace
+
+// -- registers
+void test_ppu_buffered_read() {
+  Console console(false);
+  console.write_data(0x2000, 0x11);
+  console.bus.mem_write(0x2007, 0x22);
+
+  console.set_address(0x2000);
+  console.bus.mem_read(0x2007); // primes the read buffer
+  TEST_ASSERT_EQUAL_MESSAGE(0x11, console.bus.mem_read(0x2007),
+                            "buffered read mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x22, console.bus.mem_read(0x2007),
+                            "buffered read mismatch");
+}
+void test_ppu_register_mirrors() {
+  Console console(false);
+  console.bus.mem_write(0x3ff0, 0x04); // ctrl: increment by 32
+  console.write_data(0x2000, 0x33);
+  console.bus.mem_write(0x2007, 0x44);
+
+  TEST_ASSERT_EQUAL_MESSAGE(0x44, console.ppu->mem_read(0x2020),
+                            "increment mismatch");
+}
+void test_ppu_status_clears_vblank() {
+  Console console(false);
+  console.ppu->render_frame();
+  TEST_ASSERT_BITS_HIGH(ppu_status::VBLANK, console.bus.mem_read(0x2002));
+  TEST_ASSERT_BITS_LOW(ppu_status::VBLANK, console.bus.mem_read(0x2002));
+}
+
+void test_ppu_nmi_enable_in_vblank() {
+  Console console(false);
+  Scheduler scheduler;
+  console.ppu->set_scheduler(scheduler);
+  console.ppu->render_frame();
+  TEST_ASSERT_TRUE(scheduler.get_cycle(event::NMI) == Scheduler::NEVER);
+
+  // NMI was off when vblank started, turning it on raises it right away
+  console.bus.mem_write(0x2000, ppu_ctrl::NMI_ENABLE);
+  TEST_ASSERT_TRUE(scheduler.get_cycle(event::NMI) != Scheduler::NEVER);
+  TEST_ASSERT_EQUAL_MESSAGE(scheduler.get_cycle(event::NMI),
+                            scheduler.get_deadline(), "deadline mismatch");
+}
+
+// -- memory
+void test_ppu_palette_mirrors() {
+  Console console(false);
+  console.write_data(0x3f10, 0x2a);
+  TEST_ASSERT_EQUAL_MESSAGE(0x2a, console.ppu->mem_read(0x3f00),
+                            "backdrop mirror mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(0x2a, console.ppu->mem_read(0x3f30),
+                            "palette mirror mismatch");
+}
+void test_ppu_nametable_mirroring() {
+  Console horizontal(false);
+  horizontal.ppu->mem_write(0x2005, 0x77);
+  TEST_ASSERT_EQUAL(0x77, horizontal.ppu->mem_read(0x2405));
+  TEST_ASSERT_NOT_EQUAL(0x77, horizontal.ppu->mem_read(0x2805));
+
+  Console vertical(true);
+  vertical.ppu->mem_write(0x2005, 0x77);
+  TEST_ASSERT_EQUAL(0x77, vertical.ppu->mem_read(0x2805));
+  TEST_ASSERT_NOT_EQUAL(0x77, vertical.ppu->mem_read(0x2405));
+}
+
+// -- rendering
+void test_ppu_renders_background() {
+  Console console(false);
+  PPU &ppu = *console.ppu;
+
+  // tile 1: left column color 1, right column color 3
+  for (uint8_t row = 0; row < 8; ++row) {
+    ppu.mem_write(0x0010 + row, 0x81);
+    ppu.mem_write(0x0018 + row, 0x01);
+  }
+  ppu.mem_write(0x2000, 1);
+  ppu.mem_write(0x23c0, 0b10); // top left quadrant uses palette 2
+  ppu.mem_write(0x3f00, 0x0f);
+  ppu.mem_write(0x3f09, 0x16);
+  ppu.mem_write(0x3f0b, 0x27);
+
+  console.bus.mem_write(0x2001, SHOW_BACKGROUND);
+  ppu.render_frame();
+
+  console.bus.mem_write(0x2001, SHOW_BACKGROUND);
+  console.set_address(0x0000); // scroll back to the top left
+  ppu.render_scanline(0);
+  TEST_ASSERT_EQUAL_MESSAGE(0x16, ppu.get_line()[0], PIXEL_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0x0f, ppu.get_line()[1], PIXEL_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0x27, ppu.get_line()[7], PIXEL_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0x0f, ppu.get_line()[8], PIXEL_MISMATCH);
+}
+void test_ppu_fine_scroll() {
+  Console console(false);
+  PPU &ppu = *console.ppu;
+
+  for (uint8_t row = 0; row < 8; ++row) {
+    ppu.mem_write(0x0010 + row, 0x80);
+  }
+  ppu.mem_write(0x2001, 1); // second tile of the row
+  ppu.mem_write(0x3f01, 0x30);
+
+  console.bus.mem_write(0x2001, SHOW_BACKGROUND);
+  console.set_address(0x0000);
+  console.bus.mem_write(0x2005, 3); // fine x only
+  console.bus.mem_write(0x2005, 0);
+  ppu.render_scanline(0);
+  TEST_ASSERT_EQUAL_MESSAGE(0x30, ppu.get_line()[5], PIXEL_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0x00, ppu.get_line()[8], PIXEL_MISMATCH);
+}
+void test_ppu_sprite_zero_hit() {
+  Console console(false);
+  PPU &ppu = *console.ppu;
+
+  // tile 1 is solid color 1
+  for (uint8_t row = 0; row < 8; ++row) {
+    ppu.mem_write(0x0010 + row, 0xff);
+  }
+  for (uint16_t addr = 0x2000; addr < 0x23c0; ++addr) {
+    ppu.mem_write(addr, 1);
+  }
+  ppu.mem_write(0x3f01, 0x11);
+  ppu.mem_write(0x3f11, 0x22);
+
+  uint8_t sprite[] = {9, 1, 0, 40};
+  console.bus.mem_write(0x2003, 0);
+  for (uint8_t byte : sprite) {
+    console.bus.mem_write(0x2004, byte);
+  }
+  for (int i = 4; i < 256; ++i) {
+    console.bus.mem_write(0x2004, 0xff); // off screen
+  }
+
+  std::vector<uint8_t> row_10;
+  console.ppu->set_scanline_handler(
+      [](void *context, uint16_t y, const uint8_t *pixels) {
+        if (y == 10) {
+          static_cast<std::vector<uint8_t> *>(context)->assign(
+              pixels, pixels + PPU::WIDTH);
+        }
+      },
+      &row_10);
+  console.bus.mem_write(0x2001, ppu_mask::BACKGROUND | ppu_mask::SPRITES);
+  ppu.render_frame();
+
+  TEST_ASSERT_BITS_HIGH(ppu_status::SPRITE_ZERO_HIT, ppu.get_status());
+  TEST_ASSERT_EQUAL_MESSAGE(0x22, row_10[40], PIXEL_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0x11, row_10[48], PIXEL_MISMATCH);
+}
+
+// -- tile cache
+void test_ppu_tile_cache_chr_ram() {
+  Console console(false);
+  PPU &ppu = *console.ppu;
+  ppu.mem_write(0x3f01, 0x30);
+  console.bus.mem_write(0x2001, SHOW_BACKGROUND);
+
+  ppu.render_frame();
+  uint64_t decoded = ppu.get_tiles_decoded();
+  ppu.render_frame();
+  TEST_ASSERT_EQUAL_MESSAGE(decoded, ppu.get_tiles_decoded(),
+                            "warm cache decoded tiles");
+
+  ppu.mem_write(0x0000, 0x80); // tile 0 in use everywhere
+  console.set_address(0x0000); // scroll back to the top left
+  ppu.render_scanline(0);
+  TEST_ASSERT_EQUAL_MESSAGE(decoded + 1, ppu.get_tiles_decoded(),
+                            "CHR-RAM write not invalidated");
+  TEST_ASSERT_EQUAL_MESSAGE(0x30, ppu.get_line()[0], PIXEL_MISMATCH);
+}
+void test_ppu_tile_cache_bank_switch() {
+  Console console(false, 3, 2); // CNROM, banks filled with 0 and 1
+  PPU &ppu = *console.ppu;
+  ppu.mem_write(0x3f00, 0x0f);
+  ppu.mem_write(0x3f03, 0x30);
+  console.bus.mem_write(0x2001, SHOW_BACKGROUND);
+
+  ppu.render_frame();
+  TEST_ASSERT_EQUAL_MESSAGE(0x0f, ppu.get_line()[0], PIXEL_MISMATCH);
+
+  console.bus.mem_write(0x8000, 1);
+  ppu.render_frame();
+  // both bitplanes 0x01: the rightmost pixel of every tile is color 3
+  TEST_ASSERT_EQUAL_MESSAGE(0x30, ppu.get_line()[7], PIXEL_MISMATCH);
+  TEST_ASSERT_EQUAL_MESSAGE(0x0f, ppu.get_line()[6], PIXEL_MISMATCH);
+}
+
+void run_ppu_tests() {
+  // registers
+  RUN_TEST(test_ppu_buffered_read);
+  RUN_TEST(test_ppu_register_mirrors);
+  RUN_TEST(test_ppu_status_clears_vblank);
+  RUN_TEST(test_ppu_nmi_enable_in_vblank);
+
+  // memory
+  RUN_TEST(test_ppu_palette_mirrors);
+  RUN_TEST(test_ppu_nametable_mirroring);
+
+  // rendering
+  RUN_TEST(test_ppu_renders_background);
+  RUN_TEST(test_ppu_fine_scroll);
+  RUN_TEST(test_ppu_sprite_zero_hit);
+
+  // tile cache
+  RUN_TEST(test_ppu_tile_cache_chr_ram);
+  RUN_TEST(test_ppu_tile_cache_bank_switch);
+}
@@ -0,0 +1,103 @@
+#include "../lib/scheduler/scheduler.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <unity.h>
+#include <vector>
+
+namespace {
+struct Log {
+  Scheduler *scheduler;
+  std::vector<uint8_t> order;
+  std::vector<uint64_t> cycles;
+};
+
+template <uint8_t Tag> void record(void *context, uint64_t cycle) {
+  auto *log = static_cast<Log *>(context);
+  log->order.push_back(Tag);
+  log->cycles.push_back(cycle);
+}
+} // namespace
+
+// -- deadlines
+void test_scheduler_deadline_tracks_earliest() {
+  Scheduler scheduler;
+  Log log{&scheduler, {}, {}};
+  uint8_t first = scheduler.add_event(record<1>, &log);
+  uint8_t second = scheduler.add_event(record<2>, &log);
+
+  TEST_ASSERT_TRUE(scheduler.get_deadline() == Scheduler::NEVER);
+  scheduler.schedule(first, 500);
+  scheduler.schedule(second, 200);
+  TEST_ASSERT_EQUAL_MESSAGE(200, scheduler.get_deadline(), "deadline mismatch");
+
+  // moving the earliest event later exposes the next one
+  scheduler.schedule(second, 900);
+  TEST_ASSERT_EQUAL_MESSAGE(500, scheduler.get_deadline(), "deadline mismatch");
+  scheduler.cancel(first);
+  TEST_ASSERT_EQUAL_MESSAGE(900, scheduler.get_deadline(), "deadline mismatch");
+}
+
+// -- dispatch
+void test_scheduler_runs_due_in_order() {
+  Scheduler scheduler;
+  Log log{&scheduler, {}, {}};
+  uint8_t device = scheduler.add_event(record<2>, &log);
+  scheduler.set_handler(event::NMI, record<0>, &log);
+  scheduler.set_handler(event::IRQ, record<1>, &log);
+
+  scheduler.schedule(device, 100);
+  scheduler.schedule(event::IRQ, 100);
+  scheduler.schedule(event::NMI, 150);
+  scheduler.run_due(99);
+  TEST_ASSERT_EQUAL_MESSAGE(0, log.order.size(), "ran early");
+
+  scheduler.run_due(120);
+  // ties go to the lower slot, handlers see the current cycle
+  TEST_ASSERT_EQUAL_MESSAGE(2, log.order.size(), "due events mismatch");
+  TEST_ASSERT_EQUAL(1, log.order[0]);
+  TEST_ASSERT_EQUAL(2, log.order[1]);
+  TEST_ASSERT_EQUAL(120, log.cycles[0]);
+  TEST_ASSERT_EQUAL_MESSAGE(150, scheduler.get_deadline(), "deadline mismatch");
+}
+void test_scheduler_handler_reschedules() {
+  Scheduler scheduler;
+  Log log{&scheduler, {}, {}};
+  static uint8_t id;
+  id = scheduler.add_event(
+      [](void *context, uint64_t cycle) {
+        auto *log = static_cast<Log *>(context);
+        log->cycles.push_back(cycle);
+        log->scheduler->schedule(id, cycle + 10);
+      },
+      &log);
+
+  scheduler.schedule(id, 0);
+  scheduler.run_due(5);
+  TEST_ASSERT_EQUAL_MESSAGE(1, log.cycles.size(), "reran too early");
+  TEST_ASSERT_EQUAL_MESSAGE(15, scheduler.get_deadline(), "deadline mismatch");
+}
+void test_scheduler_full() {
+  Scheduler scheduler;
+  Log log{&scheduler, {}, {}};
+  int added = 0;
+  try {
+    while (added < Scheduler::MAX_EVENTS) {
+      scheduler.add_event(record<0>, &log);
+      added++;
+    }
+  } catch (const std::runtime_error &) {
+  }
+  // NMI and IRQ keep the first two slots
+  TEST_ASSERT_EQUAL_MESSAGE(Scheduler::MAX_EVENTS - 2, added,
+                            "slot count mismatch");
+}
+
+void run_scheduler_tests() {
+  // deadlines
+  RUN_TEST(test_scheduler_deadline_tracks_earliest);
+
+  // dispatch
+  RUN_TEST(test_scheduler_runs_due_in_order);
+  RUN_TEST(test_scheduler_handler_reschedules);
+  RUN_TEST(test_scheduler_full);
+}
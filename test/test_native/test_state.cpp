@@ -0,0 +1,316 @@
+#include "../lib/cpu/cpu.hpp"
+#include "../lib/state/rewind.hpp"
+#include "../lib/state/state.hpp"
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <unity.h>
+#include <vector>
+
+namespace {
+// fills $0200..$02ff with X, X+1... forever
+const std::vector<uint8_t> FILL_PROGRAM = {
+    0x8a,             // TXA
+    0x9d, 0x00, 0x02, // STA $0200,X
+    0xe8,             // INX
+    0x4c, 0x00, 0x80, // JMP $8000
+};
+
+// header, CPU section, BUS section with its page count
+constexpr size_t EMPTY_STATE_SIZE = 12 + (8 + 15) + (8 + 2);
+constexpr size_t SAVED_PAGE_SIZE = 1 + Bus::PAGE_SIZE;
+
+void assert_same_state(CPU &expected, CPU &actual) {
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_pc(), actual.get_pc(), "pc mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_reg_x(), actual.get_reg_x(),
+                            "register X mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_status(), actual.get_status(),
+                            "status mismatch");
+  TEST_ASSERT_EQUAL_MESSAGE(expected.get_cycles(), actual.get_cycles(),
+                            "cycles mismatch");
+  for (uint32_t addr = 0; addr < 0x800; ++addr) {
+    TEST_ASSERT_EQUAL_MESSAGE(expected.mem_read(addr), actual.mem_read(addr),
+                              "memory mismatch");
+  }
+}
+
+// 4 KiB that change in a few places from one frame to the next
+std::vector<std::vector<uint8_t>> make_frames(uint32_t count) {
+  std::mt19937 random(17);
+  std::vector<uint8_t> frame(4096, 0);
+  std::vector<std::vector<uint8_t>> frames;
+  for (uint32_t i = 0; i < count; ++i) {
+    for (int change = 0; change < 16; ++change) {
+      frame[random() % frame.size()] = random();
+    }
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+bool load_fails(CPU &cpu, const std::vector<uint8_t> &data) {
+  try {
+    cpu.load_state(data);
+  } catch (const std::runtime_error &) {
+    return true;
+  }
+  return false;
+}
+} // namespace
+
+// -- full states
+void test_state_round_trip() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  cpu.run(100);
+  CPU saved = cpu;
+  auto data = cpu.save_state(state::Kind::Full);
+
+  cpu.run(333);
+  cpu.load_state(data);
+  assert_same_state(saved, cpu);
+}
+
+// RAM is saved once, not once per mirror
+void test_state_full_size() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  auto data = cpu.save_state(state::Kind::Full);
+  // 8 pages of RAM, 1 page of memory under the program
+  TEST_ASSERT_EQUAL_MESSAGE(EMPTY_STATE_SIZE + 9 * SAVED_PAGE_SIZE,
+                            data.size(), "state size mismatch");
+}
+
+// -- deltas
+void test_state_delta_holds_written_pages() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  cpu.save_state(state::Kind::Full);
+  auto empty = cpu.save_state(state::Kind::Delta);
+  TEST_ASSERT_EQUAL_MESSAGE(EMPTY_STATE_SIZE, empty.size(),
+                            "state size mismatch");
+
+  // through a mirror of page 2, and page 2 itself
+  cpu.get_bus().mem_write(0x1a05, 0x55);
+  cpu.run(50);
+  auto delta = cpu.save_state(state::Kind::Delta);
+  TEST_ASSERT_EQUAL_MESSAGE(EMPTY_STATE_SIZE + SAVED_PAGE_SIZE, delta.size(),
+                            "state size mismatch");
+}
+
+void test_state_delta_chain() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  auto full = cpu.save_state(state::Kind::Full);
+  std::vector<std::vector<uint8_t>> deltas;
+  for (int i = 0; i < 4; ++i) {
+    cpu.run(77);
+    cpu.get_bus().mem_write(0x0010 + i * 0x100, i);
+    deltas.push_back(cpu.save_state(state::Kind::Delta));
+  }
+
+  CPU restored = cpu;
+  restored.run(1000);
+  restored.get_bus().mem_write(0x0700, 1);
+  restored.load_state(full);
+  for (const auto &delta : deltas) {
+    restored.load_state(delta);
+  }
+  assert_same_state(cpu, restored);
+}
+
+void test_state_delta_out_of_order() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  auto full = cpu.save_state(state::Kind::Full);
+  auto first = cpu.save_state(state::Kind::Delta);
+  auto second = cpu.save_state(state::Kind::Delta);
+
+  cpu.load_state(full);
+  TEST_ASSERT_TRUE_MESSAGE(load_fails(cpu, second), "delta out of order");
+  cpu.load_state(first);
+  cpu.load_state(second);
+}
+
+// snapshots leave the deltas alone: the pages they restore count as written
+void test_state_snapshot_keeps_delta_chain() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  auto full = cpu.save_state(state::Kind::Full);
+  cpu.run(40);
+  auto snapshot = cpu.save_state(state::Kind::Snapshot);
+  cpu.run(400);
+  cpu.load_state(snapshot);
+  auto delta = cpu.save_state(state::Kind::Delta);
+
+  CPU restored = cpu;
+  restored.run(1000);
+  restored.load_state(full);
+  restored.load_state(delta);
+  assert_same_state(cpu, restored);
+}
+
+// -- format
+void test_state_rejects_bad_data() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  auto data = cpu.save_state(state::Kind::Full);
+
+  auto bad_magic = data;
+  bad_magic[0] = 'X';
+  TEST_ASSERT_TRUE_MESSAGE(load_fails(cpu, bad_magic), "bad magic accepted");
+
+  auto truncated = data;
+  truncated.pop_back();
+  TEST_ASSERT_TRUE_MESSAGE(load_fails(cpu, truncated),
+                           "truncated state accepted");
+}
+
+void test_state_skips_unknown_sections() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  cpu.run(10);
+  CPU saved = cpu;
+
+  StateWriter writer(state::Kind::Full, 1);
+  writer.begin_section(state::tag("XTRA"));
+  writer.write_u32(0xdeadbeef);
+  writer.end_section();
+  cpu.save_state(writer);
+
+  cpu.run(10);
+  cpu.load_state(writer.data());
+  assert_same_state(saved, cpu);
+}
+
+// -- code caches
+// restoring memory that holds code drops what was decoded out of it
+void test_state_restores_code() {
+  CPU cpu;
+  cpu.load_program({0xa9, 0x01, // LDA #$01
+                    0x4c, 0x00, 0x03},
+                   0x0300);
+#if NES_JIT
+  cpu.set_jit(true);
+#elif NES_BLOCK_CACHE
+  cpu.set_block_cache(true);
+#endif
+  cpu.get_bus().mem_write(0x0301, 0x02);
+  auto data = cpu.save_state(state::Kind::Full);
+  cpu.get_bus().mem_write(0x0301, 0x03);
+
+  cpu.run(10);
+  TEST_ASSERT_EQUAL_MESSAGE(0x03, cpu.get_reg_a(), "register A mismatch");
+  cpu.load_state(data);
+  cpu.run(10);
+  TEST_ASSERT_EQUAL_MESSAGE(0x02, cpu.get_reg_a(), "register A mismatch");
+}
+
+#if NES_JIT
+// generated stores mark their page like Bus::mem_write does
+void test_state_jit_marks_pages() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  cpu.set_jit(true);
+  cpu.save_state(state::Kind::Full);
+  cpu.run(100);
+  TEST_ASSERT_EQUAL_MESSAGE(0, cpu.get_jit_stats().interpreted,
+                            "stores went through the interpreter");
+
+  auto delta = cpu.save_state(state::Kind::Delta);
+  TEST_ASSERT_EQUAL_MESSAGE(EMPTY_STATE_SIZE + SAVED_PAGE_SIZE, delta.size(),
+                            "state size mismatch");
+}
+#endif
+
+// -- rewind
+void test_rewind_pops_in_reverse() {
+  auto frames = make_frames(100);
+  Rewind rewind(1 << 20, 10, 7);
+  for (const auto &frame : frames) {
+    rewind.push(frame);
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(100, rewind.frames(), "frame count mismatch");
+  TEST_ASSERT_TRUE_MESSAGE(rewind.stats.compression() > 10,
+                           "deltas not compressed");
+
+  std::vector<uint8_t> snapshot;
+  for (size_t i = frames.size(); i-- > 0;) {
+    TEST_ASSERT_TRUE(rewind.rewind(snapshot));
+    TEST_ASSERT_TRUE_MESSAGE(frames[i] == snapshot, "snapshot mismatch");
+    TEST_ASSERT_TRUE_MESSAGE(rewind.stats.last_step_decoded <= 7,
+                             "keyframes don't bound the step");
+  }
+  TEST_ASSERT_FALSE(rewind.rewind(snapshot));
+}
+
+// the oldest snapshots make room, a keyframe and its deltas at a time
+void test_rewind_budget() {
+  auto frames = make_frames(300);
+  constexpr size_t BUDGET = 16 << 10;
+  Rewind rewind(BUDGET, 4, 10);
+  for (uint32_t i = 0; i < frames.size(); ++i) {
+    rewind.push(frames[i]);
+    TEST_ASSERT_TRUE_MESSAGE(rewind.bytes_used() <= BUDGET, "over budget");
+    TEST_ASSERT_TRUE_MESSAGE(rewind.frames() <= 4 * 60, "over length");
+  }
+  TEST_ASSERT_TRUE_MESSAGE(rewind.stats.evicted > 0, "nothing evicted");
+
+  // what is left decodes, back to a keyframe
+  std::vector<uint8_t> snapshot;
+  uint32_t left = rewind.frames();
+  for (uint32_t i = 0; i < left; ++i) {
+    TEST_ASSERT_TRUE(rewind.rewind(snapshot));
+    TEST_ASSERT_TRUE_MESSAGE(frames[frames.size() - 1 - i] == snapshot,
+                             "snapshot mismatch");
+  }
+
+  // and pushing starts over with a keyframe
+  rewind.push(frames[0]);
+  TEST_ASSERT_TRUE(rewind.rewind(snapshot));
+  TEST_ASSERT_TRUE_MESSAGE(frames[0] == snapshot, "snapshot mismatch");
+}
+
+void test_rewind_cpu() {
+  CPU cpu;
+  cpu.load_program(FILL_PROGRAM);
+  Rewind rewind(64 << 10, 1);
+  std::vector<CPU> saved;
+  for (int frame = 0; frame < 20; ++frame) {
+    saved.push_back(cpu);
+    rewind.push(cpu);
+    cpu.run(300);
+  }
+
+  for (int frame = 19; frame >= 0; --frame) {
+    TEST_ASSERT_TRUE(rewind.rewind(cpu));
+    assert_same_state(saved[frame], cpu);
+  }
+}
+
+void run_state_tests() {
+  // full states
+  RUN_TEST(test_state_round_trip);
+  RUN_TEST(test_state_full_size);
+
+  // deltas
+  RUN_TEST(test_state_delta_holds_written_pages);
+  RUN_TEST(test_state_delta_chain);
+  RUN_TEST(test_state_delta_out_of_order);
+  RUN_TEST(test_state_snapshot_keeps_delta_chain);
+
+  // format
+  RUN_TEST(test_state_rejects_bad_data);
+  RUN_TEST(test_state_skips_unknown_sections);
+
+  // code caches
+  RUN_TEST(test_state_restores_code);
+#if NES_JIT
+  RUN_TEST(test_state_jit_marks_pages);
+#endif
+
+  // rewind
+  RUN_TEST(test_rewind_pops_in_reverse);
+  RUN_TEST(test_rewind_budget);
+  RUN_TEST(test_rewind_cpu);
+}